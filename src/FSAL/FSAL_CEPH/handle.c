@@ -184,6 +184,148 @@ static fsal_status_t fsal_readdir(struct fsal_obj_handle *dir_pub,
 	return fsal_status;
 }
 
+/**
+ * @brief Build the handle of an entry read by ceph_readdirplus_r
+ *
+ * ceph_readdirplus_r() links the inodes of the entries in the client
+ * cache as it reads their names, so the inode is taken from there by
+ * its number.  The entry is looked up when it is not there.
+ *
+ * @param[in]  dir_pub The directory
+ * @param[in]  name    Name of the entry
+ * @param[in]  st      Attributes of the entry
+ * @param[in]  stmask  Valid attributes
+ * @param[out] obj_pub The handle
+ *
+ * @return FSAL status.
+ */
+
+static fsal_status_t readdir_plus_handle(struct fsal_obj_handle *dir_pub,
+					 const char *name, struct stat *st,
+					 int stmask,
+					 struct fsal_obj_handle **obj_pub)
+{
+	/* Generic status return */
+	int rc = 0;
+	/* The private 'full' export */
+	struct export *export =
+	    container_of(op_ctx->fsal_export, struct export, export);
+	struct handle *obj = NULL;
+	struct Inode *i = NULL;
+	vinodeno_t vi;
+
+	if ((stmask & CEPH_STAT_CAP_INODE_ALL) != CEPH_STAT_CAP_INODE_ALL)
+		return lookup(dir_pub, name, obj_pub);
+
+	memset(&vi, 0, sizeof(vi));
+	vi.ino.val = st->st_ino;
+#ifdef CEPH_NOSNAP
+	vi.snapid.val = st->st_dev;
+#endif /* CEPH_NOSNAP */
+
+	i = ceph_ll_get_inode(export->cmount, vi);
+	if (i == NULL)
+		return lookup(dir_pub, name, obj_pub);
+
+	rc = construct_handle(st, i, export, &obj);
+
+	if (rc < 0) {
+		ceph_ll_put(export->cmount, i);
+		return ceph2fsal_error(rc);
+	}
+
+	*obj_pub = &obj->handle;
+
+	return fsalstat(0, 0);
+}
+
+/**
+ * @brief Read a directory with the objects of its entries
+ *
+ * The handles are built from the attributes and the inodes
+ * ceph_readdirplus_r() brings into the client cache, see
+ * readdir_plus_handle.
+ *
+ * @param[in]  dir_pub     The directory to read
+ * @param[in]  whence      The cookie indicating resumption, NULL to start
+ * @param[in]  dir_state   Opaque, passed to cb
+ * @param[in]  cb          Callback that receives directory entries
+ * @param[out] eof         True if there are no more entries
+ *
+ * @return FSAL status.
+ */
+
+static fsal_status_t fsal_readdir_plus(struct fsal_obj_handle *dir_pub,
+				       fsal_cookie_t *whence,
+				       void *dir_state,
+				       fsal_readdir_plus_cb cb, bool *eof)
+{
+	/* Generic status return */
+	int rc = 0;
+	/* The private 'full' export */
+	struct export *export =
+	    container_of(op_ctx->fsal_export, struct export, export);
+	/* The private 'full' directory handle */
+	struct handle *dir = container_of(dir_pub, struct handle, handle);
+	/* The director descriptor */
+	struct ceph_dir_result *dir_desc = NULL;
+	/* Cookie marking the start of the readdir */
+	uint64_t start = 0;
+	/* Return status */
+	fsal_status_t fsal_status = { ERR_FSAL_NO_ERROR, 0 };
+
+	rc = ceph_ll_opendir(export->cmount, dir->i, &dir_desc, 0, 0);
+	if (rc < 0)
+		return ceph2fsal_error(rc);
+
+	if (whence != NULL)
+		start = *whence;
+
+	ceph_seekdir(export->cmount, dir_desc, start);
+
+	while (!(*eof)) {
+		struct stat st;
+		struct dirent de;
+		int stmask = 0;
+		struct fsal_obj_handle *obj = NULL;
+		fsal_status_t obj_status;
+
+		rc = ceph_readdirplus_r(export->cmount, dir_desc, &de, &st,
+					&stmask);
+		if (rc < 0) {
+			fsal_status = ceph2fsal_error(rc);
+			goto closedir;
+		} else if (rc == 1) {
+			/* skip . and .. */
+			if ((strcmp(de.d_name, ".") == 0)
+			    || (strcmp(de.d_name, "..") == 0)) {
+				continue;
+			}
+
+			obj_status = readdir_plus_handle(dir_pub, de.d_name,
+							 &st, stmask, &obj);
+			if (!cb(de.d_name, obj, obj_status, dir_state,
+				de.d_off))
+				goto closedir;
+
+		} else if (rc == 0) {
+			*eof = true;
+		} else {
+			/* Can't happen */
+			abort();
+		}
+	}
+
+ closedir:
+
+	rc = ceph_ll_releasedir(export->cmount, dir_desc);
+
+	if (rc < 0)
+		fsal_status = ceph2fsal_error(rc);
+
+	return fsal_status;
+}
+
 /**
  * @brief Create a regular file
  *
@@ -939,6 +1081,7 @@ void handle_ops_init(struct fsal_obj_ops *ops)
 	ops->create = fsal_create;
 	ops->mkdir = fsal_mkdir;
 	ops->readdir = fsal_readdir;
+	ops->readdir_plus = fsal_readdir_plus;
 	ops->symlink = fsal_symlink;
 	ops->readlink = fsal_readlink;
 	ops->getattrs = getattrs;
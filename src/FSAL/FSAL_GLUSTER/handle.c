@@ -83,15 +83,49 @@ static void handle_release(struct fsal_obj_handle *obj_hdl)
  * @brief Implements GLUSTER FSAL objectoperation lookup
  */
 
+/**
+ * @brief Build the FSAL handle of a gfapi object
+ *
+ * @param[in]  glfs_export The export
+ * @param[in]  glhandle    The object, owned by the FSAL handle on
+ *                         success and left to the caller on failure
+ * @param[in]  sb          Attributes of the object
+ * @param[out] objhandle   The FSAL handle
+ *
+ * @return FSAL status.
+ */
+
+static fsal_status_t make_handle(struct glusterfs_export *glfs_export,
+				 struct glfs_object *glhandle,
+				 struct stat *sb,
+				 struct glusterfs_handle **objhandle)
+{
+	int rc = 0;
+	unsigned char globjhdl[GFAPI_HANDLE_LENGTH] = {'\0'};
+	char vol_uuid[GLAPI_UUID_LENGTH] = {'\0'};
+
+	rc = glfs_h_extract_handle(glhandle, globjhdl, GFAPI_HANDLE_LENGTH);
+	if (rc < 0)
+		return gluster2fsal_error(errno);
+
+	rc = glfs_get_volumeid(glfs_export->gl_fs, vol_uuid, GLAPI_UUID_LENGTH);
+	if (rc < 0)
+		return gluster2fsal_error(rc);
+
+	rc = construct_handle(glfs_export, sb, glhandle, globjhdl,
+			      GLAPI_HANDLE_LENGTH, objhandle, vol_uuid);
+	if (rc != 0)
+		return gluster2fsal_error(rc);
+
+	return fsalstat(ERR_FSAL_NO_ERROR, 0);
+}
+
 static fsal_status_t lookup(struct fsal_obj_handle *parent,
 			    const char *path, struct fsal_obj_handle **handle)
 {
-	int rc = 0;
 	fsal_status_t status = { ERR_FSAL_NO_ERROR, 0 };
 	struct stat sb;
 	struct glfs_object *glhandle = NULL;
-	unsigned char globjhdl[GFAPI_HANDLE_LENGTH] = {'\0'};
-	char vol_uuid[GLAPI_UUID_LENGTH] = {'\0'};
 	struct glusterfs_handle *objhandle = NULL;
 	struct glusterfs_export *glfs_export =
 	    container_of(op_ctx->fsal_export, struct glusterfs_export, export);
@@ -111,24 +145,9 @@ static fsal_status_t lookup(struct fsal_obj_handle *parent,
 		goto out;
 	}
 
-	rc = glfs_h_extract_handle(glhandle, globjhdl, GFAPI_HANDLE_LENGTH);
-	if (rc < 0) {
-		status = gluster2fsal_error(errno);
-		goto out;
-	}
-
-	rc = glfs_get_volumeid(glfs_export->gl_fs, vol_uuid, GLAPI_UUID_LENGTH);
-	if (rc < 0) {
-		status = gluster2fsal_error(rc);
-		goto out;
-	}
-
-	rc = construct_handle(glfs_export, &sb, glhandle, globjhdl,
-			      GLAPI_HANDLE_LENGTH, &objhandle, vol_uuid);
-	if (rc != 0) {
-		status = gluster2fsal_error(rc);
+	status = make_handle(glfs_export, glhandle, &sb, &objhandle);
+	if (FSAL_IS_ERROR(status))
 		goto out;
-	}
 
 	*handle = &objhandle->handle;
 
@@ -206,6 +225,154 @@ static fsal_status_t read_dirents(struct fsal_obj_handle *dir_hdl,
 	return status;
 }
 
+#ifdef USE_GLUSTER_XREADDIRPLUS
+/**
+ * @brief Build the FSAL handle of an entry read by glfs_xreaddirplus_r
+ *
+ * @param[in]  dir_hdl The directory
+ * @param[in]  name    Name of the entry
+ * @param[in]  xstat   What glfs_xreaddirplus_r returned for it
+ * @param[out] obj     The FSAL handle
+ *
+ * @return FSAL status.
+ */
+
+static fsal_status_t xreaddirplus_handle(struct fsal_obj_handle *dir_hdl,
+					 const char *name,
+					 struct glfs_xreaddirp_stat *xstat,
+					 struct fsal_obj_handle **obj)
+{
+	fsal_status_t status;
+	struct stat *sb = NULL;
+	struct glfs_object *glhandle = NULL;
+	struct glusterfs_handle *objhandle = NULL;
+	struct glusterfs_export *glfs_export =
+	    container_of(op_ctx->fsal_export, struct glusterfs_export, export);
+
+	if (xstat != NULL) {
+		sb = glfs_xreaddirplus_get_stat(xstat);
+		glhandle = glfs_xreaddirplus_get_object(xstat);
+	}
+
+	/* The object belongs to xstat */
+	if (sb != NULL && glhandle != NULL)
+		glhandle = glfs_object_copy(glhandle);
+	else
+		glhandle = NULL;
+
+	if (glhandle == NULL) {
+		/* Not linked in the inode table, look it up */
+		return lookup(dir_hdl, name, obj);
+	}
+
+	status = make_handle(glfs_export, glhandle, sb, &objhandle);
+	if (FSAL_IS_ERROR(status)) {
+		gluster_cleanup_vars(glhandle);
+		return status;
+	}
+
+	*obj = &objhandle->handle;
+	return status;
+}
+#endif
+
+/**
+ * @brief Implements GLUSTER FSAL objectoperation readdir_plus
+ *
+ * The entries come with their attributes and gfapi objects, from
+ * which the handles are built.  Entries without an object, and all
+ * of them with a gfapi lacking glfs_xreaddirplus_r(), are looked up.
+ */
+
+static fsal_status_t read_dirents_plus(struct fsal_obj_handle *dir_hdl,
+				       fsal_cookie_t *whence,
+				       void *dir_state,
+				       fsal_readdir_plus_cb cb, bool *eof)
+{
+	int rc = 0;
+	fsal_status_t status = { ERR_FSAL_NO_ERROR, 0 };
+	fsal_status_t obj_status;
+	struct fsal_obj_handle *obj;
+	struct glfs_fd *glfd = NULL;
+	long offset = 0;
+	struct dirent *pde = NULL;
+	struct glusterfs_export *glfs_export =
+	    container_of(op_ctx->fsal_export, struct glusterfs_export, export);
+	struct glusterfs_handle *objhandle =
+	    container_of(dir_hdl, struct glusterfs_handle, handle);
+#ifdef GLTIMING
+	struct timespec s_time, e_time;
+
+	now(&s_time);
+#endif
+
+	glfd = glfs_h_opendir(glfs_export->gl_fs, objhandle->glhandle);
+	if (glfd == NULL)
+		return gluster2fsal_error(errno);
+
+	if (whence != NULL)
+		offset = *whence;
+
+	glfs_seekdir(glfd, offset);
+
+	while (!(*eof)) {
+		struct dirent de;
+		bool more = true;
+#ifdef USE_GLUSTER_XREADDIRPLUS
+		struct glfs_xreaddirp_stat *xstat = NULL;
+
+		/* Returns what it filled in xstat, 0 at the end */
+		rc = glfs_xreaddirplus_r(glfd,
+					 GFAPI_XREADDIRP_STAT |
+					 GFAPI_XREADDIRP_HANDLE,
+					 &xstat, &de, &pde);
+		if (rc > 0)
+			rc = 0;
+#else
+		struct stat sb;
+
+		rc = glfs_readdirplus_r(glfd, &sb, &de, &pde);
+#endif
+		if (rc != 0) {
+			status = gluster2fsal_error(errno);
+			goto out;
+		}
+
+		if (pde == NULL) {
+			*eof = true;
+		} else if ((strcmp(de.d_name, ".") != 0)
+			   && (strcmp(de.d_name, "..") != 0)) {
+			/* skip . and .. */
+			obj = NULL;
+#ifdef USE_GLUSTER_XREADDIRPLUS
+			obj_status = xreaddirplus_handle(dir_hdl, de.d_name,
+							 xstat, &obj);
+#else
+			obj_status = lookup(dir_hdl, de.d_name, &obj);
+#endif
+			more = cb(de.d_name, obj, obj_status, dir_state,
+				  glfs_telldir(glfd));
+		}
+
+#ifdef USE_GLUSTER_XREADDIRPLUS
+		if (xstat != NULL)
+			glfs_free(xstat);
+#endif
+		if (!more)
+			goto out;
+	}
+
+ out:
+	rc = glfs_closedir(glfd);
+	if (rc < 0)
+		status = gluster2fsal_error(errno);
+#ifdef GLTIMING
+	now(&e_time);
+	latency_update(&s_time, &e_time, lat_read_dirents);
+#endif
+	return status;
+}
+
 /**
  * @brief Implements GLUSTER FSAL objectoperation create
  */
@@ -1137,6 +1304,111 @@ static fsal_status_t file_write(struct fsal_obj_handle *obj_hdl,
 	return status;
 }
 
+/* Ranges moved by one glfs_preadv/glfs_pwritev at most */
+#define GLUSTER_IO_VEC_MAX 64
+
+/**
+ * @brief Implements GLUSTER FSAL objectoperation read_vec
+ *
+ * Contiguous ranges are read with a single glfs_preadv.
+ */
+
+static fsal_status_t file_read_vec(struct fsal_obj_handle *obj_hdl,
+				   struct fsal_io_range *ranges,
+				   uint32_t count, bool *end_of_file)
+{
+	int rc = 0;
+	fsal_status_t status = { ERR_FSAL_NO_ERROR, 0 };
+	struct glusterfs_handle *objhandle =
+	    container_of(obj_hdl, struct glusterfs_handle, handle);
+	struct iovec iov[GLUSTER_IO_VEC_MAX];
+	uint32_t i, n;
+#ifdef GLTIMING
+	struct timespec s_time, e_time;
+
+	now(&s_time);
+#endif
+
+	*end_of_file = false;
+
+	for (i = 0; i < count; i++)
+		ranges[i].done = 0;
+
+	for (i = 0; i < count; i += n) {
+		n = fsal_io_range_run(&ranges[i], count - i, iov,
+				      GLUSTER_IO_VEC_MAX);
+
+		rc = glfs_preadv(objhandle->glfd, iov, n, ranges[i].offset, 0);
+		if (rc < 0) {
+			status = gluster2fsal_error(errno);
+			goto out;
+		}
+
+		if (!fsal_io_range_done(&ranges[i], n, rc)) {
+			*end_of_file = true;
+			goto out;
+		}
+	}
+
+ out:
+#ifdef GLTIMING
+	now(&e_time);
+	latency_update(&s_time, &e_time, lat_file_read);
+#endif
+	return status;
+}
+
+/**
+ * @brief Implements GLUSTER FSAL objectoperation write_vec
+ *
+ * Contiguous ranges are written with a single glfs_pwritev.
+ */
+
+static fsal_status_t file_write_vec(struct fsal_obj_handle *obj_hdl,
+				    struct fsal_io_range *ranges,
+				    uint32_t count, bool *fsal_stable)
+{
+	int rc = 0;
+	fsal_status_t status = { ERR_FSAL_NO_ERROR, 0 };
+	struct glusterfs_handle *objhandle =
+	    container_of(obj_hdl, struct glusterfs_handle, handle);
+	struct iovec iov[GLUSTER_IO_VEC_MAX];
+	uint32_t i, n;
+#ifdef GLTIMING
+	struct timespec s_time, e_time;
+
+	now(&s_time);
+#endif
+
+	for (i = 0; i < count; i++)
+		ranges[i].done = 0;
+
+	for (i = 0; i < count; i += n) {
+		n = fsal_io_range_run(&ranges[i], count - i, iov,
+				      GLUSTER_IO_VEC_MAX);
+
+		rc = glfs_pwritev(objhandle->glfd, iov, n, ranges[i].offset,
+				  ((*fsal_stable) ? O_SYNC : 0));
+		if (rc < 0) {
+			status = gluster2fsal_error(errno);
+			goto out;
+		}
+
+		if (!fsal_io_range_done(&ranges[i], n, rc))
+			break;
+	}
+
+	if (objhandle->openflags & FSAL_O_SYNC)
+		*fsal_stable = true;
+
+ out:
+#ifdef GLTIMING
+	now(&e_time);
+	latency_update(&s_time, &e_time, lat_file_write);
+#endif
+	return status;
+}
+
 /**
  * @brief Implements GLUSTER FSAL objectoperation commit
  *
@@ -1552,6 +1824,7 @@ void handle_ops_init(struct fsal_obj_ops *ops)
 	ops->mkdir = makedir;
 	ops->mknode = makenode;
 	ops->readdir = read_dirents;
+	ops->readdir_plus = read_dirents_plus;
 	ops->symlink = makesymlink;
 	ops->readlink = readsymlink;
 	ops->getattrs = getattrs;
@@ -1563,6 +1836,8 @@ void handle_ops_init(struct fsal_obj_ops *ops)
 	ops->status = file_status;
 	ops->read = file_read;
 	ops->write = file_write;
+	ops->read_vec = file_read_vec;
+	ops->write_vec = file_write_vec;
 	ops->commit = commit;
 	ops->lock_op = lock_op;
 	ops->close = file_close;
@@ -39,6 +39,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include "FSAL/fsal_commonlib.h"
+#include "gsh_read_ref.h"
 #include "vfs_methods.h"
 
 /** vfs_open
@@ -195,6 +196,255 @@ fsal_status_t vfs_write(struct fsal_obj_handle *obj_hdl,
 	return fsalstat(fsal_error, retval);
 }
 
+/* Ranges moved by one preadv/pwritev at most */
+#define VFS_IO_VEC_MAX 64
+
+/* vfs_read_vec
+ * Contiguous ranges are read with a single preadv
+ */
+
+fsal_status_t vfs_read_vec(struct fsal_obj_handle *obj_hdl,
+			   struct fsal_io_range *ranges, uint32_t count,
+			   bool *end_of_file)
+{
+	struct vfs_fsal_obj_handle *myself;
+	struct iovec iov[VFS_IO_VEC_MAX];
+	ssize_t nb_read;
+	uint32_t i, n;
+	fsal_errors_t fsal_error = ERR_FSAL_NO_ERROR;
+	int retval = 0;
+
+	myself = container_of(obj_hdl, struct vfs_fsal_obj_handle, obj_handle);
+
+	if (obj_hdl->fsal != obj_hdl->fs->fsal) {
+		LogDebug(COMPONENT_FSAL,
+			 "FSAL %s operation for handle belonging to FSAL %s, return EXDEV",
+			 obj_hdl->fsal->name, obj_hdl->fs->fsal->name);
+		retval = EXDEV;
+		fsal_error = posix2fsal_error(retval);
+		return fsalstat(fsal_error, retval);
+	}
+
+	assert(myself->u.file.fd >= 0
+	       && myself->u.file.openflags != FSAL_O_CLOSED);
+
+	*end_of_file = false;
+
+	for (i = 0; i < count; i++)
+		ranges[i].done = 0;
+
+	for (i = 0; i < count; i += n) {
+		n = fsal_io_range_run(&ranges[i], count - i, iov,
+				      VFS_IO_VEC_MAX);
+
+		nb_read = preadv(myself->u.file.fd, iov, n, ranges[i].offset);
+
+		if (nb_read == -1) {
+			retval = errno;
+			fsal_error = posix2fsal_error(retval);
+			goto out;
+		}
+
+		if (!fsal_io_range_done(&ranges[i], n, nb_read)) {
+			*end_of_file = true;
+			goto out;
+		}
+	}
+
+	/* same dual eof condition as vfs_read */
+	if (count > 0 &&
+	    ranges[count - 1].offset + ranges[count - 1].done >=
+	    obj_hdl->attributes.filesize)
+		*end_of_file = true;
+
+ out:
+	return fsalstat(fsal_error, retval);
+}
+
+/* vfs_write_vec
+ * Contiguous ranges are written with a single pwritev, stability
+ * costs one fsync for all of them
+ */
+
+fsal_status_t vfs_write_vec(struct fsal_obj_handle *obj_hdl,
+			    struct fsal_io_range *ranges, uint32_t count,
+			    bool *fsal_stable)
+{
+	struct vfs_fsal_obj_handle *myself;
+	struct iovec iov[VFS_IO_VEC_MAX];
+	ssize_t nb_written;
+	uint32_t i, n;
+	fsal_errors_t fsal_error = ERR_FSAL_NO_ERROR;
+	int retval = 0;
+
+	myself = container_of(obj_hdl, struct vfs_fsal_obj_handle, obj_handle);
+
+	if (obj_hdl->fsal != obj_hdl->fs->fsal) {
+		LogDebug(COMPONENT_FSAL,
+			 "FSAL %s operation for handle belonging to FSAL %s, return EXDEV",
+			 obj_hdl->fsal->name, obj_hdl->fs->fsal->name);
+		retval = EXDEV;
+		fsal_error = posix2fsal_error(retval);
+		return fsalstat(fsal_error, retval);
+	}
+
+	assert(myself->u.file.fd >= 0
+	       && myself->u.file.openflags != FSAL_O_CLOSED);
+
+	for (i = 0; i < count; i++)
+		ranges[i].done = 0;
+
+	fsal_set_credentials(op_ctx->creds);
+
+	for (i = 0; i < count; i += n) {
+		n = fsal_io_range_run(&ranges[i], count - i, iov,
+				      VFS_IO_VEC_MAX);
+
+		nb_written = pwritev(myself->u.file.fd, iov, n,
+				     ranges[i].offset);
+
+		if (nb_written == -1) {
+			retval = errno;
+			fsal_error = posix2fsal_error(retval);
+			goto out;
+		}
+
+		if (!fsal_io_range_done(&ranges[i], n, nb_written))
+			break;
+	}
+
+	/* attempt stability */
+	if (fsal_stable != NULL && *fsal_stable) {
+		retval = fsync(myself->u.file.fd);
+		if (retval == -1) {
+			retval = errno;
+			fsal_error = posix2fsal_error(retval);
+		}
+		*fsal_stable = true;
+	}
+
+ out:
+	fsal_restore_ganesha_credentials();
+	return fsalstat(fsal_error, retval);
+}
+
+/* Reply buffers kept by vfs_read_ref for the next READs */
+#define VFS_READ_REF_KEEP 16
+
+/* Buffers are allocated by steps, so that READs of nearby sizes
+ * share them */
+#define VFS_READ_REF_STEP (64 * 1024)
+
+/**
+ * @brief Reply buffer of vfs_read_ref
+ */
+
+struct vfs_read_buf {
+	size_t size;		/*< Room for data */
+	char data[];
+};
+
+static pthread_mutex_t vfs_read_ref_mtx = PTHREAD_MUTEX_INITIALIZER;
+static struct gsh_read_ref *vfs_read_refs[VFS_READ_REF_KEEP];
+static uint32_t vfs_read_ref_count;
+
+static void vfs_read_ref_free(struct gsh_read_ref *ref)
+{
+	gsh_free(ref->priv);
+	gsh_free(ref);
+}
+
+static void vfs_read_ref_release(struct gsh_read_ref *ref)
+{
+	PTHREAD_MUTEX_lock(&vfs_read_ref_mtx);
+	if (vfs_read_ref_count < VFS_READ_REF_KEEP) {
+		vfs_read_refs[vfs_read_ref_count++] = ref;
+		ref = NULL;
+	}
+	PTHREAD_MUTEX_unlock(&vfs_read_ref_mtx);
+
+	if (ref != NULL)
+		vfs_read_ref_free(ref);
+}
+
+/**
+ * @brief Get a reply buffer with room for size bytes
+ */
+
+static struct gsh_read_ref *vfs_read_ref_get(size_t size)
+{
+	struct gsh_read_ref *ref = NULL;
+	struct vfs_read_buf *buf;
+
+	PTHREAD_MUTEX_lock(&vfs_read_ref_mtx);
+	if (vfs_read_ref_count > 0)
+		ref = vfs_read_refs[--vfs_read_ref_count];
+	PTHREAD_MUTEX_unlock(&vfs_read_ref_mtx);
+
+	if (ref != NULL) {
+		buf = ref->priv;
+		if (buf->size >= size)
+			return ref;
+		vfs_read_ref_free(ref);
+	}
+
+	size = (size + VFS_READ_REF_STEP - 1) & ~(VFS_READ_REF_STEP - 1);
+
+	ref = gsh_malloc(sizeof(struct gsh_read_ref) + sizeof(struct iovec));
+	if (ref == NULL)
+		return NULL;
+
+	buf = gsh_malloc(sizeof(struct vfs_read_buf) + size);
+	if (buf == NULL) {
+		gsh_free(ref);
+		return NULL;
+	}
+
+	buf->size = size;
+	ref->release = vfs_read_ref_release;
+	ref->priv = buf;
+	ref->count = 1;
+
+	return ref;
+}
+
+/* vfs_read_ref
+ * Reply buffers are recycled rather than allocated, and freed, for
+ * each READ.  READ sized allocations are past the mmap threshold of
+ * malloc, each of them would map fresh pages and fault them in.
+ */
+
+fsal_status_t vfs_read_ref(struct fsal_obj_handle *obj_hdl,
+			   uint64_t offset, size_t size,
+			   struct gsh_read_ref **ref, size_t *read_amount,
+			   bool *end_of_file)
+{
+	struct gsh_read_ref *data;
+	struct vfs_read_buf *buf;
+	fsal_status_t status;
+
+	*ref = NULL;
+
+	data = vfs_read_ref_get(size);
+	if (data == NULL)
+		return fsalstat(ERR_FSAL_NOMEM, ENOMEM);
+
+	buf = data->priv;
+
+	status = vfs_read(obj_hdl, offset, size, buf->data, read_amount,
+			  end_of_file);
+	if (FSAL_IS_ERROR(status)) {
+		vfs_read_ref_release(data);
+		return status;
+	}
+
+	data->iov[0].iov_base = buf->data;
+	data->iov[0].iov_len = *read_amount;
+	*ref = data;
+
+	return status;
+}
+
 /* vfs_commit
  * Commit a file range to storage.
  * for right now, fsync will have to do.
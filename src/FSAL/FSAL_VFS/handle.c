@@ -151,57 +151,31 @@ static struct vfs_fsal_obj_handle *alloc_handle(int dirfd,
 	return NULL;
 }
 
-/* handle methods
- */
-
-/* lookup
- * deprecated NULL parent && NULL path implies root handle
+/* lookup_at
+ * look a name up in a directory already opened
  */
 
-static fsal_status_t lookup(struct fsal_obj_handle *parent,
-			    const char *path, struct fsal_obj_handle **handle)
+static fsal_status_t lookup_at(struct vfs_fsal_obj_handle *parent_hdl,
+			       int dirfd, const char *path,
+			       struct fsal_obj_handle **handle)
 {
-	struct vfs_fsal_obj_handle *parent_hdl, *hdl;
-	fsal_errors_t fsal_error = ERR_FSAL_NO_ERROR;
-	int retval, dirfd;
+	struct fsal_obj_handle *parent = &parent_hdl->obj_handle;
+	struct vfs_fsal_obj_handle *hdl;
+	int retval;
 	struct stat stat;
 	vfs_file_handle_t *fh = NULL;
 	vfs_alloc_handle(fh);
 	fsal_dev_t dev;
-	struct fsal_filesystem *fs;
+	struct fsal_filesystem *fs = parent->fs;
 	bool xfsal = false;
 
 	*handle = NULL;		/* poison it first */
-	parent_hdl =
-	    container_of(parent, struct vfs_fsal_obj_handle, obj_handle);
-	if (!parent->obj_ops.handle_is(parent, DIRECTORY)) {
-		LogCrit(COMPONENT_FSAL,
-			"Parent handle is not a directory. hdl = 0x%p", parent);
-		return fsalstat(ERR_FSAL_NOTDIR, 0);
-	}
-
-	if (parent->fsal != parent->fs->fsal) {
-		LogDebug(COMPONENT_FSAL,
-			 "FSAL %s operation for handle belonging to FSAL %s, return EXDEV",
-			 parent->fsal->name,
-			 parent->fs->fsal != NULL
-				? parent->fs->fsal->name
-				: "(none)");
-		retval = EXDEV;
-		goto hdlerr;
-	}
-
-	fs = parent->fs;
-	dirfd = vfs_fsal_open(parent_hdl, O_PATH | O_NOACCESS, &fsal_error);
-
-	if (dirfd < 0)
-		return fsalstat(fsal_error, -dirfd);
 
 	retval = fstatat(dirfd, path, &stat, AT_SYMLINK_NOFOLLOW);
 
 	if (retval < 0) {
 		retval = errno;
-		goto direrr;
+		goto err;
 	}
 
 	dev = posix2fsal_devt(stat.st_dev);
@@ -216,7 +190,7 @@ static fsal_status_t lookup(struct fsal_obj_handle *parent,
 				 "unknown file system dev=%"PRIu64".%"PRIu64,
 				 path, dev.major, dev.minor);
 			retval = EXDEV;
-			goto direrr;
+			goto err;
 		}
 
 		if (fs->fsal != parent->fsal) {
@@ -261,32 +235,74 @@ static fsal_status_t lookup(struct fsal_obj_handle *parent,
 
 			if (retval < 0) {
 				retval = errno;
-				goto direrr;
+				goto err;
 			}
 
 			retval = 0;
 		} else {
 			/* Some other error */
-			goto direrr;
+			goto err;
 		}
 	}
 
 	/* allocate an obj_handle and fill it up */
 	hdl = alloc_handle(dirfd, fh, fs, &stat, parent_hdl->handle, path,
 			   op_ctx->fsal_export);
-	close(dirfd);
 	if (hdl == NULL) {
 		retval = ENOMEM;
-		goto hdlerr;
+		goto err;
 	}
 	*handle = &hdl->obj_handle;
 	return fsalstat(ERR_FSAL_NO_ERROR, 0);
 
- direrr:
+ err:
+	return fsalstat(posix2fsal_error(retval), retval);
+}
+
+/* handle methods
+ */
+
+/* lookup
+ * deprecated NULL parent && NULL path implies root handle
+ */
+
+static fsal_status_t lookup(struct fsal_obj_handle *parent,
+			    const char *path, struct fsal_obj_handle **handle)
+{
+	struct vfs_fsal_obj_handle *parent_hdl;
+	fsal_errors_t fsal_error = ERR_FSAL_NO_ERROR;
+	fsal_status_t status;
+	int retval, dirfd;
+
+	*handle = NULL;		/* poison it first */
+	parent_hdl =
+	    container_of(parent, struct vfs_fsal_obj_handle, obj_handle);
+	if (!parent->obj_ops.handle_is(parent, DIRECTORY)) {
+		LogCrit(COMPONENT_FSAL,
+			"Parent handle is not a directory. hdl = 0x%p", parent);
+		return fsalstat(ERR_FSAL_NOTDIR, 0);
+	}
+
+	if (parent->fsal != parent->fs->fsal) {
+		LogDebug(COMPONENT_FSAL,
+			 "FSAL %s operation for handle belonging to FSAL %s, return EXDEV",
+			 parent->fsal->name,
+			 parent->fs->fsal != NULL
+				? parent->fs->fsal->name
+				: "(none)");
+		retval = EXDEV;
+		fsal_error = posix2fsal_error(retval);
+		return fsalstat(fsal_error, retval);
+	}
+
+	dirfd = vfs_fsal_open(parent_hdl, O_PATH | O_NOACCESS, &fsal_error);
+
+	if (dirfd < 0)
+		return fsalstat(fsal_error, -dirfd);
+
+	status = lookup_at(parent_hdl, dirfd, path, handle);
 	close(dirfd);
- hdlerr:
-	fsal_error = posix2fsal_error(retval);
-	return fsalstat(fsal_error, retval);
+	return status;
 }
 
 /* make_file_safe
@@ -946,6 +962,99 @@ static fsal_status_t read_dirents(struct fsal_obj_handle *dir_hdl,
 	return fsalstat(fsal_error, retval);
 }
 
+/**
+ * read_dirents_plus
+ * read the directory and call through the callback function with
+ * a handle for each entry, looked up relative to the directory
+ * file descriptor already open for reading it.
+ * @param dir_hdl [IN] the directory to read
+ * @param whence [IN] where to start (next)
+ * @param dir_state [IN] pass thru of state to callback
+ * @param cb [IN] callback function
+ * @param eof [OUT] eof marker true == end of dir
+ */
+
+static fsal_status_t read_dirents_plus(struct fsal_obj_handle *dir_hdl,
+				       fsal_cookie_t *whence,
+				       void *dir_state,
+				       fsal_readdir_plus_cb cb, bool *eof)
+{
+	struct vfs_fsal_obj_handle *myself;
+	struct fsal_obj_handle *obj;
+	fsal_status_t status;
+	int dirfd;
+	fsal_errors_t fsal_error = ERR_FSAL_NO_ERROR;
+	int retval = 0;
+	off_t seekloc = 0;
+	off_t baseloc = 0;
+	unsigned int bpos;
+	int nread;
+	struct vfs_dirent dentry, *dentryp = &dentry;
+	char buf[BUF_SIZE];
+
+	if (whence != NULL)
+		seekloc = (off_t) *whence;
+	myself = container_of(dir_hdl, struct vfs_fsal_obj_handle, obj_handle);
+	if (dir_hdl->fsal != dir_hdl->fs->fsal) {
+		LogDebug(COMPONENT_FSAL,
+			 "FSAL %s operation for handle belonging to FSAL %s, return EXDEV",
+			 dir_hdl->fsal->name,
+			 dir_hdl->fs->fsal != NULL
+				? dir_hdl->fs->fsal->name
+				: "(none)");
+		retval = EXDEV;
+		fsal_error = posix2fsal_error(retval);
+		goto out;
+	}
+	dirfd = vfs_fsal_open(myself, O_RDONLY | O_DIRECTORY, &fsal_error);
+	if (dirfd < 0) {
+		retval = -dirfd;
+		goto out;
+	}
+	seekloc = lseek(dirfd, seekloc, SEEK_SET);
+	if (seekloc < 0) {
+		retval = errno;
+		fsal_error = posix2fsal_error(retval);
+		goto done;
+	}
+
+	do {
+		baseloc = seekloc;
+		nread = vfs_readents(dirfd, buf, BUF_SIZE, &seekloc);
+		if (nread < 0) {
+			retval = errno;
+			fsal_error = posix2fsal_error(retval);
+			goto done;
+		}
+		if (nread == 0)
+			break;
+		for (bpos = 0; bpos < nread;) {
+			if (!to_vfs_dirent(buf, bpos, dentryp, baseloc)
+			    || strcmp(dentryp->vd_name, ".") == 0
+			    || strcmp(dentryp->vd_name, "..") == 0)
+				goto skip;	/* must skip '.' and '..' */
+
+			status = lookup_at(myself, dirfd, dentryp->vd_name,
+					   &obj);
+
+			/* callback to cache inode, it owns obj */
+			if (!cb(dentryp->vd_name, obj, status, dir_state,
+				(fsal_cookie_t) dentryp->vd_offset)) {
+				goto done;
+			}
+ skip:
+			bpos += dentryp->vd_reclen;
+		}
+	} while (nread > 0);
+
+	*eof = true;
+ done:
+	close(dirfd);
+
+ out:
+	return fsalstat(fsal_error, retval);
+}
+
 static fsal_status_t renamefile(struct fsal_obj_handle *obj_hdl,
 				struct fsal_obj_handle *olddir_hdl,
 				const char *old_name,
@@ -1545,6 +1654,7 @@ void vfs_handle_ops_init(struct fsal_obj_ops *ops)
 	ops->release = release;
 	ops->lookup = lookup;
 	ops->readdir = read_dirents;
+	ops->readdir_plus = read_dirents_plus;
 	ops->create = create;
 	ops->mkdir = makedir;
 	ops->mknode = makenode;
@@ -1560,6 +1670,9 @@ void vfs_handle_ops_init(struct fsal_obj_ops *ops)
 	ops->status = vfs_status;
 	ops->read = vfs_read;
 	ops->write = vfs_write;
+	ops->read_vec = vfs_read_vec;
+	ops->write_vec = vfs_write_vec;
+	ops->read_ref = vfs_read_ref;
 	ops->commit = vfs_commit;
 	ops->lock_op = vfs_lock_op;
 	ops->close = vfs_close;
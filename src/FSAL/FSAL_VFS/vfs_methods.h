@@ -197,6 +197,16 @@ fsal_status_t vfs_write(struct fsal_obj_handle *obj_hdl,
 			uint64_t offset,
 			size_t buffer_size, void *buffer, size_t *write_amount,
 			bool *fsal_stable);
+fsal_status_t vfs_read_vec(struct fsal_obj_handle *obj_hdl,
+			   struct fsal_io_range *ranges, uint32_t count,
+			   bool *end_of_file);
+fsal_status_t vfs_write_vec(struct fsal_obj_handle *obj_hdl,
+			    struct fsal_io_range *ranges, uint32_t count,
+			    bool *fsal_stable);
+fsal_status_t vfs_read_ref(struct fsal_obj_handle *obj_hdl,
+			   uint64_t offset, size_t size,
+			   struct gsh_read_ref **ref, size_t *read_amount,
+			   bool *end_of_file);
 fsal_status_t vfs_commit(struct fsal_obj_handle *obj_hdl,	/* sync */
 			 off_t offset, size_t len);
 fsal_status_t vfs_lock_op(struct fsal_obj_handle *obj_hdl,
@@ -1494,4 +1494,57 @@ int decode_fsid(char *buf,
 	return sizeof_fsid(fsid_type);
 }
 
+/**
+ * @brief Gather a run of contiguous ranges for preadv/pwritev
+ *
+ * @param[in]  ranges The ranges
+ * @param[in]  count  Number of ranges, at least 1
+ * @param[out] iov    Vector for the run
+ * @param[in]  iovmax Size of iov
+ *
+ * @return Number of ranges in the run, starting at ranges[0].
+ */
+
+uint32_t fsal_io_range_run(struct fsal_io_range *ranges, uint32_t count,
+			   struct iovec *iov, uint32_t iovmax)
+{
+	uint32_t n = 0;
+
+	do {
+		iov[n].iov_base = ranges[n].buffer;
+		iov[n].iov_len = ranges[n].length;
+		n++;
+	} while (n < count && n < iovmax &&
+		 ranges[n].offset ==
+		 ranges[n - 1].offset + ranges[n - 1].length);
+
+	return n;
+}
+
+/**
+ * @brief Spread the result of preadv/pwritev over a run
+ *
+ * @param[in,out] ranges The run
+ * @param[in]     n      Number of ranges in the run
+ * @param[in]     moved  Amount of data moved
+ *
+ * @return true if the whole run was moved.
+ */
+
+bool fsal_io_range_done(struct fsal_io_range *ranges, uint32_t n,
+			size_t moved)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		ranges[i].done = moved < ranges[i].length
+					? moved : ranges[i].length;
+		moved -= ranges[i].done;
+		if (ranges[i].done < ranges[i].length)
+			return false;
+	}
+
+	return true;
+}
+
 /** @} */
@@ -55,6 +55,7 @@
 #include "fsal_private.h"
 #include "pnfs_utils.h"
 #include "nfs_creds.h"
+#include "gsh_read_ref.h"
 
 /** fsal module method defaults and common methods
  */
@@ -582,6 +583,49 @@ static fsal_status_t read_dirents(struct fsal_obj_handle *dir_hdl,
 	return fsalstat(ERR_FSAL_NOTSUPP, 0);
 }
 
+/**
+ * @brief State of the default readdir_plus
+ */
+
+struct read_dirents_plus_state {
+	struct fsal_obj_handle *dir_hdl;
+	void *dir_state;
+	fsal_readdir_plus_cb cb;
+};
+
+static bool read_dirents_plus_cb(const char *name, void *dir_state,
+				 fsal_cookie_t cookie)
+{
+	struct read_dirents_plus_state *state = dir_state;
+	struct fsal_obj_handle *obj = NULL;
+	fsal_status_t status;
+
+	status = state->dir_hdl->obj_ops.lookup(state->dir_hdl, name, &obj);
+	if (FSAL_IS_ERROR(status))
+		obj = NULL;
+
+	return state->cb(name, obj, status, state->dir_state, cookie);
+}
+
+/* read_dirents_plus
+ * default case readdir then one lookup per name
+ */
+
+static fsal_status_t read_dirents_plus(struct fsal_obj_handle *dir_hdl,
+				       fsal_cookie_t *whence,
+				       void *dir_state,
+				       fsal_readdir_plus_cb cb, bool *eof)
+{
+	struct read_dirents_plus_state state = {
+		.dir_hdl = dir_hdl,
+		.dir_state = dir_state,
+		.cb = cb,
+	};
+
+	return dir_hdl->obj_ops.readdir(dir_hdl, whence, &state,
+					read_dirents_plus_cb, eof);
+}
+
 /* create
  * default case not supported
  */
@@ -779,6 +823,115 @@ static fsal_status_t file_write_plus(struct fsal_obj_handle *obj_hdl,
 	return fsalstat(ERR_FSAL_NOTSUPP, 0);
 }
 
+/* file_read_vec
+ * default case one read per range
+ */
+
+static fsal_status_t file_read_vec(struct fsal_obj_handle *obj_hdl,
+				   struct fsal_io_range *ranges,
+				   uint32_t count, bool *end_of_file)
+{
+	fsal_status_t status = fsalstat(ERR_FSAL_NO_ERROR, 0);
+	uint32_t i;
+
+	*end_of_file = false;
+
+	for (i = 0; i < count; i++)
+		ranges[i].done = 0;
+
+	for (i = 0; i < count && !*end_of_file; i++) {
+		status = obj_hdl->obj_ops.read(obj_hdl, ranges[i].offset,
+					       ranges[i].length,
+					       ranges[i].buffer,
+					       &ranges[i].done, end_of_file);
+		if (FSAL_IS_ERROR(status))
+			break;
+		if (ranges[i].done < ranges[i].length)
+			break;
+	}
+
+	return status;
+}
+
+/* file_write_vec
+ * default case one write per range
+ */
+
+static fsal_status_t file_write_vec(struct fsal_obj_handle *obj_hdl,
+				    struct fsal_io_range *ranges,
+				    uint32_t count, bool *fsal_stable)
+{
+	fsal_status_t status = fsalstat(ERR_FSAL_NO_ERROR, 0);
+	bool stable_in = *fsal_stable;
+	bool stable;
+	uint32_t i;
+
+	/* Stable only if every range made it */
+	*fsal_stable = true;
+
+	for (i = 0; i < count; i++)
+		ranges[i].done = 0;
+
+	for (i = 0; i < count; i++) {
+		stable = stable_in;
+		status = obj_hdl->obj_ops.write(obj_hdl, ranges[i].offset,
+						ranges[i].length,
+						ranges[i].buffer,
+						&ranges[i].done, &stable);
+		if (FSAL_IS_ERROR(status))
+			break;
+		if (!stable)
+			*fsal_stable = false;
+		if (ranges[i].done < ranges[i].length)
+			break;
+	}
+
+	return status;
+}
+
+static void file_read_ref_release(struct gsh_read_ref *ref)
+{
+	gsh_free(ref);
+}
+
+/* file_read_ref
+ * default case read into a buffer allocated with the reference
+ */
+
+static fsal_status_t file_read_ref(struct fsal_obj_handle *obj_hdl,
+				   uint64_t offset, size_t size,
+				   struct gsh_read_ref **ref,
+				   size_t *read_amount, bool *end_of_file)
+{
+	struct gsh_read_ref *data;
+	fsal_status_t status;
+
+	*ref = NULL;
+
+	data = gsh_malloc(sizeof(struct gsh_read_ref) +
+			  sizeof(struct iovec) + size);
+	if (data == NULL)
+		return fsalstat(ERR_FSAL_NOMEM, ENOMEM);
+
+	data->release = file_read_ref_release;
+	data->priv = NULL;
+	data->count = 1;
+	data->iov[0].iov_base = &data->iov[1];
+
+	status = obj_hdl->obj_ops.read(obj_hdl, offset, size,
+				       data->iov[0].iov_base, read_amount,
+				       end_of_file);
+	if (FSAL_IS_ERROR(status)) {
+		gsh_free(data);
+		return status;
+	}
+
+	data->iov[0].iov_len = *read_amount;
+	*ref = data;
+
+	return status;
+}
+
 /* seek
  * default case not supported
  */
@@ -1074,6 +1227,10 @@ struct fsal_obj_ops def_handle_ops = {
 	.read_plus = file_read_plus,
 	.write = file_write,
 	.write_plus = file_write_plus,
+	.read_vec = file_read_vec,
+	.write_vec = file_write_vec,
+	.readdir_plus = read_dirents_plus,
+	.read_ref = file_read_ref,
 	.seek = file_seek,
 	.io_advise = file_io_advise,
 	.commit = commit,
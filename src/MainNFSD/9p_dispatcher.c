@@ -44,7 +44,7 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
-#include <poll.h>
+#include <sys/epoll.h>
 #include <arpa/inet.h>		/* For inet_ntop() */
 #include "hashtable.h"
 #include "log.h"
@@ -59,6 +59,7 @@
 #include "client_mgr.h"
 #include "server_stats.h"
 #include "9p.h"
+#include "delayed_exec.h"
 #include <stdbool.h>
 
 #define P_FAMILY AF_INET6
@@ -102,248 +103,482 @@ void DispatchWork9P(request_data_t *req)
 }
 
 /**
- * _9p_socket_thread: 9p socket manager.
+ * @brief Messages read from one connection before polling the others
+ */
+#define _9P_REACTOR_BUDGET 16
+
+/**
+ * @brief Events handled per epoll_wait
+ */
+#define _9P_REACTOR_EVENTS 64
+
+/**
+ * @brief Delay between checks for the workers to release a connection
+ */
+#define _9P_RELEASE_DELAY (NS_PER_SEC / 10)
+
+/**
+ * @brief A reactor thread, polling its share of the connections
+ */
+
+struct _9p_reactor {
+	int epoll_fd;			/*< Connections of this reactor */
+	uint32_t index;			/*< For the thread name */
+	uint32_t conns;			/*< Number of connections polled */
+	pthread_t thrid;
+};
+
+/**
+ * @brief A 9P/TCP connection
  *
- * This function is the main loop for the 9p socket manager.
- * One such thread exists per connection.
+ * The socket stays blocking for the workers sending replies, the
+ * reactor reads it with MSG_DONTWAIT and keeps the message being
+ * received here until it is complete.
+ */
+
+struct _9p_tcp_conn {
+	struct _9p_conn conn;		/*< Handed to the workers */
+	struct _9p_reactor *reactor;	/*< Reactor polling the socket */
+	char *msg;			/*< Message being received */
+	uint32_t msglen;		/*< Its size, once the header is in */
+	uint32_t readlen;		/*< Bytes received so far */
+	char hdr[_9P_HDR_SIZE];		/*< Size header being received */
+	char strcaller[INET6_ADDRSTRLEN];
+};
+
+static struct _9p_reactor *_9p_reactors;
+
+/**
+ * @brief Free a connection once the workers are done with it
  *
- * @param Arg the socket number cast as a void * in pthread_create
+ * Run from the delayed executor, which calls it again until the
+ * requests still queued or in progress have released the connection.
  *
- * @return NULL
+ * @param[in] arg The connection
+ */
+
+static void _9p_tcp_release(void *arg)
+{
+	struct _9p_tcp_conn *tconn = arg;
+	struct _9p_conn *pconn = &tconn->conn;
+	unsigned int i;
+
+	while (atomic_fetch_uint32_t(&pconn->refcount)) {
+		LogDebug(COMPONENT_9P,
+			 "Waiting for workers to release pconn on socket %lu",
+			 pconn->trans_data.sockfd);
+		if (delayed_submit(_9p_tcp_release, tconn,
+				   _9P_RELEASE_DELAY) == 0)
+			return;
+		sleep(1);
+	}
+
+	LogEvent(COMPONENT_9P, "Closing connection on socket %lu",
+		 pconn->trans_data.sockfd);
+	close(pconn->trans_data.sockfd);
+
+	_9p_cleanup_fids(pconn);
+
+	if (pconn->client != NULL)
+		put_gsh_client(pconn->client);
+
+	for (i = 0; i < FLUSH_BUCKETS; i++)
+		PTHREAD_MUTEX_destroy(&pconn->flush_buckets[i].lock);
+	PTHREAD_MUTEX_destroy(&pconn->sock_lock);
+
+	gsh_free(tconn);
+}
+
+/**
+ * @brief Stop polling a connection and have it freed
+ *
+ * The socket is shut down at once so that no more requests come in
+ * and replies in progress fail, it is closed by _9p_tcp_release().
  *
+ * @param[in] tconn The connection
  */
 
-void *_9p_socket_thread(void *Arg)
+static void _9p_tcp_close(struct _9p_tcp_conn *tconn)
 {
-	long int tcp_sock = (long int)Arg;
-	int rc = -1;
-	struct pollfd fds[1];
-	int fdcount = 1;
-	static char my_name[MAXNAMLEN + 1];
-	char strcaller[INET6_ADDRSTRLEN];
-	request_data_t *req = NULL;
-	int tag;
-	unsigned long sequence = 0;
-	unsigned int i = 0;
-	char *_9pmsg = NULL;
-	uint32_t msglen;
-
-	struct _9p_conn _9p_conn;
-	socklen_t addrpeerlen;
+	int fd = tconn->conn.trans_data.sockfd;
+
+	if (epoll_ctl(tconn->reactor->epoll_fd, EPOLL_CTL_DEL, fd, NULL) != 0)
+		LogCrit(COMPONENT_9P,
+			"Could not stop polling socket %d, error %d (%s)",
+			fd, errno, strerror(errno));
+	atomic_dec_uint32_t(&tconn->reactor->conns);
+
+	(void)shutdown(fd, SHUT_RDWR);
+
+	/* Free buffer if we encountered an error
+	 * before we could give it to a worker */
+	if (tconn->msg != NULL) {
+		_9p_msgbuf_put(tconn->msg);
+		tconn->msg = NULL;
+	}
+
+	if (delayed_submit(_9p_tcp_release, tconn, 0) != 0)
+		_9p_tcp_release(tconn);
+}
+
+/**
+ * @brief Hand a complete message to the workers
+ *
+ * @param[in] tconn The connection
+ */
+
+static void _9p_tcp_dispatch(struct _9p_tcp_conn *tconn)
+{
+	struct _9p_conn *pconn = &tconn->conn;
+	request_data_t *req;
+	u16 tag;
+
+	server_stats_transport_done(pconn->client, tconn->msglen, 1, 0,
+				    0, 0, 0);
+
+	req = pool_alloc(request_pool, NULL);
+
+	req->rtype = _9P_REQUEST;
+	req->r_u._9p._9pmsg = tconn->msg;
+	req->r_u._9p.pconn = pconn;
+
+	/* Add this request to the request list,
+	 * should it be flushed later. */
+	tag = *(u16 *) (tconn->msg + _9P_HDR_SIZE + _9P_TYPE_SIZE);
+	_9p_AddFlushHook(&req->r_u._9p, tag, pconn->sequence++);
+	LogFullDebug(COMPONENT_9P, "Request tag is %d", tag);
+
+	/* Not our buffer anymore */
+	tconn->msg = NULL;
+	tconn->readlen = 0;
+
+	DispatchWork9P(req);
+}
+
+/**
+ * @brief Read what a connection has to offer
+ *
+ * Reads until the socket would block or a few messages have been
+ * dispatched, the reactor will come back for the rest.
+ *
+ * @param[in] tconn The connection
+ *
+ * @return false if the connection must be closed.
+ */
+
+static bool _9p_tcp_read(struct _9p_tcp_conn *tconn)
+{
+	struct _9p_conn *pconn = &tconn->conn;
+	int budget = _9P_REACTOR_BUDGET;
+	ssize_t readlen;
+	bool hit;
+
+	while (budget > 0) {
+		if (tconn->msg == NULL) {
+			/* An incoming 9P request: the msg has a 4 bytes
+			 * header showing the size of the msg including
+			 * the header */
+			readlen = recv(pconn->trans_data.sockfd,
+				       tconn->hdr + tconn->readlen,
+				       _9P_HDR_SIZE - tconn->readlen,
+				       MSG_DONTWAIT);
+			if (readlen <= 0)
+				break;
+
+			tconn->readlen += readlen;
+			if (tconn->readlen < _9P_HDR_SIZE)
+				continue;
+
+			memcpy(&tconn->msglen, tconn->hdr, _9P_HDR_SIZE);
+			if (tconn->msglen > pconn->msize) {
+				LogCrit(COMPONENT_9P,
+					"Message size too big! got %u, max = %u",
+					tconn->msglen, pconn->msize);
+				return false;
+			}
+			if (tconn->msglen <
+			    _9P_HDR_SIZE + _9P_TYPE_SIZE + _9P_TAG_SIZE) {
+				LogEvent(COMPONENT_9P,
+					 "Message too small! for client %s on socket %lu: size=%u",
+					 tconn->strcaller,
+					 pconn->trans_data.sockfd,
+					 tconn->msglen);
+				return false;
+			}
+
+			LogFullDebug(COMPONENT_9P,
+				     "Received 9P/TCP message of size %u from client %s on socket %lu",
+				     tconn->msglen, tconn->strcaller,
+				     pconn->trans_data.sockfd);
+
+			/* Prepare to read the message, in a buffer
+			 * sized for it rather than for msize */
+			tconn->msg = _9p_msgbuf_get(tconn->msglen, &hit);
+			if (tconn->msg == NULL) {
+				LogCrit(COMPONENT_9P,
+					"Could not allocate 9pmsg buffer for client %s on socket %lu",
+					tconn->strcaller,
+					pconn->trans_data.sockfd);
+				return false;
+			}
+			server_stats_9p_msgbuf(pconn->client, hit);
+			memcpy(tconn->msg, tconn->hdr, _9P_HDR_SIZE);
+			continue;
+		}
+
+		readlen = recv(pconn->trans_data.sockfd,
+			       tconn->msg + tconn->readlen,
+			       tconn->msglen - tconn->readlen, MSG_DONTWAIT);
+		if (readlen <= 0)
+			break;
+
+		tconn->readlen += readlen;
+		if (tconn->readlen < tconn->msglen)
+			continue;
+
+		/* Message is good, push it */
+		_9p_tcp_dispatch(tconn);
+		budget--;
+	}
+
+	if (budget == 0)
+		return true;
+
+	if (readlen == 0) {
+		LogEvent(COMPONENT_9P,
+			 "Client %s on socket %lu has shut down and closed",
+			 tconn->strcaller, pconn->trans_data.sockfd);
+		return false;
+	}
 
-	int readlen = 0;
-	int total_readlen = 0;
+	if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+		return true;
 
-	snprintf(my_name, MAXNAMLEN, "9p_sock_mgr#fd=%ld", tcp_sock);
+	/* It is not possible to survive once we get out of sync in
+	 * the TCP stream with the client */
+	LogEvent(COMPONENT_9P,
+		 "Read error client %s on socket %lu errno=%d, total read = %u",
+		 tconn->strcaller, pconn->trans_data.sockfd, errno,
+		 tconn->readlen);
+	return false;
+}
+
+/**
+ * _9p_reactor_thread: poll the connections of a reactor.
+ *
+ * Polling is level triggered: a connection that used up its budget
+ * is reported again by the next epoll_wait.
+ *
+ * @param Arg the reactor
+ *
+ * @return NULL, but this function loops forever.
+ */
+
+static void *_9p_reactor_thread(void *Arg)
+{
+	struct _9p_reactor *reactor = Arg;
+	struct epoll_event events[_9P_REACTOR_EVENTS];
+	struct _9p_tcp_conn *tconn;
+	char my_name[MAXNAMLEN + 1];
+	bool ok;
+	int i, n;
+
+	snprintf(my_name, MAXNAMLEN, "9p_reactor#%u", reactor->index);
 	SetNameFunction(my_name);
 
-	/* Init the struct _9p_conn structure */
-	memset(&_9p_conn, 0, sizeof(_9p_conn));
-	PTHREAD_MUTEX_init(&_9p_conn.sock_lock, NULL);
-	_9p_conn.trans_type = _9P_TCP;
-	_9p_conn.trans_data.sockfd = tcp_sock;
-	for (i = 0; i < FLUSH_BUCKETS; i++) {
-		PTHREAD_MUTEX_init(&_9p_conn.flush_buckets[i].lock, NULL);
-		glist_init(&_9p_conn.flush_buckets[i].list);
+	for (;;) {
+		n = epoll_wait(reactor->epoll_fd, events, _9P_REACTOR_EVENTS,
+			       -1);
+		if (n < 0) {
+			/* Interruption if not an issue */
+			if (errno != EINTR)
+				LogCrit(COMPONENT_9P,
+					"Got error %d (%s) while polling 9P sockets",
+					errno, strerror(errno));
+			continue;
+		}
+
+		for (i = 0; i < n; i++) {
+			tconn = events[i].data.ptr;
+			ok = true;
+
+			/* Read what the client sent before it went away */
+			if (events[i].events & EPOLLIN)
+				ok = _9p_tcp_read(tconn);
+
+			if (ok &&
+			    (events[i].events &
+			     (EPOLLERR | EPOLLHUP | EPOLLRDHUP))) {
+				LogEvent(COMPONENT_9P,
+					 "Client %s on socket %lu has shut down and closed",
+					 tconn->strcaller,
+					 tconn->conn.trans_data.sockfd);
+				ok = false;
+			}
+
+			if (!ok)
+				_9p_tcp_close(tconn);
+		}
 	}
-	atomic_store_uint32_t(&_9p_conn.refcount, 0);
 
-	/* Init the fids pointers array */
-	memset(&_9p_conn.fids, 0, _9P_FID_PER_CONN * sizeof(struct _9p_fid *));
+	return NULL;
+}
+
+/**
+ * @brief Start the reactor threads
+ *
+ * @param[in] attr_thr Attributes for the threads
+ */
+
+static void _9p_reactors_start(pthread_attr_t *attr_thr)
+{
+	struct _9p_reactor *reactor;
+	uint32_t i;
+	int rc;
+
+	_9p_reactors = gsh_calloc(_9p_param._9p_tcp_reactors,
+				  sizeof(struct _9p_reactor));
+	if (_9p_reactors == NULL)
+		LogFatal(COMPONENT_9P_DISPATCH,
+			 "Could not allocate 9P reactors");
+
+	for (i = 0; i < _9p_param._9p_tcp_reactors; i++) {
+		reactor = &_9p_reactors[i];
+		reactor->index = i;
+		reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+		if (reactor->epoll_fd == -1)
+			LogFatal(COMPONENT_9P_DISPATCH,
+				 "Could not create 9P epoll fd, error %d (%s)",
+				 errno, strerror(errno));
+
+		rc = pthread_create(&reactor->thrid, attr_thr,
+				    _9p_reactor_thread, reactor);
+		if (rc != 0)
+			LogFatal(COMPONENT_THREAD,
+				 "Could not create 9p reactor thread, error = %d (%s)",
+				 rc, strerror(rc));
+	}
+
+	LogInfo(COMPONENT_9P_DISPATCH, "%u 9P reactors started",
+		_9p_param._9p_tcp_reactors);
+}
+
+/**
+ * @brief Set up a newly accepted connection
+ *
+ * @param[in] tcp_sock The socket
+ *
+ * @return The connection, NULL if it could not be allocated.
+ */
+
+static struct _9p_tcp_conn *_9p_tcp_conn_init(long int tcp_sock)
+{
+	struct _9p_tcp_conn *tconn;
+	struct _9p_conn *pconn;
+	socklen_t addrpeerlen;
+	unsigned int i;
+
+	/* The fid table is allocated on first use */
+	tconn = gsh_calloc(1, sizeof(struct _9p_tcp_conn));
+	if (tconn == NULL)
+		return NULL;
+
+	pconn = &tconn->conn;
+	PTHREAD_MUTEX_init(&pconn->sock_lock, NULL);
+	pconn->trans_type = _9P_TCP;
+	pconn->trans_data.sockfd = tcp_sock;
+	for (i = 0; i < FLUSH_BUCKETS; i++) {
+		PTHREAD_MUTEX_init(&pconn->flush_buckets[i].lock, NULL);
+		glist_init(&pconn->flush_buckets[i].list);
+	}
+	atomic_store_uint32_t(&pconn->refcount, 0);
 
 	/* Set initial msize.
 	 * Client may request a lower value during TVERSION */
-	_9p_conn.msize = _9p_param._9p_tcp_msize;
+	pconn->msize = _9p_param._9p_tcp_msize;
 
-	if (gettimeofday(&_9p_conn.birth, NULL) == -1)
+	if (gettimeofday(&pconn->birth, NULL) == -1)
 		LogFatal(COMPONENT_9P, "Cannot get connection's time of birth");
 
-	addrpeerlen = sizeof(_9p_conn.addrpeer);
-	rc = getpeername(tcp_sock, (struct sockaddr *)&_9p_conn.addrpeer,
-			 &addrpeerlen);
-	if (rc == -1) {
+	addrpeerlen = sizeof(pconn->addrpeer);
+	if (getpeername(tcp_sock, (struct sockaddr *)&pconn->addrpeer,
+			&addrpeerlen) == -1) {
 		LogMajor(COMPONENT_9P,
 			 "Cannot get peername to tcp socket for 9p, error %d (%s)",
 			 errno, strerror(errno));
-		/* XXX */
-		strncpy(strcaller, "(unresolved)", INET6_ADDRSTRLEN);
-		strcaller[12] = '\0';
+		strcpy(tconn->strcaller, "(unresolved)");
 	} else {
-		switch (_9p_conn.addrpeer.ss_family) {
+		switch (pconn->addrpeer.ss_family) {
 		case AF_INET:
-			inet_ntop(_9p_conn.addrpeer.ss_family,
-				  &((struct sockaddr_in *)&_9p_conn.addrpeer)->
-				  sin_addr, strcaller, INET6_ADDRSTRLEN);
+			inet_ntop(pconn->addrpeer.ss_family,
+				  &((struct sockaddr_in *)&pconn->addrpeer)->
+				  sin_addr, tconn->strcaller,
+				  INET6_ADDRSTRLEN);
 			break;
 		case AF_INET6:
-			inet_ntop(_9p_conn.addrpeer.ss_family,
-				  &((struct sockaddr_in6 *)&_9p_conn.addrpeer)->
-				  sin6_addr, strcaller, INET6_ADDRSTRLEN);
+			inet_ntop(pconn->addrpeer.ss_family,
+				  &((struct sockaddr_in6 *)&pconn->addrpeer)->
+				  sin6_addr, tconn->strcaller,
+				  INET6_ADDRSTRLEN);
 			break;
 		default:
-			snprintf(strcaller, INET6_ADDRSTRLEN, "BAD ADDRESS");
+			snprintf(tconn->strcaller, INET6_ADDRSTRLEN,
+				 "BAD ADDRESS");
 			break;
 		}
 
 		LogEvent(COMPONENT_9P, "9p socket #%ld is connected to %s",
-			 tcp_sock, strcaller);
+			 tcp_sock, tconn->strcaller);
 	}
-	_9p_conn.client = get_gsh_client(&_9p_conn.addrpeer, false);
-
-	/* Set up the structure used by poll */
-	memset((char *)fds, 0, sizeof(struct pollfd));
-	fds[0].fd = tcp_sock;
-	fds[0].events =
-	    POLLIN | POLLPRI | POLLRDBAND | POLLRDNORM | POLLRDHUP | POLLHUP |
-	    POLLERR | POLLNVAL;
+	pconn->client = get_gsh_client(&pconn->addrpeer, false);
 
-	for (;;) {
-		total_readlen = 0;  /* new message */
-		rc = poll(fds, fdcount, -1);
-		if (rc == -1) {
-			/* timeout = -1 => Wait indefinitely for events */
-			/* Interruption if not an issue */
-			if (errno == EINTR)
-				continue;
-
-			LogCrit(COMPONENT_9P,
-				"Got error %u (%s) on fd %ld connect to %s while polling on socket",
-				errno, strerror(errno), tcp_sock, strcaller);
-		}
-
-		if (fds[0].revents & POLLNVAL) {
-			LogEvent(COMPONENT_9P,
-				 "Client %s on socket %lu produced POLLNVAL",
-				 strcaller, tcp_sock);
-			goto end;
-		}
-
-		if (fds[0].revents & (POLLERR | POLLHUP | POLLRDHUP)) {
-			LogEvent(COMPONENT_9P,
-				 "Client %s on socket %lu has shut down and closed",
-				 strcaller, tcp_sock);
-			goto end;
-		}
-
-		if (!(fds[0].revents & (POLLIN | POLLRDNORM)))
-			continue;
-
-		/* Prepare to read the message */
-		_9pmsg = gsh_malloc(_9p_conn.msize);
-		if (_9pmsg == NULL) {
-			LogCrit(COMPONENT_9P,
-				"Could not allocate 9pmsg buffer for client %s on socket %lu",
-				strcaller, tcp_sock);
-			goto end;
-		}
-
-		/* An incoming 9P request: the msg has a 4 bytes header
-		   showing the size of the msg including the header */
-		readlen = recv(fds[0].fd, _9pmsg,
-			       _9P_HDR_SIZE, MSG_WAITALL);
-		if (readlen != _9P_HDR_SIZE)
-			goto badmsg;
-
-		msglen = *(uint32_t *) _9pmsg;
-		if (msglen > _9p_conn.msize) {
-			LogCrit(COMPONENT_9P,
-				"Message size too big! got %u, max = %u",
-				msglen, _9p_conn.msize);
-			goto end;
-		}
-
-		LogFullDebug(COMPONENT_9P,
-			     "Received 9P/TCP message of size %u from client %s on socket %lu",
-			     msglen, strcaller, tcp_sock);
-
-		total_readlen += readlen;
-		while (total_readlen < msglen) {
-			readlen = recv(fds[0].fd,
-				       _9pmsg + total_readlen,
-				       msglen - total_readlen,
-				       0);
+	return tconn;
+}
 
-			if (readlen > 0) {
-				total_readlen += readlen;
-				continue;
-			}
-			if (readlen == 0 ||
-			    (readlen < 0 && errno != EINTR))
-				goto badmsg;
-		}	/* while */
-
-		server_stats_transport_done(_9p_conn.client,
-					    total_readlen, 1, 0,
-					    0, 0, 0);
-
-		/* Message is good. */
-		req = pool_alloc(request_pool, NULL);
-
-		req->rtype = _9P_REQUEST;
-		req->r_u._9p._9pmsg = _9pmsg;
-		req->r_u._9p.pconn = &_9p_conn;
-
-		/* Add this request to the request list,
-		 * should it be flushed later. */
-		tag = *(u16 *) (_9pmsg + _9P_HDR_SIZE +
-				_9P_TYPE_SIZE);
-		_9p_AddFlushHook(&req->r_u._9p, tag,
-				 sequence++);
-		LogFullDebug(COMPONENT_9P,
-			     "Request tag is %d\n", tag);
-
-		/* Message was OK push it */
-		DispatchWork9P(req);
-
-		/* Not our buffer anymore */
-		_9pmsg = NULL;
-		continue;
-
-badmsg:
-		if (readlen == 0)
-			LogEvent(COMPONENT_9P,
-				 "Premature end for Client %s on socket %lu, total read = %u",
-				 strcaller, tcp_sock, total_readlen);
-		else if (readlen < 0) {
-			LogEvent(COMPONENT_9P,
-				 "Read error client %s on socket %lu errno=%d, total read = %u",
-				 strcaller, tcp_sock,
-				 errno, total_readlen);
-		} else
-			LogEvent(COMPONENT_9P,
-				 "Header too small! for client %s on socket %lu: readlen=%u expected=%u",
-				 strcaller, tcp_sock, readlen,
-				 _9P_HDR_SIZE);
-
-		/* Either way, we close the connection.
-		 * It is not possible to survive
-		 * once we get out of sync in the TCP stream
-		 * with the client
-		 */
-		break; /* bail out */
-	}			/* for( ;; ) */
-
-end:
-	LogEvent(COMPONENT_9P, "Closing connection on socket %lu", tcp_sock);
-	close(tcp_sock);
+/**
+ * @brief Give a new connection to the least loaded reactor
+ *
+ * @param[in] tcp_sock The socket
+ */
 
-	/* Free buffer if we encountered an error
-	 * before we could give it to a worker */
-	if (_9pmsg)
-		gsh_free(_9pmsg);
+static void _9p_tcp_accepted(long int tcp_sock)
+{
+	struct _9p_tcp_conn *tconn;
+	struct _9p_reactor *reactor = &_9p_reactors[0];
+	struct epoll_event ev;
+	uint32_t i;
+
+	tconn = _9p_tcp_conn_init(tcp_sock);
+	if (tconn == NULL) {
+		LogCrit(COMPONENT_9P_DISPATCH,
+			"Could not allocate 9P connection for socket %ld",
+			tcp_sock);
+		close(tcp_sock);
+		return;
+	}
 
-	while (atomic_fetch_uint32_t(&_9p_conn.refcount)) {
-		LogEvent(COMPONENT_9P, "Waiting for workers to release pconn");
-		sleep(1);
+	for (i = 1; i < _9p_param._9p_tcp_reactors; i++) {
+		if (atomic_fetch_uint32_t(&_9p_reactors[i].conns) <
+		    atomic_fetch_uint32_t(&reactor->conns))
+			reactor = &_9p_reactors[i];
 	}
 
-	_9p_cleanup_fids(&_9p_conn);
+	tconn->reactor = reactor;
+	atomic_inc_uint32_t(&reactor->conns);
 
-	if (_9p_conn.client != NULL)
-		put_gsh_client(_9p_conn.client);
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN | EPOLLRDHUP;
+	ev.data.ptr = tconn;
 
-	pthread_exit(NULL);
-}				/* _9p_socket_thread */
+	if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, tcp_sock, &ev) != 0) {
+		LogCrit(COMPONENT_9P_DISPATCH,
+			"Could not poll 9P socket %ld, error %d (%s)",
+			tcp_sock, errno, strerror(errno));
+		atomic_dec_uint32_t(&reactor->conns);
+		(void)shutdown(tcp_sock, SHUT_RDWR);
+		_9p_tcp_release(tconn);
+	}
+}
 
 /**
  * _9p_create_socket_V4 : create the socket and bind for 9P using
@@ -551,10 +786,8 @@ err:
 void *_9p_dispatcher_thread(void *Arg)
 {
 	int _9p_socket;
-	int rc = 0;
 	long int newsock = -1;
 	pthread_attr_t attr_thr;
-	pthread_t tcp_thrid;
 
 	SetNameFunction("_9p_disp");
 
@@ -587,6 +820,8 @@ void *_9p_dispatcher_thread(void *Arg)
 		LogDebug(COMPONENT_9P_DISPATCH,
 			 "can't set pthread's join state");
 
+	_9p_reactors_start(&attr_thr);
+
 	LogEvent(COMPONENT_9P_DISPATCH, "9P dispatcher started");
 
 	while (true) {
@@ -598,14 +833,7 @@ void *_9p_dispatcher_thread(void *Arg)
 			continue;
 		}
 
-		/* Starting the thread dedicated to signal handling */
-		rc = pthread_create(&tcp_thrid, &attr_thr,
-				    _9p_socket_thread, (void *)newsock);
-		if (rc != 0) {
-			LogFatal(COMPONENT_THREAD,
-				 "Could not create 9p socket manager thread, error = %d (%s)",
-				 errno, strerror(errno));
-		}
+		_9p_tcp_accepted(newsock);
 	}			/* while */
 
 	close(_9p_socket);
@@ -171,10 +171,8 @@ void *_9p_rdma_thread(void *Arg)
 	p_9p_conn->client =
 		get_gsh_client(&p_9p_conn->addrpeer, false);
 
-	/* Init the fids pointers array */
-	memset(&p_9p_conn->fids,
-	       0,
-	       _9P_FID_PER_CONN * sizeof(struct _9p_fid *));
+	/* The fid table is allocated on first use */
+	p_9p_conn->fids = NULL;
 
 	/* Set initial msize.
 	 * Client may request a lower value during TVERSION */
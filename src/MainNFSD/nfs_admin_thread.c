@@ -386,6 +386,46 @@ static void do_shutdown(void)
 		LogEvent(COMPONENT_THREAD, "Reaper thread shut down.");
 	}
 
+	rc = cache_inode_data_pkgshutdown();
+	if (rc != 0) {
+		LogMajor(COMPONENT_THREAD,
+			 "Error shutting down readahead threads: %d", rc);
+		disorderly = true;
+	} else {
+		LogEvent(COMPONENT_THREAD, "Readahead threads shut down.");
+	}
+
+	rc = cache_inode_readdir_pkgshutdown();
+	if (rc != 0) {
+		LogMajor(COMPONENT_THREAD,
+			 "Error shutting down readdir lookup threads: %d", rc);
+		disorderly = true;
+	} else {
+		LogEvent(COMPONENT_THREAD, "Readdir lookup threads shut down.");
+	}
+
+	rc = idmapper_shutdown();
+	if (rc != 0) {
+		LogMajor(COMPONENT_THREAD,
+			 "Error shutting down idmapper refresh threads: %d",
+			 rc);
+		disorderly = true;
+	} else {
+		LogEvent(COMPONENT_THREAD,
+			 "Idmapper refresh threads shut down.");
+	}
+
+	rc = uid2grp_shutdown();
+	if (rc != 0) {
+		LogMajor(COMPONENT_THREAD,
+			 "Error shutting down uid2grp lookup threads: %d",
+			 rc);
+		disorderly = true;
+	} else {
+		LogEvent(COMPONENT_THREAD,
+			 "uid2grp lookup threads shut down.");
+	}
+
 	LogEvent(COMPONENT_MAIN, "Stopping LRU thread.");
 	rc = cache_inode_lru_pkgshutdown();
 	if (rc != 0) {
@@ -62,8 +62,10 @@
 #include "fridgethr.h"
 #include "idmapper.h"
 #include "delayed_exec.h"
+#include "abstract_atomic.h"
 #include "client_mgr.h"
 #include "export_mgr.h"
+#include "server_stats.h"
 #ifdef USE_CAPS
 #include <sys/capability.h>	/* For capget/capset */
 #endif
@@ -80,6 +82,7 @@ time_t ServerEpoch;
 
 verifier4 NFS4_write_verifier;	/* NFS V4 write verifier */
 writeverf3 NFS3_write_verifier;	/* NFS V3 write verifier */
+static uint64_t write_verifier_epoch;	/* Source of the write verifiers */
 
 /* node ID used to identify an individual node in a cluster */
 int g_nodeid = 0;
@@ -237,6 +240,7 @@ int nfs_set_param_from_conf(config_file_t parse_tree,
 	 * Initialize exports and clients so config parsing can use them
 	 * early.
 	 */
+	server_stats_init();
 	client_pkginit();
 	export_pkginit();
 	server_pkginit();
@@ -327,7 +331,11 @@ int init_server_pkgs(void)
 	state_status_t state_status;
 
 	/* init uid2grp cache */
-	uid2grp_cache_init();
+	if (!uid2grp_init()) {
+		LogCrit(COMPONENT_INIT,
+			"uid2grp lookup threads could not be started");
+		return -1;
+	}
 
 	/* Cache Inode Initialisation */
 	cache_status = cache_inode_init();
@@ -802,6 +810,40 @@ static void lower_my_caps(void)
 }
 #endif
 
+/**
+ * @brief Set the write verifiers from write_verifier_epoch
+ */
+static void nfs_set_write_verifier(void)
+{
+	union {
+		verifier4 NFS4_write_verifier;
+		writeverf3 NFS3_write_verifier;
+		uint64_t epoch;
+	} build_verifier;
+
+	build_verifier.epoch = atomic_fetch_uint64_t(&write_verifier_epoch);
+
+	memcpy(NFS3_write_verifier, build_verifier.NFS3_write_verifier,
+	       sizeof(NFS3_write_verifier));
+	memcpy(NFS4_write_verifier, build_verifier.NFS4_write_verifier,
+	       sizeof(NFS4_write_verifier));
+}
+
+/**
+ * @brief Change the write verifiers
+ *
+ * For when UNSTABLE data acknowledged to clients was lost without a
+ * restart.  Clients compare the verifier of their WRITEs and COMMIT
+ * and send again what they did not see committed.  A reader copying
+ * the verifier meanwhile gets a mix of old and new bytes, which is
+ * still different from the old verifier.
+ */
+void nfs_change_write_verifier(void)
+{
+	(void)atomic_inc_uint64_t(&write_verifier_epoch);
+	nfs_set_write_verifier();
+}
+
 /**
  * @brief Start NFS service
  *
@@ -820,21 +862,9 @@ void nfs_start(nfs_start_info_t *p_start_info)
 	/* Make sure Ganesha runs with a 0000 umask. */
 	umask(0000);
 
-	{
-		/* Set the write verifiers */
-		union {
-			verifier4 NFS4_write_verifier;
-			writeverf3 NFS3_write_verifier;
-			uint64_t epoch;
-		} build_verifier;
-
-		build_verifier.epoch = (uint64_t) ServerEpoch;
-
-		memcpy(NFS3_write_verifier, build_verifier.NFS3_write_verifier,
-		       sizeof(NFS3_write_verifier));
-		memcpy(NFS4_write_verifier, build_verifier.NFS4_write_verifier,
-		       sizeof(NFS4_write_verifier));
-	}
+	/* Set the write verifiers */
+	write_verifier_epoch = (uint64_t) ServerEpoch;
+	nfs_set_write_verifier();
 
 #ifdef USE_CAPS
 	lower_my_caps();
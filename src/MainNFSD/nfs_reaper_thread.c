@@ -34,6 +34,7 @@
 #include "nfs_core.h"
 #include "log.h"
 #include "fridgethr.h"
+#include "timer_wheel.h"
 
 #define REAPER_DELAY 10
 
@@ -41,186 +42,216 @@ unsigned int reaper_delay = REAPER_DELAY;
 
 static struct fridgethr *reaper_fridge;
 
-static int reap_expired_open_owners(hash_table_t *ht_reap)
+/**
+ * @brief Expire a cached open owner whose timer went off
+ *
+ * Open owners are cached with a zero refcount for a lease period
+ * after their last CLOSE.  If the owner was used again since it was
+ * armed, either leave it alone (still in use, it will be armed again
+ * on release) or re-arm it for the new deadline.
+ *
+ * @param[in] entry Timer of the owner
+ * @param[in] tnow  Time the wheel is expiring for
+ * @param[in] arg   Unused
+ */
+
+static void reap_open_owner(struct timer_wheel_entry *entry, time_t tnow,
+			    void *arg)
 {
-	struct rbt_head *head_rbt;
-	struct hash_data *addr = NULL;
-	uint32_t i;
-	int rc;
-	struct rbt_node *pn;
-	int count = 0;
+	state_owner_t *powner = container_of(entry, state_owner_t,
+					     so_owner.so_nfs4_owner.so_expiry);
 	char str[LOG_BUFF_LEN];
 	struct display_buffer dspbuf = {
 			sizeof(str), str, str};
-	state_owner_t *powner;
-	time_t tnow, tclose, texpire;
+	struct hash_latch latch;
+	hash_error_t rc;
+	time_t tclose, texpire;
 	struct gsh_buffdesc buffkey;
 	struct gsh_buffdesc old_value;
 	struct gsh_buffdesc old_key;
 
-	/* For each bucket of the requested hashtable */
-	for (i = 0; i < ht_reap->parameter.index_size; i++) {
-		head_rbt = &ht_reap->partitions[i].rbt;
-
- restart:
-		/* Use the time at the start or restart of a bucket to
-		 * check for validity (don't call time() too many times).
-		 */
-		tnow = time(NULL);
-
-		/* acquire mutex */
-		PTHREAD_RWLOCK_wrlock(&ht_reap->partitions[i].lock);
-
-		/* go through all entries in the red-black-tree */
-		RBT_LOOP(head_rbt, pn) {
-			addr = RBT_OPAQ(pn);
-
-
-			powner = addr->val.addr;
-			count++;
-
-			if (powner->so_type != STATE_OPEN_OWNER_NFSV4) {
-				RBT_INCREMENT(pn);
-				continue;
-			}
-
-			display_owner(&dspbuf, powner);
-
-			/* Cleanup the open owner only if its refcount is zero
-			 * and its last_close_time exceeds the lease_lifetime
-			 */
-			tclose = atomic_fetch_time_t(&powner->so_owner.
-						     so_nfs4_owner.
-						     last_close_time);
-			texpire = tclose + nfs_param.nfsv4_param.lease_lifetime;
-
-			if ((tclose == 0) || (texpire > tnow)) {
-				if (tclose != 0 &&
-					isFullDebug(COMPONENT_STATE)) {
-					LogFullDebug(COMPONENT_STATE,
-							"Did not release CLOSE_PENDING %s, %d seconds left",
-							str,
-							(int) (texpire - tnow));
-				}
-				RBT_INCREMENT(pn);
-				continue;
-			}
-			LogFullDebug(COMPONENT_STATE, "Free {%s}", str);
-			buffkey.addr = powner;
-			buffkey.len = sizeof(*powner);
-
-			atomic_inc_int32_t(&powner->so_refcount);
-			PTHREAD_RWLOCK_unlock(&ht_reap->partitions[i].
-					      lock);
-			rc = HashTable_Del(ht_reap, &buffkey,
-					   &old_key, &old_value);
-
-			if (rc != HASHTABLE_SUCCESS) {
-				LogCrit(COMPONENT_CLIENTID,
-					"Could not remove expired owner %s"
-					" error=%s", str,
-					hash_table_err_to_str(rc));
-			}
-
-			atomic_dec_int32_t(&powner->so_refcount);
-			free_state_owner(powner);
-			goto restart;
+	/* Cleanup the open owner only if its refcount is zero
+	 * and its last_close_time exceeds the lease_lifetime
+	 */
+	tclose = atomic_fetch_time_t(&powner->so_owner.so_nfs4_owner.
+				     last_close_time);
+	if (tclose == 0)
+		return;
 
-		}
-		PTHREAD_RWLOCK_unlock(&ht_reap->partitions[i].lock);
+	texpire = tclose + nfs_param.nfsv4_param.lease_lifetime;
+
+	display_owner(&dspbuf, powner);
+
+	if (texpire > tnow) {
+		LogFullDebug(COMPONENT_STATE,
+			     "Did not release CLOSE_PENDING %s, %d seconds left",
+			     str, (int) (texpire - tnow));
+		timer_wheel_arm(&open_owner_wheel, entry, texpire);
+		return;
 	}
 
-	return count;
-}
+	buffkey.addr = powner;
+	buffkey.len = sizeof(*powner);
 
-static int reap_hash_table(hash_table_t *ht_reap)
-{
-	struct rbt_head *head_rbt;
-	struct hash_data *addr = NULL;
-	uint32_t i;
-	int rc;
-	struct rbt_node *pn;
-	nfs_client_id_t *pclientid;
-	nfs_client_record_t *precord;
-	int count = 0;
+	rc = hashtable_getlatch(ht_nfs4_owner, &buffkey, &old_value, true,
+				&latch);
 
-	/* For each bucket of the requested hashtable */
-	for (i = 0; i < ht_reap->parameter.index_size; i++) {
-		head_rbt = &ht_reap->partitions[i].rbt;
+	if (rc != HASHTABLE_SUCCESS) {
+		/* Already on its way out */
+		if (rc == HASHTABLE_ERROR_NO_SUCH_KEY)
+			hashtable_releaselatched(ht_nfs4_owner, &latch);
+		return;
+	}
+
+	/* Re-check under the latch, get_state_owner may have revived it */
+	if (atomic_fetch_int32_t(&powner->so_refcount) != 0 ||
+	    atomic_fetch_time_t(&powner->so_owner.so_nfs4_owner.
+				last_close_time) != tclose) {
+		hashtable_releaselatched(ht_nfs4_owner, &latch);
+		return;
+	}
 
- restart:
-		/* acquire mutex */
-		PTHREAD_RWLOCK_wrlock(&ht_reap->partitions[i].lock);
+	rc = hashtable_deletelatched(ht_nfs4_owner, &buffkey, &latch,
+				     &old_key, &old_value);
 
-		/* go through all entries in the red-black-tree */
-		RBT_LOOP(head_rbt, pn) {
-			addr = RBT_OPAQ(pn);
+	if (rc != HASHTABLE_SUCCESS) {
+		if (rc == HASHTABLE_ERROR_NO_SUCH_KEY)
+			hashtable_releaselatched(ht_nfs4_owner, &latch);
 
-			pclientid = addr->val.addr;
-			count++;
+		LogCrit(COMPONENT_CLIENTID,
+			"Could not remove expired owner %s error=%s", str,
+			hash_table_err_to_str(rc));
+		return;
+	}
+
+	LogFullDebug(COMPONENT_STATE, "Free {%s}", str);
+	free_state_owner(powner);
+}
+
+static void reaper_inc_client_id_ref(struct gsh_buffdesc *val)
+{
+	inc_client_id_ref(val->addr);
+}
+
+/**
+ * @brief Get a reference on a client ID through its hash table
+ *
+ * The timer holds no reference on the client ID.  One is taken under
+ * the latch of the table it is in, a client ID in neither table is
+ * being expired or freed and is left alone.
+ *
+ * @param[in] pclientid The client ID, only its clientid is read
+ *
+ * @return true if a reference was taken.
+ */
 
-			PTHREAD_MUTEX_lock(&pclientid->cid_mutex);
+static bool reaper_get_client_id(nfs_client_id_t *pclientid)
+{
+	hash_table_t *tables[] = {ht_confirmed_client_id,
+				  ht_unconfirmed_client_id};
+	clientid4 clientid = pclientid->cid_clientid;
+	struct gsh_buffdesc buffkey;
+	struct gsh_buffdesc buffval;
+	size_t i;
+
+	buffkey.addr = &clientid;
+	buffkey.len = sizeof(clientid);
+
+	for (i = 0; i < sizeof(tables) / sizeof(tables[0]); i++) {
+		if (hashtable_getref(tables[i], &buffkey, &buffval,
+				     reaper_inc_client_id_ref) !=
+		    HASHTABLE_SUCCESS)
+			continue;
+		if (buffval.addr == pclientid)
+			return true;
+		/* Another record under the same clientid */
+		dec_client_id_ref(buffval.addr);
+	}
 
-			if (!valid_lease(pclientid)) {
-				char str[LOG_BUFF_LEN];
-				struct display_buffer dspbuf = {
-					sizeof(str), str, str};
-				bool str_valid = false;
+	return false;
+}
 
-				inc_client_id_ref(pclientid);
+/**
+ * @brief Expire a client ID whose lease timer went off
+ *
+ * The lease is renewed without touching the timer, so most of the
+ * time the client is still valid and only needs re-arming for when
+ * the renewed lease runs out.
+ *
+ * Nothing is done unless a reference is got through the client ID
+ * tables, so a client ID being freed is neither revived nor waited
+ * for under its record's cr_mutex.
+ *
+ * @param[in] entry Timer of the client ID
+ * @param[in] tnow  Time the wheel is expiring for
+ * @param[in] arg   Unused
+ */
 
-				/* Take a reference to the client record */
-				precord = pclientid->cid_client_record;
-				inc_client_record_ref(precord);
+static void reap_client_id(struct timer_wheel_entry *entry, time_t tnow,
+			   void *arg)
+{
+	nfs_client_id_t *pclientid =
+	    container_of(entry, nfs_client_id_t, cid_expiry);
+	nfs_client_record_t *precord;
+	char str[LOG_BUFF_LEN];
+	struct display_buffer dspbuf = {
+		sizeof(str), str, str};
+	bool str_valid = false;
+	time_t texpire;
 
-				PTHREAD_MUTEX_unlock(&pclientid->cid_mutex);
+	/* Expired some other way, about to be freed */
+	if (!reaper_get_client_id(pclientid))
+		return;
 
-				PTHREAD_RWLOCK_unlock(&ht_reap->partitions[i].
-						      lock);
+	PTHREAD_MUTEX_lock(&pclientid->cid_mutex);
 
-				if (isDebug(COMPONENT_CLIENTID)) {
-					display_client_id_rec(&dspbuf,
-							      pclientid);
+	if (pclientid->cid_confirmed == EXPIRED_CLIENT_ID) {
+		PTHREAD_MUTEX_unlock(&pclientid->cid_mutex);
+		dec_client_id_ref(pclientid);
+		return;
+	}
 
-					LogFullDebug(COMPONENT_CLIENTID,
-						     "Expire index %d %s", i,
-						     str);
-					str_valid = true;
-				}
+	if (valid_lease(pclientid)) {
+		if (pclientid->cid_lease_reservations != 0)
+			texpire = tnow;
+		else
+			texpire = pclientid->cid_last_renew;
+		texpire += nfs_param.nfsv4_param.lease_lifetime;
+		timer_wheel_arm(&clientid_wheel, entry, texpire);
+		PTHREAD_MUTEX_unlock(&pclientid->cid_mutex);
+		dec_client_id_ref(pclientid);
+		return;
+	}
 
-				/* Take cr_mutex and expire clientid */
-				PTHREAD_MUTEX_lock(&precord->cr_mutex);
+	/* Take a reference to the client record */
+	precord = pclientid->cid_client_record;
+	inc_client_record_ref(precord);
 
-				rc = nfs_client_id_expire(pclientid, false);
+	PTHREAD_MUTEX_unlock(&pclientid->cid_mutex);
 
-				PTHREAD_MUTEX_unlock(&precord->cr_mutex);
+	if (isDebug(COMPONENT_CLIENTID)) {
+		display_client_id_rec(&dspbuf, pclientid);
 
-				dec_client_id_ref(pclientid);
-				dec_client_record_ref(precord);
+		LogFullDebug(COMPONENT_CLIENTID, "Expire %s", str);
+		str_valid = true;
+	}
 
-				if (isFullDebug(COMPONENT_CLIENTID)) {
-					if (!str_valid)
-						display_printf(&dspbuf,
-							       "clientid %p",
-							       pclientid);
-					LogFullDebug(COMPONENT_CLIENTID,
-						     "Reaper done, expired {%s}",
-						     str);
-				}
+	/* Take cr_mutex and expire clientid */
+	PTHREAD_MUTEX_lock(&precord->cr_mutex);
 
-				if (rc)
-					goto restart;
-			} else {
-				PTHREAD_MUTEX_unlock(&pclientid->cid_mutex);
-			}
+	(void) nfs_client_id_expire(pclientid, false);
 
-			RBT_INCREMENT(pn);
-		}
+	PTHREAD_MUTEX_unlock(&precord->cr_mutex);
 
-		PTHREAD_RWLOCK_unlock(&ht_reap->partitions[i].lock);
+	if (isFullDebug(COMPONENT_CLIENTID)) {
+		if (!str_valid)
+			display_printf(&dspbuf, "clientid %p", pclientid);
+		LogFullDebug(COMPONENT_CLIENTID,
+			     "Reaper done, expired {%s}", str);
 	}
 
-	return count;
+	dec_client_id_ref(pclientid);
+	dec_client_record_ref(precord);
 }
 
 struct reaper_state {
@@ -240,6 +271,7 @@ static struct reaper_state reaper_state = {
 static void reaper_run(struct fridgethr_context *ctx)
 {
 	struct reaper_state *rst = ctx->arg;
+	time_t tnow;
 
 	SetNameFunction("reaper");
 	rst->in_grace = nfs_in_grace();
@@ -266,11 +298,12 @@ static void reaper_run(struct fridgethr_context *ctx)
 #endif
 	}
 
-	rst->count =
-	    (reap_hash_table(ht_confirmed_client_id) +
-	     reap_hash_table(ht_unconfirmed_client_id));
-
-	rst->count += reap_expired_open_owners(ht_nfs4_owner);
+	/* Only the client IDs and open owners due by now are looked at */
+	tnow = time(NULL);
+	rst->count = timer_wheel_expire(&clientid_wheel, tnow,
+					reap_client_id, NULL);
+	rst->count += timer_wheel_expire(&open_owner_wheel, tnow,
+					 reap_open_owner, NULL);
 }
 
 int reaper_init(void)
@@ -56,6 +56,11 @@
 #include "nfs_dupreq.h"
 #include "nfs_file_handle.h"
 #include "fridgethr.h"
+#include "server_stats.h"
+#ifdef USE_DBUS
+#include "gsh_dbus.h"
+#include "server_stats_private.h"
+#endif
 
 /**
  * TI-RPC event channels.  Each channel is a thread servicing an event
@@ -86,6 +91,9 @@ const char *req_q_s[N_REQ_QUEUES] = {
 	"REQ_Q_HIGH_LATENCY"
 };
 
+/* requests served per turn of each class */
+static int32_t req_q_weight[N_REQ_QUEUES];
+
 static u_int nfs_rpc_rdvs(SVCXPRT *xprt, SVCXPRT *newxprt, const u_int flags,
 			  void *u_data);
 static bool nfs_rpc_getreq_ng(SVCXPRT *xprt /*, int chan_id */);
@@ -1015,23 +1023,35 @@ request_data_t *nfs_rpc_get_nfsreq(uint32_t __attribute__ ((unused)) flags)
 	return nfsreq;
 }
 
+/**
+ * @brief Number of requests queued on a queue set
+ *
+ * Read without locking, only an estimate.
+ */
+static inline uint32_t nfs_rpc_q_set_size(struct req_q_set *qset)
+{
+	uint32_t size = 0;
+	int ix;
+
+	for (ix = 0; ix < N_REQ_QUEUES; ++ix)
+		size += nfs_rpc_q_class_size(&qset->qset[ix]);
+
+	return size;
+}
+
 uint32_t nfs_rpc_outstanding_reqs_est(void)
 {
 	static uint32_t ctr;
 	static uint32_t nreqs;
-	struct req_q_pair *qpair;
 	uint32_t treqs;
-	int ix;
+	uint32_t ix;
 
 	if ((atomic_inc_uint32_t(&ctr) % 10) != 0)
 		return atomic_fetch_uint32_t(&nreqs);
 
 	treqs = 0;
-	for (ix = 0; ix < N_REQ_QUEUES; ++ix) {
-		qpair = &(nfs_req_st.reqs.nfs_request_q.qset[ix]);
-		treqs += atomic_fetch_uint32_t(&qpair->producer.size);
-		treqs += atomic_fetch_uint32_t(&qpair->consumer.size);
-	}
+	for (ix = 0; ix < nfs_req_st.reqs.nsets; ++ix)
+		treqs += nfs_rpc_q_set_size(&nfs_req_st.reqs.nfs_request_q[ix]);
 
 	atomic_store_uint32_t(&nreqs, treqs);
 	return treqs;
@@ -1159,9 +1179,11 @@ static bool nfs_rpc_cond_stall_xprt(SVCXPRT *xprt)
 void nfs_rpc_queue_init(void)
 {
 	struct fridgethr_params reqparams;
-	struct req_q_pair *qpair;
+	struct req_q_set *qset;
+	struct req_q_class *qclass;
+	uint32_t nsets, set;
 	int rc = 0;
-	int ix;
+	int ix, flow;
 
 	memset(&reqparams, 0, sizeof(struct fridgethr_params));
     /**
@@ -1181,19 +1203,55 @@ void nfs_rpc_queue_init(void)
 		LogFatal(COMPONENT_DISPATCH,
 			 "Unable to initialize decoder thread pool: %d", rc);
 
-	/* queues */
-	pthread_spin_init(&nfs_req_st.reqs.sp, PTHREAD_PROCESS_PRIVATE);
+	/* class weights */
+	req_q_weight[REQ_Q_MOUNT] = nfs_param.core_param.dispatch_weight_mount;
+	req_q_weight[REQ_Q_CALL] = nfs_param.core_param.dispatch_weight_call;
+	req_q_weight[REQ_Q_LOW_LATENCY] =
+	    nfs_param.core_param.dispatch_weight_low_latency;
+	req_q_weight[REQ_Q_HIGH_LATENCY] =
+	    nfs_param.core_param.dispatch_weight_high_latency;
+
+	/* queues, one set per CPU unless configured */
+	nsets = nfs_param.core_param.dispatch_queue_sets;
+	if (nsets == 0) {
+		long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+
+		nsets = ncpu > 0 ? ncpu : 1;
+	}
+
+	nfs_req_st.reqs.nfs_request_q =
+	    gsh_malloc_aligned(CACHE_LINE_SIZE,
+			       nsets * sizeof(struct req_q_set));
+	if (nfs_req_st.reqs.nfs_request_q == NULL)
+		LogFatal(COMPONENT_DISPATCH,
+			 "Unable to allocate %u request queue sets", nsets);
+
+	memset(nfs_req_st.reqs.nfs_request_q, 0,
+	       nsets * sizeof(struct req_q_set));
+	nfs_req_st.reqs.nsets = nsets;
 	nfs_req_st.reqs.size = 0;
-	for (ix = 0; ix < N_REQ_QUEUES; ++ix) {
-		qpair = &(nfs_req_st.reqs.nfs_request_q.qset[ix]);
-		qpair->s = req_q_s[ix];
-		nfs_rpc_q_init(&qpair->producer);
-		nfs_rpc_q_init(&qpair->consumer);
+
+	for (set = 0; set < nsets; ++set) {
+		qset = &nfs_req_st.reqs.nfs_request_q[set];
+		for (ix = 0; ix < N_REQ_QUEUES; ++ix) {
+			qclass = &(qset->qset[ix]);
+			qclass->s = req_q_s[ix];
+			for (flow = 0; flow < REQ_Q_FLOWS; ++flow)
+				nfs_rpc_q_init(&qclass->flow[flow]);
+		}
+
+		/* scheduler */
+		pthread_spin_init(&qset->sched_sp, PTHREAD_PROCESS_PRIVATE);
+		qset->cur = 0;
+		qset->deficit[0] = req_q_weight[0];
+
+		/* waitq */
+		pthread_spin_init(&qset->sp, PTHREAD_PROCESS_PRIVATE);
+		glist_init(&qset->wait_list);
+		qset->waiters = 0;
 	}
 
-	/* waitq */
-	glist_init(&nfs_req_st.reqs.wait_list);
-	nfs_req_st.reqs.waiters = 0;
+	LogInfo(COMPONENT_DISPATCH, "Using %u request queue sets", nsets);
 
 	/* stallq */
 	gsh_mutex_init(&nfs_req_st.stallq.mtx, NULL);
@@ -1215,13 +1273,106 @@ uint32_t get_dequeue_count()
 	return dequeued_reqs;
 }
 
+/**
+ * @brief Hand off to one waiting worker
+ *
+ * Workers sleeping on the given set are preferred, the other sets are
+ * tried next since their workers will steal the request.
+ *
+ * @param[in] home The set a request was queued on
+ *
+ * @return true if a worker was woken.
+ */
+static bool nfs_rpc_wake_one(struct req_q_set *home)
+{
+	struct req_q_set *qset;
+	wait_q_entry_t *wqe;
+	uint32_t nsets = nfs_req_st.reqs.nsets;
+	uint32_t first = home - nfs_req_st.reqs.nfs_request_q;
+	uint32_t ix;
+
+	for (ix = 0; ix < nsets; ++ix) {
+		qset = &nfs_req_st.reqs.nfs_request_q[(first + ix) % nsets];
+
+		/* unlocked peek, a worker registering concurrently
+		 * re-scans the queues before sleeping */
+		if (atomic_fetch_uint32_t(&qset->waiters) == 0)
+			continue;
+
+		/* SPIN LOCKED */
+		pthread_spin_lock(&qset->sp);
+		if (qset->waiters == 0) {
+			pthread_spin_unlock(&qset->sp);
+			continue;
+		}
+
+		wqe = glist_first_entry(&qset->wait_list, wait_q_entry_t,
+					waitq);
+
+		LogFullDebug(COMPONENT_DISPATCH,
+			     "set %u waiters %u signal wqe %p",
+			     (first + ix) % nsets, qset->waiters, wqe);
+
+		/* release 1 waiter */
+		glist_del(&wqe->waitq);
+		atomic_dec_uint32_t(&qset->waiters);
+		--(wqe->waiters);
+		/* ! SPIN LOCKED */
+		pthread_spin_unlock(&qset->sp);
+		PTHREAD_MUTEX_lock(&wqe->lwe.mtx);
+		/* XXX reliable handoff */
+		wqe->flags |= Wqe_LFlag_SyncDone;
+		if (wqe->flags & Wqe_LFlag_WaitSync)
+			pthread_cond_signal(&wqe->lwe.cv);
+		PTHREAD_MUTEX_unlock(&wqe->lwe.mtx);
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * @brief Pick the flow of a request within its class
+ *
+ * Requests are hashed by client address without the port, so all the
+ * connections of a client share a flow.
+ *
+ * @param[in] qclass The class
+ * @param[in] req    The request
+ *
+ * @return The flow queue.
+ */
+static inline struct req_q *nfs_rpc_q_flow(struct req_q_class *qclass,
+					   request_data_t *req)
+{
+	sockaddr_t addr;
+	uint64_t hash = 0;
+
+	switch (req->rtype) {
+	case NFS_REQUEST:
+		if (copy_xprt_addr(&addr, req->r_u.nfs->xprt))
+			hash = hash_sockaddr(&addr, true);
+		break;
+#ifdef _USE_9P
+	case _9P_REQUEST:
+		hash = hash_sockaddr(&req->r_u._9p.pconn->addrpeer, true);
+		break;
+#endif
+	default:
+		break;
+	}
+
+	hash *= 0x9e3779b97f4a7c15ULL;
+	return &qclass->flow[(hash >> 32) % REQ_Q_FLOWS];
+}
+
 void nfs_rpc_enqueue_req(request_data_t *req)
 {
 	struct req_q_set *nfs_request_q;
-	struct req_q_pair *qpair;
+	struct req_q_class *qclass;
 	struct req_q *q;
 
-	nfs_request_q = &nfs_req_st.reqs.nfs_request_q;
+	nfs_request_q = &nfs_req_st.reqs.nfs_request_q[nfs_rpc_q_set_self()];
 
 	switch (req->rtype) {
 	case NFS_REQUEST:
@@ -1230,22 +1381,22 @@ void nfs_rpc_enqueue_req(request_data_t *req)
 			     req->r_u.nfs->req.rq_xid,
 			     req->r_u.nfs->lookahead.flags);
 		if (req->r_u.nfs->lookahead.flags & NFS_LOOKAHEAD_MOUNT) {
-			qpair = &(nfs_request_q->qset[REQ_Q_MOUNT]);
+			qclass = &(nfs_request_q->qset[REQ_Q_MOUNT]);
 			break;
 		}
 		if (NFS_LOOKAHEAD_HIGH_LATENCY(req->r_u.nfs->lookahead))
-			qpair = &(nfs_request_q->qset[REQ_Q_HIGH_LATENCY]);
+			qclass = &(nfs_request_q->qset[REQ_Q_HIGH_LATENCY]);
 		else
-			qpair = &(nfs_request_q->qset[REQ_Q_LOW_LATENCY]);
+			qclass = &(nfs_request_q->qset[REQ_Q_LOW_LATENCY]);
 		break;
 	case NFS_CALL:
-		qpair = &(nfs_request_q->qset[REQ_Q_CALL]);
+		qclass = &(nfs_request_q->qset[REQ_Q_CALL]);
 		break;
 #ifdef _USE_9P
 	case _9P_REQUEST:
 		/* XXX identify high-latency requests and allocate
 		 * to the high-latency queue, as above */
-		qpair = &(nfs_request_q->qset[REQ_Q_LOW_LATENCY]);
+		qclass = &(nfs_request_q->qset[REQ_Q_LOW_LATENCY]);
 		break;
 #endif
 	default:
@@ -1256,8 +1407,7 @@ void nfs_rpc_enqueue_req(request_data_t *req)
 	/* this one is real, timestamp it
 	 */
 	now(&req->time_queued);
-	/* always append to producer queue */
-	q = &qpair->producer;
+	q = nfs_rpc_q_flow(qclass, req);
 	pthread_spin_lock(&q->sp);
 	glist_add_tail(&q->q, &req->req_q);
 	++(q->size);
@@ -1266,172 +1416,209 @@ void nfs_rpc_enqueue_req(request_data_t *req)
 	atomic_inc_uint32_t(&enqueued_reqs);
 
 	LogDebug(COMPONENT_DISPATCH,
-		 "enqueued req, q %p (%s %p:%p) " "size is %d (enq %u deq %u)",
-		 q, qpair->s, &qpair->producer, &qpair->consumer, q->size,
+		 "enqueued req, q %p (%s flow %td) size is %d (enq %u deq %u)",
+		 q, qclass->s, q - qclass->flow, q->size,
 		 enqueued_reqs, dequeued_reqs);
 
-	/* potentially wakeup some thread */
-
-	/* global waitq */
-	{
-		wait_q_entry_t *wqe;
+	/* Also orders the insert before the peek at the waiters */
+	atomic_inc_uint64_t(&nfs_request_q->enqueued);
 
-		/* SPIN LOCKED */
-		pthread_spin_lock(&nfs_req_st.reqs.sp);
-		if (nfs_req_st.reqs.waiters) {
-			wqe = glist_first_entry(&nfs_req_st.reqs.wait_list,
-						wait_q_entry_t, waitq);
-
-			LogFullDebug(COMPONENT_DISPATCH,
-				     "nfs_req_st.reqs.waiters %u signal wqe %p (for q %p)",
-				     nfs_req_st.reqs.waiters, wqe, q);
-
-			/* release 1 waiter */
-			glist_del(&wqe->waitq);
-			--(nfs_req_st.reqs.waiters);
-			--(wqe->waiters);
-			/* ! SPIN LOCKED */
-			pthread_spin_unlock(&nfs_req_st.reqs.sp);
-			PTHREAD_MUTEX_lock(&wqe->lwe.mtx);
-			/* XXX reliable handoff */
-			wqe->flags |= Wqe_LFlag_SyncDone;
-			if (wqe->flags & Wqe_LFlag_WaitSync)
-				pthread_cond_signal(&wqe->lwe.cv);
-			PTHREAD_MUTEX_unlock(&wqe->lwe.mtx);
-		} else
-			/* ! SPIN LOCKED */
-			pthread_spin_unlock(&nfs_req_st.reqs.sp);
-	}
+	/* potentially wakeup some thread */
+	nfs_rpc_wake_one(nfs_request_q);
 
  out:
 	return;
 }
 
-/* static inline */
-request_data_t *nfs_rpc_consume_req(struct req_q_pair *qpair)
+/**
+ * @brief Take a request from a class
+ *
+ * The flows are served in turn, starting with the one after the flow
+ * served last.
+ *
+ * @param[in] qclass The class
+ *
+ * @return A request or NULL.
+ */
+static request_data_t *nfs_rpc_consume_req(struct req_q_class *qclass)
 {
 	request_data_t *nfsreq = NULL;
+	struct req_q *q;
+	uint32_t ix, flow;
+
+	flow = atomic_inc_uint32_t(&qclass->next);
+	for (ix = 0; ix < REQ_Q_FLOWS; ++ix, ++flow) {
+		q = &qclass->flow[flow % REQ_Q_FLOWS];
+		if (atomic_fetch_uint32_t(&q->size) == 0)
+			continue;
+
+		pthread_spin_lock(&q->sp);
+		if (q->size > 0) {
+			nfsreq = glist_first_entry(&q->q, request_data_t,
+						   req_q);
+			glist_del(&nfsreq->req_q);
+			--(q->size);
+			pthread_spin_unlock(&q->sp);
+			LogFullDebug(COMPONENT_DISPATCH,
+				     "consumed req from %s flow %u, qsize=%u",
+				     qclass->s, flow % REQ_Q_FLOWS, q->size);
+			break;
+		}
+		pthread_spin_unlock(&q->sp);
+	}
 
-	pthread_spin_lock(&qpair->consumer.sp);
-	if (qpair->consumer.size > 0) {
-		nfsreq =
-		    glist_first_entry(&qpair->consumer.q, request_data_t,
-				      req_q);
-		glist_del(&nfsreq->req_q);
-		--(qpair->consumer.size);
-		pthread_spin_unlock(&qpair->consumer.sp);
-		goto out;
-	} else {
-		char *s = NULL;
-		uint32_t csize = ~0U;
-		uint32_t psize = ~0U;
-
-		pthread_spin_lock(&qpair->producer.sp);
-		if (isFullDebug(COMPONENT_DISPATCH)) {
-			s = (char *)qpair->s;
-			csize = qpair->consumer.size;
-			psize = qpair->producer.size;
+	return nfsreq;
+}
+
+/**
+ * @brief Take a request from one queue set
+ *
+ * Deficit round robin over the classes, see struct req_q_set.
+ *
+ * @param[in]  nfs_request_q The set
+ * @param[out] qclass        Class the request was queued in
+ *
+ * @return A request or NULL.
+ */
+static request_data_t *nfs_rpc_dequeue_set(struct req_q_set *nfs_request_q,
+					   uint32_t *qclass)
+{
+	request_data_t *nfsreq;
+	uint32_t ix, turn;
+
+	/* every class gets a look before giving up */
+	for (turn = 0; turn <= N_REQ_QUEUES; ++turn) {
+		pthread_spin_lock(&nfs_request_q->sched_sp);
+		ix = nfs_request_q->cur;
+		if (nfs_request_q->deficit[ix] <= 0) {
+			ix = (ix + 1) % N_REQ_QUEUES;
+			nfs_request_q->cur = ix;
+			nfs_request_q->deficit[ix] += req_q_weight[ix];
 		}
-		if (qpair->producer.size > 0) {
-			/* splice */
-			glist_splice_tail(&qpair->consumer.q,
-					  &qpair->producer.q);
-			qpair->consumer.size = qpair->producer.size;
-			qpair->producer.size = 0;
-			/* consumer.size > 0 */
-			pthread_spin_unlock(&qpair->producer.sp);
-			nfsreq =
-			    glist_first_entry(&qpair->consumer.q,
-					      request_data_t, req_q);
-			glist_del(&nfsreq->req_q);
-			--(qpair->consumer.size);
-			pthread_spin_unlock(&qpair->consumer.sp);
-			if (s)
-				LogFullDebug(COMPONENT_DISPATCH,
-					     "try splice, qpair %s consumer qsize=%u "
-					     "producer qsize=%u", s, csize,
-					     psize);
-			goto out;
+		--(nfs_request_q->deficit[ix]);
+		pthread_spin_unlock(&nfs_request_q->sched_sp);
+
+		nfsreq = nfs_rpc_consume_req(&nfs_request_q->qset[ix]);
+		if (nfsreq) {
+			*qclass = ix;
+			return nfsreq;
 		}
 
-		pthread_spin_unlock(&qpair->producer.sp);
-		pthread_spin_unlock(&qpair->consumer.sp);
+		/* an empty class gives up its turn */
+		pthread_spin_lock(&nfs_request_q->sched_sp);
+		if (nfs_request_q->cur == ix)
+			nfs_request_q->deficit[ix] = 0;
+		pthread_spin_unlock(&nfs_request_q->sched_sp);
+	}
 
-		if (s)
+	return NULL;
+}
+
+/**
+ * @brief Take a request from any queue set
+ *
+ * The home set comes first, then the others are stolen from.  Sets
+ * that look empty are skipped without taking their locks.
+ *
+ * @param[in] home Index of the home set
+ *
+ * @return A request or NULL.
+ */
+static request_data_t *nfs_rpc_dequeue_any(uint32_t home)
+{
+	request_data_t *nfsreq;
+	struct req_q_set *victim;
+	struct timespec ts;
+	uint32_t nsets = nfs_req_st.reqs.nsets;
+	uint32_t ix, qclass;
+
+	nfsreq = nfs_rpc_dequeue_set(&nfs_req_st.reqs.nfs_request_q[home],
+				     &qclass);
+	if (nfsreq)
+		goto out;
+
+	for (ix = 1; ix < nsets; ++ix) {
+		victim = &nfs_req_st.reqs.nfs_request_q[(home + ix) % nsets];
+		if (nfs_rpc_q_set_size(victim) == 0)
+			continue;
+		nfsreq = nfs_rpc_dequeue_set(victim, &qclass);
+		if (nfsreq) {
+			atomic_inc_uint64_t(&victim->stolen);
 			LogFullDebug(COMPONENT_DISPATCH,
-				     "try splice, qpair %s consumer qsize=%u "
-				     "producer qsize=%u", s, csize, psize);
+				     "set %u stole from set %u", home,
+				     (home + ix) % nsets);
+			goto out;
+		}
 	}
+
+	return NULL;
+
  out:
+	atomic_inc_uint32_t(&dequeued_reqs);
+	now(&ts);
+	server_stats_queue_wait(qclass,
+				timespec_diff(&nfsreq->time_queued, &ts));
 	return nfsreq;
 }
 
 request_data_t *nfs_rpc_dequeue_req(nfs_worker_data_t *worker)
 {
 	request_data_t *nfsreq = NULL;
-	struct req_q_set *nfs_request_q = &nfs_req_st.reqs.nfs_request_q;
-	struct req_q_pair *qpair;
-	uint32_t ix, slot;
+	struct req_q_set *nfs_request_q;
 	struct timespec timeout;
+	uint32_t home;
 
-	/* XXX: the following stands in for a more robust/flexible
-	 * weighting function */
-
-	/* slot in 1..4 */
  retry_deq:
-	slot = (nfs_rpc_q_next_slot() % 4);
-	for (ix = 0; ix < 4; ++ix) {
-		switch (slot) {
-		case 0:
-			/* MOUNT */
-			qpair = &(nfs_request_q->qset[REQ_Q_MOUNT]);
-			break;
-		case 1:
-			/* NFS_CALL */
-			qpair = &(nfs_request_q->qset[REQ_Q_CALL]);
-			break;
-		case 2:
-			/* LL */
-			qpair = &(nfs_request_q->qset[REQ_Q_LOW_LATENCY]);
-			break;
-		case 3:
-			/* HL */
-			qpair = &(nfs_request_q->qset[REQ_Q_HIGH_LATENCY]);
-			break;
-		default:
-			/* not here */
-			abort();
-			break;
-		}
-
-		LogFullDebug(COMPONENT_DISPATCH,
-			     "dequeue_req try qpair %s %p:%p", qpair->s,
-			     &qpair->producer, &qpair->consumer);
-
-		/* anything? */
-		nfsreq = nfs_rpc_consume_req(qpair);
-		if (nfsreq) {
-			atomic_inc_uint32_t(&dequeued_reqs);
-			break;
-		}
-
-		++slot;
-		slot = slot % 4;
-
-	}			/* for */
+	home = nfs_rpc_q_set_self();
+	nfsreq = nfs_rpc_dequeue_any(home);
 
 	/* wait */
 	if (!nfsreq) {
 		wait_q_entry_t *wqe = &worker->wqe;
+
+		nfs_request_q = &nfs_req_st.reqs.nfs_request_q[home];
 		assert(wqe->waiters == 0); /* wqe is not on any wait queue */
 		PTHREAD_MUTEX_lock(&wqe->lwe.mtx);
 		wqe->flags = Wqe_LFlag_WaitSync;
 		wqe->waiters = 1;
 		/* XXX functionalize */
-		pthread_spin_lock(&nfs_req_st.reqs.sp);
-		glist_add_tail(&nfs_req_st.reqs.wait_list, &wqe->waitq);
-		++(nfs_req_st.reqs.waiters);
-		pthread_spin_unlock(&nfs_req_st.reqs.sp);
+		pthread_spin_lock(&nfs_request_q->sp);
+		glist_add_tail(&nfs_request_q->wait_list, &wqe->waitq);
+		atomic_inc_uint32_t(&nfs_request_q->waiters);
+		pthread_spin_unlock(&nfs_request_q->sp);
+
+		/* A request queued while we were registering may have
+		 * found no waiter, look again before sleeping. */
+		nfsreq = nfs_rpc_dequeue_any(home);
+		if (nfsreq) {
+			bool handed_off = false;
+
+			pthread_spin_lock(&nfs_request_q->sp);
+			if (wqe->waitq.next != NULL
+			    || wqe->waitq.prev != NULL) {
+				glist_del(&wqe->waitq);
+				atomic_dec_uint32_t(&nfs_request_q->waiters);
+				--(wqe->waiters);
+			} else {
+				/* An enqueuer picked us, pass it on */
+				handed_off = true;
+			}
+			pthread_spin_unlock(&nfs_request_q->sp);
+			/* The enqueuer still has to mark the handoff done
+			 * under our mutex, don't let it touch a wqe we are
+			 * already reusing. */
+			while (handed_off
+			       && !(wqe->flags & Wqe_LFlag_SyncDone))
+				pthread_cond_wait(&wqe->lwe.cv,
+						  &wqe->lwe.mtx);
+			wqe->flags &= ~(Wqe_LFlag_WaitSync |
+					Wqe_LFlag_SyncDone);
+			PTHREAD_MUTEX_unlock(&wqe->lwe.mtx);
+			if (handed_off)
+				(void)nfs_rpc_wake_one(nfs_request_q);
+			return nfsreq;
+		}
+
 		while (!(wqe->flags & Wqe_LFlag_SyncDone)) {
 			timeout.tv_sec = time(NULL) + 5;
 			timeout.tv_nsec = 0;
@@ -1440,25 +1627,26 @@ request_data_t *nfs_rpc_dequeue_req(nfs_worker_data_t *worker)
 			if (fridgethr_you_should_break(worker->ctx)) {
 				/* We are returning;
 				 * so take us out of the waitq */
-				pthread_spin_lock(&nfs_req_st.reqs.sp);
+				pthread_spin_lock(&nfs_request_q->sp);
 				if (wqe->waitq.next != NULL
 				    || wqe->waitq.prev != NULL) {
 					/* Element is still in wqitq,
 					 * remove it */
 					glist_del(&wqe->waitq);
-					--(nfs_req_st.reqs.waiters);
+					atomic_dec_uint32_t(
+						&nfs_request_q->waiters);
 					--(wqe->waiters);
 					wqe->flags &=
 					    ~(Wqe_LFlag_WaitSync |
 					      Wqe_LFlag_SyncDone);
 				}
-				pthread_spin_unlock(&nfs_req_st.reqs.sp);
+				pthread_spin_unlock(&nfs_request_q->sp);
 				PTHREAD_MUTEX_unlock(&wqe->lwe.mtx);
 				return NULL;
 			}
 		}
 
-		/* XXX wqe was removed from nfs_req_st.waitq
+		/* XXX wqe was removed from the set's wait list
 		 * (by signalling thread) */
 		wqe->flags &= ~(Wqe_LFlag_WaitSync | Wqe_LFlag_SyncDone);
 		PTHREAD_MUTEX_unlock(&wqe->lwe.mtx);
@@ -1469,6 +1657,54 @@ request_data_t *nfs_rpc_dequeue_req(nfs_worker_data_t *worker)
 	return nfsreq;
 }
 
+#ifdef USE_DBUS
+/**
+ * @brief Report depth and counters of each queue set
+ *
+ * @param[in,out] iter Reply iterator
+ */
+void nfs_rpc_queue_dbus_show(DBusMessageIter *iter)
+{
+	struct timespec timestamp;
+	DBusMessageIter array_iter, struct_iter;
+	struct req_q_set *qset;
+	uint32_t set, depth;
+	uint64_t counter;
+	int ix;
+
+	now(&timestamp);
+	dbus_append_timestamp(iter, &timestamp);
+
+	dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY,
+					 REQ_QUEUES_REPLY_ARRAY_TYPE,
+					 &array_iter);
+	for (set = 0; set < nfs_req_st.reqs.nsets; ++set) {
+		qset = &nfs_req_st.reqs.nfs_request_q[set];
+		dbus_message_iter_open_container(&array_iter,
+						 DBUS_TYPE_STRUCT, NULL,
+						 &struct_iter);
+		dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT32,
+					       &set);
+		for (ix = 0; ix < N_REQ_QUEUES; ++ix) {
+			depth = nfs_rpc_q_class_size(&qset->qset[ix]);
+			dbus_message_iter_append_basic(&struct_iter,
+						       DBUS_TYPE_UINT32,
+						       &depth);
+		}
+		counter = atomic_fetch_uint64_t(&qset->enqueued);
+		dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+					       &counter);
+		counter = atomic_fetch_uint64_t(&qset->stolen);
+		dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+					       &counter);
+		dbus_message_iter_close_container(&array_iter, &struct_iter);
+	}
+	dbus_message_iter_close_container(iter, &array_iter);
+
+	server_dbus_queue_wait(iter);
+}
+#endif				/* USE_DBUS */
+
 /**
  * @brief Allocate a new request
  *
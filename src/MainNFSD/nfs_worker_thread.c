@@ -60,6 +60,7 @@
 #include "export_mgr.h"
 #include "server_stats.h"
 #include "uid2grp.h"
+#include "delayed_exec.h"
 
 #ifdef USE_LTTNG
 #include "gsh_lttng/nfs_rpc.h"
@@ -694,14 +695,261 @@ const nfs_function_desc_t *nfs_rpc_get_funcdesc(nfs_request_data_t *reqnfs)
 	return funcdesc;
 }
 
+/**
+ * @brief Find the export and data size a request is charged for
+ *
+ * NFSv3 requests carry the handle first.  An NFSv4 compound is
+ * charged to the export of its first PUTFH, with the data of all of
+ * its READ and WRITE operations.  Other programs are not limited.
+ *
+ * @param[in]  reqnfs NFS request
+ * @param[out] bytes  Data read or written
+ *
+ * @return The export id, or -1 if the request is not limited.
+ */
+
+static int nfs_rpc_limit_export_id(nfs_request_data_t *reqnfs,
+				   uint64_t *bytes)
+{
+	struct svc_req *svcreq = &reqnfs->req;
+	nfs_arg_t *arg_nfs = &reqnfs->arg_nfs;
+	nfs_argop4 *argop;
+	int exportid = -1;
+	u_int i;
+
+	*bytes = 0;
+
+	if (reqnfs->funcdesc == &invalid_funcdesc
+	    || svcreq->rq_proc == NFSPROC_NULL
+	    || svcreq->rq_prog != nfs_param.core_param.program[P_NFS])
+		return -1;
+
+	if (svcreq->rq_vers == NFS_V3) {
+		if (svcreq->rq_proc == NFSPROC3_READ)
+			*bytes = arg_nfs->arg_read3.count;
+		else if (svcreq->rq_proc == NFSPROC3_WRITE)
+			*bytes = arg_nfs->arg_write3.data.data_len;
+		return nfs3_FhandleToExportId((nfs_fh3 *) arg_nfs);
+	}
+
+	for (i = 0; i < arg_nfs->arg_compound4.argarray.argarray_len; i++) {
+		argop = &arg_nfs->arg_compound4.argarray.argarray_val[i];
+
+		switch (argop->argop) {
+		case NFS4_OP_PUTFH:
+			if (exportid >= 0 ||
+			    nfs4_Is_Fh_Invalid(&argop->nfs_argop4_u.opputfh
+					       .object) != NFS4_OK ||
+			    nfs4_Is_Fh_DSHandle(&argop->nfs_argop4_u.opputfh
+						.object))
+				break;
+			exportid = ((struct file_handle_v4 *)
+				    argop->nfs_argop4_u.opputfh.object
+				    .nfs_fh4_val)->id.exports;
+			break;
+		case NFS4_OP_READ:
+			*bytes += argop->nfs_argop4_u.opread.count;
+			break;
+		case NFS4_OP_WRITE:
+			*bytes += argop->nfs_argop4_u.opwrite.data.data_len;
+			break;
+		default:
+			break;
+		}
+	}
+
+	return exportid;
+}
+
+static void nfs_rpc_limit_requeue(void *arg)
+{
+	nfs_rpc_enqueue_req(arg);
+}
+
+/**
+ * @brief Check whether the caller may use the export of a request
+ *
+ * Applies the export, protocol, transport, security and port checks
+ * to the permissions export_check_access computed for op_ctx->export.
+ *
+ * @param[in] reqnfs           NFS request
+ * @param[in] protocol_options Protocol the request is for
+ * @param[in] progname         Program name to log
+ * @param[in] client_ip        Client address to log, NULL not to log
+ *
+ * @return AUTH_OK if the request is let in, else why not.
+ */
+
+static enum auth_stat nfs_rpc_check_export(nfs_request_data_t *reqnfs,
+					   int protocol_options,
+					   const char *progname,
+					   const char *client_ip)
+{
+	struct svc_req *svcreq = &reqnfs->req;
+	xprt_type_t xprt_type = svc_get_xprt_type(reqnfs->xprt);
+	uint32_t options = op_ctx->export_perms->options;
+	int port = get_port(op_ctx->caller_addr);
+
+	if (options == 0) {
+		if (client_ip != NULL)
+			LogInfoAlt(COMPONENT_DISPATCH, COMPONENT_EXPORT,
+				"Client %s is not allowed to access Export_Id %d %s, vers=%d, proc=%d",
+				client_ip,
+				op_ctx->export->export_id,
+				op_ctx->export->fullpath,
+				(int)svcreq->rq_vers, (int)svcreq->rq_proc);
+		return AUTH_TOOWEAK;
+	}
+
+	/* Check protocol version */
+	if ((protocol_options & EXPORT_OPTION_PROTOCOLS) == 0) {
+		if (client_ip != NULL)
+			LogCrit(COMPONENT_DISPATCH,
+				"Problem, request requires export but does not have a protocol version");
+		return AUTH_FAILED;
+	}
+
+	if ((protocol_options & options) == 0) {
+		if (client_ip != NULL)
+			LogInfoAlt(COMPONENT_DISPATCH, COMPONENT_EXPORT,
+				"%s Version %d not allowed on Export_Id %d %s for client %s",
+				progname, svcreq->rq_vers,
+				op_ctx->export->export_id,
+				op_ctx->export->fullpath,
+				client_ip);
+		return AUTH_FAILED;
+	}
+
+	/* Check transport type */
+	if (((xprt_type == XPRT_UDP)
+	     && ((options & EXPORT_OPTION_UDP) == 0))
+	    || ((xprt_type == XPRT_TCP)
+		&& ((options & EXPORT_OPTION_TCP) == 0))) {
+		if (client_ip != NULL)
+			LogInfoAlt(COMPONENT_DISPATCH, COMPONENT_EXPORT,
+				"%s Version %d over %s not allowed on Export_Id %d %s for client %s",
+				progname, svcreq->rq_vers,
+				xprt_type_to_str(xprt_type),
+				op_ctx->export->export_id,
+				op_ctx->export->fullpath,
+				client_ip);
+		return AUTH_FAILED;
+	}
+
+	/* Test if export allows the authentication provided */
+	if (((reqnfs->funcdesc->dispatch_behaviour & SUPPORTS_GSS) != 0) &&
+	    !export_check_security(svcreq)) {
+		if (client_ip != NULL)
+			LogInfoAlt(COMPONENT_DISPATCH, COMPONENT_EXPORT,
+				"%s Version %d auth not allowed on Export_Id %d %s for client %s",
+				progname, svcreq->rq_vers,
+				op_ctx->export->export_id,
+				op_ctx->export->fullpath,
+				client_ip);
+		return AUTH_TOOWEAK;
+	}
+
+	/* Check if client is using a privileged port,
+	 * but only for NFS protocol */
+	if ((svcreq->rq_prog == nfs_param.core_param.program[P_NFS])
+	    && ((options & EXPORT_OPTION_PRIVILEGED_PORT) != 0)
+	    && (port >= IPPORT_RESERVED)) {
+		if (client_ip != NULL)
+			LogInfoAlt(COMPONENT_DISPATCH, COMPONENT_EXPORT,
+				"Non-reserved Port %d is not allowed on Export_Id %d %s for client %s",
+				port, op_ctx->export->export_id,
+				op_ctx->export->fullpath,
+				client_ip);
+		return AUTH_TOOWEAK;
+	}
+
+	return AUTH_OK;
+}
+
+/**
+ * @brief Defer a request over the rate limits of its export
+ *
+ * Called once the client is known and before the duplicate request
+ * cache sees the request, so a deferred request leaves no trace.  It
+ * is queued again once the limits allow it.  Only requests the export
+ * would let in are charged.
+ *
+ * The permissions computed for a rate limited export are handed back
+ * with a reference on it, so that nfs_rpc_execute does not compute
+ * them again.
+ *
+ * @param[in]  req     Request
+ * @param[out] checked Export the permissions are for, or NULL
+ * @param[out] perms   Permissions of the client on it
+ *
+ * @return true if the request was deferred.
+ */
+
+static bool nfs_rpc_limit(request_data_t *req, struct gsh_export **checked,
+			  struct export_perms *perms)
+{
+	struct svc_req *svcreq = &req->r_u.nfs->req;
+	struct export_perms *saved_perms = op_ctx->export_perms;
+	struct gsh_export *export;
+	enum auth_stat auth_rc;
+	nsecs_elapsed_t wait;
+	uint64_t bytes;
+	int exportid;
+
+	*checked = NULL;
+
+	if (atomic_fetch_uint32_t(&export_rate_limits) == 0)
+		return false;
+
+	exportid = nfs_rpc_limit_export_id(req->r_u.nfs, &bytes);
+	if (exportid < 0)
+		return false;
+
+	export = get_gsh_export(exportid);
+	if (export == NULL)
+		return false;
+
+	if (!export->rate_limited) {
+		put_gsh_export(export);
+		return false;
+	}
+
+	op_ctx->export = export;
+	op_ctx->export_perms = perms;
+	export_check_access();
+	auth_rc = nfs_rpc_check_export(req->r_u.nfs,
+				       svcreq->rq_vers == NFS_V3 ?
+				       EXPORT_OPTION_NFSV3 :
+				       EXPORT_OPTION_NFSV4,
+				       NULL, NULL);
+	op_ctx->export_perms = saved_perms;
+	op_ctx->export = NULL;
+	*checked = export;
+
+	/* requests that will be refused are not charged */
+	if (auth_rc != AUTH_OK)
+		return false;
+
+	wait = export_rate_limit(export, op_ctx->caller_addr, bytes);
+	if (wait != 0 &&
+	    delayed_submit(nfs_rpc_limit_requeue, req, wait) == 0) {
+		server_stats_throttled(op_ctx->client, export);
+		return true;
+	}
+
+	return false;
+}
+
 /**
  * @brief Main RPC dispatcher routine
  *
  * @param[in,out] req         NFS request
  * @param[in,out] worker_data Worker thread context
  *
+ * @return true if the request was deferred by the rate limits and
+ *         must not be freed.
  */
-static void nfs_rpc_execute(request_data_t *req,
+static bool nfs_rpc_execute(request_data_t *req,
 			    nfs_worker_data_t *worker_data)
 {
 	nfs_request_data_t *reqnfs = req->r_u.nfs;
@@ -711,6 +959,8 @@ static void nfs_rpc_execute(request_data_t *req,
 	struct svc_req *svcreq = &reqnfs->req;
 	SVCXPRT *xprt = reqnfs->xprt;
 	struct export_perms export_perms;
+	struct export_perms checked_perms;
+	struct gsh_export *checked_export = NULL;
 	int protocol_options = 0;
 	struct user_cred user_credentials;
 	struct req_op_context req_ctx;
@@ -720,6 +970,8 @@ static void nfs_rpc_execute(request_data_t *req,
 	int port, rc = NFS_REQ_OK;
 	enum auth_stat auth_rc;
 	bool slocked = false;
+	bool deferred = false;
+	bool sent;
 	const char *progname = "unknown";
 
 #ifdef USE_LTTNG
@@ -786,6 +1038,14 @@ static void nfs_rpc_execute(request_data_t *req,
 			 (int)svcreq->rq_proc, svcreq->rq_xid);
 	}
 
+	if (nfs_rpc_limit(req, &checked_export, &checked_perms)) {
+		LogFullDebug(COMPONENT_DISPATCH,
+			     "Request xid=%u from %s deferred by rate limits",
+			     svcreq->rq_xid, client_ip);
+		deferred = true;
+		goto out;
+	}
+
 	/* start the processing clock
 	 * we measure all time stats as intervals (elapsed nsecs) from
 	 * server boot time.  This gets high precision with simple 64 bit math.
@@ -820,10 +1080,17 @@ static void nfs_rpc_execute(request_data_t *req,
 				     xprt->xp_fd);
 
 			DISP_SLOCK(xprt);
-			if (svc_sendreply(
-				    xprt, svcreq,
-				    reqnfs->funcdesc->xdr_encode_func,
-			     (caddr_t) res_nfs) == false) {
+			if (reqnfs->reply != NULL)
+				sent = svc_sendreply(
+					xprt, svcreq,
+					(xdrproc_t) xdr_dupreq_reply,
+					(caddr_t) reqnfs->reply);
+			else
+				sent = svc_sendreply(
+					xprt, svcreq,
+					reqnfs->funcdesc->xdr_encode_func,
+					(caddr_t) res_nfs);
+			if (!sent) {
 				LogDebug(COMPONENT_DISPATCH,
 					 "NFS DISPATCHER: FAILURE: Error while calling "
 					 "svc_sendreply on a duplicate request. rpcxid=%u "
@@ -1052,93 +1319,21 @@ static void nfs_rpc_execute(request_data_t *req,
 
 	/* Only do access check if we have an export. */
 	if (op_ctx->export != NULL) {
-		xprt_type_t xprt_type = svc_get_xprt_type(xprt);
-
-		LogMidDebugAlt(COMPONENT_DISPATCH, COMPONENT_EXPORT,
-			    "nfs_rpc_execute about to call nfs_export_check_access for client %s",
-			    client_ip);
-
-		export_check_access();
-
-		if (export_perms.options == 0) {
-			LogInfoAlt(COMPONENT_DISPATCH, COMPONENT_EXPORT,
-				"Client %s is not allowed to access Export_Id %d %s, vers=%d, proc=%d",
-				client_ip,
-				op_ctx->export->export_id,
-				op_ctx->export->fullpath,
-				(int)svcreq->rq_vers, (int)svcreq->rq_proc);
-
-			auth_rc = AUTH_TOOWEAK;
-			goto auth_failure;
-		}
-
-		/* Check protocol version */
-		if ((protocol_options & EXPORT_OPTION_PROTOCOLS) == 0) {
-			LogCrit(COMPONENT_DISPATCH,
-				"Problem, request requires export but does not have a protocol version");
-
-			auth_rc = AUTH_FAILED;
-			goto auth_failure;
-		}
-
-		if ((protocol_options & export_perms.options) == 0) {
-			LogInfoAlt(COMPONENT_DISPATCH, COMPONENT_EXPORT,
-				"%s Version %d not allowed on Export_Id %d %s for client %s",
-				progname, svcreq->rq_vers,
-				op_ctx->export->export_id,
-				op_ctx->export->fullpath,
-				client_ip);
-
-			auth_rc = AUTH_FAILED;
-			goto auth_failure;
-		}
-
-		/* Check transport type */
-		if (((xprt_type == XPRT_UDP)
-		     && ((export_perms.options & EXPORT_OPTION_UDP) == 0))
-		    || ((xprt_type == XPRT_TCP)
-			&& ((export_perms.options & EXPORT_OPTION_TCP) == 0))) {
-			LogInfoAlt(COMPONENT_DISPATCH, COMPONENT_EXPORT,
-				"%s Version %d over %s not allowed on Export_Id %d %s for client %s",
-				progname, svcreq->rq_vers,
-				xprt_type_to_str(xprt_type),
-				op_ctx->export->export_id,
-				op_ctx->export->fullpath,
-				client_ip);
-
-			auth_rc = AUTH_FAILED;
-			goto auth_failure;
-		}
-
-		/* Test if export allows the authentication provided */
-		if (((reqnfs->funcdesc->dispatch_behaviour & SUPPORTS_GSS)
-		      != 0) &&
-		    !export_check_security(svcreq)) {
-			LogInfoAlt(COMPONENT_DISPATCH, COMPONENT_EXPORT,
-				"%s Version %d auth not allowed on Export_Id %d %s for client %s",
-				progname, svcreq->rq_vers,
-				op_ctx->export->export_id,
-				op_ctx->export->fullpath,
-				client_ip);
+		if (op_ctx->export == checked_export) {
+			/* Computed by the rate limits already */
+			export_perms = checked_perms;
+		} else {
+			LogMidDebugAlt(COMPONENT_DISPATCH, COMPONENT_EXPORT,
+				    "nfs_rpc_execute about to call nfs_export_check_access for client %s",
+				    client_ip);
 
-			auth_rc = AUTH_TOOWEAK;
-			goto auth_failure;
+			export_check_access();
 		}
 
-		/* Check if client is using a privileged port,
-		 * but only for NFS protocol */
-		if ((svcreq->rq_prog == nfs_param.core_param.program[P_NFS])
-		    && ((export_perms.options & EXPORT_OPTION_PRIVILEGED_PORT)
-			!= 0) && (port >= IPPORT_RESERVED)) {
-			LogInfoAlt(COMPONENT_DISPATCH, COMPONENT_EXPORT,
-				"Non-reserved Port %d is not allowed on Export_Id %d %s for client %s",
-				port, op_ctx->export->export_id,
-				op_ctx->export->fullpath,
-				client_ip);
-
-			auth_rc = AUTH_TOOWEAK;
+		auth_rc = nfs_rpc_check_export(reqnfs, protocol_options,
+					       progname, client_ip);
+		if (auth_rc != AUTH_OK)
 			goto auth_failure;
-		}
 	}
 
 	/*
@@ -1378,22 +1573,29 @@ static void nfs_rpc_execute(request_data_t *req,
 	}
 
 	/* Finalize the request. */
-	if (res_nfs)
+	if (res_nfs || reqnfs->reply)
 		nfs_dupreq_rele(svcreq, reqnfs->funcdesc);
 
+	if (reqnfs->reply) {
+		dupreq_reply_put(reqnfs->reply);
+		reqnfs->reply = NULL;
+	}
+
 out:
 	SetClientIP(NULL);
 	if (op_ctx->client != NULL)
 		put_gsh_client(op_ctx->client);
 	if (op_ctx->export != NULL)
 		put_gsh_export(op_ctx->export);
+	if (checked_export != NULL)
+		put_gsh_export(checked_export);
 	op_ctx = NULL;
 
 #ifdef USE_LTTNG
 	tracepoint(nfs_rpc, end, req);
 #endif
 
-	return;
+	return deferred;
 }
 
 #ifdef _USE_9P
@@ -1435,7 +1637,7 @@ static void _9p_execute(request_data_t *req, nfs_worker_data_t *worker_data)
 static void _9p_free_reqdata(struct _9p_request_data *req9p)
 {
 	if (req9p->pconn->trans_type == _9P_TCP)
-		gsh_free(req9p->_9pmsg);
+		_9p_msgbuf_put(req9p->_9pmsg);
 
 	/* decrease connection refcount */
 	atomic_dec_uint32_t(&req9p->pconn->refcount);
@@ -1532,7 +1734,10 @@ static void worker_run(struct fridgethr_context *ctx)
 			LogDebug(COMPONENT_DISPATCH,
 				 "NFS protocol request, nfsreq=%p xprt=%p req_cnt=%d",
 				 nfsreq, nfsreq->r_u.nfs->xprt, reqcnt);
-			nfs_rpc_execute(nfsreq, worker_data);
+			if (nfs_rpc_execute(nfsreq, worker_data)) {
+				/* Deferred, the request is queued again */
+				continue;
+			}
 			break;
 
 		case NFS_CALL:
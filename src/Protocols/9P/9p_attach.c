@@ -86,10 +86,10 @@ int _9p_attach(struct _9p_request_data *req9p, void *worker_data,
 		 (u32) *msgtag, *fid, *afid, (int) *uname_len, uname_str,
 		 (int) *aname_len, aname_str, *n_uname);
 
-	if (*fid >= _9P_FID_PER_CONN) {
-		err = ERANGE;
+	/* Make room for the new fid */
+	err = _9p_fid_reserve(req9p->pconn, *fid);
+	if (err != 0)
 		goto errout;
-	}
 
 	/*
 	 * Find the export for the aname (using as well Path or Tag)
@@ -125,7 +125,6 @@ int _9p_attach(struct _9p_request_data *req9p, void *worker_data,
 	}
 
 	pfid->fid = *fid;
-	req9p->pconn->fids[*fid] = pfid;
 
 	/* Is user name provided as a string or as an uid ? */
 	if (*n_uname != _9P_NONUNAME) {
@@ -205,6 +204,9 @@ int _9p_attach(struct _9p_request_data *req9p, void *worker_data,
 				 * to stay synchronous with the server */
 	pfid->qid.path = fileid;
 
+	/* The fid is ready, errors above must not leave it reachable */
+	_9p_fid_set(req9p->pconn, *fid, pfid);
+
 	/* Build the reply */
 	_9p_setinitptr(cursor, preply, _9P_RATTACH);
 	_9p_setptr(cursor, msgtag, u16);
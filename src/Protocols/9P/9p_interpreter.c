@@ -149,6 +149,7 @@ int _9p_process_buffer(struct _9p_request_data *req9p,
 	u32 msglen;
 	u8 msgtype;
 	int rc = 0;
+	u16 notag = 0;
 
 	msgdata = req9p->_9pmsg;
 
@@ -174,6 +175,15 @@ int _9p_process_buffer(struct _9p_request_data *req9p,
 	 */
 	*poutlen = req9p->pconn->msize;
 
+	/* Receive buffers are only as large as the message: the decoders
+	 * check each field against msglen, and count on the tag */
+	if (msglen > req9p->pconn->msize || msglen < _9P_STD_HDR_SIZE) {
+		LogEvent(COMPONENT_9P, "%s: bad request size %u",
+			 _9pfuncdesc[msgtype].funcname, msglen);
+		return _9p_rerror(req9p, worker_data, &notag, EINVAL,
+				  poutlen, replydata);
+	}
+
 	/* Call the 9P service function */
 	rc = _9pfuncdesc[msgtype].service_function(req9p,
 						   (void *)worker_data,
@@ -0,0 +1,192 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * @file    9p_msgbuf.c
+ * @brief   Size classed receive buffers for 9P/TCP messages
+ *
+ * Incoming messages used to get an msize buffer each, a megabyte for
+ * a 20 bytes Tclunk with large msizes.  The reactor now reads the
+ * size header first and takes a buffer of the power of 2 class that
+ * fits the message.  Buffers released by the workers are kept in a
+ * free list per class, up to a byte budget, so that steady traffic
+ * does not go through the allocator at all.  Messages larger than
+ * the largest class are allocated exactly and never cached.
+ */
+
+#include "config.h"
+#include <string.h>
+#include <pthread.h>
+#include "log.h"
+#include "abstract_mem.h"
+#include "abstract_atomic.h"
+#include "gsh_intrinsic.h"
+#include "9p.h"
+
+/**
+ * @brief Smallest class, 256 bytes
+ */
+#define _9P_MSGBUF_MIN_SHIFT 8
+
+/**
+ * @brief Largest class, 1MB
+ */
+#define _9P_MSGBUF_MAX_SHIFT 20
+
+#define _9P_MSGBUF_CLASSES (_9P_MSGBUF_MAX_SHIFT - _9P_MSGBUF_MIN_SHIFT + 1)
+
+/**
+ * @brief Class of the buffers too large to be cached
+ */
+#define _9P_MSGBUF_NOCLASS UINT32_MAX
+
+/**
+ * @brief Bytes kept in each free list
+ */
+#define _9P_MSGBUF_CACHE_BYTES (8 * 1024 * 1024)
+
+/**
+ * @brief Bounds on the number of buffers kept in each free list
+ */
+#define _9P_MSGBUF_CACHE_MIN 8
+#define _9P_MSGBUF_CACHE_MAX 1024
+
+/**
+ * @brief Header in front of each buffer
+ *
+ * Sized to keep the message as aligned as malloc returned it.
+ */
+
+struct _9p_msgbuf {
+	struct _9p_msgbuf *next;	/*< In the free list */
+	uint32_t class;			/*< Size class */
+} __attribute__ ((aligned(16)));
+
+struct _9p_msgbuf_class {
+	pthread_mutex_t lock;
+	struct _9p_msgbuf *free;	/*< Free buffers */
+	uint32_t count;			/*< Number of them */
+	uint32_t max;			/*< Number kept at most */
+} __attribute__ ((aligned(CACHE_LINE_SIZE)));
+
+static struct _9p_msgbuf_class _9p_msgbuf_classes[_9P_MSGBUF_CLASSES];
+
+/**
+ * @brief Initialize the free lists
+ */
+
+void _9p_msgbuf_init(void)
+{
+	struct _9p_msgbuf_class *mc;
+	uint32_t i;
+
+	for (i = 0; i < _9P_MSGBUF_CLASSES; i++) {
+		mc = &_9p_msgbuf_classes[i];
+		PTHREAD_MUTEX_init(&mc->lock, NULL);
+		mc->free = NULL;
+		mc->count = 0;
+		mc->max = _9P_MSGBUF_CACHE_BYTES >>
+			  (i + _9P_MSGBUF_MIN_SHIFT);
+		if (mc->max < _9P_MSGBUF_CACHE_MIN)
+			mc->max = _9P_MSGBUF_CACHE_MIN;
+		if (mc->max > _9P_MSGBUF_CACHE_MAX)
+			mc->max = _9P_MSGBUF_CACHE_MAX;
+	}
+}
+
+static inline uint32_t _9p_msgbuf_class(uint32_t size)
+{
+	uint32_t class = 0;
+
+	while (class < _9P_MSGBUF_CLASSES &&
+	       (1U << (class + _9P_MSGBUF_MIN_SHIFT)) < size)
+		class++;
+
+	return class < _9P_MSGBUF_CLASSES ? class : _9P_MSGBUF_NOCLASS;
+}
+
+/**
+ * @brief Get a buffer for a message
+ *
+ * @param[in]  size Size of the message, header included
+ * @param[out] hit  Whether the buffer came from a free list
+ *
+ * @return The buffer, NULL if it could not be allocated.
+ */
+
+char *_9p_msgbuf_get(uint32_t size, bool *hit)
+{
+	uint32_t class = _9p_msgbuf_class(size);
+	struct _9p_msgbuf_class *mc;
+	struct _9p_msgbuf *mb = NULL;
+
+	*hit = false;
+
+	if (class != _9P_MSGBUF_NOCLASS) {
+		mc = &_9p_msgbuf_classes[class];
+		PTHREAD_MUTEX_lock(&mc->lock);
+		mb = mc->free;
+		if (mb != NULL) {
+			mc->free = mb->next;
+			mc->count--;
+		}
+		PTHREAD_MUTEX_unlock(&mc->lock);
+
+		if (mb != NULL) {
+			*hit = true;
+			return (char *)(mb + 1);
+		}
+
+		size = 1U << (class + _9P_MSGBUF_MIN_SHIFT);
+	}
+
+	mb = gsh_malloc(sizeof(struct _9p_msgbuf) + size);
+	if (mb == NULL)
+		return NULL;
+
+	mb->class = class;
+	return (char *)(mb + 1);
+}
+
+/**
+ * @brief Release a buffer got from _9p_msgbuf_get
+ *
+ * @param[in] buf The buffer
+ */
+
+void _9p_msgbuf_put(char *buf)
+{
+	struct _9p_msgbuf *mb = (struct _9p_msgbuf *)buf - 1;
+	struct _9p_msgbuf_class *mc;
+
+	if (mb->class != _9P_MSGBUF_NOCLASS) {
+		mc = &_9p_msgbuf_classes[mb->class];
+		PTHREAD_MUTEX_lock(&mc->lock);
+		if (mc->count < mc->max) {
+			mb->next = mc->free;
+			mc->free = mb;
+			mc->count++;
+			mb = NULL;
+		}
+		PTHREAD_MUTEX_unlock(&mc->lock);
+	}
+
+	if (mb != NULL)
+		gsh_free(mb);
+}
@@ -49,6 +49,7 @@
 
 int _9p_init(void)
 {
+	_9p_msgbuf_init();
 	return 0;
 }				/* _9p_init */
 
@@ -314,13 +315,91 @@ int _9p_tools_clunk(struct _9p_fid *pfid)
 	return 0;
 }
 
+/**
+ * @brief Make room for a new fid of a connection
+ *
+ * Allocates the leaf holding the fid number if needed, so that
+ * _9p_fid_set() cannot fail once the fid is ready.  Workers may race
+ * here, the loser of the race frees its allocation.
+ *
+ * @param[in] conn The connection
+ * @param[in] fid  Fid number
+ *
+ * @return 0, ERANGE or ENOMEM.
+ */
+
+int _9p_fid_reserve(struct _9p_conn *conn, u32 fid)
+{
+	uint32_t nleaves;
+	struct _9p_fid ***fids;
+	struct _9p_fid ***newfids;
+	struct _9p_fid **leaf;
+
+	if (fid >= _9p_param._9p_max_fids)
+		return ERANGE;
+
+	fids = atomic_fetch_voidptr((void **)&conn->fids);
+	if (fids == NULL) {
+		nleaves = (_9p_param._9p_max_fids + _9P_FID_LEAF_SIZE - 1) >>
+			  _9P_FID_LEAF_SHIFT;
+		newfids = gsh_calloc(nleaves, sizeof(struct _9p_fid **));
+		if (newfids == NULL)
+			return ENOMEM;
+		if (atomic_cas_voidptr((void **)&conn->fids, NULL, newfids)) {
+			fids = newfids;
+		} else {
+			gsh_free(newfids);
+			fids = atomic_fetch_voidptr((void **)&conn->fids);
+		}
+	}
+
+	leaf = atomic_fetch_voidptr((void **)&fids[fid >> _9P_FID_LEAF_SHIFT]);
+	if (leaf != NULL)
+		return 0;
+
+	leaf = gsh_calloc(_9P_FID_LEAF_SIZE, sizeof(struct _9p_fid *));
+	if (leaf == NULL)
+		return ENOMEM;
+	if (!atomic_cas_voidptr((void **)&fids[fid >> _9P_FID_LEAF_SHIFT],
+				NULL, leaf))
+		gsh_free(leaf);
+
+	return 0;
+}
+
+/**
+ * @brief Clunk all the fids of a connection and free its fid table
+ *
+ * Only the leaves in use are walked.  No request may be using the
+ * connection any more.
+ *
+ * @param[in] conn The connection
+ */
+
 void _9p_cleanup_fids(struct _9p_conn *conn)
 {
-	int i;
-	for (i = 0; i < _9P_FID_PER_CONN; i++) {
-		if (conn->fids[i]) {
-			_9p_tools_clunk(conn->fids[i]);
-			conn->fids[i] = NULL;	/* poison the entry */
+	uint32_t nleaves, i, j;
+	struct _9p_fid **leaf;
+
+	if (conn->fids == NULL)
+		return;
+
+	nleaves = (_9p_param._9p_max_fids + _9P_FID_LEAF_SIZE - 1) >>
+		  _9P_FID_LEAF_SHIFT;
+
+	for (i = 0; i < nleaves; i++) {
+		leaf = conn->fids[i];
+		if (leaf == NULL)
+			continue;
+
+		for (j = 0; j < _9P_FID_LEAF_SIZE; j++) {
+			if (leaf[j] != NULL)
+				_9p_tools_clunk(leaf[j]);
 		}
+
+		gsh_free(leaf);
 	}
+
+	gsh_free(conn->fids);
+	conn->fids = NULL;	/* poison the table */
 }
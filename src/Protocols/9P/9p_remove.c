@@ -48,7 +48,7 @@
 	cache_inode_put(pfid->pentry);                                  \
 	/* Free the fid */                                              \
 	gsh_free(pfid);                                                 \
-	req9p->pconn->fids[*fid] = NULL;                                \
+	_9p_fid_set(req9p->pconn, *fid, NULL);                          \
 } while (0)
 
 int _9p_remove(struct _9p_request_data *req9p, void *worker_data,
@@ -67,11 +67,11 @@ int _9p_remove(struct _9p_request_data *req9p, void *worker_data,
 
 	LogDebug(COMPONENT_9P, "TREMOVE: tag=%u fid=%u", (u32) *msgtag, *fid);
 
-	if (*fid >= _9P_FID_PER_CONN)
+	if (*fid >= _9p_param._9p_max_fids)
 		return _9p_rerror(req9p, worker_data, msgtag, ERANGE, plenout,
 				  preply);
 
-	pfid = req9p->pconn->fids[*fid];
+	pfid = _9p_fid_get(req9p->pconn, *fid);
 
 	/* Check that it is a valid fid */
 	if (pfid == NULL || pfid->pentry == NULL) {
@@ -68,11 +68,11 @@ int _9p_rename(struct _9p_request_data *req9p, void *worker_data,
 	LogDebug(COMPONENT_9P, "TRENAME: tag=%u fid=%u dfid=%u name=%.*s",
 		 (u32) *msgtag, *fid, *dfid, *name_len, name_str);
 
-	if (*fid >= _9P_FID_PER_CONN)
+	if (*fid >= _9p_param._9p_max_fids)
 		return _9p_rerror(req9p, worker_data, msgtag, ERANGE, plenout,
 				  preply);
 
-	pfid = req9p->pconn->fids[*fid];
+	pfid = _9p_fid_get(req9p->pconn, *fid);
 
 	/* Check that it is a valid fid */
 	if (pfid == NULL || pfid->pentry == NULL) {
@@ -88,11 +88,11 @@ int _9p_rename(struct _9p_request_data *req9p, void *worker_data,
 
 	op_ctx = &pfid->op_context;
 
-	if (*dfid >= _9P_FID_PER_CONN)
+	if (*dfid >= _9p_param._9p_max_fids)
 		return _9p_rerror(req9p, worker_data, msgtag, ERANGE, plenout,
 				  preply);
 
-	pdfid = req9p->pconn->fids[*dfid];
+	pdfid = _9p_fid_get(req9p->pconn, *dfid);
 
 	/* Check that it is a valid fid */
 	if (pdfid == NULL || pdfid->pentry == NULL) {
@@ -76,11 +76,11 @@ int _9p_renameat(struct _9p_request_data *req9p, void *worker_data,
 		 (u32) *msgtag, *oldfid, *oldname_len, oldname_str, *newfid,
 		 *newname_len, newname_str);
 
-	if (*oldfid >= _9P_FID_PER_CONN)
+	if (*oldfid >= _9p_param._9p_max_fids)
 		return _9p_rerror(req9p, worker_data, msgtag, ERANGE, plenout,
 				  preply);
 
-	poldfid = req9p->pconn->fids[*oldfid];
+	poldfid = _9p_fid_get(req9p->pconn, *oldfid);
 
 	/* Check that it is a valid fid */
 	if (poldfid == NULL || poldfid->pentry == NULL) {
@@ -91,11 +91,11 @@ int _9p_renameat(struct _9p_request_data *req9p, void *worker_data,
 
 	op_ctx = &poldfid->op_context;
 
-	if (*newfid >= _9P_FID_PER_CONN)
+	if (*newfid >= _9p_param._9p_max_fids)
 		return _9p_rerror(req9p, worker_data, msgtag, ERANGE, plenout,
 				  preply);
 
-	pnewfid = req9p->pconn->fids[*newfid];
+	pnewfid = _9p_fid_get(req9p->pconn, *newfid);
 
 	/* Check that it is a valid fid */
 	if (pnewfid == NULL || pnewfid->pentry == NULL) {
@@ -49,6 +49,7 @@ int _9p_walk(struct _9p_request_data *req9p, void *worker_data,
 {
 	char *cursor = req9p->_9pmsg + _9P_HDR_SIZE + _9P_TYPE_SIZE;
 	unsigned int i = 0;
+	int rc;
 
 	u16 *msgtag = NULL;
 	u32 *fid = NULL;
@@ -56,6 +57,7 @@ int _9p_walk(struct _9p_request_data *req9p, void *worker_data,
 	u16 *nwname = NULL;
 	u16 *wnames_len;
 	char *wnames_str;
+	char *wnames;
 	uint64_t fileid;
 	cache_inode_status_t cache_status;
 	cache_entry_t *pentry = NULL;
@@ -75,15 +77,23 @@ int _9p_walk(struct _9p_request_data *req9p, void *worker_data,
 	LogDebug(COMPONENT_9P, "TWALK: tag=%u fid=%u newfid=%u nwname=%u",
 		 (u32) *msgtag, *fid, *newfid, *nwname);
 
-	if (*fid >= _9P_FID_PER_CONN)
+	/* Check that all the names were received before taking anything */
+	wnames = cursor;
+	for (i = 0; i < *nwname; i++)
+		_9p_getstr(cursor, wnames_len, wnames_str);
+	cursor = wnames;
+
+	if (*fid >= _9p_param._9p_max_fids)
 		return _9p_rerror(req9p, worker_data, msgtag, ERANGE, plenout,
 				  preply);
 
-	if (*newfid >= _9P_FID_PER_CONN)
-		return _9p_rerror(req9p, worker_data, msgtag, ERANGE, plenout,
+	/* Make room for the new fid */
+	rc = _9p_fid_reserve(req9p->pconn, *newfid);
+	if (rc != 0)
+		return _9p_rerror(req9p, worker_data, msgtag, rc, plenout,
 				  preply);
 
-	pfid = req9p->pconn->fids[*fid];
+	pfid = _9p_fid_get(req9p->pconn, *fid);
 	/* Check that it is a valid fid */
 	if (pfid == NULL || pfid->pentry == NULL) {
 		LogDebug(COMPONENT_9P, "request on invalid fid=%u", *fid);
@@ -202,7 +212,7 @@ int _9p_walk(struct _9p_request_data *req9p, void *worker_data,
 	}
 
 	/* keep info on new fid */
-	req9p->pconn->fids[*newfid] = pnewfid;
+	_9p_fid_set(req9p->pconn, *newfid, pnewfid);
 
 	/* As much qid as requested fid */
 	nwqid = nwname;
@@ -81,14 +81,16 @@ int _9p_write(struct _9p_request_data *req9p, void *worker_data,
 	LogDebug(COMPONENT_9P, "TWRITE: tag=%u fid=%u offset=%llu count=%u",
 		 (u32) *msgtag, *fid, (unsigned long long)*offset, *count);
 
-	if (*fid >= _9P_FID_PER_CONN)
+	if (*fid >= _9p_param._9p_max_fids)
 		return _9p_rerror(req9p, worker_data, msgtag, ERANGE, plenout,
 				  preply);
 
-	pfid = req9p->pconn->fids[*fid];
+	pfid = _9p_fid_get(req9p->pconn, *fid);
 
-	/* Make sure the requested amount of data respects negotiated msize */
-	if (*count + _9P_ROOM_TWRITE > req9p->pconn->msize)
+	/* Make sure the requested amount of data respects negotiated msize
+	 * and was actually received */
+	if (*count + _9P_ROOM_TWRITE > req9p->pconn->msize ||
+	    _9p_msgend(req9p) - databuffer < *count)
 		return _9p_rerror(req9p, worker_data, msgtag, ERANGE, plenout,
 				  preply);
 
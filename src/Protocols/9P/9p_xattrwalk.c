@@ -63,6 +63,7 @@ int _9p_xattrwalk(struct _9p_request_data *req9p, void *worker_data,
 	char name[MAXNAMLEN];
 	fsal_xattrent_t xattrs_arr[XATTRS_ARRAY_LEN];
 	int eod_met = false;
+	int rc;
 	unsigned int nb_xattrs_read = 0;
 	unsigned int i = 0;
 	char *xattr_cursor = NULL;
@@ -90,15 +91,17 @@ int _9p_xattrwalk(struct _9p_request_data *req9p, void *worker_data,
 			 "TXATTRWALK (component): tag=%u fid=%u attrfid=%u name=%.*s",
 			 (u32) *msgtag, *fid, *attrfid, *name_len, name_str);
 
-	if (*fid >= _9P_FID_PER_CONN)
+	if (*fid >= _9p_param._9p_max_fids)
 		return _9p_rerror(req9p, worker_data, msgtag, ERANGE, plenout,
 				  preply);
 
-	if (*attrfid >= _9P_FID_PER_CONN)
-		return _9p_rerror(req9p, worker_data, msgtag, ERANGE, plenout,
+	/* Make room for the new fid */
+	rc = _9p_fid_reserve(req9p->pconn, *attrfid);
+	if (rc != 0)
+		return _9p_rerror(req9p, worker_data, msgtag, rc, plenout,
 				  preply);
 
-	pfid = req9p->pconn->fids[*fid];
+	pfid = _9p_fid_get(req9p->pconn, *fid);
 	/* Check that it is a valid fid */
 	if (pfid == NULL || pfid->pentry == NULL) {
 		LogDebug(COMPONENT_9P, "request on invalid fid=%u", *fid);
@@ -255,7 +258,7 @@ int _9p_xattrwalk(struct _9p_request_data *req9p, void *worker_data,
 		}
 	}
 
-	req9p->pconn->fids[*attrfid] = pxattrfid;
+	_9p_fid_set(req9p->pconn, *attrfid, pxattrfid);
 
 	/* Increments refcount as we're manually making a new copy */
 	(void) cache_inode_lru_ref(pfid->pentry, LRU_REQ_STALE_OK);
@@ -48,12 +48,13 @@
 
 static void nfs_read_ok(struct svc_req *req,
 			nfs_res_t *res,
-			char *data, uint32_t read_size, cache_entry_t *entry,
+			struct gsh_read_ref *data_ref,
+			uint32_t read_size, cache_entry_t *entry,
 			int eof)
 {
-	if ((read_size == 0) && (data != NULL)) {
-		gsh_free(data);
-		data = NULL;
+	if ((read_size == 0) && (data_ref != NULL)) {
+		gsh_read_ref_release(data_ref);
+		data_ref = NULL;
 	}
 
 	/* Build Post Op Attributes */
@@ -62,8 +63,9 @@ static void nfs_read_ok(struct svc_req *req,
 
 	res->res_read3.READ3res_u.resok.eof = eof;
 	res->res_read3.READ3res_u.resok.count = read_size;
-	res->res_read3.READ3res_u.resok.data.data_val = data;
+	res->res_read3.READ3res_u.resok.data.data_val = NULL;
 	res->res_read3.READ3res_u.resok.data.data_len = read_size;
+	res->res_read3.READ3res_u.resok.data_ref = data_ref;
 
 	res->res_read3.status = NFS3_OK;
 }
@@ -95,10 +97,9 @@ int nfs3_read(nfs_arg_t *arg,
 	size_t size = 0;
 	size_t read_size = 0;
 	uint64_t offset = 0;
-	void *data = NULL;
+	struct gsh_read_ref *data_ref;
 	bool eof_met = false;
 	int rc = NFS_REQ_OK;
-	bool sync = false;
 
 	if (isDebug(COMPONENT_NFSPROTO)) {
 		char str[LEN_FH_STR];
@@ -120,6 +121,7 @@ int nfs3_read(nfs_arg_t *arg,
 	res->res_read3.READ3res_u.resok.count = 0;
 	res->res_read3.READ3res_u.resok.data.data_val = NULL;
 	res->res_read3.READ3res_u.resok.data.data_len = 0;
+	res->res_read3.READ3res_u.resok.data_ref = NULL;
 	res->res_read3.status = NFS3_OK;
 	entry = nfs3_FhandleToCache(&arg->arg_read3.file,
 				    &res->res_read3.status, &rc);
@@ -208,12 +210,6 @@ int nfs3_read(nfs_arg_t *arg,
 		rc = NFS_REQ_OK;
 		goto out;
 	} else {
-		data = gsh_malloc(size);
-		if (data == NULL) {
-			rc = NFS_REQ_DROP;
-			goto out;
-		}
-
 		res->res_read3.status = nfs3_Errno_state(
 				state_share_anonymous_io_start(
 					entry,
@@ -222,28 +218,22 @@ int nfs3_read(nfs_arg_t *arg,
 
 		if (res->res_read3.status != NFS3_OK) {
 			rc = NFS_REQ_OK;
-			gsh_free(data);
 			goto out;
 		}
 
-		cache_status = cache_inode_rdwr(entry,
-						CACHE_INODE_READ,
-						offset,
-						size,
-						&read_size,
-						data,
-						&eof_met,
-						&sync);
+		/* Reply from the data cache or FSAL buffers, no copy */
+		cache_status = cache_inode_read_ref(entry, offset, size,
+						    &read_size, &eof_met,
+						    &data_ref);
 
 		state_share_anonymous_io_done(entry, OPEN4_SHARE_ACCESS_READ);
 
 		if (cache_status == CACHE_INODE_SUCCESS) {
-			nfs_read_ok(req, res, data, read_size,
-				    entry, eof_met);
+			nfs_read_ok(req, res, data_ref, read_size, entry,
+				    eof_met);
 			rc = NFS_REQ_OK;
 			goto out;
 		}
-		gsh_free(data);
 	}
 
 	/* If we are here, there was an error */
@@ -281,6 +271,10 @@ void nfs3_read_free(nfs_res_t *res)
 {
 	if ((res->res_read3.status == NFS3_OK)
 	    && (res->res_read3.READ3res_u.resok.data.data_len != 0)) {
-		gsh_free(res->res_read3.READ3res_u.resok.data.data_val);
+		if (res->res_read3.READ3res_u.resok.data_ref != NULL)
+			gsh_read_ref_release(
+				res->res_read3.READ3res_u.resok.data_ref);
+		else
+			gsh_free(res->res_read3.READ3res_u.resok.data.data_val);
 	}
 }
@@ -215,6 +215,7 @@ static int nfs4_read(struct nfs_argop4 *op, compound_data_t *data,
 	uint64_t offset = 0;
 	bool eof_met = false;
 	void *bufferdata = NULL;
+	struct gsh_read_ref *data_ref = NULL;
 	cache_inode_status_t cache_status = CACHE_INODE_SUCCESS;
 	state_t *state_found = NULL;
 	state_t *state_open = NULL;
@@ -227,6 +228,7 @@ static int nfs4_read(struct nfs_argop4 *op, compound_data_t *data,
 	/* Say we are managing NFS4_OP_READ */
 	resp->resop = NFS4_OP_READ;
 	res_READ4->status = NFS4_OK;
+	res_READ4->READ4res_u.resok4.data_ref = NULL;
 
 	/* Do basic checks on a filehandle Only files can be read */
 
@@ -458,15 +460,6 @@ static int nfs4_read(struct nfs_argop4 *op, compound_data_t *data,
 		goto done;
 	}
 
-	/* Some work is to be done */
-	bufferdata = gsh_malloc_aligned(4096, size);
-
-	if (bufferdata == NULL) {
-		LogEvent(COMPONENT_NFS_V4, "FAILED to allocate bufferdata");
-		res_READ4->status = NFS4ERR_SERVERFAULT;
-		goto done;
-	}
-
 	if (!anonymous_started && data->minorversion == 0) {
 		owner = get_state_owner_ref(state_found);
 		if (owner != NULL) {
@@ -475,9 +468,25 @@ static int nfs4_read(struct nfs_argop4 *op, compound_data_t *data,
 		}
 	}
 
-	cache_status =
-	    cache_inode_rdwr_plus(entry, io, offset, size, &read_size,
-				  bufferdata, &eof_met, &sync, info);
+	if (io == CACHE_INODE_READ) {
+		/* Reply from the data cache or FSAL buffers, no copy */
+		cache_status = cache_inode_read_ref(entry, offset, size,
+						    &read_size, &eof_met,
+						    &data_ref);
+	} else {
+		bufferdata = gsh_malloc_aligned(4096, size);
+
+		if (bufferdata == NULL) {
+			LogEvent(COMPONENT_NFS_V4,
+				 "FAILED to allocate bufferdata");
+			res_READ4->status = NFS4ERR_SERVERFAULT;
+			goto done;
+		}
+
+		cache_status =
+		    cache_inode_rdwr_plus(entry, io, offset, size, &read_size,
+					  bufferdata, &eof_met, &sync, info);
+	}
 	if (cache_status != CACHE_INODE_SUCCESS) {
 		res_READ4->status = nfs4_Errno(cache_status);
 		gsh_free(bufferdata);
@@ -485,19 +494,22 @@ static int nfs4_read(struct nfs_argop4 *op, compound_data_t *data,
 		goto done;
 	}
 
+	if (!anonymous_started && data->minorversion == 0)
+		op_ctx->clientid = NULL;
+
 	if (cache_inode_size(entry, &file_size) !=
 	    CACHE_INODE_SUCCESS) {
 		res_READ4->status = nfs4_Errno(cache_status);
 		gsh_free(bufferdata);
+		if (data_ref != NULL)
+			gsh_read_ref_release(data_ref);
 		res_READ4->READ4res_u.resok4.data.data_val = NULL;
 		goto done;
 	}
 
-	if (!anonymous_started && data->minorversion == 0)
-		op_ctx->clientid = NULL;
-
 	res_READ4->READ4res_u.resok4.data.data_len = read_size;
 	res_READ4->READ4res_u.resok4.data.data_val = bufferdata;
+	res_READ4->READ4res_u.resok4.data_ref = data_ref;
 
 	LogFullDebug(COMPONENT_NFS_V4,
 		     "NFS4_OP_READ: offset = %" PRIu64
@@ -570,9 +582,12 @@ void nfs4_op_read_Free(nfs_resop4 *res)
 {
 	READ4res *resp = &res->nfs_resop4_u.opread;
 
-	if (resp->status == NFS4_OK)
-		if (resp->READ4res_u.resok4.data.data_val != NULL)
+	if (resp->status == NFS4_OK) {
+		if (resp->READ4res_u.resok4.data_ref != NULL)
+			gsh_read_ref_release(resp->READ4res_u.resok4.data_ref);
+		else if (resp->READ4res_u.resok4.data.data_val != NULL)
 			gsh_free(resp->READ4res_u.resok4.data.data_val);
+	}
 	return;
 }				/* nfs4_op_read_Free */
 
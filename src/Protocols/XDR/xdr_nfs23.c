@@ -1273,6 +1273,10 @@ READ3resok *objp;
 		return (false);
 	if (!xdr_bool(xdrs, &objp->eof))
 		return (false);
+	if (xdrs->x_op == XDR_ENCODE && objp->data.data_val == NULL &&
+	    objp->data_ref != NULL)
+		return xdr_gsh_read_ref(xdrs, objp->data_ref,
+					objp->data.data_len);
 	if (!xdr_bytes
 	    (xdrs, (char **)&objp->data.data_val,
 	     (u_int *) & objp->data.data_len, ~0))
@@ -48,6 +48,7 @@
 #include "city.h"
 #include "abstract_mem.h"
 #include "gsh_intrinsic.h"
+#include "abstract_atomic.h"
 #include "wait_queue.h"
 
 #define DUPREQ_BAD_ADDR1 0x01	/* safe for marked pointers, etc */
@@ -222,12 +223,13 @@ static inline void init_shared_drc()
 
 	drc->type = DRC_UDP_V234;
 	drc->refcnt = 0;
-	drc->retwnd = 0;
 	drc->d_u.tcp.recycle_time = 0;
 	drc->maxsize = nfs_param.core_param.drc.udp.size;
 	drc->cachesz = nfs_param.core_param.drc.udp.cachesz;
 	drc->npart = nfs_param.core_param.drc.udp.npart;
 	drc->hiwat = nfs_param.core_param.drc.udp.hiwat;
+	drc->max_bytes = nfs_param.core_param.drc.udp.max_bytes;
+	drc->hiwat_bytes = nfs_param.core_param.drc.udp.hiwat_bytes;
 
 	gsh_mutex_init(&drc->mtx, NULL);
 
@@ -237,8 +239,13 @@ static inline void init_shared_drc()
 		      RBT_X_FLAG_ALLOC | RBT_X_FLAG_CACHE_WT);
 	assert(!code);
 
-	/* completed requests */
-	TAILQ_INIT(&drc->dupreq_q);
+	/* completed requests, per partition */
+	drc->parts = gsh_calloc(drc->npart, sizeof(struct drc_part));
+	if (unlikely(!drc->parts))
+		LogFatal(COMPONENT_INIT,
+			 "Error while allocating UDP DRC partitions");
+	for (ix = 0; ix < drc->npart; ++ix)
+		TAILQ_INIT(&drc->parts[ix].dupreq_q);
 
 	/* init closed-form "cache" partition */
 	for (ix = 0; ix < drc->npart; ++ix) {
@@ -369,12 +376,13 @@ static inline drc_t *alloc_tcp_drc(enum drc_type dtype)
 
 	drc->type = dtype;	/* DRC_TCP_V3 or DRC_TCP_V4 */
 	drc->refcnt = 0;
-	drc->retwnd = 0;
 	drc->d_u.tcp.recycle_time = 0;
 	drc->maxsize = nfs_param.core_param.drc.tcp.size;
 	drc->cachesz = nfs_param.core_param.drc.tcp.cachesz;
 	drc->npart = nfs_param.core_param.drc.tcp.npart;
 	drc->hiwat = nfs_param.core_param.drc.udp.hiwat;
+	drc->max_bytes = nfs_param.core_param.drc.tcp.max_bytes;
+	drc->hiwat_bytes = nfs_param.core_param.drc.tcp.hiwat_bytes;
 
 	PTHREAD_MUTEX_init(&drc->mtx, NULL);
 
@@ -384,8 +392,17 @@ static inline drc_t *alloc_tcp_drc(enum drc_type dtype)
 		      RBT_X_FLAG_ALLOC | RBT_X_FLAG_CACHE_WT);
 	assert(!code);
 
-	/* completed requests */
-	TAILQ_INIT(&drc->dupreq_q);
+	/* completed requests, per partition */
+	drc->parts = gsh_calloc(drc->npart, sizeof(struct drc_part));
+	if (unlikely(!drc->parts)) {
+		LogCrit(COMPONENT_DUPREQ, "alloc TCP DRC partitions failed");
+		PTHREAD_MUTEX_destroy(&drc->mtx);
+		pool_free(tcp_drc_pool, drc);
+		drc = NULL;
+		goto out;
+	}
+	for (ix = 0; ix < drc->npart; ++ix)
+		TAILQ_INIT(&drc->parts[ix].dupreq_q);
 
 	/* recycling DRC */
 	TAILQ_INIT_ENTRY(drc, d_u.tcp.recycle_q);
@@ -420,6 +437,7 @@ static inline void free_tcp_drc(drc_t *drc)
 {
 	if (drc->xt.tree[0].cache)
 		gsh_free(drc->xt.tree[0].cache);
+	gsh_free(drc->parts);
 	PTHREAD_MUTEX_destroy(&drc->mtx);
 	LogFullDebug(COMPONENT_DUPREQ, "free TCP drc %p", drc);
 	pool_free(tcp_drc_pool, drc);
@@ -537,11 +555,9 @@ nfs_dupreq_get_drc(struct svc_req *req)
 
 	switch (dtype) {
 	case DRC_UDP_V234:
-		LogFullDebug(COMPONENT_DUPREQ, "ref shared UDP DRC");
+		/* the shared DRC lives as long as the server, so it is
+		 * not refcounted */
 		drc = &(drc_st->udp_drc);
-		DRC_ST_LOCK();
-		(void)nfs_dupreq_ref_drc(drc);
-		DRC_ST_UNLOCK();
 		goto out;
 		break;
 	case DRC_TCP_V4:
@@ -658,6 +674,10 @@ out:
  */
 void nfs_dupreq_put_drc(SVCXPRT *xprt, drc_t *drc, uint32_t flags)
 {
+	/* the shared DRC is never freed, see nfs_dupreq_get_drc */
+	if (drc->type == DRC_UDP_V234)
+		return;
+
 	if (!(flags & DRC_FLAG_LOCKED))
 		PTHREAD_MUTEX_lock(&drc->mtx);
 	/* drc LOCKED */
@@ -673,9 +693,6 @@ void nfs_dupreq_put_drc(SVCXPRT *xprt, drc_t *drc, uint32_t flags)
 	LogFullDebug(COMPONENT_DUPREQ, "drc %p refcnt==%u", drc, drc->refcnt);
 
 	switch (drc->type) {
-	case DRC_UDP_V234:
-		/* do nothing */
-		break;
 	case DRC_TCP_V4:
 	case DRC_TCP_V3:
 		if (drc->refcnt == 0) {
@@ -809,19 +826,99 @@ static inline void nfs_dupreq_free_dupreq(dupreq_entry_t *dv)
 		func->free_function(dv->res);
 		free_nfs_res(dv->res);
 	}
+	if (dv->reply)
+		dupreq_reply_put(dv->reply);
 	PTHREAD_MUTEX_destroy(&dv->mtx);
 	pool_free(dupreq_pool, dv);
 }
 
+/**
+ * @brief Release a reference on an encoded reply
+ *
+ * @param[in] reply The reply
+ */
+void dupreq_reply_put(struct dupreq_reply *reply)
+{
+	if (atomic_dec_int32_t(&reply->refcnt) == 0)
+		gsh_free(reply);
+}
+
+/**
+ * @brief Send an encoded reply as is
+ *
+ * Used as the XDR function of the replay of a reply cached encoded,
+ * the bytes are those the encoding function of the request produced.
+ *
+ * @param[in] xdrs  The XDR stream
+ * @param[in] reply The reply
+ *
+ * @return true if successful.
+ */
+bool xdr_dupreq_reply(XDR *xdrs, struct dupreq_reply *reply)
+{
+	if (xdrs->x_op != XDR_ENCODE)
+		return xdrs->x_op == XDR_FREE;
+
+	return XDR_PUTBYTES(xdrs, reply->data, reply->len);
+}
+
+/**
+ * @brief Encode a result for the cache
+ *
+ * @param[in] dv  The duplicate request entry
+ * @param[in] res Its result
+ *
+ * @return The encoded reply, with a reference, or NULL.
+ */
+static struct dupreq_reply *nfs_dupreq_encode(dupreq_entry_t *dv,
+					      nfs_res_t *res)
+{
+	const nfs_function_desc_t *func = nfs_dupreq_func(dv);
+	struct dupreq_reply *reply;
+	u_long len;
+	XDR xdrs;
+
+	if (func == NULL)
+		return NULL;
+
+	len = xdr_sizeof(func->xdr_encode_func, res);
+	if (len > UINT32_MAX)
+		return NULL;
+
+	reply = gsh_malloc(sizeof(struct dupreq_reply) + len);
+	if (reply == NULL)
+		return NULL;
+
+	xdrmem_create(&xdrs, reply->data, len, XDR_ENCODE);
+	if (!func->xdr_encode_func(&xdrs, res)) {
+		LogDebug(COMPONENT_DUPREQ,
+			 "encoding reply of xid=%u failed, caching it decoded",
+			 dv->hin.tcp.rq_xid);
+		XDR_DESTROY(&xdrs);
+		gsh_free(reply);
+		return NULL;
+	}
+	reply->len = XDR_GETPOS(&xdrs);
+	reply->refcnt = 1;
+	XDR_DESTROY(&xdrs);
+
+	return reply;
+}
+
 /**
  * @page DRC_RETIRE DRC request retire heuristic.
  *
- * We add a new, per-drc semphore like counter, retwnd.  The value of
+ * We add a new, per-partition semphore like counter, retwnd.  The value of
  * retwnd begins at 0, and is always >= 0.  The value of retwnd is increased
  * when a a duplicate req cache hit occurs.  If it was 0, it is increased by
  * some small constant, say, 16, otherwise, by 1.  And retwnd decreases by 1
  * when we successfully finish any request.  Likewise in finish, a cached
  * request may be retired iff we are above our water mark, and retwnd is 0.
+ *
+ * Each partition of the DRC tree keeps its own retire queue, counters
+ * and retwnd, protected by the partition lock, so no DRC-wide lock is
+ * taken on this path.  A partition retires once it is above its share
+ * of the DRC limits, which bounds the whole DRC approximately.
  */
 
 #define RETWND_START_BIAS 16
@@ -829,54 +926,81 @@ static inline void nfs_dupreq_free_dupreq(dupreq_entry_t *dv)
 /**
  * @brief advance retwnd.
  *
- * If (drc)->retwnd is 0, advance its value to RETWND_START_BIAS, else
+ * If (p)->retwnd is 0, advance its value to RETWND_START_BIAS, else
  * increase its value by 1.
  *
- * @param[in] drc The duplicate request cache
+ * @param[in] p The DRC partition
  */
-#define drc_inc_retwnd(drc)					\
+#define drc_inc_retwnd(p)					\
 	do {							\
-		if ((drc)->retwnd == 0)				\
-			(drc)->retwnd = RETWND_START_BIAS;	\
+		if ((p)->retwnd == 0)				\
+			(p)->retwnd = RETWND_START_BIAS;	\
 		else						\
-			++((drc)->retwnd);			\
+			++((p)->retwnd);			\
 	} while (0)
 
 /**
  * @brief conditionally decrement retwnd.
  *
- * If (drc)->retwnd > 0, decrease its value by 1.
+ * If (p)->retwnd > 0, decrease its value by 1.
  *
- * @param[in] drc The duplicate request cache
+ * @param[in] p The DRC partition
  */
-#define drc_dec_retwnd(drc)			\
+#define drc_dec_retwnd(p)			\
 	do {					\
-		if ((drc)->retwnd > 0)		\
-			--((drc)->retwnd);	\
+		if ((p)->retwnd > 0)		\
+			--((p)->retwnd);	\
 	} while (0)
 
+/**
+ * @brief Find the retire queue of a partition of the DRC tree
+ *
+ * @param[in] drc The duplicate request cache
+ * @param[in] t   The partition
+ *
+ * @return The partition's queue and counters.
+ */
+static inline struct drc_part *drc_part_of(drc_t *drc,
+					   struct rbtree_x_part *t)
+{
+	return &drc->parts[t - drc->xt.tree];
+}
+
 /**
  * @brief retire request predicate.
  *
- * Calculate whether a request may be retired from the provided duplicate
- * request cache.
+ * Calculate whether a request may be retired from the provided partition
+ * of a duplicate request cache.  The partition is held to its share of
+ * the limits of the DRC.
  *
  * @param[in] drc The duplicate request cache
+ * @param[in] p   The partition, locked
  *
  * @return true if a request may be retired, else false.
  */
-static inline bool drc_should_retire(drc_t *drc)
+static inline bool drc_should_retire(drc_t *drc, struct drc_part *p)
 {
+	uint64_t size = (uint64_t)p->size * drc->npart;
+	uint64_t bytes = p->bytes * drc->npart;
+
 	/* do not exeed the hard bound on cache size */
-	if (unlikely(drc->size > drc->maxsize))
+	if (unlikely(size > drc->maxsize))
+		return true;
+
+	/* nor the one in bytes, if any */
+	if (unlikely(drc->max_bytes && bytes > drc->max_bytes))
 		return true;
 
 	/* otherwise, are we permitted to retire requests */
-	if (unlikely(drc->retwnd > 0))
+	if (unlikely(p->retwnd > 0))
 		return false;
 
-	/* finally, retire if drc->size is above intended high water mark */
-	if (unlikely(drc->size > drc->hiwat))
+	/* finally, retire if size is above intended high water mark */
+	if (unlikely(size > drc->hiwat))
+		return true;
+
+	/* or the one in bytes */
+	if (unlikely(drc->hiwat_bytes && bytes > drc->hiwat_bytes))
 		return true;
 
 	return false;
@@ -922,6 +1046,9 @@ dupreq_status_t nfs_dupreq_start(nfs_request_data_t *nfs_req,
 	nfs_res_t *res = NULL;
 	drc_t *drc;
 
+	nfs_req->res_nfs = NULL;
+	nfs_req->reply = NULL;
+
 	/* Disabled? */
 	if (nfs_param.core_param.drc.disabled) {
 		req->rq_u1 = (void *)DUPREQ_NOCACHE;
@@ -1002,6 +1129,7 @@ dupreq_status_t nfs_dupreq_start(nfs_request_data_t *nfs_req,
 		struct opr_rbtree_node *nv;
 		struct rbtree_x_part *t =
 		    rbtx_partition_of_scalar(&drc->xt, dk->hk);
+		struct drc_part *p = drc_part_of(drc, t);
 		PTHREAD_MUTEX_lock(&t->mtx);	/* partition lock */
 		nv = rbtree_x_cached_lookup(&drc->xt, t, &dk->rbt_k, dk->hk);
 		if (nv) {
@@ -1013,10 +1141,14 @@ dupreq_status_t nfs_dupreq_start(nfs_request_data_t *nfs_req,
 			} else {
 				/* satisfy req from the DRC, incref,
 				   extend window */
-				res = dv->res;
-				PTHREAD_MUTEX_lock(&drc->mtx);
-				drc_inc_retwnd(drc);
-				PTHREAD_MUTEX_unlock(&drc->mtx);
+				if (dv->reply) {
+					nfs_req->reply = dv->reply;
+					atomic_inc_int32_t(
+						&dv->reply->refcnt);
+				} else {
+					res = dv->res;
+				}
+				drc_inc_retwnd(p);
 				status = DUPREQ_EXISTS;
 				(dv->refcnt)++;
 			}
@@ -1033,10 +1165,8 @@ dupreq_status_t nfs_dupreq_start(nfs_request_data_t *nfs_req,
 						     dk->hk);
 			(dk->refcnt)++;
 			/* add to q tail */
-			PTHREAD_MUTEX_lock(&drc->mtx);
-			TAILQ_INSERT_TAIL(&drc->dupreq_q, dk, fifo_q);
-			++(drc->size);
-			PTHREAD_MUTEX_unlock(&drc->mtx);
+			TAILQ_INSERT_TAIL(&p->dupreq_q, dk, fifo_q);
+			++(p->size);
 			req->rq_u1 = dk;
 			release_dk = false;
 			dv = dk;
@@ -1083,6 +1213,9 @@ dupreq_status_t nfs_dupreq_start(nfs_request_data_t *nfs_req,
  * req->rq_u1 has either a magic value, or points to a duplicate request
  * cache entry allocated in nfs_dupreq_start.
  *
+ * With DRC_Encoded_Replies, the response is encoded and freed here,
+ * the entry keeping only the encoded bytes.
+ *
  * @param[in] req     The request
  * @param[in] res_nfs The response
  *
@@ -1093,8 +1226,11 @@ dupreq_status_t nfs_dupreq_finish(struct svc_req *req, nfs_res_t *res_nfs)
 {
 	dupreq_entry_t *ov = NULL, *dv = (dupreq_entry_t *)req->rq_u1;
 	dupreq_status_t status = DUPREQ_SUCCESS;
+	struct dupreq_reply *reply = NULL;
 	struct rbtree_x_part *t;
+	struct drc_part *p;
 	drc_t *drc = NULL;
+	uint64_t bytes = sizeof(dupreq_entry_t);
 
 	/* do nothing if req is marked no-cache */
 	if (dv == (void *)DUPREQ_NOCACHE)
@@ -1104,15 +1240,39 @@ dupreq_status_t nfs_dupreq_finish(struct svc_req *req, nfs_res_t *res_nfs)
 	if (dv == (void *)DUPREQ_BAD_ADDR1)
 		goto out;
 
+	if (nfs_param.core_param.drc.encoded_replies) {
+		reply = nfs_dupreq_encode(dv, res_nfs);
+		if (reply)
+			bytes += sizeof(struct dupreq_reply) + reply->len;
+	}
+
 	PTHREAD_MUTEX_lock(&dv->mtx);
-	dv->res = res_nfs;
+	if (reply) {
+		dv->reply = reply;
+		dv->res = NULL;
+	} else {
+		dv->res = res_nfs;
+	}
 	dv->timestamp = time(NULL);
 	dv->state = DUPREQ_COMPLETE;
 	drc = dv->hin.drc;
 	PTHREAD_MUTEX_unlock(&dv->mtx);
 
-	/* cond. remove from q head */
-	PTHREAD_MUTEX_lock(&drc->mtx);
+	if (reply) {
+		/* only the encoded bytes are kept */
+		nfs_dupreq_func(dv)->free_function(res_nfs);
+		free_nfs_res(res_nfs);
+	}
+
+	/* cond. remove from the q head of dv's partition */
+	t = rbtx_partition_of_scalar(&drc->xt, dv->hk);
+	p = drc_part_of(drc, t);
+	PTHREAD_MUTEX_lock(&t->mtx);	/* partition lock */
+
+	/* the caller's ref keeps dv from being retired before it is
+	 * counted */
+	dv->bytes = bytes;
+	p->bytes += bytes;
 
 	LogFullDebug(COMPONENT_DUPREQ,
 		     "completing dv=%p xid=%u on DRC=%p state=%s, status=%s, "
@@ -1122,26 +1282,27 @@ dupreq_status_t nfs_dupreq_finish(struct svc_req *req, nfs_res_t *res_nfs)
 
 	/* ok, do the new retwnd calculation here.  then, put drc only if
 	 * we retire an entry */
-	if (drc_should_retire(drc)) {
+	if (drc_should_retire(drc, p)) {
 		/* again: */
-		ov = TAILQ_FIRST(&drc->dupreq_q);
+		ov = TAILQ_FIRST(&p->dupreq_q);
 		if (likely(ov)) {
 			/* finished request count against retwnd */
-			drc_dec_retwnd(drc);
-			/* check refcnt */
+			drc_dec_retwnd(p);
+			/* check refcnt, under ov's lock so that a racing
+			 * nfs_dupreq_rele is done with ov once it drops */
+			PTHREAD_MUTEX_lock(&ov->mtx);
 			if (ov->refcnt > 0) {
 				/* ov still in use, apparently */
+				PTHREAD_MUTEX_unlock(&ov->mtx);
 				goto unlock;
 			}
+			PTHREAD_MUTEX_unlock(&ov->mtx);
 			/* remove q entry */
-			TAILQ_REMOVE(&drc->dupreq_q, ov, fifo_q);
-			--(drc->size);
+			TAILQ_REMOVE(&p->dupreq_q, ov, fifo_q);
+			--(p->size);
+			p->bytes -= ov->bytes;
 
-			/* remove dict entry */
-			t = rbtx_partition_of_scalar(&drc->xt, ov->hk);
-			/* interlock */
-			PTHREAD_MUTEX_unlock(&drc->mtx);
-			PTHREAD_MUTEX_lock(&t->mtx);	/* partition lock */
+			/* remove dict entry, ov is in the same partition */
 			rbtree_x_cached_remove(&drc->xt, t, &ov->rbt_k, ov->hk);
 			PTHREAD_MUTEX_unlock(&t->mtx);
 
@@ -1158,7 +1319,7 @@ dupreq_status_t nfs_dupreq_finish(struct svc_req *req, nfs_res_t *res_nfs)
 	}
 
  unlock:
-	PTHREAD_MUTEX_unlock(&drc->mtx);
+	PTHREAD_MUTEX_unlock(&t->mtx);
 
  out:
 	return status;
@@ -1185,6 +1346,7 @@ dupreq_status_t nfs_dupreq_delete(struct svc_req *req)
 	dupreq_entry_t *dv = (dupreq_entry_t *)req->rq_u1;
 	dupreq_status_t status = DUPREQ_SUCCESS;
 	struct rbtree_x_part *t;
+	struct drc_part *p;
 	drc_t *drc;
 
 	/* do nothing if req is marked no-cache */
@@ -1209,19 +1371,20 @@ dupreq_status_t nfs_dupreq_delete(struct svc_req *req)
 	/* XXX dv holds a ref on drc */
 	t = rbtx_partition_of_scalar(&drc->xt, dv->hk);
 
+	p = drc_part_of(drc, t);
+
 	PTHREAD_MUTEX_lock(&t->mtx);
 	rbtree_x_cached_remove(&drc->xt, t, &dv->rbt_k, dv->hk);
 
-	PTHREAD_MUTEX_unlock(&t->mtx);
-	PTHREAD_MUTEX_lock(&drc->mtx);
-
 	if (TAILQ_IS_ENQUEUED(dv, fifo_q))
-		TAILQ_REMOVE(&drc->dupreq_q, dv, fifo_q);
-	--(drc->size);
+		TAILQ_REMOVE(&p->dupreq_q, dv, fifo_q);
+	--(p->size);
+	p->bytes -= dv->bytes;
+	dv->bytes = 0;
+	PTHREAD_MUTEX_unlock(&t->mtx);
 
-	/* release dv's ref and unlock */
-	nfs_dupreq_put_drc(req->rq_xprt, drc, DRC_FLAG_LOCKED);
-	/* !LOCKED */
+	/* release dv's ref */
+	nfs_dupreq_put_drc(req->rq_xprt, drc, DRC_FLAG_NONE);
 
  out:
 	return status;
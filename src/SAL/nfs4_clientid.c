@@ -66,6 +66,11 @@ hash_table_t *ht_confirmed_client_id;
  */
 hash_table_t *ht_unconfirmed_client_id;
 
+/**
+ * @brief Lease expiry timers of all client IDs, run by the reaper
+ */
+struct timer_wheel clientid_wheel;
+
 /**
  * @brief Counter to create clientids
  */
@@ -311,6 +316,8 @@ void free_client_id(nfs_client_id_t *clientid)
 {
 	assert(atomic_fetch_int32_t(&clientid->cid_refcount) == 0);
 
+	timer_wheel_cancel(&clientid_wheel, &clientid->cid_expiry);
+
 	if (clientid->cid_client_record != NULL)
 		dec_client_record_ref(clientid->cid_client_record);
 
@@ -545,6 +552,7 @@ nfs_client_id_t *create_client_id(clientid4 clientid,
 	client_rec->cid_minorversion = minorversion;
 	client_rec->gsh_client = op_ctx->client;
 	inc_gsh_client_refcount(op_ctx->client);
+	timer_wheel_entry_init(&client_rec->cid_expiry);
 
 	/* need to init the list_head */
 	glist_init(&client_rec->cid_openowners);
@@ -612,6 +620,11 @@ clientid_status_t nfs_client_id_insert(nfs_client_id_t *clientid)
 	/* Take a reference to the unconfirmed clientid for the hash table. */
 	(void)inc_client_id_ref(clientid);
 
+	/* Have the reaper look at it when the lease would run out */
+	timer_wheel_arm(&clientid_wheel, &clientid->cid_expiry,
+			clientid->cid_last_renew +
+			nfs_param.nfsv4_param.lease_lifetime);
+
 	if (isFullDebug(COMPONENT_CLIENTID) &&
 	    isFullDebug(COMPONENT_HASHTABLE)) {
 		LogFullDebug(COMPONENT_CLIENTID,
@@ -1253,6 +1266,13 @@ int nfs_Init_client_id(void)
 		return -1;
 	}
 
+	if (timer_wheel_init(&clientid_wheel,
+			     2 * nfs_param.nfsv4_param.lease_lifetime) != 0) {
+		LogCrit(COMPONENT_INIT,
+			"NFS CLIENT_ID: Cannot init Client Id expiry timers");
+		return -1;
+	}
+
 	return CLIENT_ID_SUCCESS;
 }
 
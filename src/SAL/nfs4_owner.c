@@ -44,6 +44,11 @@
 
 hash_table_t *ht_nfs4_owner;
 
+/**
+ * @brief Expiry timers of cached open owners, run by the reaper
+ */
+struct timer_wheel open_owner_wheel;
+
 /**
  * @brief Display an NFSv4 owner key
  *
@@ -315,6 +320,9 @@ uint64_t nfs4_owner_rbt_hash_func(hash_parameter_t *hparam,
 
 void free_nfs4_owner(state_owner_t *owner)
 {
+	timer_wheel_cancel(&open_owner_wheel,
+			   &owner->so_owner.so_nfs4_owner.so_expiry);
+
 	if (owner->so_owner.so_nfs4_owner.so_related_owner != NULL)
 		dec_state_owner_ref(owner->so_owner.so_nfs4_owner.
 				    so_related_owner);
@@ -341,7 +349,7 @@ static hash_parameter_t nfs4_owner_param = {
 	.compare_key = compare_nfs4_owner_key,
 	.key_to_str = display_nfs4_owner_key,
 	.val_to_str = display_nfs4_owner_val,
-	.flags = HT_FLAG_CACHE,
+	.flags = HT_FLAG_RESIZE,
 };
 
 /**
@@ -359,6 +367,13 @@ int Init_nfs4_owner(void)
 		return -1;
 	}
 
+	if (timer_wheel_init(&open_owner_wheel,
+			     2 * nfs_param.nfsv4_param.lease_lifetime) != 0) {
+		LogCrit(COMPONENT_STATE,
+			"Cannot init NFS Open Owner expiry timers");
+		return -1;
+	}
+
 	return 0;
 }				/* nfs4_Init_nfs4_owner */
 
@@ -371,6 +386,7 @@ int Init_nfs4_owner(void)
 static void init_nfs4_owner(state_owner_t *owner)
 {
 	glist_init(&owner->so_owner.so_nfs4_owner.so_state_list);
+	timer_wheel_entry_init(&owner->so_owner.so_nfs4_owner.so_expiry);
 
 	/* Increment refcount on related owner */
 	if (owner->so_owner.so_nfs4_owner.so_related_owner != NULL)
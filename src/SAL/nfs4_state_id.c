@@ -287,6 +287,20 @@ uint64_t state_id_rbt_hash_func(hash_parameter_t *hparam,
 	return val;
 }
 
+/**
+ * @brief Drop the reference of the stateid table
+ *
+ * Called once lock free lookups can no longer find the deleted state.
+ *
+ * @param[in] key The stateid other
+ * @param[in] val The state
+ */
+static void state_id_release(struct gsh_buffdesc *key,
+			     struct gsh_buffdesc *val)
+{
+	dec_state_t_ref(val->addr);
+}
+
 static hash_parameter_t state_id_param = {
 	.index_size = PRIME_STATE,
 	.hash_func_key = state_id_value_hash_func,
@@ -294,7 +308,8 @@ static hash_parameter_t state_id_param = {
 	.compare_key = compare_state_id,
 	.key_to_str = display_state_id_key,
 	.val_to_str = display_state_id_val,
-	.flags = HT_FLAG_CACHE,
+	.release_entry = state_id_release,
+	.flags = HT_FLAG_RESIZE,
 };
 
 /**
@@ -407,18 +422,27 @@ int nfs4_State_Set(state_t *state)
 	buffval.addr = state;
 	buffval.len = sizeof(state_t);
 
+	/* Reference of the table, dropped by state_id_release */
+	inc_state_t_ref(state);
+
 	if (hashtable_test_and_set
 	    (ht_state_id, &buffkey, &buffval,
 	     HASHTABLE_SET_HOW_SET_NO_OVERWRITE) != HASHTABLE_SUCCESS) {
 		LogCrit(COMPONENT_STATE,
 			"hashtable_test_and_set failed for key %p",
 			buffkey.addr);
+		dec_state_t_ref(state);
 		return 0;
 	}
 
 	return 1;
 }
 
+static void state_id_get_ref(struct gsh_buffdesc *val)
+{
+	inc_state_t_ref(val->addr);
+}
+
 /**
  * @brief Get the state from the stateid
  *
@@ -431,30 +455,23 @@ struct state_t *nfs4_State_Get_Pointer(char *other)
 	struct gsh_buffdesc buffkey;
 	struct gsh_buffdesc buffval;
 	hash_error_t rc;
-	struct hash_latch latch;
-	struct state_t *state;
 
 	buffkey.addr = other;
 	buffkey.len = OTHERSIZE;
 
-	rc = hashtable_getlatch(ht_state_id, &buffkey, &buffval, true, &latch);
+	/* The table holds a reference until lock free lookups can no
+	 * longer find the deleted state, so the reference can be taken
+	 * without the latch.
+	 */
+	rc = hashtable_getref(ht_state_id, &buffkey, &buffval,
+			      state_id_get_ref);
 
 	if (rc != HASHTABLE_SUCCESS) {
-		if (rc == HASHTABLE_ERROR_NO_SUCH_KEY)
-			hashtable_releaselatched(ht_state_id, &latch);
 		LogDebug(COMPONENT_STATE, "HashTable_Get returned %d", rc);
 		return NULL;
 	}
 
-	state = buffval.addr;
-
-	/* Take a reference under latch */
-	inc_state_t_ref(state);
-
-	/* Release latch */
-	hashtable_releaselatched(ht_state_id, &latch);
-
-	return state;
+	return buffval.addr;
 }
 
 /**
@@ -552,6 +552,7 @@ static state_lock_entry_t *create_state_lock_entry(cache_entry_t *entry,
 	new_entry->sle_state = state;
 	new_entry->sle_lock = *lock;
 	new_entry->sle_export = export;
+	interval_node_init(&new_entry->sle_range);
 
 	if (owner->so_type == STATE_LOCK_OWNER_NLM) {
 		/* Add to list of locks owned by client that owner belongs to */
@@ -663,6 +664,111 @@ static void lock_entry_dec_ref(state_lock_entry_t *lock_entry)
 	}
 }
 
+/**
+ * @brief Add an entry to a list of locks
+ *
+ * Entries added to the lock list of their file are also indexed in
+ * the file's lock tree.
+ *
+ * @param[in,out] list       List to add to
+ * @param[in,out] lock_entry Entry to add
+ */
+static void lock_list_add(struct glist_head *list,
+			  state_lock_entry_t *lock_entry)
+{
+	struct cache_inode_file *file = &lock_entry->sle_entry->object.file;
+
+	if (list == &file->lock_list) {
+		if (glist_empty(list))
+			file->lock_export = lock_entry->sle_export;
+		else if (file->lock_export != lock_entry->sle_export)
+			file->lock_export = NULL;
+
+		interval_tree_insert(&file->lock_tree, &lock_entry->sle_range,
+				     lock_entry->sle_lock.lock_start,
+				     lock_end(&lock_entry->sle_lock));
+	}
+
+	glist_add_tail(list, &lock_entry->sle_list);
+}
+
+/**
+ * @brief Take an entry off the list of locks it is on
+ *
+ * @param[in,out] lock_entry Entry to remove
+ */
+static void lock_list_del(state_lock_entry_t *lock_entry)
+{
+	if (interval_node_linked(&lock_entry->sle_range))
+		interval_tree_remove(&lock_entry->sle_entry->object.file
+				     .lock_tree, &lock_entry->sle_range);
+
+	glist_del(&lock_entry->sle_list);
+}
+
+/**
+ * @brief Index an entry again after its range changed
+ *
+ * @param[in,out] lock_entry Entry that was resized
+ */
+static void lock_range_changed(state_lock_entry_t *lock_entry)
+{
+	struct interval_tree *tree =
+			&lock_entry->sle_entry->object.file.lock_tree;
+
+	if (!interval_node_linked(&lock_entry->sle_range))
+		return;
+
+	interval_tree_remove(tree, &lock_entry->sle_range);
+	interval_tree_insert(tree, &lock_entry->sle_range,
+			     lock_entry->sle_lock.lock_start,
+			     lock_end(&lock_entry->sle_lock));
+}
+
+/**
+ * @brief First lock of a file overlapping a range
+ *
+ * Granted and blocked locks are returned alike, in order of start.
+ *
+ * @param[in] entry File
+ * @param[in] start First byte of the range
+ * @param[in] last  Last byte of the range
+ *
+ * @return The lock entry or NULL.
+ */
+static state_lock_entry_t *lock_range_first(cache_entry_t *entry,
+					    uint64_t start, uint64_t last)
+{
+	struct interval_node *node;
+
+	node = interval_tree_first(&entry->object.file.lock_tree, start, last);
+	if (node == NULL)
+		return NULL;
+
+	return interval_entry(node, state_lock_entry_t, sle_range);
+}
+
+/**
+ * @brief Next lock of a file overlapping a range
+ *
+ * @param[in] lock_entry Previous match, still on the lock list
+ * @param[in] start      First byte of the range
+ * @param[in] last       Last byte of the range
+ *
+ * @return The lock entry or NULL.
+ */
+static state_lock_entry_t *lock_range_next(state_lock_entry_t *lock_entry,
+					   uint64_t start, uint64_t last)
+{
+	struct interval_node *node;
+
+	node = interval_tree_next(&lock_entry->sle_range, start, last);
+	if (node == NULL)
+		return NULL;
+
+	return interval_entry(node, state_lock_entry_t, sle_range);
+}
+
 /**
  * @brief Remove an entry from the lock lists
  *
@@ -716,7 +822,7 @@ static void remove_from_locklist(state_lock_entry_t *lock_entry)
 	}
 
 	lock_entry->sle_owner = NULL;
-	glist_del(&lock_entry->sle_list);
+	lock_list_del(lock_entry);
 	lock_entry_dec_ref(lock_entry);
 }
 
@@ -733,13 +839,14 @@ static state_lock_entry_t *get_overlapping_entry(cache_entry_t *entry,
 						 state_owner_t *owner,
 						 fsal_lock_param_t *lock)
 {
-	struct glist_head *glist;
-	state_lock_entry_t *found_entry = NULL;
-	uint64_t found_entry_end, range_end = lock_end(lock);
-
-	glist_for_each(glist, &entry->object.file.lock_list) {
-		found_entry = glist_entry(glist, state_lock_entry_t, sle_list);
+	state_lock_entry_t *found_entry;
+	uint64_t range_end = lock_end(lock);
 
+	for (found_entry = lock_range_first(entry, lock->lock_start,
+					    range_end);
+	     found_entry != NULL;
+	     found_entry = lock_range_next(found_entry, lock->lock_start,
+					   range_end)) {
 		LogEntry("Checking", found_entry);
 
 		/* Skip blocked or cancelled locks */
@@ -748,21 +855,15 @@ static state_lock_entry_t *get_overlapping_entry(cache_entry_t *entry,
 		    || found_entry->sle_blocked == STATE_CANCELED)
 			continue;
 
-		found_entry_end = lock_end(&found_entry->sle_lock);
-
-		if ((found_entry_end >= lock->lock_start)
-		    && (found_entry->sle_lock.lock_start <= range_end)) {
-			/* lock overlaps see if we can allow:
-			 * allow if neither lock is exclusive or
-			 * the owner is the same
-			 */
-			if ((found_entry->sle_lock.lock_type == FSAL_LOCK_W
-			     || lock->lock_type == FSAL_LOCK_W)
-			    && different_owners(found_entry->sle_owner, owner)
-			    ) {
-				/* found a conflicting lock, return it */
-				return found_entry;
-			}
+		/* lock overlaps see if we can allow:
+		 * allow if neither lock is exclusive or
+		 * the owner is the same
+		 */
+		if ((found_entry->sle_lock.lock_type == FSAL_LOCK_W
+		     || lock->lock_type == FSAL_LOCK_W)
+		    && different_owners(found_entry->sle_owner, owner)) {
+			/* found a conflicting lock, return it */
+			return found_entry;
 		}
 	}
 
@@ -772,9 +873,9 @@ static state_lock_entry_t *get_overlapping_entry(cache_entry_t *entry,
 /**
  * @brief Add a lock, potentially merging with existing locks
  *
- * We need to iterate over the full lock list and remove
- * any mapping entry. And l_offset = 0 and sle_lock.lock_length = 0 lock_entry
- * implies remove all entries
+ * Only the locks overlapping or touching the new lock are looked at.
+ * Locks of the same owner and type never touch, so the ones the lock
+ * grows over as it merges are found by the same search.
  *
  * @param[in,out] entry      File to operate on
  * @param[in]     lock_entry Lock to add
@@ -784,15 +885,25 @@ static void merge_lock_entry(cache_entry_t *entry,
 {
 	state_lock_entry_t *check_entry;
 	state_lock_entry_t *check_entry_right;
+	state_lock_entry_t *next_entry;
 	uint64_t check_entry_end;
-	uint64_t lock_entry_end;
-	struct glist_head *glist;
-	struct glist_head *glistn;
+	uint64_t lock_entry_end = lock_end(&lock_entry->sle_lock);
+	uint64_t range_start = lock_entry->sle_lock.lock_start;
+	uint64_t range_end = lock_entry_end;
 
 	/* lock_entry might be STATE_NON_BLOCKING or STATE_GRANTING */
 
-	glist_for_each_safe(glist, glistn, &entry->object.file.lock_list) {
-		check_entry = glist_entry(glist, state_lock_entry_t, sle_list);
+	/* Touching locks are merged too */
+	if (range_start > 0)
+		range_start--;
+	if (range_end < UINT64_MAX)
+		range_end++;
+
+	for (check_entry = lock_range_first(entry, range_start, range_end);
+	     check_entry != NULL;
+	     check_entry = next_entry) {
+		next_entry = lock_range_next(check_entry, range_start,
+					     range_end);
 
 		/* Skip entry being merged - it could be in the list */
 		if (check_entry == lock_entry)
@@ -843,8 +954,8 @@ static void merge_lock_entry(cache_entry_t *entry,
 						 "Memory allocation failure during lock upgrade/downgrade");
 					continue;
 				}
-				glist_add_tail(&entry->object.file.lock_list,
-					       &(check_entry_right->sle_list));
+				lock_list_add(&entry->object.file.lock_list,
+					      check_entry_right);
 			} else {
 				/* No split, just shrink, make the logic below
 				 * work on original lock
@@ -875,6 +986,9 @@ static void merge_lock_entry(cache_entry_t *entry,
 				    check_entry->sle_lock.lock_start;
 				LogEntry("Merge shrunk left", check_entry);
 			}
+			lock_range_changed(check_entry_right);
+			if (check_entry_right != check_entry)
+				lock_range_changed(check_entry);
 			/* Done splitting/shrinking old lock */
 			continue;
 		}
@@ -901,6 +1015,8 @@ static void merge_lock_entry(cache_entry_t *entry,
 		LogEntry("Merging removing", check_entry);
 		remove_from_locklist(check_entry);
 	}
+
+	lock_range_changed(lock_entry);
 }
 
 /**
@@ -1005,13 +1121,48 @@ static state_status_t subtract_lock_from_entry(cache_entry_t *entry,
 	/* Remove the lock from the list it's
 	 * on and put it on the remove_list
 	 */
-	glist_del(&found_entry->sle_list);
+	lock_list_del(found_entry);
 	glist_add_tail(remove_list, &(found_entry->sle_list));
 
 	*removed = true;
 	return status;
 }
 
+/**
+ * @brief Next entry of a lock list that may overlap a range
+ *
+ * The lock list of a file is walked through its lock tree, only the
+ * locks overlapping the range are returned.  Other lists are walked
+ * in full.
+ *
+ * @param[in] entry      File the list belongs to
+ * @param[in] list       List of locks
+ * @param[in] lock_entry Previous entry, NULL to start
+ * @param[in] start      First byte of the range
+ * @param[in] last       Last byte of the range
+ *
+ * @return The next entry or NULL.
+ */
+static state_lock_entry_t *lock_list_next(cache_entry_t *entry,
+					  struct glist_head *list,
+					  state_lock_entry_t *lock_entry,
+					  uint64_t start, uint64_t last)
+{
+	struct glist_head *glist;
+
+	if (list == &entry->object.file.lock_list) {
+		if (lock_entry == NULL)
+			return lock_range_first(entry, start, last);
+		return lock_range_next(lock_entry, start, last);
+	}
+
+	glist = lock_entry == NULL ? list->next : lock_entry->sle_list.next;
+	if (glist == list)
+		return NULL;
+
+	return glist_entry(glist, state_lock_entry_t, sle_list);
+}
+
 /**
  * @brief Subtract a lock from a list of locks
  *
@@ -1033,19 +1184,24 @@ static state_status_t subtract_lock_from_list(cache_entry_t *entry,
 					      bool *removed,
 					      struct glist_head *list)
 {
-	state_lock_entry_t *found_entry;
+	state_lock_entry_t *found_entry, *next_entry;
 	struct glist_head split_lock_list, remove_list;
 	struct glist_head *glist, *glistn;
 	state_status_t status = STATE_SUCCESS;
 	bool removed_one = false;
+	uint64_t range_end = lock_end(lock);
 
 	*removed = false;
 
 	glist_init(&split_lock_list);
 	glist_init(&remove_list);
 
-	glist_for_each_safe(glist, glistn, list) {
-		found_entry = glist_entry(glist, state_lock_entry_t, sle_list);
+	for (found_entry = lock_list_next(entry, list, NULL,
+					  lock->lock_start, range_end);
+	     found_entry != NULL;
+	     found_entry = next_entry) {
+		next_entry = lock_list_next(entry, list, found_entry,
+					    lock->lock_start, range_end);
 
 		if (owner != NULL
 		    && different_owners(found_entry->sle_owner, owner))
@@ -1091,14 +1247,19 @@ static state_status_t subtract_lock_from_list(cache_entry_t *entry,
 			found_entry =
 			    glist_entry(glist, state_lock_entry_t, sle_list);
 			glist_del(&found_entry->sle_list);
-			glist_add_tail(list, &(found_entry->sle_list));
+			lock_list_add(list, found_entry);
 		}
 	} else {
 		/* free the enttries on the remove_list */
 		free_list(&remove_list);
 
 		/* now add the split lock list */
-		glist_add_list_tail(list, &split_lock_list);
+		glist_for_each_safe(glist, glistn, &split_lock_list) {
+			found_entry =
+			    glist_entry(glist, state_lock_entry_t, sle_list);
+			glist_del(&found_entry->sle_list);
+			lock_list_add(list, found_entry);
+		}
 	}
 
 	LogFullDebug(COMPONENT_STATE,
@@ -1146,7 +1307,8 @@ static state_status_t subtract_list_from_list(cache_entry_t *entry,
  *
  ******************************************************************************/
 
-static void grant_blocked_locks(cache_entry_t *entry);
+static void grant_blocked_locks(cache_entry_t *entry,
+				fsal_lock_param_t *lock);
 
 /**
  * @brief Display lock cookie in hash table
@@ -1665,7 +1827,7 @@ void grant_blocked_lock_immediate(cache_entry_t *entry,
 	LogEntry("Immediate Granted entry", lock_entry);
 
 	/* A lock downgrade could unblock blocked locks */
-	grant_blocked_locks(entry);
+	grant_blocked_locks(entry, &lock_entry->sle_lock);
 }
 
 /**
@@ -1704,7 +1866,7 @@ void state_complete_grant(state_cookie_entry_t *cookie_entry)
 		LogEntry("Granted entry", lock_entry);
 
 		/* A lock downgrade could unblock blocked locks */
-		grant_blocked_locks(entry);
+		grant_blocked_locks(entry, &lock_entry->sle_lock);
 	}
 
 	/* Free cookie and unblock lock.
@@ -1829,16 +1991,23 @@ void process_blocked_lock_upcall(state_block_data_t *block_data)
 }
 
 /**
- * @brief Attempt to grant all blocked locks on a file
+ * @brief Attempt to grant the blocked locks on part of a file
+ *
+ * Only locks overlapping the range that was released or downgraded
+ * can have been unblocked.
  *
  * @param[in] entry Cache entry for the file
+ * @param[in] lock  Range that changed
  */
 
-static void grant_blocked_locks(cache_entry_t *entry)
+static void grant_blocked_locks(cache_entry_t *entry,
+				fsal_lock_param_t *lock)
 {
-	state_lock_entry_t *found_entry;
-	struct glist_head *glist, *glistn;
+	state_lock_entry_t *found_entry, *next_entry;
 	struct fsal_export *export = op_ctx->export->fsal_export;
+	uint64_t range_start = lock->lock_start;
+	uint64_t range_end = lock_end(lock);
+	bool linked;
 
 	/* If FSAL supports async blocking locks,
 	 * allow it to grant blocked locks.
@@ -1846,23 +2015,37 @@ static void grant_blocked_locks(cache_entry_t *entry)
 	if (export->exp_ops.fs_supports(export, fso_lock_support_async_block))
 		return;
 
-	glist_for_each_safe(glist, glistn, &entry->object.file.lock_list) {
-		found_entry = glist_entry(glist, state_lock_entry_t, sle_list);
+	found_entry = lock_range_first(entry, range_start, range_end);
 
-		if (found_entry->sle_blocked != STATE_NLM_BLOCKING
-		    && found_entry->sle_blocked != STATE_NFSV4_BLOCKING)
-			continue;
+	while (found_entry != NULL) {
+		/* Granting may remove other locks, hold on to the next
+		 * one so we can tell.
+		 */
+		next_entry = lock_range_next(found_entry, range_start,
+					     range_end);
+		if (next_entry != NULL)
+			lock_entry_inc_ref(next_entry);
 
 		/* Found a blocked entry for this file,
 		 * see if we can place the lock.
 		 */
-		if (get_overlapping_entry
-		    (entry, found_entry->sle_owner,
-		     &found_entry->sle_lock) != NULL)
-			continue;
+		if ((found_entry->sle_blocked == STATE_NLM_BLOCKING
+		     || found_entry->sle_blocked == STATE_NFSV4_BLOCKING)
+		    && get_overlapping_entry(entry, found_entry->sle_owner,
+					     &found_entry->sle_lock) == NULL) {
+			/* Found an entry that might work, try to grant it. */
+			try_to_grant_lock(found_entry);
+		}
+
+		if (next_entry == NULL)
+			break;
 
-		/* Found an entry that might work, try to grant it. */
-		try_to_grant_lock(found_entry);
+		/* Stop if the next lock went away, what is left will be
+		 * tried again on the next change.
+		 */
+		linked = interval_node_linked(&next_entry->sle_range);
+		lock_entry_dec_ref(next_entry);
+		found_entry = linked ? next_entry : NULL;
 	}
 }
 
@@ -1973,12 +2156,15 @@ void cancel_blocked_locks_range(cache_entry_t *entry,
 				state_owner_t *owner, state_t *state,
 				fsal_lock_param_t *lock)
 {
-	struct glist_head *glist, *glistn;
-	state_lock_entry_t *found_entry = NULL;
-	uint64_t found_entry_end, range_end = lock_end(lock);
+	state_lock_entry_t *found_entry, *next_entry;
+	uint64_t range_end = lock_end(lock);
 
-	glist_for_each_safe(glist, glistn, &entry->object.file.lock_list) {
-		found_entry = glist_entry(glist, state_lock_entry_t, sle_list);
+	for (found_entry = lock_range_first(entry, lock->lock_start,
+					    range_end);
+	     found_entry != NULL;
+	     found_entry = next_entry) {
+		next_entry = lock_range_next(found_entry, lock->lock_start,
+					     range_end);
 
 		/* Skip locks not owned by owner */
 		if (owner != NULL
@@ -1999,13 +2185,8 @@ void cancel_blocked_locks_range(cache_entry_t *entry,
 
 		LogEntry("Checking", found_entry);
 
-		found_entry_end = lock_end(&found_entry->sle_lock);
-
-		if ((found_entry_end >= lock->lock_start)
-		    && (found_entry->sle_lock.lock_start <= range_end)) {
-			/* lock overlaps, cancel it. */
-			cancel_blocked_lock(entry, found_entry);
-		}
+		/* lock overlaps, cancel it. */
+		cancel_blocked_lock(entry, found_entry);
 	}
 }
 
@@ -2021,9 +2202,11 @@ state_status_t state_release_grant(state_cookie_entry_t *cookie_entry)
 	state_lock_entry_t *lock_entry;
 	cache_entry_t *entry;
 	state_status_t status = STATE_SUCCESS;
+	fsal_lock_param_t released;
 
 	lock_entry = cookie_entry->sce_lock_entry;
 	entry = cookie_entry->sce_entry;
+	released = lock_entry->sle_lock;
 
 	/* This routine does not call cache_inode_inc_pin_ref() because there
 	 * MUST be at least one lock present for there to be a cookie_entry
@@ -2072,7 +2255,7 @@ state_status_t state_release_grant(state_cookie_entry_t *cookie_entry)
 	free_cookie(cookie_entry, true);
 
 	/* Check to see if we can grant any blocked locks. */
-	grant_blocked_locks(entry);
+	grant_blocked_locks(entry, &released);
 
 	PTHREAD_RWLOCK_unlock(&entry->state_lock);
 
@@ -2451,6 +2634,35 @@ state_status_t state_test(cache_entry_t *entry,
 	return status;
 }
 
+/**
+ * @brief Find a lock an owner holds on a file through another export
+ *
+ * @param[in] entry File
+ * @param[in] owner Lock owner
+ *
+ * @return The lock entry or NULL.
+ */
+static state_lock_entry_t *lock_export_conflict(cache_entry_t *entry,
+						state_owner_t *owner)
+{
+	struct glist_head *glist;
+	state_lock_entry_t *found_entry;
+
+	/* No need to look when all the locks came through this export */
+	if (entry->object.file.lock_export == op_ctx->export)
+		return NULL;
+
+	glist_for_each(glist, &entry->object.file.lock_list) {
+		found_entry = glist_entry(glist, state_lock_entry_t, sle_list);
+
+		if (found_entry->sle_export != op_ctx->export
+		    && !different_owners(found_entry->sle_owner, owner))
+			return found_entry;
+	}
+
+	return NULL;
+}
+
 /**
  * @brief Attempt to acquire a lock
  *
@@ -2476,9 +2688,7 @@ state_status_t state_lock(cache_entry_t *entry,
 			  fsal_lock_param_t *conflict)
 {
 	bool allow = true, overlap = false;
-	struct glist_head *glist;
 	state_lock_entry_t *found_entry;
-	uint64_t found_entry_end;
 	uint64_t range_end = lock_end(lock);
 	cache_inode_status_t cache_status;
 	struct fsal_export *fsal_export = op_ctx->fsal_export;
@@ -2536,37 +2746,40 @@ state_status_t state_lock(cache_entry_t *entry,
 
 	PTHREAD_RWLOCK_wrlock(&entry->state_lock);
 
+	/* Need to reject lock request if this lock owner already has
+	 * a lock on this file via a different export.
+	 */
+	found_entry = lock_export_conflict(entry, owner);
+	if (found_entry != NULL) {
+		LogEvent(COMPONENT_STATE,
+			 "Lock Owner Export Conflict, Lock held for export %d (%s), request for export %d (%s)",
+			 found_entry->sle_export->export_id,
+			 found_entry->sle_export->fullpath,
+			 op_ctx->export->export_id,
+			 op_ctx->export->fullpath);
+
+		LogEntry("Found lock entry belonging to another export",
+			 found_entry);
+
+		status = STATE_INVALID_ARGUMENT;
+		goto out_unlock;
+	}
+
 	if (blocking != STATE_NON_BLOCKING) {
 		/* First search for a blocked request. Client can ignore the
 		 * blocked request and keep sending us new lock request again
 		 * and again. So if we have a mapping blocked request return
 		 * that
 		 */
-		glist_for_each(glist, &entry->object.file.lock_list) {
-			found_entry =
-			    glist_entry(glist, state_lock_entry_t, sle_list);
-
+		for (found_entry = lock_range_first(entry, lock->lock_start,
+						    range_end);
+		     found_entry != NULL;
+		     found_entry = lock_range_next(found_entry,
+						   lock->lock_start,
+						   range_end)) {
 			if (different_owners(found_entry->sle_owner, owner))
 				continue;
 
-			/* Need to reject lock request if this lock owner
-			 * already has a lock on this file via a different
-			 * export.
-			 */
-			if (found_entry->sle_export != op_ctx->export) {
-				LogEvent(COMPONENT_STATE,
-					 "Lock Owner Export Conflict, Lock held for export %d (%s), request for export %d (%s)",
-					 found_entry->sle_export->export_id,
-					 found_entry->sle_export->fullpath,
-					 op_ctx->export->export_id,
-					 op_ctx->export->fullpath);
-				LogEntry(
-					"Found lock entry belonging to another export",
-					found_entry);
-				status = STATE_INVALID_ARGUMENT;
-				goto out_unlock;
-			}
-
 			if (found_entry->sle_blocked != blocking)
 				continue;
 
@@ -2583,55 +2796,30 @@ state_status_t state_lock(cache_entry_t *entry,
 		}
 	}
 
-	glist_for_each(glist, &entry->object.file.lock_list) {
-		found_entry = glist_entry(glist, state_lock_entry_t, sle_list);
-		/* Need to reject lock request if this lock owner already has
-		 * a lock on this file via a different export.
-		 */
-		if (found_entry->sle_export != op_ctx->export
-		    && !different_owners(found_entry->sle_owner, owner)) {
-			LogEvent(COMPONENT_STATE,
-				 "Lock Owner Export Conflict, Lock held for export %d (%s), request for export %d (%s)",
-				 found_entry->sle_export->export_id,
-				 found_entry->sle_export->fullpath,
-				 op_ctx->export->export_id,
-				 op_ctx->export->fullpath);
-
-			LogEntry("Found lock entry belonging to another export",
-				 found_entry);
-
-			status = STATE_INVALID_ARGUMENT;
-			goto out_unlock;
-		}
-
+	for (found_entry = lock_range_first(entry, lock->lock_start,
+					    range_end);
+	     found_entry != NULL;
+	     found_entry = lock_range_next(found_entry, lock->lock_start,
+					   range_end)) {
 		/* Don't skip blocked locks for fairness */
-		found_entry_end = lock_end(&found_entry->sle_lock);
-
 		if (!(lock->lock_reclaim)
-		    && (found_entry_end >= lock->lock_start)
-		    && (found_entry->sle_lock.lock_start <= range_end)) {
-			/* lock overlaps see if we can allow:
-			 * allow if neither lock is exclusive or
-			 * the owner is the same
+		    && (found_entry->sle_lock.lock_type == FSAL_LOCK_W
+			|| lock->lock_type == FSAL_LOCK_W)
+		    && different_owners(found_entry->sle_owner, owner)) {
+			/* lock overlaps and neither lock is shared nor
+			 * the owner the same.  Found a conflicting lock,
+			 * break out of loop.  Also indicate overlap hint.
 			 */
-			if ((found_entry->sle_lock.lock_type == FSAL_LOCK_W
-			     || lock->lock_type == FSAL_LOCK_W)
-			    && different_owners(found_entry->sle_owner,
-						owner)) {
-				/* Found a conflicting lock, break out of loop.
-				 * Also indicate overlap hint.
-				 */
-				LogEntry("Conflicts with", found_entry);
-				LogList("Locks", entry,
-					&entry->object.file.lock_list);
-				copy_conflict(found_entry, holder, conflict);
-				allow = false;
-				overlap = true;
-				break;
-			}
+			LogEntry("Conflicts with", found_entry);
+			LogList("Locks", entry,
+				&entry->object.file.lock_list);
+			copy_conflict(found_entry, holder, conflict);
+			allow = false;
+			overlap = true;
+			break;
 		}
 
-		if (found_entry_end >= range_end
+		if (lock_end(&found_entry->sle_lock) >= range_end
 		    && found_entry->sle_lock.lock_start <= lock->lock_start
 		    && found_entry->sle_lock.lock_type == lock->lock_type
 		    && (found_entry->sle_blocked == STATE_NON_BLOCKING
@@ -2789,11 +2977,10 @@ state_status_t state_lock(cache_entry_t *entry,
 			unpin = false;
 		}
 
-		glist_add_tail(&entry->object.file.lock_list,
-			       &found_entry->sle_list);
+		lock_list_add(&entry->object.file.lock_list, found_entry);
 
 		/* A lock downgrade could unblock blocked locks */
-		grant_blocked_locks(entry);
+		grant_blocked_locks(entry, &found_entry->sle_lock);
 	} else if (status == STATE_LOCK_CONFLICT) {
 		LogEntry("Conflict in FSAL for", found_entry);
 
@@ -2814,8 +3001,7 @@ state_status_t state_lock(cache_entry_t *entry,
 			unpin = false;
 		}
 
-		glist_add_tail(&entry->object.file.lock_list,
-			       &found_entry->sle_list);
+		lock_list_add(&entry->object.file.lock_list, found_entry);
 
 		PTHREAD_RWLOCK_unlock(&entry->state_lock);
 		release_state_lock = false;
@@ -2961,7 +3147,7 @@ state_status_t state_unlock(cache_entry_t *entry,
 		empty =
 		    LogList("Lock List", entry, &entry->object.file.lock_list);
 
-	grant_blocked_locks(entry);
+	grant_blocked_locks(entry, lock);
 
 
 	if (isFullDebug(COMPONENT_STATE) && isFullDebug(COMPONENT_MEMLEAKS)
@@ -2990,10 +3176,10 @@ state_status_t state_unlock(cache_entry_t *entry,
 state_status_t state_cancel(cache_entry_t *entry,
 			    state_owner_t *owner, fsal_lock_param_t *lock)
 {
-	struct glist_head *glist;
 	state_lock_entry_t *found_entry;
 	cache_inode_status_t cache_status;
 	state_status_t status;
+	uint64_t range_end = lock_end(lock);
 
 	if (entry->type != REGULAR_FILE) {
 		LogLock(COMPONENT_STATE, NIV_DEBUG,
@@ -3020,9 +3206,11 @@ state_status_t state_cancel(cache_entry_t *entry,
 		goto out_unlock;
 	}
 
-	glist_for_each(glist, &entry->object.file.lock_list) {
-		found_entry = glist_entry(glist, state_lock_entry_t, sle_list);
-
+	for (found_entry = lock_range_first(entry, lock->lock_start,
+					    range_end);
+	     found_entry != NULL;
+	     found_entry = lock_range_next(found_entry, lock->lock_start,
+					   range_end)) {
 		if (different_owners(found_entry->sle_owner, owner))
 			continue;
 
@@ -3037,7 +3225,7 @@ state_status_t state_cancel(cache_entry_t *entry,
 		cancel_blocked_lock(entry, found_entry);
 
 		/* Check to see if we can grant any blocked locks. */
-		grant_blocked_locks(entry);
+		grant_blocked_locks(entry, lock);
 
 		break;
 	}
@@ -1000,8 +1000,13 @@ void dec_state_owner_ref(state_owner_t *owner)
 	if ((owner->so_type == STATE_OPEN_OWNER_NFSV4) &&
 	    (atomic_fetch_time_t(&owner->so_owner.so_nfs4_owner.
 				 last_close_time) == 0)) {
+		time_t tclose = time(NULL);
+
 		atomic_store_time_t(&owner->so_owner.so_nfs4_owner.
-				    last_close_time, time(NULL));
+				    last_close_time, tclose);
+		timer_wheel_arm(&open_owner_wheel,
+				&owner->so_owner.so_nfs4_owner.so_expiry,
+				tclose + nfs_param.nfsv4_param.lease_lifetime);
 		LogFullDebug(COMPONENT_STATE,
 			     "Cached open owner {%s}",
 			     str);
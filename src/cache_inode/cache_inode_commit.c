@@ -96,8 +96,12 @@ cache_inode_commit(cache_entry_t *entry, uint64_t offset, size_t count)
 		PTHREAD_RWLOCK_rdlock(&entry->content_lock);
 	}
 
-	fsal_status = entry->obj_handle->obj_ops.commit(entry->obj_handle,
-						     offset, count);
+	/* A gathered write that failed fails the COMMIT */
+	fsal_status = cache_inode_gather_commit(entry);
+	if (!FSAL_IS_ERROR(fsal_status))
+		fsal_status = entry->obj_handle->obj_ops.commit(
+						entry->obj_handle,
+						offset, count);
 
 	if (FSAL_IS_ERROR(fsal_status)) {
 		status = cache_inode_error_convert(fsal_status);
@@ -0,0 +1,851 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * @addtogroup cache_inode
+ * @{
+ */
+
+/**
+ * @file cache_inode_data.c
+ * @brief Read-through cache of file data
+ *
+ * With a high latency FSAL every READ costs a round trip to the
+ * backend, even for hot files read by many clients.  When
+ * Data_Cache_Size is set, exports with Data_Cache enabled keep the
+ * data they read in blocks of CACHE_INODE_DATA_BLOCK bytes.
+ *
+ * Each block is stamped with the version of the file (change
+ * attribute and ctime) it was read at, and is only used while the
+ * attributes of the file still show that version, so blocks go stale
+ * as the attribute cache does.  Local writes and FSAL_UP content
+ * invalidation drop the blocks of the file at once.
+ *
+ * Blocks live in the LRU lane of their cache entry, each lane keeping
+ * its own hash, LRU list and byte count under its own lock.  A lane
+ * going over its share of Data_Cache_Size evicts its least recently
+ * used blocks, and an entry reclaimed by the LRU drops its blocks.
+ *
+ * Once a file has been read CACHE_INODE_READAHEAD_SEQ times in a row
+ * at the offset the previous read ended, the readahead threads read
+ * the next Readahead_Size bytes into the cache, keeping at least half
+ * of that ahead of the reader.  Blocks read ahead remember their
+ * export until read, to count the readahead used and wasted.
+ */
+
+#include "config.h"
+#include <string.h>
+#include <pthread.h>
+#include "log.h"
+#include "abstract_mem.h"
+#include "abstract_atomic.h"
+#include "gsh_intrinsic.h"
+#include "fsal.h"
+#include "cache_inode.h"
+#include "cache_inode_lru.h"
+#include "fridgethr.h"
+#include "nfs_core.h"
+#include "nfs_exports.h"
+#include "export_mgr.h"
+#include "server_stats.h"
+#include "gsh_read_ref.h"
+
+#define CACHE_INODE_DATA_SHIFT 16
+#define CACHE_INODE_DATA_BLOCK (1 << CACHE_INODE_DATA_SHIFT)
+
+/**
+ * @brief Hash buckets per lane
+ */
+#define CACHE_INODE_DATA_BUCKETS 1024
+
+/**
+ * @brief Sequential reads before readahead starts
+ */
+#define CACHE_INODE_READAHEAD_SEQ 2
+
+/**
+ * @brief A block of file data
+ */
+
+struct cache_inode_data_block {
+	struct glist_head lru;		/*< In the lane, MRU at tail */
+	struct glist_head hash;		/*< In the hash bucket */
+	struct glist_head entry_list;	/*< In the entry's data_blocks */
+	cache_entry_t *entry;		/*< File the data belongs to */
+	uint64_t index;			/*< Offset / CACHE_INODE_DATA_BLOCK */
+	uint64_t version;		/*< File version the data was read at */
+	struct gsh_export *ra_export;	/*< Export read ahead for, with
+					    a reference, until read */
+	int32_t refcnt;			/*< The cache's and READ replies' */
+	uint32_t len;			/*< Bytes of data */
+	bool eof;			/*< The file ends with this block */
+	char data[];
+};
+
+/**
+ * @brief A readahead in the queue
+ */
+
+struct data_readahead {
+	cache_entry_t *entry;		/*< With a reference */
+	struct gsh_export *export;	/*< With a reference */
+	uint64_t version;		/*< Version of the file */
+	uint64_t offset;		/*< On a block boundary */
+	uint64_t len;			/*< Whole blocks */
+};
+
+struct cache_inode_data_lane {
+	pthread_mutex_t mtx;
+	struct glist_head lru;		/*< LRU at head */
+	struct glist_head *buckets;
+	uint64_t bytes;			/*< Held by the blocks */
+	CACHE_PAD(0);
+};
+
+static struct cache_inode_data_lane *data_lanes;
+
+/**
+ * @brief Bytes each lane may hold
+ */
+static uint64_t lane_limit;
+
+/**
+ * @brief Bytes to read ahead, 0 if readahead is off
+ */
+static uint64_t readahead_window;
+
+static struct fridgethr *readahead_fridge;
+
+/**
+ * @brief Initialize the data cache
+ *
+ * Nothing is allocated unless Data_Cache_Size is set.
+ *
+ * @return 0 or ENOMEM.
+ */
+
+int cache_inode_data_pkginit(void)
+{
+	struct cache_inode_data_lane *lane;
+	struct fridgethr_params frp;
+	uint32_t i, j;
+	int rc;
+
+	if (cache_param.data_cache_size == 0)
+		return 0;
+
+	data_lanes = gsh_calloc(LRU_N_Q_LANES,
+				sizeof(struct cache_inode_data_lane));
+	if (data_lanes == NULL)
+		return ENOMEM;
+
+	for (i = 0; i < LRU_N_Q_LANES; i++) {
+		lane = &data_lanes[i];
+		PTHREAD_MUTEX_init(&lane->mtx, NULL);
+		glist_init(&lane->lru);
+		lane->buckets = gsh_malloc(CACHE_INODE_DATA_BUCKETS *
+					   sizeof(struct glist_head));
+		if (lane->buckets == NULL)
+			return ENOMEM;
+		for (j = 0; j < CACHE_INODE_DATA_BUCKETS; j++)
+			glist_init(&lane->buckets[j]);
+	}
+
+	lane_limit = cache_param.data_cache_size / LRU_N_Q_LANES;
+
+	LogInfo(COMPONENT_CACHE_INODE,
+		"Data cache of %" PRIu64 " bytes enabled",
+		cache_param.data_cache_size);
+
+	/* Readahead must not push out what it has just read */
+	readahead_window = MIN(cache_param.readahead_size, lane_limit / 2) &
+			   ~((uint64_t)CACHE_INODE_DATA_BLOCK - 1);
+	if (readahead_window == 0)
+		return 0;
+
+	memset(&frp, 0, sizeof(struct fridgethr_params));
+	frp.thr_max = cache_param.readahead_threads;
+	frp.thr_min = 1;
+	frp.flavor = fridgethr_flavor_worker;
+	/* A late readahead is worse than none */
+	frp.deferment = fridgethr_defer_fail;
+
+	rc = fridgethr_init(&readahead_fridge, "Readahead", &frp);
+	if (rc != 0) {
+		LogMajor(COMPONENT_CACHE_INODE,
+			 "Unable to initialize readahead threads: %d", rc);
+		readahead_fridge = NULL;
+		return rc;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Stop the readahead threads
+ *
+ * @return 0 or errors from the fridge.
+ */
+
+int cache_inode_data_pkgshutdown(void)
+{
+	return fridgethr_shutdown(readahead_fridge);
+}
+
+/**
+ * @brief Whether READs of the current export go through the cache
+ */
+
+bool cache_inode_data_enabled(void)
+{
+	return data_lanes != NULL && op_ctx->export != NULL &&
+	       (op_ctx->export->options & EXPORT_OPTION_DATA_CACHE);
+}
+
+static inline struct cache_inode_data_lane *data_lane(cache_entry_t *entry)
+{
+	return &data_lanes[entry->lru.lane];
+}
+
+static inline struct glist_head *data_bucket(
+				struct cache_inode_data_lane *lane,
+				cache_entry_t *entry, uint64_t index)
+{
+	uint64_t h = ((uintptr_t)entry >> 6) + index;
+
+	h *= 0x9e3779b97f4a7c15ULL;
+	return &lane->buckets[h >> 54];
+}
+
+static inline size_t data_block_size(struct cache_inode_data_block *block)
+{
+	return sizeof(struct cache_inode_data_block) + block->len;
+}
+
+/**
+ * @brief Unlink and free a block, the lane lock is held
+ */
+
+static void data_block_drop(struct cache_inode_data_lane *lane,
+			    struct cache_inode_data_block *block)
+{
+	glist_del(&block->lru);
+	glist_del(&block->hash);
+	glist_del(&block->entry_list);
+	lane->bytes -= data_block_size(block);
+	(void)atomic_sub_uint64_t(&cache_stp->data_bytes,
+				  data_block_size(block));
+	if (block->ra_export != NULL) {
+		server_stats_readahead(block->ra_export, 0, 0, block->len);
+		put_gsh_export(block->ra_export);
+		block->ra_export = NULL;
+	}
+	if (atomic_dec_int32_t(&block->refcnt) == 0)
+		gsh_free(block);
+}
+
+/**
+ * @brief Track the read pattern of a file, the lane lock is held
+ *
+ * @param[in]  entry  The file
+ * @param[in]  offset Offset of the read
+ * @param[in]  len    Bytes read
+ * @param[in]  eof    Whether the read reached the end of file
+ * @param[out] start  Start of the readahead to issue
+ * @param[out] end    End of the readahead to issue
+ *
+ * @return true if a readahead should be issued.
+ */
+
+static bool data_readahead_check(cache_entry_t *entry, uint64_t offset,
+				 size_t len, bool eof, uint64_t *start,
+				 uint64_t *end)
+{
+	struct cache_inode_readahead *ra = &entry->object.file.readahead;
+
+	if (offset == ra->next) {
+		ra->seq++;
+	} else {
+		ra->seq = 0;
+		ra->end = 0;
+	}
+	ra->next = offset + len;
+
+	if (readahead_fridge == NULL || eof || ra->busy ||
+	    ra->seq < CACHE_INODE_READAHEAD_SEQ)
+		return false;
+
+	/* Still far enough ahead */
+	if (ra->end >= ra->next + readahead_window / 2)
+		return false;
+
+	*start = MAX(ra->end, ra->next) &
+		 ~((uint64_t)CACHE_INODE_DATA_BLOCK - 1);
+	*end = (ra->next + readahead_window + CACHE_INODE_DATA_BLOCK - 1) &
+	       ~((uint64_t)CACHE_INODE_DATA_BLOCK - 1);
+	ra->end = *end;
+	ra->busy = true;
+
+	return true;
+}
+
+static void data_readahead_done(cache_entry_t *entry, bool failed)
+{
+	struct cache_inode_data_lane *lane = data_lane(entry);
+
+	PTHREAD_MUTEX_lock(&lane->mtx);
+	entry->object.file.readahead.busy = false;
+	if (failed)
+		entry->object.file.readahead.end = 0;
+	PTHREAD_MUTEX_unlock(&lane->mtx);
+}
+
+static struct cache_inode_data_block *data_block_find(
+				struct cache_inode_data_lane *lane,
+				cache_entry_t *entry, uint64_t index)
+{
+	struct glist_head *bucket = data_bucket(lane, entry, index);
+	struct glist_head *glist;
+	struct cache_inode_data_block *block;
+
+	glist_for_each(glist, bucket) {
+		block = glist_entry(glist, struct cache_inode_data_block,
+				    hash);
+		if (block->entry == entry && block->index == index)
+			return block;
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Current version of a file
+ *
+ * Refreshes the attributes if they expired, so that data changed
+ * behind our back is noticed as soon as the attributes are.
+ *
+ * @param[in]  entry   The file
+ * @param[out] version Its version
+ *
+ * @return CACHE_INODE_SUCCESS or errors refreshing the attributes.
+ */
+
+cache_inode_status_t cache_inode_data_version(cache_entry_t *entry,
+					      uint64_t *version)
+{
+	cache_inode_status_t status;
+
+	status = cache_inode_lock_trust_attrs(entry, false);
+	if (status != CACHE_INODE_SUCCESS)
+		return status;
+
+	*version = cache_inode_attr_version(&entry->obj_handle->attributes);
+
+	PTHREAD_RWLOCK_unlock(&entry->attr_lock);
+	return CACHE_INODE_SUCCESS;
+}
+
+static void data_readahead_start(cache_entry_t *entry, uint64_t version,
+				 uint64_t start, uint64_t end);
+
+/**
+ * @brief Look a READ up in the cache
+ *
+ * Succeeds only if every block of the range is cached at the current
+ * version of the file.  Stale blocks met are dropped.  The data is
+ * either copied to a buffer or referenced, the blocks referenced
+ * staying around until the reference is released even if dropped
+ * from the cache meanwhile.
+ *
+ * @param[in]  entry       The file
+ * @param[in]  version     Its current version
+ * @param[in]  offset      Offset of the read
+ * @param[in]  io_size     Size of the read
+ * @param[out] buffer      Where to copy the data, or NULL
+ * @param[out] ref         Where to reference the data, or NULL
+ * @param[out] bytes_moved Bytes read
+ * @param[out] eof         Whether the read reached the end of file
+ *
+ * @return true on a hit.
+ */
+
+static bool data_lookup(cache_entry_t *entry, uint64_t version,
+			uint64_t offset, size_t io_size, char *buffer,
+			struct gsh_read_ref *ref, size_t *bytes_moved,
+			bool *eof)
+{
+	struct cache_inode_data_block **blocks = ref ? ref->priv : NULL;
+	struct cache_inode_data_lane *lane = data_lane(entry);
+	struct cache_inode_data_block *block;
+	uint64_t pos = offset;
+	uint64_t end = offset + io_size;
+	uint32_t in_block;
+	size_t len;
+	bool hit = true;
+	bool readahead = false;
+	uint64_t ra_start = 0, ra_end = 0;
+
+	*bytes_moved = 0;
+	*eof = false;
+
+	PTHREAD_MUTEX_lock(&lane->mtx);
+
+	while (pos < end) {
+		block = data_block_find(lane, entry,
+					pos >> CACHE_INODE_DATA_SHIFT);
+		if (block == NULL) {
+			hit = false;
+			break;
+		}
+		if (block->version != version) {
+			data_block_drop(lane, block);
+			hit = false;
+			break;
+		}
+
+		in_block = pos & (CACHE_INODE_DATA_BLOCK - 1);
+		if (in_block >= block->len) {
+			/* Past the end of file */
+			if (!block->eof)
+				hit = false;
+			*eof = true;
+			break;
+		}
+
+		len = MIN(end - pos, block->len - in_block);
+		if (ref != NULL) {
+			ref->iov[ref->count].iov_base = block->data + in_block;
+			ref->iov[ref->count].iov_len = len;
+			blocks[ref->count++] = block;
+			(void)atomic_inc_int32_t(&block->refcnt);
+		} else {
+			memcpy(buffer + (pos - offset), block->data + in_block,
+			       len);
+		}
+		pos += len;
+
+		glist_del(&block->lru);
+		glist_add_tail(&lane->lru, &block->lru);
+
+		if (block->ra_export != NULL) {
+			server_stats_readahead(block->ra_export, 0, block->len,
+					       0);
+			put_gsh_export(block->ra_export);
+			block->ra_export = NULL;
+		}
+
+		if (block->eof && in_block + len == block->len) {
+			*eof = true;
+			break;
+		}
+	}
+
+	if (hit)
+		readahead = data_readahead_check(entry, offset, pos - offset,
+						 *eof, &ra_start, &ra_end);
+
+	PTHREAD_MUTEX_unlock(&lane->mtx);
+
+	if (readahead)
+		data_readahead_start(entry, version, ra_start, ra_end);
+
+	if (hit) {
+		*bytes_moved = pos - offset;
+		(void)atomic_inc_uint64_t(&cache_stp->data_hit);
+	} else {
+		*eof = false;
+		(void)atomic_inc_uint64_t(&cache_stp->data_miss);
+	}
+
+	return hit;
+}
+
+/**
+ * @brief Serve a READ from the cache
+ *
+ * @param[in]  entry       The file
+ * @param[in]  version     Its current version
+ * @param[in]  offset      Offset of the read
+ * @param[in]  io_size     Size of the read
+ * @param[out] buffer      Where to put the data
+ * @param[out] bytes_moved Bytes read
+ * @param[out] eof         Whether the read reached the end of file
+ *
+ * @return true on a hit.
+ */
+
+bool cache_inode_data_read(cache_entry_t *entry, uint64_t version,
+			   uint64_t offset, size_t io_size, void *buffer,
+			   size_t *bytes_moved, bool *eof)
+{
+	return data_lookup(entry, version, offset, io_size, buffer, NULL,
+			   bytes_moved, eof);
+}
+
+static void data_ref_release(struct gsh_read_ref *ref)
+{
+	struct cache_inode_data_block **blocks = ref->priv;
+	uint32_t i;
+
+	for (i = 0; i < ref->count; i++) {
+		if (atomic_dec_int32_t(&blocks[i]->refcnt) == 0)
+			gsh_free(blocks[i]);
+	}
+
+	gsh_free(ref);
+}
+
+/**
+ * @brief Serve a READ from the cache without copying the data
+ *
+ * @param[in]  entry       The file
+ * @param[in]  version     Its current version
+ * @param[in]  offset      Offset of the read
+ * @param[in]  io_size     Size of the read
+ * @param[out] bytes_moved Bytes read
+ * @param[out] eof         Whether the read reached the end of file
+ *
+ * @return The data on a hit, to be released once sent, else NULL.
+ */
+
+struct gsh_read_ref *cache_inode_data_read_ref(cache_entry_t *entry,
+					       uint64_t version,
+					       uint64_t offset,
+					       size_t io_size,
+					       size_t *bytes_moved,
+					       bool *eof)
+{
+	/* The blocks a misaligned range can span */
+	uint32_t nseg = (io_size >> CACHE_INODE_DATA_SHIFT) + 2;
+	struct gsh_read_ref *ref;
+
+	ref = gsh_malloc(sizeof(struct gsh_read_ref) +
+			 nseg * (sizeof(struct iovec) +
+				 sizeof(struct cache_inode_data_block *)));
+	if (ref == NULL)
+		return NULL;
+
+	ref->release = data_ref_release;
+	ref->priv = &ref->iov[nseg];
+	ref->count = 0;
+
+	if (!data_lookup(entry, version, offset, io_size, NULL, ref,
+			 bytes_moved, eof)) {
+		data_ref_release(ref);
+		return NULL;
+	}
+
+	return ref;
+}
+
+/**
+ * @brief Keep data read from the FSAL
+ *
+ * @param[in] entry   The file
+ * @param[in] version Version of the file before the data was read
+ * @param[in] start   Offset of the data, on a block boundary
+ * @param[in] data    The data
+ * @param[in] len     Its length
+ * @param[in] eof     Whether the file ends with it
+ * @param[in] ra      Export the data was read ahead for, or NULL
+ */
+
+static void data_insert(cache_entry_t *entry, uint64_t version,
+			uint64_t start, char *data, size_t len, bool eof,
+			struct gsh_export *ra)
+{
+	struct cache_inode_data_lane *lane = data_lane(entry);
+	struct cache_inode_data_block *block, *old;
+	struct glist_head blocks;
+	size_t pos, blen;
+	uint64_t ra_bytes = 0;
+
+	glist_init(&blocks);
+
+	/* Copy out of the lock */
+	for (pos = 0; pos < len; pos += blen) {
+		blen = MIN(len - pos, CACHE_INODE_DATA_BLOCK);
+
+		/* A short block is only known complete at end of file */
+		if (blen < CACHE_INODE_DATA_BLOCK && !eof)
+			break;
+
+		block = gsh_malloc(sizeof(struct cache_inode_data_block) +
+				   blen);
+		if (block == NULL)
+			break;
+
+		block->entry = entry;
+		block->index = (start + pos) >> CACHE_INODE_DATA_SHIFT;
+		block->version = version;
+		block->len = blen;
+		block->eof = eof && pos + blen == len;
+		block->ra_export = NULL;
+		block->refcnt = 1;
+		memcpy(block->data, data + pos, blen);
+		glist_add_tail(&blocks, &block->lru);
+	}
+
+	PTHREAD_MUTEX_lock(&lane->mtx);
+
+	while (!glist_empty(&blocks)) {
+		block = glist_first_entry(&blocks,
+					  struct cache_inode_data_block, lru);
+		glist_del(&block->lru);
+
+		old = data_block_find(lane, entry, block->index);
+		if (old != NULL && ra != NULL) {
+			/* Read by a client meanwhile */
+			gsh_free(block);
+			continue;
+		}
+		if (old != NULL)
+			data_block_drop(lane, old);
+
+		if (ra != NULL) {
+			get_gsh_export_ref(ra);
+			block->ra_export = ra;
+			ra_bytes += block->len;
+		}
+
+		glist_add_tail(data_bucket(lane, entry, block->index),
+			       &block->hash);
+		glist_add_tail(&entry->data_blocks, &block->entry_list);
+		glist_add_tail(&lane->lru, &block->lru);
+		lane->bytes += data_block_size(block);
+		(void)atomic_add_uint64_t(&cache_stp->data_bytes,
+					  data_block_size(block));
+	}
+
+	while (lane->bytes > lane_limit && !glist_empty(&lane->lru)) {
+		block = glist_first_entry(&lane->lru,
+					  struct cache_inode_data_block, lru);
+		data_block_drop(lane, block);
+		(void)atomic_inc_uint64_t(&cache_stp->data_evict);
+	}
+
+	PTHREAD_MUTEX_unlock(&lane->mtx);
+
+	if (ra_bytes != 0)
+		server_stats_readahead(ra, ra_bytes, 0, 0);
+}
+
+/**
+ * @brief Read ahead, in a readahead thread
+ *
+ * Only reads through a descriptor left open by a client read, a
+ * readahead never opens the file.
+ *
+ * @param[in] ctx Thread context, the readahead is the argument
+ */
+
+static void data_readahead_run(struct fridgethr_context *ctx)
+{
+	struct data_readahead *ra = ctx->arg;
+	cache_entry_t *entry = ra->entry;
+	struct fsal_obj_handle *obj_hdl = entry->obj_handle;
+	struct root_op_context root_op_context;
+	fsal_status_t fsal_status = { ERR_FSAL_NOT_OPENED, 0 };
+	size_t got = 0;
+	bool eof = false;
+	char *span;
+
+	init_root_op_context(&root_op_context, ra->export,
+			     ra->export->fsal_export, 0, 0, UNKNOWN_REQUEST);
+
+	span = gsh_malloc(ra->len);
+	if (span != NULL) {
+		PTHREAD_RWLOCK_rdlock(&entry->content_lock);
+		if (is_open(entry) &&
+		    (obj_hdl->obj_ops.status(obj_hdl) & FSAL_O_READ))
+			fsal_status = obj_hdl->obj_ops.read(obj_hdl, ra->offset,
+							    ra->len, span,
+							    &got, &eof);
+		PTHREAD_RWLOCK_unlock(&entry->content_lock);
+
+		if (!FSAL_IS_ERROR(fsal_status))
+			data_insert(entry, ra->version, ra->offset, span, got,
+				    eof, ra->export);
+		gsh_free(span);
+	}
+
+	LogFullDebug(COMPONENT_CACHE_INODE,
+		     "Readahead of %" PRIu64 " bytes at %" PRIu64
+		     " on entry %p got %zu, status %d",
+		     ra->len, ra->offset, entry, got, fsal_status.major);
+
+	data_readahead_done(entry, FSAL_IS_ERROR(fsal_status));
+	release_root_op_context();
+	put_gsh_export(ra->export);
+	cache_inode_put(entry);
+	gsh_free(ra);
+}
+
+/**
+ * @brief Queue a readahead
+ *
+ * Dropped if all the readahead threads are busy.
+ *
+ * @param[in] entry   The file
+ * @param[in] version Version of the file
+ * @param[in] start   Start of the readahead
+ * @param[in] end     End of the readahead
+ */
+
+static void data_readahead_start(cache_entry_t *entry, uint64_t version,
+				 uint64_t start, uint64_t end)
+{
+	struct data_readahead *ra;
+
+	ra = gsh_malloc(sizeof(struct data_readahead));
+	if (ra == NULL)
+		goto fail;
+
+	if (cache_inode_lru_ref(entry, LRU_FLAG_NONE) != CACHE_INODE_SUCCESS) {
+		gsh_free(ra);
+		goto fail;
+	}
+
+	get_gsh_export_ref(op_ctx->export);
+	ra->entry = entry;
+	ra->export = op_ctx->export;
+	ra->version = version;
+	ra->offset = start;
+	ra->len = end - start;
+
+	if (fridgethr_submit(readahead_fridge, data_readahead_run, ra) == 0)
+		return;
+
+	put_gsh_export(ra->export);
+	cache_inode_put(entry);
+	gsh_free(ra);
+
+ fail:
+	data_readahead_done(entry, true);
+}
+
+/**
+ * @brief Read through the cache from the FSAL
+ *
+ * Reads the whole blocks covering the range, keeps them and copies
+ * the range asked for.  The caller holds the content lock and the
+ * file is open for reading, as for a plain FSAL read.
+ *
+ * @param[in]  entry       The file
+ * @param[in]  version     Version of the file before the read
+ * @param[in]  offset      Offset of the read
+ * @param[in]  io_size     Size of the read
+ * @param[out] buffer      Where to put the data, NULL to only keep it
+ * @param[out] bytes_moved Bytes read
+ * @param[out] eof         Whether the read reached the end of file
+ *
+ * @return Status of the FSAL read.
+ */
+
+fsal_status_t cache_inode_data_fill(cache_entry_t *entry, uint64_t version,
+				    uint64_t offset, size_t io_size,
+				    void *buffer, size_t *bytes_moved,
+				    bool *eof)
+{
+	struct fsal_obj_handle *obj_hdl = entry->obj_handle;
+	uint64_t start = offset & ~((uint64_t)CACHE_INODE_DATA_BLOCK - 1);
+	uint64_t end = (offset + io_size + CACHE_INODE_DATA_BLOCK - 1) &
+		       ~((uint64_t)CACHE_INODE_DATA_BLOCK - 1);
+	struct cache_inode_data_lane *lane = data_lane(entry);
+	fsal_status_t fsal_status;
+	size_t got = 0, skip = offset - start;
+	bool span_eof = false;
+	bool readahead;
+	uint64_t ra_start = 0, ra_end = 0;
+	char *span;
+
+	span = gsh_malloc(end - start);
+	if (span == NULL && buffer == NULL) {
+		/* Nothing kept, the caller reads on its own */
+		*bytes_moved = 0;
+		*eof = false;
+		return fsalstat(ERR_FSAL_NO_ERROR, 0);
+	}
+	if (span == NULL) {
+		/* Not worth failing the read for */
+		return obj_hdl->obj_ops.read(obj_hdl, offset, io_size,
+					     buffer, bytes_moved, eof);
+	}
+
+	fsal_status = obj_hdl->obj_ops.read(obj_hdl, start, end - start,
+					    span, &got, &span_eof);
+	if (FSAL_IS_ERROR(fsal_status)) {
+		*bytes_moved = 0;
+		gsh_free(span);
+		return fsal_status;
+	}
+
+	if (got > skip) {
+		*bytes_moved = MIN(io_size, got - skip);
+		if (buffer != NULL)
+			memcpy(buffer, span + skip, *bytes_moved);
+	} else {
+		*bytes_moved = 0;
+	}
+	*eof = span_eof && offset + *bytes_moved >= start + got;
+
+	data_insert(entry, version, start, span, got, span_eof, NULL);
+
+	gsh_free(span);
+
+	PTHREAD_MUTEX_lock(&lane->mtx);
+	readahead = data_readahead_check(entry, offset, *bytes_moved, *eof,
+					 &ra_start, &ra_end);
+	PTHREAD_MUTEX_unlock(&lane->mtx);
+
+	if (readahead)
+		data_readahead_start(entry, version, ra_start, ra_end);
+
+	return fsal_status;
+}
+
+/**
+ * @brief Drop the cached data of a file
+ *
+ * @param[in] entry The file
+ */
+
+void cache_inode_data_invalidate(cache_entry_t *entry)
+{
+	struct cache_inode_data_lane *lane;
+	struct cache_inode_data_block *block;
+
+	if (data_lanes == NULL || glist_empty(&entry->data_blocks))
+		return;
+
+	lane = data_lane(entry);
+
+	PTHREAD_MUTEX_lock(&lane->mtx);
+
+	while (!glist_empty(&entry->data_blocks)) {
+		block = glist_first_entry(&entry->data_blocks,
+					  struct cache_inode_data_block,
+					  entry_list);
+		data_block_drop(lane, block);
+	}
+
+	PTHREAD_MUTEX_unlock(&lane->mtx);
+}
+
+/** @} */
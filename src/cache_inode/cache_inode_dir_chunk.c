@@ -0,0 +1,671 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * @addtogroup cache_inode
+ * @{
+ */
+
+/**
+ * @file cache_inode_dir_chunk.c
+ * @brief Directories read in chunks
+ *
+ * Reading a whole directory before answering the first READDIR makes
+ * clients of directories with millions of entries wait for all of
+ * them, and keeps them all in memory.  When Dir_Chunk is set,
+ * directories are instead read Dir_Chunk entries at a time from the
+ * cookie the client asked for, plus Dir_Chunk_Prefetch chunks ahead
+ * in the same FSAL call.
+ *
+ * The cookies are then those of the FSAL, offset by
+ * CACHE_INODE_DIR_CHUNK_COOKIE to stay clear of the cookies of "."
+ * and "..", so that any chunk can be read again on its own.  Each
+ * chunk is stamped with the version of the directory (its ctime) it
+ * was read at and dropped once the directory shows a later one.  A
+ * reader still holding an older version of the directory keeps using
+ * the newer chunks rather than dropping them.  Anything invalidating
+ * the cached dirents of a directory drops its chunks as well, and
+ * raises the generation of the directory so that chunks being loaded
+ * at the time are not cached.
+ *
+ * Chunks live in the LRU lane of their directory, each lane keeping
+ * its own LRU list and entry count under its own lock.  A lane going
+ * over its share of Dir_Chunk_HWMark drops its least recently used
+ * chunks, and the LRU thread halves every lane while the cache is over
+ * Entries_HWMark.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "log.h"
+#include "abstract_mem.h"
+#include "abstract_atomic.h"
+#include "gsh_intrinsic.h"
+#include "fsal.h"
+#include "cache_inode.h"
+#include "cache_inode_lru.h"
+
+/**
+ * @brief Added to FSAL cookies, NFS cookies 1 and 2 are reserved
+ */
+#define CACHE_INODE_DIR_CHUNK_COOKIE 3
+
+struct cache_inode_dir_chunk_lane {
+	pthread_mutex_t mtx;
+	struct glist_head lru;		/*< LRU at head */
+	uint64_t entries;		/*< Held by the chunks */
+	CACHE_PAD(0);
+};
+
+static struct cache_inode_dir_chunk_lane *chunk_lanes;
+
+/**
+ * @brief Entries each lane may hold
+ */
+static uint64_t lane_limit;
+
+/**
+ * @brief State of a chunk load
+ */
+
+struct dir_chunk_load_state {
+	cache_entry_t *directory;	/*< Directory read */
+	uint64_t gen;			/*< Its chunk generation */
+	uint64_t version;		/*< Its version */
+	struct glist_head chunks;	/*< Chunks read, in order */
+	struct cache_inode_dir_chunk *cur;	/*< Chunk being filled */
+	uint32_t nchunks;		/*< Chunks started */
+	uint32_t max_chunks;		/*< Chunks to read */
+	bool full;			/*< All the chunks are full */
+	cache_inode_status_t status;	/*< Why the load stopped */
+};
+
+/**
+ * @brief Initialize the directory chunks
+ *
+ * Nothing is allocated unless Dir_Chunk is set.
+ *
+ * @return 0 or ENOMEM.
+ */
+
+int cache_inode_dir_chunk_pkginit(void)
+{
+	uint32_t i;
+
+	if (cache_param.dir_chunk == 0)
+		return 0;
+
+	chunk_lanes = gsh_calloc(LRU_N_Q_LANES,
+				 sizeof(struct cache_inode_dir_chunk_lane));
+	if (chunk_lanes == NULL)
+		return ENOMEM;
+
+	for (i = 0; i < LRU_N_Q_LANES; i++) {
+		PTHREAD_MUTEX_init(&chunk_lanes[i].mtx, NULL);
+		glist_init(&chunk_lanes[i].lru);
+	}
+
+	lane_limit = MAX(cache_param.dir_chunk_hwmark / LRU_N_Q_LANES,
+			 cache_param.dir_chunk);
+
+	LogInfo(COMPONENT_CACHE_INODE,
+		"Directories read in chunks of %" PRIu32 " entries",
+		cache_param.dir_chunk);
+
+	return 0;
+}
+
+/**
+ * @brief Whether directories are read in chunks
+ */
+
+bool cache_inode_dir_chunked(void)
+{
+	return chunk_lanes != NULL;
+}
+
+static inline struct cache_inode_dir_chunk_lane *chunk_lane(
+						cache_entry_t *directory)
+{
+	return &chunk_lanes[directory->lru.lane];
+}
+
+static struct cache_inode_dir_chunk *dir_chunk_alloc(uint64_t gen,
+						     uint64_t version,
+						     uint64_t whence)
+{
+	struct cache_inode_dir_chunk *chunk;
+
+	chunk = gsh_calloc(1, sizeof(struct cache_inode_dir_chunk) +
+			   cache_param.dir_chunk *
+			   sizeof(cache_inode_dir_entry_t *));
+	if (chunk == NULL)
+		return NULL;
+
+	chunk->cookies =
+	    gsh_malloc(cache_param.dir_chunk *
+		       sizeof(struct cache_inode_dir_chunk_cookie));
+	if (chunk->cookies == NULL) {
+		gsh_free(chunk);
+		return NULL;
+	}
+
+	glist_init(&chunk->lru);
+	glist_init(&chunk->dir_list);
+	chunk->gen = gen;
+	chunk->version = version;
+	chunk->whence = whence;
+	chunk->refcnt = 1;
+
+	return chunk;
+}
+
+static void dir_chunk_free(struct cache_inode_dir_chunk *chunk)
+{
+	uint32_t i;
+
+	for (i = 0; i < chunk->count; i++)
+		cache_inode_free_dirent(chunk->dirents[i]);
+	gsh_free(chunk->cookies);
+	gsh_free(chunk);
+}
+
+/**
+ * @brief Release a reference on a chunk
+ *
+ * @param[in] directory The directory the chunk belongs to
+ * @param[in] chunk     The chunk
+ */
+
+void cache_inode_dir_chunk_put(cache_entry_t *directory,
+			       struct cache_inode_dir_chunk *chunk)
+{
+	if (atomic_dec_int32_t(&chunk->refcnt) == 0)
+		dir_chunk_free(chunk);
+}
+
+/**
+ * @brief Unlink a chunk and drop the cache's reference, the lane
+ *        lock is held
+ */
+
+static void dir_chunk_drop(struct cache_inode_dir_chunk_lane *lane,
+			   struct cache_inode_dir_chunk *chunk)
+{
+	glist_del(&chunk->lru);
+	glist_del(&chunk->dir_list);
+	lane->entries -= chunk->count;
+	if (atomic_dec_int32_t(&chunk->refcnt) == 0)
+		dir_chunk_free(chunk);
+}
+
+/**
+ * @brief Whether a chunk is older than its directory, the lane lock is
+ *        held
+ */
+
+static inline bool dir_chunk_stale(cache_entry_t *directory,
+				   struct cache_inode_dir_chunk *chunk)
+{
+	return chunk->gen != directory->object.dir.chunk_gen ||
+	       chunk->version < directory->object.dir.chunk_version;
+}
+
+/**
+ * @brief Drop the chunks of a directory
+ *
+ * Chunks being loaded at the time are not cached either.
+ *
+ * @param[in] directory The directory
+ */
+
+void cache_inode_dir_chunk_invalidate(cache_entry_t *directory)
+{
+	struct cache_inode_dir_chunk_lane *lane;
+	struct glist_head *glist, *glistn;
+
+	if (chunk_lanes == NULL || directory->type != DIRECTORY)
+		return;
+
+	lane = chunk_lane(directory);
+
+	PTHREAD_MUTEX_lock(&lane->mtx);
+	directory->object.dir.chunk_gen++;
+	glist_for_each_safe(glist, glistn, &directory->object.dir.chunks) {
+		dir_chunk_drop(lane,
+			       glist_entry(glist, struct cache_inode_dir_chunk,
+					   dir_list));
+	}
+	PTHREAD_MUTEX_unlock(&lane->mtx);
+}
+
+/**
+ * @brief Drop the least recently used chunks under memory pressure
+ *
+ * Called by the LRU thread while the cache is over its high water
+ * mark, each lane is brought down to half its share of
+ * Dir_Chunk_HWMark.
+ */
+
+void cache_inode_dir_chunk_reclaim(void)
+{
+	struct cache_inode_dir_chunk_lane *lane;
+	uint64_t dropped = 0;
+	uint32_t i;
+
+	if (chunk_lanes == NULL)
+		return;
+
+	for (i = 0; i < LRU_N_Q_LANES; i++) {
+		lane = &chunk_lanes[i];
+		PTHREAD_MUTEX_lock(&lane->mtx);
+		while (lane->entries > lane_limit / 2 &&
+		       !glist_empty(&lane->lru)) {
+			dropped += lane->entries;
+			dir_chunk_drop(lane,
+				       glist_first_entry(
+					       &lane->lru,
+					       struct cache_inode_dir_chunk,
+					       lru));
+			dropped -= lane->entries;
+		}
+		PTHREAD_MUTEX_unlock(&lane->mtx);
+	}
+
+	LogDebug(COMPONENT_CACHE_INODE_LRU,
+		 "Dropped %" PRIu64 " directory entries held in chunks",
+		 dropped);
+}
+
+static int dir_chunk_cookie_cmp(const void *a, const void *b)
+{
+	const struct cache_inode_dir_chunk_cookie *ca = a, *cb = b;
+
+	if (ca->cookie < cb->cookie)
+		return -1;
+	return ca->cookie > cb->cookie;
+}
+
+/**
+ * @brief Index of the entry with a cookie in a chunk
+ *
+ * @return The index or -1.
+ */
+
+static int64_t dir_chunk_find_cookie(struct cache_inode_dir_chunk *chunk,
+				     uint64_t cookie)
+{
+	uint32_t lo = 0, hi = chunk->count, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (chunk->cookies[mid].cookie < cookie)
+			lo = mid + 1;
+		else if (chunk->cookies[mid].cookie > cookie)
+			hi = mid;
+		else
+			return chunk->cookies[mid].index;
+	}
+
+	return -1;
+}
+
+/**
+ * @brief Find the chunk to read on from a cookie, the lane lock is held
+ *
+ * Chunks older than the directory are dropped on the way.  A chunk
+ * ending with the cookie only does if it ends the directory too,
+ * otherwise the chunk read from the cookie is wanted.
+ */
+
+static struct cache_inode_dir_chunk *dir_chunk_find(
+				struct cache_inode_dir_chunk_lane *lane,
+				cache_entry_t *directory, uint64_t cookie,
+				uint32_t *index)
+{
+	struct glist_head *glist, *glistn;
+	struct cache_inode_dir_chunk *chunk, *found = NULL;
+	int64_t i;
+
+	glist_for_each_safe(glist, glistn, &directory->object.dir.chunks) {
+		chunk = glist_entry(glist, struct cache_inode_dir_chunk,
+				    dir_list);
+
+		if (dir_chunk_stale(directory, chunk)) {
+			dir_chunk_drop(lane, chunk);
+			continue;
+		}
+
+		if (found != NULL)
+			continue;
+
+		if (chunk->whence == cookie) {
+			found = chunk;
+			*index = 0;
+			continue;
+		}
+
+		if (cookie == 0)
+			continue;
+
+		i = dir_chunk_find_cookie(chunk, cookie);
+		if (i < 0 || (i + 1 == chunk->count && !chunk->eod))
+			continue;
+
+		found = chunk;
+		*index = i + 1;
+	}
+
+	return found;
+}
+
+/**
+ * @brief Add a read entry to the chunks being loaded
+ *
+ * Once the last chunk is full, the next entry is refused so that the
+ * FSAL stops there.
+ *
+ * @return true if the entry was taken and the FSAL should go on.
+ */
+
+static bool dir_chunk_load_dirent(const char *name,
+				  struct fsal_obj_handle *entry_hdl,
+				  fsal_status_t fsal_status, void *dir_state,
+				  fsal_cookie_t cookie)
+{
+	struct dir_chunk_load_state *state = dir_state;
+	struct cache_inode_dir_chunk *chunk = state->cur;
+	cache_inode_dir_entry_t *dirent;
+	cache_entry_t *entry = NULL;
+	size_t namesize = strlen(name) + 1;
+	cache_inode_status_t status;
+
+	if (chunk->count == cache_param.dir_chunk) {
+		if (state->nchunks == state->max_chunks) {
+			/* Not taken, the FSAL stops before it */
+			if (entry_hdl != NULL)
+				entry_hdl->obj_ops.release(entry_hdl);
+			state->full = true;
+			return false;
+		}
+
+		/* Go on with the next chunk, from the last cookie read */
+		chunk = dir_chunk_alloc(state->gen, state->version,
+					chunk->dirents[chunk->count - 1]->hk.k);
+		if (chunk == NULL) {
+			if (entry_hdl != NULL)
+				entry_hdl->obj_ops.release(entry_hdl);
+			state->status = CACHE_INODE_MALLOC_ERROR;
+			return false;
+		}
+		glist_add_tail(&state->chunks, &chunk->lru);
+		state->cur = chunk;
+		state->nchunks++;
+	}
+
+	if (entry_hdl == NULL) {
+		status = cache_inode_error_convert(fsal_status);
+		if (status == CACHE_INODE_FSAL_XDEV) {
+			LogInfo(COMPONENT_NFS_READDIR,
+				"Ignoring XDEV entry %s", name);
+			return true;
+		}
+		LogInfo(COMPONENT_CACHE_INODE,
+			"Lookup failed on %s in dir %p with %s",
+			name, state->directory->obj_handle,
+			cache_inode_err_str(status));
+		if (!cache_param.retry_readdir)
+			return true;
+		state->status = status;
+		return false;
+	}
+
+	if (cookie > UINT64_MAX - CACHE_INODE_DIR_CHUNK_COOKIE) {
+		entry_hdl->obj_ops.release(entry_hdl);
+		LogCrit(COMPONENT_NFS_READDIR,
+			"FSAL cookie %" PRIx64 " of %s out of range",
+			cookie, name);
+		state->status = CACHE_INODE_SERVERFAULT;
+		return false;
+	}
+	cookie += CACHE_INODE_DIR_CHUNK_COOKIE;
+
+	status = cache_inode_new_entry(entry_hdl, CACHE_INODE_FLAG_NONE,
+				       &entry);
+	if (entry == NULL) {
+		/* entry_hdl is consumed by cache_inode_new_entry */
+		LogEvent(COMPONENT_NFS_READDIR,
+			 "cache_inode_new_entry failed with %s",
+			 cache_inode_err_str(status));
+		state->status = CACHE_INODE_NOT_FOUND;
+		return false;
+	}
+
+	if (entry->type == DIRECTORY) {
+		/* Insert Parent's key */
+		cache_inode_key_dup(&entry->object.dir.parent,
+				    &state->directory->fh_hk.key);
+	}
+
+	dirent = gsh_calloc(1, sizeof(cache_inode_dir_entry_t) + namesize);
+	if (dirent == NULL ||
+	    cache_inode_key_dup(&dirent->ckey, &entry->fh_hk.key) != 0) {
+		gsh_free(dirent);
+		cache_inode_put(entry);
+		state->status = CACHE_INODE_MALLOC_ERROR;
+		return false;
+	}
+	cache_inode_put(entry);
+
+	memcpy(dirent->name, name, namesize);
+	dirent->hk.k = cookie;
+
+	chunk->cookies[chunk->count].cookie = cookie;
+	chunk->cookies[chunk->count].index = chunk->count;
+	chunk->dirents[chunk->count++] = dirent;
+
+	return true;
+}
+
+/**
+ * @brief Read chunks from a cookie and add them to the cache
+ *
+ * The content lock of the directory is held.  The chunks are only
+ * cached if the directory was neither invalidated nor seen at a later
+ * version while they were read.
+ *
+ * @param[in]  directory The directory
+ * @param[in]  gen       Its chunk generation
+ * @param[in]  version   Its version
+ * @param[in]  whence    Cookie to read from, 0 for the start
+ * @param[out] first     The chunk read from whence, with a reference
+ *
+ * @return CACHE_INODE_SUCCESS or errors.
+ */
+
+static cache_inode_status_t dir_chunk_load(cache_entry_t *directory,
+					   uint64_t gen, uint64_t version,
+					   uint64_t whence,
+					   struct cache_inode_dir_chunk **first)
+{
+	struct cache_inode_dir_chunk_lane *lane = chunk_lane(directory);
+	struct dir_chunk_load_state state;
+	struct cache_inode_dir_chunk *chunk, *old;
+	struct glist_head *glist, *glistn, *dl, *dln;
+	fsal_cookie_t fsal_whence = whence - CACHE_INODE_DIR_CHUNK_COOKIE;
+	fsal_status_t fsal_status;
+	bool eod = false;
+
+	state.directory = directory;
+	state.gen = gen;
+	state.version = version;
+	glist_init(&state.chunks);
+	state.nchunks = 1;
+	state.max_chunks = 1 + cache_param.dir_chunk_prefetch;
+	state.full = false;
+	state.status = CACHE_INODE_SUCCESS;
+
+	state.cur = dir_chunk_alloc(gen, version, whence);
+	if (state.cur == NULL)
+		return CACHE_INODE_MALLOC_ERROR;
+	glist_add_tail(&state.chunks, &state.cur->lru);
+
+	fsal_status = directory->obj_handle->obj_ops.readdir_plus(
+					directory->obj_handle,
+					whence == 0 ? NULL : &fsal_whence,
+					&state, dir_chunk_load_dirent, &eod);
+	if (FSAL_IS_ERROR(fsal_status)) {
+		if (fsal_status.major == ERR_FSAL_STALE) {
+			LogEvent(COMPONENT_NFS_READDIR,
+				 "FSAL returned STALE from readdir.");
+			cache_inode_kill_entry(directory);
+		}
+		state.status = cache_inode_error_convert(fsal_status);
+	} else if (state.status == CACHE_INODE_SUCCESS && !eod &&
+		   !state.full) {
+		LogInfo(COMPONENT_NFS_READDIR,
+			"Readdir stopped short on dir %p",
+			directory->obj_handle);
+		state.status = CACHE_INODE_DELAY;
+	}
+
+	if (state.status != CACHE_INODE_SUCCESS) {
+		LogDebug(COMPONENT_NFS_READDIR,
+			 "Loading chunk at %" PRIu64 " failed with %s",
+			 whence, cache_inode_err_str(state.status));
+		glist_for_each_safe(glist, glistn, &state.chunks) {
+			dir_chunk_free(glist_entry(glist,
+						   struct cache_inode_dir_chunk,
+						   lru));
+		}
+		return state.status;
+	}
+
+	state.cur->eod = eod;
+
+	*first = glist_first_entry(&state.chunks,
+				   struct cache_inode_dir_chunk, lru);
+	atomic_inc_int32_t(&(*first)->refcnt);
+
+	PTHREAD_MUTEX_lock(&lane->mtx);
+
+	glist_for_each_safe(glist, glistn, &state.chunks) {
+		chunk = glist_entry(glist, struct cache_inode_dir_chunk, lru);
+		glist_del(&chunk->lru);
+
+		qsort(chunk->cookies, chunk->count,
+		      sizeof(struct cache_inode_dir_chunk_cookie),
+		      dir_chunk_cookie_cmp);
+
+		/* Invalidated or outdated while read, only first is used */
+		if (dir_chunk_stale(directory, chunk)) {
+			if (atomic_dec_int32_t(&chunk->refcnt) == 0)
+				dir_chunk_free(chunk);
+			continue;
+		}
+
+		/* Another thread may have read the same chunk meanwhile */
+		glist_for_each_safe(dl, dln, &directory->object.dir.chunks) {
+			old = glist_entry(dl, struct cache_inode_dir_chunk,
+					  dir_list);
+			if (old->whence == chunk->whence ||
+			    dir_chunk_stale(directory, old))
+				dir_chunk_drop(lane, old);
+		}
+
+		glist_add_tail(&directory->object.dir.chunks,
+			       &chunk->dir_list);
+		glist_add_tail(&lane->lru, &chunk->lru);
+		lane->entries += chunk->count;
+	}
+
+	while (lane->entries > lane_limit && !glist_empty(&lane->lru)) {
+		dir_chunk_drop(lane,
+			       glist_first_entry(&lane->lru,
+						 struct cache_inode_dir_chunk,
+						 lru));
+	}
+
+	PTHREAD_MUTEX_unlock(&lane->mtx);
+
+	return CACHE_INODE_SUCCESS;
+}
+
+/**
+ * @brief Get the chunk to read a directory on from a cookie
+ *
+ * The chunk is read from the FSAL, with the following ones, unless
+ * it is cached at the current version of the directory or a later
+ * one.  The version only ever moves forward, a reader which fetched
+ * the attributes before another one did uses the newer chunks.  The
+ * chunk stays valid until released, even if dropped from the cache meanwhile.
+ * The content lock of the directory is held.
+ *
+ * @param[in]  directory The directory
+ * @param[in]  version   Its version as seen by the caller
+ * @param[in]  cookie    Cookie to read on from, 0 for the start
+ * @param[out] chunk     The chunk, with a reference
+ * @param[out] index     Index of the first entry to read in the chunk,
+ *                       the count of entries if the directory ends
+ *                       there
+ *
+ * @return CACHE_INODE_SUCCESS or errors.
+ */
+
+cache_inode_status_t cache_inode_dir_chunk_get(cache_entry_t *directory,
+					       uint64_t version,
+					       uint64_t cookie,
+					       struct cache_inode_dir_chunk
+					       **chunk, uint32_t *index)
+{
+	struct cache_inode_dir_chunk_lane *lane = chunk_lane(directory);
+	cache_inode_status_t status;
+	uint64_t gen;
+
+	if (cookie != 0 && cookie < CACHE_INODE_DIR_CHUNK_COOKIE)
+		return CACHE_INODE_BAD_COOKIE;
+
+	PTHREAD_MUTEX_lock(&lane->mtx);
+
+	if (version > directory->object.dir.chunk_version)
+		directory->object.dir.chunk_version = version;
+
+	*chunk = dir_chunk_find(lane, directory, cookie, index);
+	if (*chunk != NULL) {
+		atomic_inc_int32_t(&(*chunk)->refcnt);
+		glist_del(&(*chunk)->lru);
+		glist_add_tail(&lane->lru, &(*chunk)->lru);
+		PTHREAD_MUTEX_unlock(&lane->mtx);
+		return CACHE_INODE_SUCCESS;
+	}
+
+	gen = directory->object.dir.chunk_gen;
+	version = directory->object.dir.chunk_version;
+
+	PTHREAD_MUTEX_unlock(&lane->mtx);
+
+	status = dir_chunk_load(directory, gen, version, cookie, chunk);
+	*index = 0;
+
+	return status;
+}
+
+/** @} */
@@ -0,0 +1,356 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * @addtogroup cache_inode
+ * @{
+ */
+
+/**
+ * @file cache_inode_gather.c
+ * @brief Gathering of UNSTABLE writes
+ *
+ * Clients writing a file UNSTABLE send it in wsize pieces, each of
+ * which would cost a write to the FSAL.  When Write_Gather_Size is
+ * set, an UNSTABLE write that extends the extent a file is gathering
+ * is only copied into it, and the extent goes to the FSAL as one
+ * write when it is full, Write_Gather_Delay after it was started, on
+ * COMMIT, or before any other I/O, SETATTR, attribute refresh or
+ * close of the file.  Once Write_Gather_Limit bytes are gathered in
+ * all files, further writes go through until some are written.
+ *
+ * Nothing here makes UNSTABLE data more volatile than the protocol
+ * allows: a restart changes the write verifier, and so does a failed
+ * write of a gathered extent, so clients send again whatever they had
+ * not seen committed.  The failure is also returned by the next
+ * COMMIT of the file.
+ *
+ * An extent is only ever gathered by a write holding the content lock
+ * with the file open for writing, and closing or reopening the file
+ * writes the extent first, so a non-empty extent always has a
+ * descriptor to go out through.  The gather lock is taken last, after
+ * the content or attribute lock.
+ */
+
+#include "config.h"
+#include <string.h>
+#include <pthread.h>
+#include "log.h"
+#include "abstract_mem.h"
+#include "abstract_atomic.h"
+#include "fsal.h"
+#include "nfs_core.h"
+#include "cache_inode.h"
+#include "cache_inode_lru.h"
+#include "delayed_exec.h"
+#include "export_mgr.h"
+
+/**
+ * @brief Write gathering state of a file
+ */
+
+struct cache_inode_gather {
+	pthread_mutex_t mtx;		/*< Protects everything below */
+	char *buf;			/*< Write_Gather_Size bytes */
+	uint64_t offset;		/*< Offset of the extent */
+	size_t len;			/*< Bytes gathered */
+	struct gsh_export *export;	/*< Export of the writes, with a
+					    reference, while len > 0 */
+	bool armed;			/*< Flush timer pending */
+	fsal_status_t error;		/*< Failed flush, for COMMIT */
+};
+
+/**
+ * @brief Bytes gathered in all files
+ */
+
+static uint64_t gather_bytes;
+
+/**
+ * @brief Write a gathered extent to the FSAL, the gather lock is held
+ *
+ * @param[in] entry The file
+ * @param[in] g     Its gathering state
+ */
+
+static void gather_flush(cache_entry_t *entry, struct cache_inode_gather *g)
+{
+	struct fsal_obj_handle *obj_hdl = entry->obj_handle;
+	struct root_op_context root_op_context;
+	fsal_status_t fsal_status = { ERR_FSAL_NO_ERROR, 0 };
+	size_t done = 0, written;
+	bool fsal_sync;
+
+	if (g->len == 0)
+		return;
+
+	init_root_op_context(&root_op_context, g->export,
+			     g->export->fsal_export, 0, 0, UNKNOWN_REQUEST);
+
+	while (done < g->len) {
+		written = 0;
+		fsal_sync = false;
+		fsal_status = obj_hdl->obj_ops.write(obj_hdl, g->offset + done,
+						     g->len - done,
+						     g->buf + done, &written,
+						     &fsal_sync);
+		if (FSAL_IS_ERROR(fsal_status))
+			break;
+		if (written == 0) {
+			fsal_status = fsalstat(ERR_FSAL_IO, 0);
+			break;
+		}
+		done += written;
+	}
+
+	release_root_op_context();
+
+	LogFullDebug(COMPONENT_CACHE_INODE,
+		     "Wrote %zu gathered bytes at %" PRIu64
+		     " of entry %p, status %d",
+		     g->len, g->offset, entry, fsal_status.major);
+
+	if (FSAL_IS_ERROR(fsal_status)) {
+		LogWarn(COMPONENT_CACHE_INODE,
+			"Writing %zu gathered bytes at %" PRIu64
+			" of entry %p failed: %d(%d)",
+			g->len, g->offset, entry, fsal_status.major,
+			fsal_status.minor);
+		g->error = fsal_status;
+		nfs_change_write_verifier();
+	}
+
+	atomic_sub_uint64_t(&gather_bytes, g->len);
+	put_gsh_export(g->export);
+	g->export = NULL;
+	g->len = 0;
+}
+
+/**
+ * @brief Flush timer
+ *
+ * @param[in] arg The file, with a reference
+ */
+
+static void gather_timer(void *arg)
+{
+	cache_entry_t *entry = arg;
+	struct cache_inode_gather *g = entry->object.file.gather;
+
+	PTHREAD_MUTEX_lock(&g->mtx);
+	g->armed = false;
+	gather_flush(entry, g);
+	/* Idle files keep no buffer */
+	gsh_free(g->buf);
+	g->buf = NULL;
+	PTHREAD_MUTEX_unlock(&g->mtx);
+
+	cache_inode_put(entry);
+}
+
+/**
+ * @brief Get the gathering state of a file, creating it
+ */
+
+static struct cache_inode_gather *gather_get(cache_entry_t *entry)
+{
+	struct cache_inode_gather *g;
+
+	g = atomic_fetch_voidptr((void **)&entry->object.file.gather);
+	if (g != NULL)
+		return g;
+
+	g = gsh_calloc(1, sizeof(struct cache_inode_gather));
+	if (g == NULL)
+		return NULL;
+	PTHREAD_MUTEX_init(&g->mtx, NULL);
+
+	if (!atomic_cas_voidptr((void **)&entry->object.file.gather, NULL,
+				g)) {
+		PTHREAD_MUTEX_destroy(&g->mtx);
+		gsh_free(g);
+		g = atomic_fetch_voidptr((void **)&entry->object.file.gather);
+	}
+
+	return g;
+}
+
+/**
+ * @brief Gather an UNSTABLE write
+ *
+ * The caller holds the content lock and the file is open for
+ * writing.  A write that can not be gathered gets the extent written
+ * first, so the caller may write it through at once.
+ *
+ * @param[in] entry   The file
+ * @param[in] offset  Offset of the write
+ * @param[in] io_size Size of the write
+ * @param[in] buffer  The data
+ *
+ * @return true if the write was gathered.
+ */
+
+bool cache_inode_gather_write(cache_entry_t *entry, uint64_t offset,
+			      size_t io_size, void *buffer)
+{
+	struct cache_inode_gather *g;
+	bool gathered = false;
+
+	if (cache_param.write_gather_size == 0)
+		return false;
+
+	g = gather_get(entry);
+	if (g == NULL)
+		return false;
+
+	PTHREAD_MUTEX_lock(&g->mtx);
+
+	if (g->len != 0 &&
+	    (offset != g->offset + g->len || g->export != op_ctx->export ||
+	     g->len + io_size > cache_param.write_gather_size))
+		gather_flush(entry, g);
+
+	if (io_size >= cache_param.write_gather_size)
+		goto out;
+
+	if (g->buf == NULL) {
+		g->buf = gsh_malloc(cache_param.write_gather_size);
+		if (g->buf == NULL)
+			goto out;
+	}
+
+	/* Past the limit, the extent goes out and the write through */
+	if (atomic_add_uint64_t(&gather_bytes, io_size) >
+	    cache_param.write_gather_limit) {
+		atomic_sub_uint64_t(&gather_bytes, io_size);
+		gather_flush(entry, g);
+		goto out;
+	}
+
+	if (g->len == 0) {
+		g->offset = offset;
+		get_gsh_export_ref(op_ctx->export);
+		g->export = op_ctx->export;
+	}
+
+	memcpy(g->buf + g->len, buffer, io_size);
+	g->len += io_size;
+	gathered = true;
+
+	if (g->len == cache_param.write_gather_size) {
+		gather_flush(entry, g);
+	} else if (!g->armed &&
+		   cache_inode_lru_ref(entry, LRU_FLAG_NONE) ==
+		   CACHE_INODE_SUCCESS) {
+		if (delayed_submit(gather_timer, entry,
+				   cache_param.write_gather_delay *
+				   NS_PER_MSEC) == 0)
+			g->armed = true;
+		else
+			cache_inode_put(entry);
+	}
+
+	/* Without a timer the extent would wait for the next I/O */
+	if (!g->armed)
+		gather_flush(entry, g);
+
+ out:
+	PTHREAD_MUTEX_unlock(&g->mtx);
+	return gathered;
+}
+
+/**
+ * @brief Write what a file gathered to the FSAL
+ *
+ * Called before anything that must see the writes.  Errors are kept
+ * for the next COMMIT.
+ *
+ * @param[in] entry The file
+ */
+
+void cache_inode_gather_flush(cache_entry_t *entry)
+{
+	struct cache_inode_gather *g;
+
+	if (entry->type != REGULAR_FILE)
+		return;
+
+	g = atomic_fetch_voidptr((void **)&entry->object.file.gather);
+	if (g == NULL)
+		return;
+
+	PTHREAD_MUTEX_lock(&g->mtx);
+	gather_flush(entry, g);
+	PTHREAD_MUTEX_unlock(&g->mtx);
+}
+
+/**
+ * @brief Write what a file gathered for a COMMIT
+ *
+ * @param[in] entry The file
+ *
+ * @return The error of the first write of gathered data that failed
+ *         since the last COMMIT, if any.
+ */
+
+fsal_status_t cache_inode_gather_commit(cache_entry_t *entry)
+{
+	struct cache_inode_gather *g;
+	fsal_status_t fsal_status = { ERR_FSAL_NO_ERROR, 0 };
+
+	g = atomic_fetch_voidptr((void **)&entry->object.file.gather);
+	if (g == NULL)
+		return fsal_status;
+
+	PTHREAD_MUTEX_lock(&g->mtx);
+	gather_flush(entry, g);
+	fsal_status = g->error;
+	g->error = fsalstat(ERR_FSAL_NO_ERROR, 0);
+	PTHREAD_MUTEX_unlock(&g->mtx);
+
+	return fsal_status;
+}
+
+/**
+ * @brief Free the gathering state of a file being cleaned
+ *
+ * The file has been closed, which wrote the extent.  No timer can be
+ * pending, it holds a reference.
+ *
+ * @param[in] entry The file
+ */
+
+void cache_inode_gather_release(cache_entry_t *entry)
+{
+	struct cache_inode_gather *g = entry->object.file.gather;
+
+	if (g == NULL)
+		return;
+
+	PTHREAD_MUTEX_lock(&g->mtx);
+	gather_flush(entry, g);
+	PTHREAD_MUTEX_unlock(&g->mtx);
+
+	PTHREAD_MUTEX_destroy(&g->mtx);
+	gsh_free(g->buf);
+	gsh_free(g);
+	entry->object.file.gather = NULL;
+}
+
+/** @} */
@@ -65,6 +65,23 @@ cache_inode_init(void)
 
 	cih_pkginit();
 
+	if (cache_inode_data_pkginit() != 0) {
+		LogCrit(COMPONENT_CACHE_INODE, "Can't init the data cache");
+		status = CACHE_INODE_MALLOC_ERROR;
+	}
+
+	if (cache_inode_readdir_pkginit() != 0) {
+		LogCrit(COMPONENT_CACHE_INODE,
+			"Can't init the readdir lookup threads");
+		status = CACHE_INODE_MALLOC_ERROR;
+	}
+
+	if (cache_inode_dir_chunk_pkginit() != 0) {
+		LogCrit(COMPONENT_CACHE_INODE,
+			"Can't init the directory chunks");
+		status = CACHE_INODE_MALLOC_ERROR;
+	}
+
 	return status;
 }				/* cache_inode_init */
 
@@ -100,6 +100,14 @@ cache_inode_invalidate(cache_entry_t *entry, uint32_t flags)
 	if (!(flags & CACHE_INODE_INVALIDATE_GOT_LOCK))
 		PTHREAD_RWLOCK_unlock(&entry->attr_lock);
 
+	if ((flags & CACHE_INODE_INVALIDATE_CONTENT)
+	    && (entry->type == REGULAR_FILE))
+		cache_inode_data_invalidate(entry);
+
+	if ((flags & CACHE_INODE_INVALIDATE_CONTENT)
+	    && (entry->type == DIRECTORY))
+		cache_inode_dir_chunk_invalidate(entry);
+
 	if (((flags & CACHE_INODE_INVALIDATE_CLOSE) != 0)
 	    && (entry->type == REGULAR_FILE))
 		status = cache_inode_close(entry, CACHE_INODE_FLAG_REALLYCLOSE);
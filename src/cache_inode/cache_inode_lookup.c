@@ -200,7 +200,7 @@ cache_inode_lookup_impl(cache_entry_t *parent,
 
 	/* Entry was found in the FSAL, add this entry to the
 	   parent directory */
-	status = cache_inode_add_cached_dirent(parent, name, *entry, NULL);
+	status = cache_inode_insert_cached_dirent(parent, name, *entry, NULL);
 	if (status == CACHE_INODE_ENTRY_EXISTS)
 		status = CACHE_INODE_SUCCESS;
 
@@ -408,6 +408,11 @@ cache_inode_lru_clean(cache_entry_t *entry)
 	if (entry->type == DIRECTORY)
 		cache_inode_release_dirents(entry, CACHE_INODE_AVL_BOTH);
 
+	cache_inode_data_invalidate(entry);
+
+	if (entry->type == REGULAR_FILE)
+		cache_inode_gather_release(entry);
+
 	/* Free FSAL resources */
 	if (entry->obj_handle) {
 		entry->obj_handle->obj_ops.release(entry->obj_handle);
@@ -896,6 +901,11 @@ lru_run(struct fridgethr_context *ctx)
 		}
 	}
 
+	/* Chunks of directories hold dirents the entry count does not
+	 * see, give their memory back too. */
+	if (lru_state.entries_used >= lru_state.entries_hiwat)
+		cache_inode_dir_chunk_reclaim();
+
 	/* The following calculation will progressively garbage collect
 	 * more frequently as these two factors increase:
 	 * 1. current number of open file descriptors
@@ -1226,6 +1236,7 @@ cache_inode_lru_get(cache_entry_t **entry)
 	nentry->lru.refcnt = 2;
 	nentry->lru.pin_refcnt = 0;
 	nentry->lru.cf = 0;
+	glist_init(&nentry->data_blocks);
 
 	/* Enqueue. */
 	lane = lru_lane_of_entry(nentry);
@@ -335,10 +335,15 @@ cache_inode_new_entry(struct fsal_obj_handle *new_obj,
 
 		/* No shares or locks, yet. */
 		glist_init(&nentry->object.file.lock_list);
+		interval_tree_init(&nentry->object.file.lock_tree);
+		nentry->object.file.lock_export = NULL;
 		glist_init(&nentry->object.file.nlm_share_list);
 		memset(&nentry->object.file.share_state, 0,
 		       sizeof(cache_inode_share_t));
 		nentry->object.file.write_delegated = false;
+		memset(&nentry->object.file.readahead, 0,
+		       sizeof(struct cache_inode_readahead));
+		nentry->object.file.gather = NULL;
 
 		/* Init statistics used for intelligently granting delegations*/
 		init_deleg_heuristics(nentry);
@@ -364,6 +369,9 @@ cache_inode_new_entry(struct fsal_obj_handle *new_obj,
 		nentry->object.dir.avl.collisions = 0;
 		nentry->object.dir.nbactive = 0;
 		glist_init(&nentry->object.dir.export_roots);
+		glist_init(&nentry->object.dir.chunks);
+		nentry->object.dir.chunk_gen = 0;
+		nentry->object.dir.chunk_version = 0;
 		/* init avl tree */
 		cache_inode_avl_init(nentry);
 		break;
@@ -782,6 +790,7 @@ cache_inode_release_dirents(cache_entry_t *entry,
 	case CACHE_INODE_AVL_BOTH:
 		cache_inode_release_dirents(entry, CACHE_INODE_AVL_NAMES);
 		cache_inode_release_dirents(entry, CACHE_INODE_AVL_COOKIES);
+		cache_inode_dir_chunk_invalidate(entry);
 		/* tree == NULL */
 		break;
 
@@ -172,6 +172,8 @@ cache_inode_open(cache_entry_t *entry,
 	 * read/write */
 	if ((current_flags != FSAL_O_RDWR) && (current_flags != FSAL_O_CLOSED)
 	    && (current_flags != openflags)) {
+		cache_inode_gather_flush(entry);
+
 		/* If the FSAL has reopen method, we just use it instead
 		 * of closing and opening the file again. This avoids
 		 * losing any lock state due to closing the file!
@@ -302,6 +304,7 @@ cache_inode_close(cache_entry_t *entry, uint32_t flags)
 	    || (flags & CACHE_INODE_FLAG_REALLYCLOSE)
 	    || (entry->obj_handle->attributes.numlinks == 0)) {
 		LogFullDebug(COMPONENT_CACHE_INODE, "Closing entry %p", entry);
+		cache_inode_gather_flush(entry);
 		fsal_status = entry->obj_handle->
 				obj_ops.close(entry->obj_handle);
 		if (FSAL_IS_ERROR(fsal_status)
@@ -390,6 +393,7 @@ void cache_inode_adjust_openflags(cache_entry_t *entry)
 	if (!(openflags & FSAL_O_READ))
 		goto unlock;
 
+	cache_inode_gather_flush(entry);
 	openflags &= ~FSAL_O_WRITE;
 	fsal_status = obj_hdl->obj_ops.reopen(obj_hdl, openflags);
 	if (FSAL_IS_ERROR(fsal_status)) {
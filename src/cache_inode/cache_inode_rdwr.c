@@ -65,7 +65,9 @@
  * @param[in]     offset       Absolute file position for I/O
  * @param[in]     io_size      Amount of data to be read or written
  * @param[out]    bytes_moved  The length of data successfuly read or written
- * @param[in,out] buffer       Where in memory to read or write data
+ * @param[in,out] buffer       Where in memory to read or write data, for
+ *                             CACHE_INODE_READ_REF where to return the
+ *                             struct gsh_read_ref of the data
  * @param[out]    eof          Whether a READ encountered the end of file.  May
  *                             be NULL for writes.
  * @param[in]     sync         Whether the write is synchronous or not
@@ -93,12 +95,19 @@ cache_inode_rdwr_plus(cache_entry_t *entry,
 	bool attributes_locked = false;
 	/* TRUE if we opened a previously closed FD */
 	bool opened = false;
+	/* True if the read goes through the data cache */
+	bool data_cache = false;
+	/* Version of the file for the data cache */
+	uint64_t data_version = 0;
+	/* True if the write was gathered, not written yet */
+	bool gathered = false;
 
 	cache_inode_status_t status = CACHE_INODE_SUCCESS;
 
 	/* Set flags for a read or write, as appropriate */
 	if (io_direction == CACHE_INODE_READ ||
-	    io_direction == CACHE_INODE_READ_PLUS) {
+	    io_direction == CACHE_INODE_READ_PLUS ||
+	    io_direction == CACHE_INODE_READ_REF) {
 		openflags = FSAL_O_READ;
 	} else {
 		struct export_perms *perms;
@@ -128,6 +137,29 @@ cache_inode_rdwr_plus(cache_entry_t *entry,
 		goto out;
 	}
 
+	if (io_direction == CACHE_INODE_READ_REF)
+		*(struct gsh_read_ref **)buffer = NULL;
+
+	if ((io_direction == CACHE_INODE_READ ||
+	     io_direction == CACHE_INODE_READ_REF) &&
+	    cache_inode_data_enabled()) {
+		status = cache_inode_data_version(entry, &data_version);
+		if (status != CACHE_INODE_SUCCESS)
+			goto out;
+		if (io_direction == CACHE_INODE_READ_REF) {
+			*(struct gsh_read_ref **)buffer =
+			    cache_inode_data_read_ref(entry, data_version,
+						      offset, io_size,
+						      bytes_moved, eof);
+			if (*(struct gsh_read_ref **)buffer != NULL)
+				goto update_attrs;
+		} else if (cache_inode_data_read(entry, data_version, offset,
+						 io_size, buffer, bytes_moved,
+						 eof))
+			goto update_attrs;
+		data_cache = true;
+	}
+
 	/* Write through the FSAL.  We need a write lock only if we need
 	   to open or close a file descriptor. */
 	PTHREAD_RWLOCK_rdlock(&entry->content_lock);
@@ -154,18 +186,53 @@ cache_inode_rdwr_plus(cache_entry_t *entry,
 		loflags = obj_hdl->obj_ops.status(obj_hdl);
 	}
 
+	/* Gathered writes go out before any other I/O */
+	if (io_direction != CACHE_INODE_WRITE || *sync)
+		cache_inode_gather_flush(entry);
+
 	/* Call FSAL_read or FSAL_write */
-	if (io_direction == CACHE_INODE_READ) {
+	if (io_direction == CACHE_INODE_READ && data_cache) {
+		fsal_status =
+		    cache_inode_data_fill(entry, data_version, offset,
+					  io_size, buffer, bytes_moved, eof);
+	} else if (io_direction == CACHE_INODE_READ) {
 		fsal_status =
 		    obj_hdl->obj_ops.read(obj_hdl, offset, io_size,
 				       buffer, bytes_moved, eof);
+	} else if (io_direction == CACHE_INODE_READ_REF) {
+		struct gsh_read_ref **ref = buffer;
+
+		/* Fill the data cache and reply from the blocks, unless
+		   they are gone already */
+		if (data_cache) {
+			fsal_status =
+			    cache_inode_data_fill(entry, data_version, offset,
+						  io_size, NULL, bytes_moved,
+						  eof);
+			if (!FSAL_IS_ERROR(fsal_status))
+				*ref = cache_inode_data_read_ref(entry,
+								 data_version,
+								 offset,
+								 io_size,
+								 bytes_moved,
+								 eof);
+		}
+		if (*ref == NULL && !FSAL_IS_ERROR(fsal_status))
+			fsal_status =
+			    obj_hdl->obj_ops.read_ref(obj_hdl, offset, io_size,
+						      ref, bytes_moved, eof);
 	} else if (io_direction == CACHE_INODE_READ_PLUS) {
 		fsal_status =
 		    obj_hdl->obj_ops.read_plus(obj_hdl, offset, io_size,
 					    buffer, bytes_moved, eof, info);
 	} else {
 		bool fsal_sync = *sync;
-		if (io_direction == CACHE_INODE_WRITE)
+		if (io_direction == CACHE_INODE_WRITE && !fsal_sync &&
+		    cache_inode_gather_write(entry, offset, io_size,
+					     buffer)) {
+			*bytes_moved = io_size;
+			gathered = true;
+		} else if (io_direction == CACHE_INODE_WRITE)
 			fsal_status =
 			  obj_hdl->obj_ops.write(obj_hdl, offset,
 					      io_size, buffer, bytes_moved,
@@ -187,6 +254,8 @@ cache_inode_rdwr_plus(cache_entry_t *entry,
 		} else {
 			*sync = fsal_sync;
 		}
+
+		cache_inode_data_invalidate(entry);
 	}
 
 	LogFullDebug(COMPONENT_FSAL,
@@ -264,10 +333,22 @@ cache_inode_rdwr_plus(cache_entry_t *entry,
 		content_locked = false;
 	}
 
+ update_attrs:
 	PTHREAD_RWLOCK_wrlock(&entry->attr_lock);
 	attributes_locked = true;
-	if (io_direction == CACHE_INODE_WRITE ||
-	    io_direction == CACHE_INODE_WRITE_PLUS) {
+	if (gathered) {
+		/* The FSAL has not seen the write yet, a refresh would
+		   write it out */
+		struct attrlist *attrs = &obj_hdl->attributes;
+
+		if (attrs->filesize < offset + *bytes_moved)
+			attrs->filesize = offset + *bytes_moved;
+		cache_inode_set_time_current(&attrs->mtime);
+		attrs->ctime = attrs->mtime;
+		attrs->chgtime = attrs->mtime;
+		attrs->change++;
+	} else if (io_direction == CACHE_INODE_WRITE ||
+		   io_direction == CACHE_INODE_WRITE_PLUS) {
 		status = cache_inode_refresh_attrs(entry);
 		if (status != CACHE_INODE_SUCCESS)
 			goto out;
@@ -305,4 +386,37 @@ cache_inode_rdwr(cache_entry_t *entry,
 				     bytes_moved, buffer, eof, sync, NULL);
 }
 
+/**
+ * @brief Read without copying into a buffer of the caller
+ *
+ * For protocols that can reply with data they do not own.  The data
+ * is referenced in the data cache blocks when the data cache is
+ * enabled, else in buffers of the FSAL's read_ref.  The caller MUST
+ * NOT hold either the content or attribute locks.
+ *
+ * @param[in]  entry       File to be read
+ * @param[in]  offset      Absolute file position for I/O
+ * @param[in]  io_size     Amount of data to be read
+ * @param[out] bytes_moved The length of data successfuly read
+ * @param[out] eof         Whether the READ encountered the end of file
+ * @param[out] ref         The data, to release once sent.  NULL on
+ *                         error.
+ *
+ * @return CACHE_INODE_SUCCESS or various errors
+ */
+
+cache_inode_status_t cache_inode_read_ref(cache_entry_t *entry,
+					  uint64_t offset, size_t io_size,
+					  size_t *bytes_moved, bool *eof,
+					  struct gsh_read_ref **ref)
+{
+	bool sync = false;
+
+	*ref = NULL;
+
+	return cache_inode_rdwr_plus(entry, CACHE_INODE_READ_REF, offset,
+				     io_size, bytes_moved, ref, eof, &sync,
+				     NULL);
+}
+
 /** @} */
@@ -81,6 +81,28 @@ static struct config_item cache_inode_params[] = {
 		       cache_inode_parameter, futility_count),
 	CONF_ITEM_BOOL("Retry_Readdir", false,
 		       cache_inode_parameter, retry_readdir),
+	CONF_ITEM_UI64("Data_Cache_Size", 0, UINT64_MAX, 0,
+		       cache_inode_parameter, data_cache_size),
+	CONF_ITEM_UI32("Write_Gather_Size", 0, 16777216, 0,
+		       cache_inode_parameter, write_gather_size),
+	CONF_ITEM_UI32("Write_Gather_Delay", 1, 10000, 100,
+		       cache_inode_parameter, write_gather_delay),
+	CONF_ITEM_UI64("Write_Gather_Limit", 0, UINT64_MAX, 268435456,
+		       cache_inode_parameter, write_gather_limit),
+	CONF_ITEM_UI32("Readahead_Size", 0, 16777216, 1048576,
+		       cache_inode_parameter, readahead_size),
+	CONF_ITEM_UI32("Readahead_Threads", 1, 256, 4,
+		       cache_inode_parameter, readahead_threads),
+	CONF_ITEM_UI32("Dir_Chunk", 0, 65536, 0,
+		       cache_inode_parameter, dir_chunk),
+	CONF_ITEM_UI32("Dir_Chunk_Prefetch", 0, 64, 1,
+		       cache_inode_parameter, dir_chunk_prefetch),
+	CONF_ITEM_UI32("Dir_Chunk_HWMark", 1, UINT32_MAX, 1000000,
+		       cache_inode_parameter, dir_chunk_hwmark),
+	CONF_ITEM_UI32("Readdir_Lookup_Threads", 0, 256, 0,
+		       cache_inode_parameter, readdir_lookup_threads),
+	CONF_ITEM_UI32("Readdir_Lookup_Depth", 1, 1024, 16,
+		       cache_inode_parameter, readdir_lookup_depth),
 	CONFIG_EOL
 };
 
@@ -46,6 +46,7 @@
 #include "cache_inode.h"
 #include "cache_inode_lru.h"
 #include "cache_inode_avl.h"
+#include "fridgethr.h"
 
 #include <unistd.h>
 #include <sys/types.h>
@@ -115,6 +116,55 @@ cache_inode_invalidate_all_cached_dirent(cache_entry_t *entry)
 #define CIV_FLAGS (CACHE_INODE_INVALIDATE_ATTRS| \
 		   CACHE_INODE_INVALIDATE_CONTENT)
 
+/**
+ * @brief Threads looking up names for directory population, if any
+ */
+static struct fridgethr *readdir_lookup_fridge;
+
+/**
+ * @brief Start the readdir lookup threads
+ *
+ * Nothing is started unless Readdir_Lookup_Threads is set.
+ *
+ * @return 0 or errors from the fridge.
+ */
+
+int cache_inode_readdir_pkginit(void)
+{
+	struct fridgethr_params frp;
+	int rc;
+
+	if (cache_param.readdir_lookup_threads == 0)
+		return 0;
+
+	memset(&frp, 0, sizeof(struct fridgethr_params));
+	frp.thr_max = cache_param.readdir_lookup_threads;
+	frp.thr_min = 1;
+	frp.flavor = fridgethr_flavor_worker;
+	frp.deferment = fridgethr_defer_queue;
+
+	rc = fridgethr_init(&readdir_lookup_fridge, "Readdir_Lookup", &frp);
+	if (rc != 0) {
+		LogMajor(COMPONENT_CACHE_INODE,
+			 "Unable to initialize readdir lookup threads: %d",
+			 rc);
+		readdir_lookup_fridge = NULL;
+	}
+
+	return rc;
+}
+
+/**
+ * @brief Stop the readdir lookup threads
+ *
+ * @return 0 or errors from the fridge.
+ */
+
+int cache_inode_readdir_pkgshutdown(void)
+{
+	return fridgethr_shutdown(readdir_lookup_fridge);
+}
+
 cache_inode_status_t
 cache_inode_operate_cached_dirent(cache_entry_t *directory,
 				  const char *name,
@@ -249,13 +299,13 @@ out:
 
 /**
  *
- * @brief Adds a directory entry to a cached directory.
+ * @brief Caches a directory entry the directory already has.
  *
- * This function adds a new directory entry to a directory.  Directory
- * entries have only weak references, so they do not prevent recycling
- * or freeing the entry they locate.  This function may be called
- * either once (for handling creation) or iteratively in directory
- * population.
+ * This function adds a directory entry found in the FSAL to a cached
+ * directory.  Directory entries have only weak references, so they do
+ * not prevent recycling or freeing the entry they locate.  The chunks
+ * of the directory are left alone, the directory itself did not
+ * change.
  *
  * @param[in,out] parent    Cache entry of the directory being updated
  * @param[in]     name      The name to add to the entry
@@ -266,10 +316,10 @@ out:
  */
 
 cache_inode_status_t
-cache_inode_add_cached_dirent(cache_entry_t *parent,
-			      const char *name,
-			      cache_entry_t *entry,
-			      cache_inode_dir_entry_t **dir_entry)
+cache_inode_insert_cached_dirent(cache_entry_t *parent,
+				 const char *name,
+				 cache_entry_t *entry,
+				 cache_inode_dir_entry_t **dir_entry)
 {
 	cache_inode_dir_entry_t *new_dir_entry = NULL;
 	size_t namesize = strlen(name) + 1;
@@ -314,11 +364,43 @@ cache_inode_add_cached_dirent(cache_entry_t *parent,
 	return status;
 }
 
+/**
+ *
+ * @brief Adds a directory entry to a cached directory.
+ *
+ * This function adds a new directory entry to a directory.  Directory
+ * entries have only weak references, so they do not prevent recycling
+ * or freeing the entry they locate.  This function may be called
+ * either once (for handling creation) or iteratively in directory
+ * population.  The chunks of the directory are dropped, the ctime
+ * they are checked against may not have moved.
+ *
+ * @param[in,out] parent    Cache entry of the directory being updated
+ * @param[in]     name      The name to add to the entry
+ * @param[in]     entry     The cache entry associated with name
+ * @param[out]    dir_entry The directory entry newly added (optional)
+ *
+ * @return CACHE_INODE_SUCCESS or errors on failure.
+ */
+
+cache_inode_status_t
+cache_inode_add_cached_dirent(cache_entry_t *parent,
+			      const char *name,
+			      cache_entry_t *entry,
+			      cache_inode_dir_entry_t **dir_entry)
+{
+	cache_inode_dir_chunk_invalidate(parent);
+
+	return cache_inode_insert_cached_dirent(parent, name, entry,
+						dir_entry);
+}
+
 /**
  * @brief Removes an entry from a cached directory.
  *
- * This function removes the named entry from a cached directory.  The
- * caller must hold the content lock.
+ * This function removes the named entry from a cached directory, and
+ * drops the chunks of the directory.  The caller must hold the content
+ * lock.
  *
  * @param[in,out] directory The cache entry representing the directory
  * @param[in]     name      The name indicating the entry to remove
@@ -340,6 +422,8 @@ cache_inode_remove_cached_dirent(cache_entry_t *directory,
 		return status;
 	}
 
+	cache_inode_dir_chunk_invalidate(directory);
+
 	status =
 	    cache_inode_operate_cached_dirent(directory, name, NULL,
 					      CACHE_INODE_DIRENT_OP_REMOVE);
@@ -361,30 +445,30 @@ struct cache_inode_populate_cb_state {
  * @brief Populate a single dir entry
  *
  * This callback serves to populate a single dir entry from the
- * readdir.
+ * readdir_plus, which comes with the object of the entry.
  *
- * @param[in]     name      Name of the directory entry
- * @param[in,out] dir_state Callback state
- * @param[in]     cookie    Directory cookie
+ * @param[in]     name        Name of the directory entry
+ * @param[in]     entry_hdl   Object of the entry, consumed
+ * @param[in]     fsal_status Why there is no object, if there is none
+ * @param[in,out] dir_state   Callback state
+ * @param[in]     cookie      Directory cookie
  *
  * @retval true if more entries are requested
  * @retval false if no more should be sent and the last was not processed
  */
 
 static bool
-populate_dirent(const char *name, void *dir_state,
+populate_dirent(const char *name, struct fsal_obj_handle *entry_hdl,
+		fsal_status_t fsal_status, void *dir_state,
 		fsal_cookie_t cookie)
 {
 	struct cache_inode_populate_cb_state *state =
 	    (struct cache_inode_populate_cb_state *)dir_state;
-	struct fsal_obj_handle *entry_hdl;
 	cache_inode_dir_entry_t *new_dir_entry = NULL;
 	cache_entry_t *cache_entry = NULL;
-	fsal_status_t fsal_status = { 0, 0 };
 	struct fsal_obj_handle *dir_hdl = state->directory->obj_handle;
 
-	fsal_status = dir_hdl->obj_ops.lookup(dir_hdl, name, &entry_hdl);
-	if (FSAL_IS_ERROR(fsal_status)) {
+	if (entry_hdl == NULL) {
 		*state->status = cache_inode_error_convert(fsal_status);
 		if (*state->status == CACHE_INODE_FSAL_XDEV) {
 			LogInfo(COMPONENT_NFS_READDIR,
@@ -438,13 +522,197 @@ populate_dirent(const char *name, void *dir_state,
 	return true;
 }
 
+/**
+ * @brief A name of a directory being populated, looked up in parallel
+ */
+
+struct readdir_lookup {
+	struct readdir_lookup_window *window;
+	struct fsal_obj_handle *hdl;	/*< The object found, or NULL */
+	fsal_status_t status;		/*< Why there is none */
+	fsal_cookie_t cookie;		/*< Cookie of the name */
+	bool done;			/*< The lookup returned */
+	char *name;
+};
+
+/**
+ * @brief Lookups in flight for a directory being populated
+ *
+ * The names are looked up in the order readdir returned them, up to
+ * Readdir_Lookup_Depth at a time, and the results are added to the
+ * directory in the same order as they would have been sequentially.
+ */
+
+struct readdir_lookup_window {
+	pthread_mutex_t mtx;
+	pthread_cond_t cv;		/*< Signalled when a lookup returns */
+	struct req_op_context ctx;	/*< The reader's, for the lookups */
+	struct cache_inode_populate_cb_state *state;
+	struct readdir_lookup *ring;	/*< Readdir_Lookup_Depth slots */
+	uint32_t head;			/*< Oldest lookup in flight */
+	uint32_t count;			/*< Lookups in flight */
+	bool stop;			/*< populate_dirent asked to stop */
+};
+
+static void readdir_lookup_do(struct readdir_lookup *lookup)
+{
+	struct readdir_lookup_window *window = lookup->window;
+	struct fsal_obj_handle *dir_hdl = window->state->directory->obj_handle;
+
+	lookup->hdl = NULL;
+	lookup->status = dir_hdl->obj_ops.lookup(dir_hdl, lookup->name,
+						 &lookup->hdl);
+
+	PTHREAD_MUTEX_lock(&window->mtx);
+	lookup->done = true;
+	pthread_cond_broadcast(&window->cv);
+	PTHREAD_MUTEX_unlock(&window->mtx);
+}
+
+/**
+ * @brief Look a name up, in a readdir lookup thread
+ *
+ * @param[in] ctx Thread context, the lookup is the argument
+ */
+
+static void readdir_lookup_run(struct fridgethr_context *ctx)
+{
+	struct readdir_lookup *lookup = ctx->arg;
+
+	/* The reader waits for the lookup, its context stays valid */
+	op_ctx = &lookup->window->ctx;
+	readdir_lookup_do(lookup);
+	op_ctx = NULL;
+}
+
+/**
+ * @brief Add the oldest lookup in flight to the directory
+ *
+ * Waits for the lookup to return.  Once populate_dirent has asked to
+ * stop, the objects found are released instead.
+ */
+
+static void readdir_lookup_merge(struct readdir_lookup_window *window)
+{
+	struct readdir_lookup *lookup = &window->ring[window->head];
+
+	PTHREAD_MUTEX_lock(&window->mtx);
+	while (!lookup->done)
+		pthread_cond_wait(&window->cv, &window->mtx);
+	PTHREAD_MUTEX_unlock(&window->mtx);
+
+	if (!window->stop) {
+		window->stop = !populate_dirent(lookup->name, lookup->hdl,
+						lookup->status, window->state,
+						lookup->cookie);
+	} else if (lookup->hdl != NULL) {
+		lookup->hdl->obj_ops.release(lookup->hdl);
+	}
+
+	gsh_free(lookup->name);
+	window->head = (window->head + 1) % cache_param.readdir_lookup_depth;
+	window->count--;
+}
+
+/**
+ * @brief Start the lookup of a name read from the directory
+ *
+ * @param[in]     name      Name of the directory entry
+ * @param[in,out] dir_state The lookup window
+ * @param[in]     cookie    Directory cookie
+ *
+ * @retval true if more entries are requested
+ * @retval false if no more should be sent and the last was not processed
+ */
+
+static bool readdir_lookup_start(const char *name, void *dir_state,
+				 fsal_cookie_t cookie)
+{
+	struct readdir_lookup_window *window = dir_state;
+	struct readdir_lookup *lookup;
+
+	if (window->count == cache_param.readdir_lookup_depth)
+		readdir_lookup_merge(window);
+
+	if (window->stop)
+		return false;
+
+	lookup = &window->ring[(window->head + window->count) %
+			       cache_param.readdir_lookup_depth];
+	lookup->name = gsh_strdup(name);
+	if (lookup->name == NULL) {
+		*window->state->status = CACHE_INODE_MALLOC_ERROR;
+		window->stop = true;
+		return false;
+	}
+	lookup->window = window;
+	lookup->cookie = cookie;
+	lookup->done = false;
+	window->count++;
+
+	if (fridgethr_submit(readdir_lookup_fridge, readdir_lookup_run,
+			     lookup) != 0)
+		readdir_lookup_do(lookup);
+
+	return true;
+}
+
+/**
+ * @brief Read the names of a directory, looking them up in parallel
+ *
+ * Used instead of readdir_plus when there are readdir lookup threads.
+ * The content lock must be held on the directory being read.
+ *
+ * @param[in]  state The populate state
+ * @param[out] eod   Whether the end of directory was reached
+ *
+ * @return Status of the FSAL readdir.
+ */
+
+static fsal_status_t
+cache_inode_readdir_lookup(struct cache_inode_populate_cb_state *state,
+			   bool *eod)
+{
+	struct fsal_obj_handle *dir_hdl = state->directory->obj_handle;
+	struct readdir_lookup_window window;
+	fsal_status_t fsal_status;
+
+	memset(&window, 0, sizeof(window));
+	window.ring = gsh_calloc(cache_param.readdir_lookup_depth,
+				 sizeof(struct readdir_lookup));
+	if (window.ring == NULL)
+		return fsalstat(ERR_FSAL_NOMEM, 0);
+
+	PTHREAD_MUTEX_init(&window.mtx, NULL);
+	PTHREAD_COND_init(&window.cv, NULL);
+	window.ctx = *op_ctx;
+	window.state = state;
+
+	fsal_status = dir_hdl->obj_ops.readdir(dir_hdl, NULL, &window,
+					       readdir_lookup_start, eod);
+
+	while (window.count != 0)
+		readdir_lookup_merge(&window);
+
+	/* A stop asked for by populate_dirent must not look like eod */
+	if (window.stop)
+		*eod = false;
+
+	PTHREAD_COND_destroy(&window.cv);
+	PTHREAD_MUTEX_destroy(&window.mtx);
+	gsh_free(window.ring);
+
+	return fsal_status;
+}
+
 /**
  *
  * @brief Cache complete directory contents
  *
  * This function reads a complete directory from the FSAL and caches
- * both the names and filess.  The content lock must be held on the
- * directory being read.
+ * both the names and filess.  The FSAL supplies the objects with the
+ * names so there is no lookup per name.  The content lock must be
+ * held on the directory being read.
  *
  * @param[in] directory  Entry for the parent directory to be read
  *
@@ -490,12 +758,16 @@ cache_inode_readdir_populate(cache_entry_t *directory)
 	state.status = &status;
 	state.offset_cookie = 0;
 
-	fsal_status =
-		directory->obj_handle->obj_ops.readdir(directory->obj_handle,
-						    NULL,
-						    (void *)&state,
-						    populate_dirent,
-						    &eod);
+	if (readdir_lookup_fridge != NULL)
+		fsal_status = cache_inode_readdir_lookup(&state, &eod);
+	else
+		fsal_status =
+			directory->obj_handle->obj_ops.readdir_plus(
+						directory->obj_handle,
+						NULL,
+						(void *)&state,
+						populate_dirent,
+						&eod);
 	if (FSAL_IS_ERROR(fsal_status)) {
 		if (fsal_status.major == ERR_FSAL_STALE) {
 			LogEvent(COMPONENT_NFS_READDIR,
@@ -533,6 +805,198 @@ cache_inode_readdir_populate(cache_entry_t *directory)
 	return status;
 }				/* cache_inode_readdir_populate */
 
+/**
+ * @brief Pass a cached directory entry to the readdir callback
+ *
+ * Entries gone from under us are skipped, after one retry if stale.
+ * The content lock of the directory is held.
+ *
+ * @param[in]     directory   The directory being read
+ * @param[in]     dirent      The entry
+ * @param[in]     attr_status Whether attributes may be returned
+ * @param[in,out] cb_parms    Callback parameters
+ * @param[in]     cb          The callback
+ * @param[in,out] retry_stale Whether a stale entry may be retried
+ * @param[in,out] nbfound     Entries passed to the callback
+ *
+ * @return CACHE_INODE_SUCCESS if the entry was passed or skipped, or
+ *         errors to stop reading on.
+ */
+
+static cache_inode_status_t
+cache_inode_readdir_dirent(cache_entry_t *directory,
+			   cache_inode_dir_entry_t *dirent,
+			   cache_inode_status_t attr_status,
+			   struct cache_inode_readdir_cb_parms *cb_parms,
+			   cache_inode_getattr_cb_t cb, bool *retry_stale,
+			   unsigned int *nbfound)
+{
+	cache_entry_t *entry = NULL;
+	cache_inode_status_t status;
+
+ estale_retry:
+	LogFullDebug(COMPONENT_NFS_READDIR,
+		     "Lookup direct %s",
+		     dirent->name);
+
+	entry = cache_inode_get_keyed(&dirent->ckey, CIG_KEYED_FLAG_NONE,
+				      &status);
+	if (!entry) {
+		LogFullDebug(COMPONENT_NFS_READDIR,
+			     "Lookup returned %s",
+			     cache_inode_err_str(status));
+
+		if (*retry_stale && status == CACHE_INODE_ESTALE) {
+			LogDebug(COMPONENT_NFS_READDIR,
+				 "cache_inode_get_keyed returned %s "
+				 "for %s - retrying entry",
+				 cache_inode_err_str(status), dirent->name);
+			*retry_stale = false; /* only one retry per dirent */
+			goto estale_retry;
+		}
+
+		if (status == CACHE_INODE_NOT_FOUND
+		    || status == CACHE_INODE_ESTALE) {
+			/* Directory changed out from under us.
+			   Invalidate it, skip the name, and keep
+			   going. */
+			atomic_clear_uint32_t_bits(&directory->flags,
+						   CACHE_INODE_TRUST_CONTENT);
+			cache_inode_dir_chunk_invalidate(directory);
+			LogDebug(COMPONENT_NFS_READDIR,
+				 "cache_inode_get_keyed returned %s "
+				 "for %s - skipping entry",
+				 cache_inode_err_str(status), dirent->name);
+			return CACHE_INODE_SUCCESS;
+		}
+
+		/* Something is more seriously wrong, probably an
+		   inconsistency. */
+		LogCrit(COMPONENT_NFS_READDIR,
+			"cache_inode_get_keyed returned %s "
+			"for %s - bailing out",
+			cache_inode_err_str(status), dirent->name);
+		return status;
+	}
+
+	LogFullDebug(COMPONENT_NFS_READDIR,
+		     "cache_inode_readdir: dirent=%p name=%s "
+		     "cookie=%" PRIu64 " (probes %d)", dirent,
+		     dirent->name, dirent->hk.k, dirent->hk.p);
+
+	cb_parms->name = dirent->name;
+	cb_parms->attr_allowed = attr_status == CACHE_INODE_SUCCESS;
+	cb_parms->cookie = dirent->hk.k;
+
+	status = cache_inode_getattr(entry, cb_parms, cb, CB_ORIGINAL);
+
+	cache_inode_lru_unref(entry, LRU_FLAG_NONE);
+
+	if (status == CACHE_INODE_SUCCESS) {
+		(*nbfound)++;
+		return CACHE_INODE_SUCCESS;
+	}
+
+	if (status == CACHE_INODE_ESTALE) {
+		if (*retry_stale) {
+			LogDebug(COMPONENT_NFS_READDIR,
+				 "cache_inode_getattr returned "
+				 "%s for %s - retrying entry",
+				 cache_inode_err_str(status), dirent->name);
+			*retry_stale = false; /* only one retry per dirent */
+			goto estale_retry;
+		}
+
+		/* Directory changed out from under us.  Invalidate it,
+		   skip the name, and keep going. */
+		atomic_clear_uint32_t_bits(&directory->flags,
+					   CACHE_INODE_TRUST_CONTENT);
+		cache_inode_dir_chunk_invalidate(directory);
+
+		LogDebug(COMPONENT_NFS_READDIR,
+			 "cache_inode_lock_trust_attrs "
+			 "returned %s for %s - skipping entry",
+			 cache_inode_err_str(status), dirent->name);
+		return CACHE_INODE_SUCCESS;
+	}
+
+	LogCrit(COMPONENT_NFS_READDIR,
+		"cache_inode_lock_trust_attrs returned %s for "
+		"%s - bailing out",
+		cache_inode_err_str(status), dirent->name);
+
+	return status;
+}
+
+/**
+ * @brief Read a directory from its chunks
+ *
+ * The content lock of the directory is held.
+ *
+ * @param[in]     directory   The directory to be read
+ * @param[in]     version     Its current version
+ * @param[in]     cookie      Starting cookie
+ * @param[in]     attr_status Whether attributes may be returned
+ * @param[in,out] cb_parms    Callback parameters
+ * @param[in]     cb          The callback
+ * @param[out]    nbfound     Number of entries returned
+ * @param[out]    eod_met     Whether the end of directory was met
+ *
+ * @return CACHE_INODE_SUCCESS or errors.
+ */
+
+static cache_inode_status_t
+cache_inode_readdir_chunks(cache_entry_t *directory, uint64_t version,
+			   uint64_t cookie, cache_inode_status_t attr_status,
+			   struct cache_inode_readdir_cb_parms *cb_parms,
+			   cache_inode_getattr_cb_t cb,
+			   unsigned int *nbfound, bool *eod_met)
+{
+	struct cache_inode_dir_chunk *chunk;
+	cache_inode_status_t status;
+	bool retry_stale = true;
+	uint32_t index;
+
+	*nbfound = 0;
+	*eod_met = false;
+
+	status = cache_inode_dir_chunk_get(directory, version, cookie,
+					   &chunk, &index);
+	if (status != CACHE_INODE_SUCCESS)
+		return status;
+
+	while (cb_parms->in_result) {
+		if (index == chunk->count) {
+			if (chunk->eod) {
+				*eod_met = true;
+				break;
+			}
+
+			/* A chunk that is not the last is full */
+			cookie = chunk->dirents[chunk->count - 1]->hk.k;
+			cache_inode_dir_chunk_put(directory, chunk);
+
+			status = cache_inode_dir_chunk_get(directory, version,
+							   cookie, &chunk,
+							   &index);
+			if (status != CACHE_INODE_SUCCESS)
+				return status;
+			continue;
+		}
+
+		status = cache_inode_readdir_dirent(directory,
+						    chunk->dirents[index++],
+						    attr_status, cb_parms, cb,
+						    &retry_stale, nbfound);
+		if (status != CACHE_INODE_SUCCESS)
+			break;
+	}
+
+	cache_inode_dir_chunk_put(directory, chunk);
+
+	return status;
+}
+
 /**
  * @brief Reads a directory
  *
@@ -584,6 +1048,7 @@ cache_inode_readdir(cache_entry_t *directory,
 	struct cache_inode_readdir_cb_parms cb_parms = { opaque, NULL,
 							 true, 0, true };
 	bool retry_stale = true;
+	uint64_t version = 0;
 
 	LogFullDebug(COMPONENT_NFS_READDIR,
 		     "Enter....");
@@ -640,8 +1105,22 @@ cache_inode_readdir(cache_entry_t *directory,
 		/* No attributes requested, we don't need permission */
 		attr_status = CACHE_INODE_SUCCESS;
 
+	/* FSALs derive the change attribute from the ctime, which unlike
+	   it orders the versions of the directory */
+	if (cache_inode_dir_chunked())
+		version = timespec_to_nsecs(
+				&directory->obj_handle->attributes.chgtime);
+
 	PTHREAD_RWLOCK_rdlock(&directory->content_lock);
 	PTHREAD_RWLOCK_unlock(&directory->attr_lock);
+
+	if (cache_inode_dir_chunked()) {
+		status = cache_inode_readdir_chunks(directory, version, cookie,
+						    attr_status, &cb_parms, cb,
+						    nbfound, eod_met);
+		goto unlock_dir;
+	}
+
 	if (!
 	    ((directory->flags & CACHE_INODE_TRUST_CONTENT)
 	     && (directory->flags & CACHE_INODE_DIR_POPULATED))) {
@@ -719,120 +1198,15 @@ cache_inode_readdir(cache_entry_t *directory,
 
 	for (; cb_parms.in_result && dirent_node;
 	     dirent_node = avltree_next(dirent_node)) {
-
-		cache_entry_t *entry = NULL;
-		cache_inode_status_t tmp_status = 0;
-
 		dirent =
 		    avltree_container_of(dirent_node, cache_inode_dir_entry_t,
 					 node_hk);
 
- estale_retry:
-		LogFullDebug(COMPONENT_NFS_READDIR,
-			     "Lookup direct %s",
-			     dirent->name);
-
-		entry =
-		    cache_inode_get_keyed(&dirent->ckey,
-					  CIG_KEYED_FLAG_NONE, &tmp_status);
-		if (!entry) {
-			LogFullDebug(COMPONENT_NFS_READDIR,
-				     "Lookup returned %s",
-				     cache_inode_err_str(tmp_status));
-
-			if (retry_stale
-			    && tmp_status == CACHE_INODE_ESTALE) {
-				LogDebug(COMPONENT_NFS_READDIR,
-					 "cache_inode_get_keyed returned %s "
-					 "for %s - retrying entry",
-					 cache_inode_err_str(tmp_status),
-					 dirent->name);
-				retry_stale = false; /* only one retry per
-						      * dirent */
-				goto estale_retry;
-			}
-
-			if (tmp_status == CACHE_INODE_NOT_FOUND
-			    || tmp_status == CACHE_INODE_ESTALE) {
-				/* Directory changed out from under us.
-				   Invalidate it, skip the name, and keep
-				   going. */
-				atomic_clear_uint32_t_bits(
-					&directory->flags,
-					CACHE_INODE_TRUST_CONTENT);
-				LogDebug(COMPONENT_NFS_READDIR,
-					 "cache_inode_get_keyed returned %s "
-					 "for %s - skipping entry",
-					 cache_inode_err_str(tmp_status),
-					 dirent->name);
-				continue;
-			} else {
-				/* Something is more seriously wrong,
-				   probably an inconsistency. */
-				status = tmp_status;
-				LogCrit(COMPONENT_NFS_READDIR,
-					"cache_inode_get_keyed returned %s "
-					"for %s - bailing out",
-					cache_inode_err_str(status),
-					dirent->name);
-				goto unlock_dir;
-			}
-		}
-
-		LogFullDebug(COMPONENT_NFS_READDIR,
-			     "cache_inode_readdir: dirent=%p name=%s "
-			     "cookie=%" PRIu64 " (probes %d)", dirent,
-			     dirent->name, dirent->hk.k, dirent->hk.p);
-
-		cb_parms.name = dirent->name;
-		cb_parms.attr_allowed = attr_status == CACHE_INODE_SUCCESS;
-		cb_parms.cookie = dirent->hk.k;
-
-		tmp_status =
-		    cache_inode_getattr(entry, &cb_parms, cb, CB_ORIGINAL);
-
-		if (tmp_status != CACHE_INODE_SUCCESS) {
-			cache_inode_lru_unref(entry, LRU_FLAG_NONE);
-			if (tmp_status == CACHE_INODE_ESTALE) {
-				if (retry_stale) {
-					LogDebug(COMPONENT_NFS_READDIR,
-						 "cache_inode_getattr returned "
-						 "%s for %s - retrying entry",
-						 cache_inode_err_str
-						 (tmp_status), dirent->name);
-					retry_stale = false; /* only one retry
-							      * per dirent */
-					goto estale_retry;
-				}
-
-				/* Directory changed out from under us.
-				   Invalidate it, skip the name, and keep
-				   going. */
-				atomic_clear_uint32_t_bits(
-					&directory->flags,
-					CACHE_INODE_TRUST_CONTENT);
-
-				LogDebug(COMPONENT_NFS_READDIR,
-					 "cache_inode_lock_trust_attrs "
-					 "returned %s for %s - skipping entry",
-					 cache_inode_err_str(tmp_status),
-					 dirent->name);
-				continue;
-			}
-
-			status = tmp_status;
-
-			LogCrit(COMPONENT_NFS_READDIR,
-				"cache_inode_lock_trust_attrs returned %s for "
-				"%s - bailing out",
-				cache_inode_err_str(status), dirent->name);
-
+		status = cache_inode_readdir_dirent(directory, dirent,
+						    attr_status, &cb_parms,
+						    cb, &retry_stale, nbfound);
+		if (status != CACHE_INODE_SUCCESS)
 			goto unlock_dir;
-		}
-
-		(*nbfound)++;
-
-		cache_inode_lru_unref(entry, LRU_FLAG_NONE);
 
 		if (!cb_parms.in_result) {
 			LogDebug(COMPONENT_NFS_READDIR,
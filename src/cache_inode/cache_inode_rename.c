@@ -75,6 +75,8 @@ cache_inode_rename_cached_dirent(cache_entry_t *parent,
 		return status;
 	}
 
+	cache_inode_dir_chunk_invalidate(parent);
+
 	status =
 	    cache_inode_operate_cached_dirent(parent, oldname, newname,
 					      CACHE_INODE_DIRENT_OP_RENAME);
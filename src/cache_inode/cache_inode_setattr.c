@@ -167,6 +167,7 @@ cache_inode_setattr(cache_entry_t *entry,
 
 	saved_acl = obj_handle->attributes.acl;
 	before = obj_handle->attributes.change;
+	cache_inode_gather_flush(entry);
 	fsal_status = obj_handle->obj_ops.setattrs(obj_handle, attr);
 	if (FSAL_IS_ERROR(fsal_status)) {
 		status = cache_inode_error_convert(fsal_status);
@@ -39,6 +39,9 @@
  * determines which of the partitions (each containing a tree and each
  * separately locked), and a hash which acts as the key within an
  * individual Red-Black Tree.
+ *
+ * Tables created with HT_FLAG_RESIZE use growable hash chains in each
+ * partition instead, with lock free lookups.
  */
 
 #include "config.h"
@@ -46,10 +49,13 @@
 #include <stdio.h>
 #include <string.h>
 #include <pthread.h>
+#include <sched.h>
 #include "hashtable.h"
 #include "log.h"
 #include "abstract_atomic.h"
 #include "common_utils.h"
+#include "gsh_list.h"
+#include "gsh_intrinsic.h"
 #include <assert.h>
 
 /**
@@ -271,6 +277,644 @@ compute(struct hash_table *ht, const struct gsh_buffdesc *key,
 	return HASHTABLE_SUCCESS;
 }
 
+/* The following implement the HT_FLAG_RESIZE variant.
+ *
+ * Each partition keeps a power of 2 array of singly linked chains
+ * instead of a red-black tree.  The partition lock still serializes
+ * writers and latched lookups, but unlatched lookups (HashTable_Get)
+ * and hashtable_getref don't take it: they walk the chains inside an
+ * epoch read section.
+ *
+ * Writers never modify a node a reader may be looking at.  Entries
+ * are unlinked, or replaced by a copy on overwrite, and put on the
+ * retired list of the table with the epoch they were retired at.
+ * Nobody waits for readers: the writers that follow free the retired
+ * nodes once every read section that could have found them has
+ * ended, after releasing the partition lock.  The release_entry
+ * parameter is then called with the key and value of deleted and
+ * replaced entries, a table with lock free readers keeps what it
+ * stored alive until then, e.g. by holding a reference that
+ * release_entry drops.  get_ref must not block.  A table that decides
+ * to delete from the reference count under the latch
+ * (hashtable_delref) must not use this variant, the lock free get_ref
+ * could race with it.
+ *
+ * A partition grows by doubling its chain array once it holds more
+ * than HASH_CHAIN_LOAD entries per chain.  Once the readers that
+ * don't know about the old array have left, entries are copied to the
+ * new array HASH_MIGRATE_BATCH chains at a time by the following
+ * insertions.  Lookups search the old array before the new one: a
+ * chain is copied before it is cleared, so an entry is always found
+ * in one of them.
+ */
+
+#define HASH_CHAINS_MIN_BITS 4
+#define HASH_CHAIN_LOAD 2
+#define HASH_MIGRATE_BATCH 16
+
+/**
+ * @brief What a retired object is
+ */
+
+enum hash_retired_kind {
+	HASH_RETIRED_ENTRY, /*< Deleted or replaced entry */
+	HASH_RETIRED_MOVED, /*< Entry copied to the grown chains */
+	HASH_RETIRED_CHAINS /*< Chain array emptied by migration */
+};
+
+/**
+ * @brief Link of an object waiting for readers to leave
+ */
+
+struct hash_retired {
+	struct hash_retired *next; /*< Next retired object */
+	uint64_t epoch; /*< Epoch readers must have reached to free it */
+	enum hash_retired_kind kind; /*< What it is */
+};
+
+/**
+ * @brief An entry of a chained partition
+ */
+
+struct hash_chain_node {
+	struct hash_retired retired; /*< Retired list link */
+	struct hash_chain_node *next; /*< Next entry in the chain */
+	uint64_t rbt_hash; /*< Hash of the key */
+	struct hash_data data; /*< Key and value */
+};
+
+/**
+ * @brief The chains of a partition
+ */
+
+struct hash_chains {
+	struct hash_retired retired; /*< Retired list link */
+	uint32_t bits; /*< log2 of the number of chains */
+	struct hash_chain_node *heads[]; /*< Chain heads */
+};
+
+/**
+ * @brief Epoch read section state of a thread
+ *
+ * Records are never freed, the record of an exited thread is reused
+ * by the next thread needing one.
+ */
+
+struct hash_reader {
+	uint64_t epoch; /*< Epoch at section entry, 0 outside */
+	uint32_t depth; /*< Section nesting */
+	uint32_t in_use; /*< Owned by a live thread */
+	struct hash_reader *next; /*< Next record */
+} __attribute__ ((aligned(CACHE_LINE_SIZE)));
+
+static struct hash_reader *hash_readers;
+static uint64_t hash_epoch = 1;
+static __thread struct hash_reader *hash_reader_self;
+static pthread_key_t hash_reader_key;
+static pthread_once_t hash_reader_once = PTHREAD_ONCE_INIT;
+
+static void hash_reader_release(void *arg)
+{
+	struct hash_reader *reader = arg;
+
+	atomic_store_uint64_t(&reader->epoch, 0);
+	atomic_store_uint32_t(&reader->in_use, 0);
+}
+
+static void hash_reader_key_init(void)
+{
+	if (pthread_key_create(&hash_reader_key, hash_reader_release) != 0)
+		LogFatal(COMPONENT_HASHTABLE,
+			 "Unable to create hash reader key");
+}
+
+/**
+ * @brief Find or create the calling thread's reader record
+ *
+ * @return The record.
+ */
+
+static struct hash_reader *hash_reader_get(void)
+{
+	struct hash_reader *reader = hash_reader_self;
+	struct hash_reader *head;
+
+	if (likely(reader != NULL))
+		return reader;
+
+	(void)pthread_once(&hash_reader_once, hash_reader_key_init);
+
+	/* Reuse the record of an exited thread */
+	for (reader = atomic_fetch_voidptr((void **)&hash_readers);
+	     reader != NULL;
+	     reader = reader->next) {
+		if (atomic_cas_uint32_t(&reader->in_use, 0, 1))
+			break;
+	}
+
+	if (reader == NULL) {
+		reader = gsh_malloc_aligned(CACHE_LINE_SIZE, sizeof(*reader));
+		if (reader == NULL)
+			LogFatal(COMPONENT_HASHTABLE,
+				 "Unable to allocate hash reader");
+
+		memset(reader, 0, sizeof(*reader));
+		reader->in_use = 1;
+
+		do {
+			head = atomic_fetch_voidptr((void **)&hash_readers);
+			reader->next = head;
+		} while (!atomic_cas_voidptr((void **)&hash_readers, head,
+					     reader));
+	}
+
+	(void)pthread_setspecific(hash_reader_key, reader);
+	hash_reader_self = reader;
+
+	return reader;
+}
+
+static inline struct hash_reader *hash_read_lock(void)
+{
+	struct hash_reader *reader = hash_reader_get();
+
+	if (reader->depth++ == 0)
+		atomic_store_uint64_t(&reader->epoch,
+				      atomic_fetch_uint64_t(&hash_epoch));
+
+	return reader;
+}
+
+static inline void hash_read_unlock(struct hash_reader *reader)
+{
+	if (--reader->depth == 0)
+		atomic_store_uint64_t(&reader->epoch, 0);
+}
+
+/**
+ * @brief Epoch every running read section has reached
+ *
+ * Objects retired at or before the returned epoch can no longer be
+ * found by any reader.
+ *
+ * @return The epoch.
+ */
+
+static uint64_t hash_quiescent_epoch(void)
+{
+	uint64_t quiescent = atomic_fetch_uint64_t(&hash_epoch);
+	struct hash_reader *reader;
+	uint64_t epoch;
+
+	for (reader = atomic_fetch_voidptr((void **)&hash_readers);
+	     reader != NULL;
+	     reader = reader->next) {
+		epoch = atomic_fetch_uint64_t(&reader->epoch);
+		if (epoch != 0 && epoch < quiescent)
+			quiescent = epoch;
+	}
+
+	return quiescent;
+}
+
+/**
+ * @brief Wait for the read sections that might see unlinked nodes
+ *
+ * Every read section entered before the call has ended when this
+ * returns.  Only used to tear a table down, must not be called from
+ * a read section or with a partition locked.
+ */
+
+static void hash_synchronize(void)
+{
+	uint64_t target = atomic_inc_uint64_t(&hash_epoch);
+
+	while (hash_quiescent_epoch() < target)
+		sched_yield();
+}
+
+/**
+ * @brief Queue unlinked objects until readers have left them
+ *
+ * @param[in] ht    The hash table
+ * @param[in] first First of the objects, linked through next
+ * @param[in] last  Last of the objects
+ */
+
+static void hash_retire(struct hash_table *ht, struct hash_retired *first,
+			struct hash_retired *last)
+{
+	struct hash_retired *retired;
+	uint64_t epoch;
+
+	PTHREAD_MUTEX_lock(&ht->retired_lock);
+
+	/* Taken under the lock to keep the list in epoch order */
+	epoch = atomic_inc_uint64_t(&hash_epoch);
+	for (retired = first; retired != NULL; retired = retired->next)
+		retired->epoch = epoch;
+
+	/* ht->retired itself is peeked at without the lock */
+	atomic_store_voidptr((void **)ht->retired_tail, first);
+	ht->retired_tail = &last->next;
+
+	PTHREAD_MUTEX_unlock(&ht->retired_lock);
+}
+
+/**
+ * @brief Free the retired objects no reader can see any more
+ *
+ * Called without any partition lock held, since release_entry may
+ * call back into the table's owner.
+ *
+ * @param[in] ht The hash table
+ */
+
+static void hash_reclaim(struct hash_table *ht)
+{
+	struct hash_retired *list, *retired, *next;
+	struct hash_retired **link;
+	struct hash_chain_node *node;
+	uint64_t quiescent;
+
+	if (atomic_fetch_voidptr((void **)&ht->retired) == NULL)
+		return;
+
+	quiescent = hash_quiescent_epoch();
+
+	PTHREAD_MUTEX_lock(&ht->retired_lock);
+
+	list = ht->retired;
+	for (link = &list;
+	     *link != NULL && (*link)->epoch <= quiescent;
+	     link = &(*link)->next)
+		;
+
+	atomic_store_voidptr((void **)&ht->retired, *link);
+	if (*link == NULL)
+		ht->retired_tail = &ht->retired;
+	*link = NULL;
+
+	PTHREAD_MUTEX_unlock(&ht->retired_lock);
+
+	for (retired = list; retired != NULL; retired = next) {
+		next = retired->next;
+
+		switch (retired->kind) {
+		case HASH_RETIRED_ENTRY:
+			node = container_of(retired, struct hash_chain_node,
+					    retired);
+			if (ht->parameter.release_entry != NULL)
+				ht->parameter.release_entry(&node->data.key,
+							    &node->data.val);
+			gsh_free(node);
+			break;
+		case HASH_RETIRED_MOVED:
+			gsh_free(container_of(retired, struct hash_chain_node,
+					      retired));
+			break;
+		case HASH_RETIRED_CHAINS:
+			gsh_free(container_of(retired, struct hash_chains,
+					      retired));
+			break;
+		}
+	}
+}
+
+static struct hash_chains *chains_alloc(uint32_t bits)
+{
+	struct hash_chains *chains;
+
+	chains = gsh_calloc(1, sizeof(struct hash_chains) +
+			    (sizeof(struct hash_chain_node *) << bits));
+	if (chains != NULL)
+		chains->bits = bits;
+
+	return chains;
+}
+
+/**
+ * @brief Chain of a hash value
+ *
+ * The partition index is usually derived from the same hash, so mix
+ * it before taking the top bits.
+ */
+
+static inline struct hash_chain_node **
+chain_head(struct hash_chains *chains, uint64_t rbt_hash)
+{
+	return &chains->heads[(rbt_hash * 0x9e3779b97f4a7c15ULL) >>
+			      (64 - chains->bits)];
+}
+
+static struct hash_chain_node *
+chain_find(struct hash_table *ht, struct hash_chains *chains,
+	   const struct gsh_buffdesc *key, uint64_t rbt_hash)
+{
+	struct hash_chain_node *node;
+
+	if (chains == NULL)
+		return NULL;
+
+	for (node = atomic_fetch_voidptr((void **)chain_head(chains,
+							     rbt_hash));
+	     node != NULL;
+	     node = atomic_fetch_voidptr((void **)&node->next)) {
+		if (node->rbt_hash == rbt_hash &&
+		    ht->parameter.compare_key((struct gsh_buffdesc *)key,
+					      &node->data.key) == 0)
+			return node;
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Locate a key in a chained partition
+ *
+ * Called with the partition locked or in a read section.
+ *
+ * @param[in] ht        The hash table
+ * @param[in] partition The partition
+ * @param[in] key       The key
+ * @param[in] rbt_hash  Hash of the key
+ *
+ * @return The entry or NULL.
+ */
+
+static struct hash_chain_node *
+chains_locate(struct hash_table *ht, struct hash_partition *partition,
+	      const struct gsh_buffdesc *key, uint64_t rbt_hash)
+{
+	struct hash_chains *chains;
+	struct hash_chains *old_chains;
+	struct hash_chain_node *node;
+
+	chains = atomic_fetch_voidptr((void **)&partition->chains);
+	old_chains = atomic_fetch_voidptr((void **)&partition->old_chains);
+
+	node = chain_find(ht, old_chains, key, rbt_hash);
+	if (node == NULL)
+		node = chain_find(ht, chains, key, rbt_hash);
+
+	return node;
+}
+
+/**
+ * @brief Unlink or replace an entry
+ *
+ * Called with the partition write locked.  The entry must then be
+ * retired, not freed.
+ *
+ * @param[in] partition The partition
+ * @param[in] node      The entry to unlink
+ * @param[in] repl      Replacement entry or NULL
+ */
+
+static void chains_unlink(struct hash_partition *partition,
+			  struct hash_chain_node *node,
+			  struct hash_chain_node *repl)
+{
+	struct hash_chains *lists[] = {partition->old_chains,
+				       partition->chains};
+	struct hash_chain_node **link;
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		if (lists[i] == NULL)
+			continue;
+
+		for (link = chain_head(lists[i], node->rbt_hash);
+		     *link != NULL;
+		     link = &(*link)->next) {
+			if (*link != node)
+				continue;
+
+			if (repl != NULL) {
+				repl->next = node->next;
+				atomic_store_voidptr((void **)link, repl);
+			} else {
+				atomic_store_voidptr((void **)link,
+						     node->next);
+			}
+			return;
+		}
+	}
+
+	assert(0);
+}
+
+/**
+ * @brief Grow a partition, or move a batch of chains once grown
+ *
+ * Called with the partition write locked after an insertion.  Nothing
+ * is moved until the readers that started before the growth, and so
+ * only search the old chains, have left.  The entries moved and the
+ * old chains once emptied are retired.
+ *
+ * @param[in] ht        The hash table
+ * @param[in] partition The partition
+ */
+
+static void chains_maintain(struct hash_table *ht,
+			    struct hash_partition *partition)
+{
+	struct hash_chains *old_chains = partition->old_chains;
+	struct hash_chains *grown;
+	struct hash_chain_node *node, *copy, *copies, *next;
+	struct hash_chain_node **head;
+	struct hash_retired *moved = NULL;
+	struct hash_retired **moved_tail = &moved;
+	struct hash_retired *last = NULL;
+	uint32_t end;
+
+	if (old_chains == NULL) {
+		if (partition->count <=
+		    ((size_t) HASH_CHAIN_LOAD << partition->chains->bits))
+			return;
+
+		grown = chains_alloc(partition->chains->bits + 1);
+		if (grown == NULL)
+			return;	/* Retry on next insert */
+
+		atomic_store_voidptr((void **)&partition->old_chains,
+				     partition->chains);
+		atomic_store_voidptr((void **)&partition->chains, grown);
+		partition->migrated = 0;
+		partition->grow_epoch = atomic_inc_uint64_t(&hash_epoch);
+		return;
+	}
+
+	if (hash_quiescent_epoch() < partition->grow_epoch)
+		return;	/* Retry on next insert */
+
+	end = partition->migrated + HASH_MIGRATE_BATCH;
+	if (end > (1U << old_chains->bits))
+		end = 1U << old_chains->bits;
+
+	for (; partition->migrated < end; partition->migrated++) {
+		head = &old_chains->heads[partition->migrated];
+		if (*head == NULL)
+			continue;
+
+		/* Copy the chain first, so a failure leaves it alone */
+		copies = NULL;
+		for (node = *head; node != NULL; node = node->next) {
+			copy = gsh_malloc(sizeof(*copy));
+			if (copy == NULL)
+				break;
+			copy->rbt_hash = node->rbt_hash;
+			copy->data = node->data;
+			copy->next = copies;
+			copies = copy;
+		}
+
+		if (node != NULL) {
+			while (copies != NULL) {
+				next = copies->next;
+				gsh_free(copies);
+				copies = next;
+			}
+			break;	/* Retry on next insert */
+		}
+
+		while (copies != NULL) {
+			next = copies->next;
+			copy = copies;
+			copy->next = *chain_head(partition->chains,
+						 copy->rbt_hash);
+			atomic_store_voidptr((void **)
+					     chain_head(partition->chains,
+							copy->rbt_hash),
+					     copy);
+			copies = next;
+		}
+
+		/* Readers may still walk the chain, only link the
+		 * retired list.
+		 */
+		for (node = *head; node != NULL; node = node->next) {
+			node->retired.kind = HASH_RETIRED_MOVED;
+			node->retired.next = NULL;
+			*moved_tail = &node->retired;
+			moved_tail = &node->retired.next;
+			last = &node->retired;
+		}
+		atomic_store_voidptr((void **)head, NULL);
+	}
+
+	if (partition->migrated == (1U << old_chains->bits)) {
+		atomic_store_voidptr((void **)&partition->old_chains, NULL);
+		old_chains->retired.kind = HASH_RETIRED_CHAINS;
+		old_chains->retired.next = NULL;
+		*moved_tail = &old_chains->retired;
+		last = &old_chains->retired;
+	}
+
+	if (moved != NULL)
+		hash_retire(ht, moved, last);
+}
+
+/**
+ * @brief Remove and free all entries of a chained partition
+ *
+ * The chains are emptied under the partition lock, their entries are
+ * freed once readers have left them, without the lock.  On failure,
+ * the entries not freed yet are put back in the table.
+ *
+ * @param[in] ht        The hash table
+ * @param[in] partition The partition
+ * @param[in] free_func The function with which to free the contents
+ *                      of each entry
+ *
+ * @return HASHTABLE_SUCCESS or HASHTABLE_ERROR_DELALL_FAIL.
+ */
+
+static hash_error_t
+chains_delall(struct hash_table *ht, struct hash_partition *partition,
+	      int (*free_func)(struct gsh_buffdesc, struct gsh_buffdesc))
+{
+	struct hash_chains *lists[2];
+	struct hash_retired *detached = NULL;
+	struct hash_chain_node *node, *next;
+	struct hash_chain_node **head;
+	struct gsh_buffdesc key, val;
+	uint32_t i;
+	int l;
+
+	PTHREAD_RWLOCK_wrlock(&partition->lock);
+
+	lists[0] = partition->old_chains;
+	lists[1] = partition->chains;
+
+	/* The first entry of each chain links the detached chains */
+	for (l = 0; l < 2; l++) {
+		if (lists[l] == NULL)
+			continue;
+
+		for (i = 0; i < (1U << lists[l]->bits); i++) {
+			head = &lists[l]->heads[i];
+			node = *head;
+			if (node == NULL)
+				continue;
+
+			atomic_store_voidptr((void **)head, NULL);
+			node->retired.next = detached;
+			detached = &node->retired;
+		}
+	}
+
+	partition->count = 0;
+	PTHREAD_RWLOCK_unlock(&partition->lock);
+
+	if (detached == NULL)
+		return HASHTABLE_SUCCESS;
+
+	hash_synchronize();
+
+	while (detached != NULL) {
+		node = container_of(detached, struct hash_chain_node, retired);
+		detached = detached->next;
+
+		while (node != NULL) {
+			next = node->next;
+			key = node->data.key;
+			val = node->data.val;
+			gsh_free(node);
+
+			if (free_func(key, val) == 0)
+				goto fail;
+			node = next;
+		}
+	}
+
+	return HASHTABLE_SUCCESS;
+
+ fail:
+	/* Leave the rest in the table */
+	PTHREAD_RWLOCK_wrlock(&partition->lock);
+
+	for (;;) {
+		for (; next != NULL; next = node) {
+			node = next->next;
+			head = chain_head(partition->chains, next->rbt_hash);
+			next->next = *head;
+			atomic_store_voidptr((void **)head, next);
+			++partition->count;
+		}
+
+		if (detached == NULL)
+			break;
+
+		next = container_of(detached, struct hash_chain_node, retired);
+		detached = detached->next;
+	}
+
+	PTHREAD_RWLOCK_unlock(&partition->lock);
+
+	return HASHTABLE_ERROR_DELALL_FAIL;
+}
+
 /* The following are the hash table primitives implementing the
    actual functionality. */
 
@@ -331,6 +975,8 @@ hashtable_init(struct hash_param *hparam)
 
 	/* We need to save copy of the parameters in the table. */
 	ht->parameter = *hparam;
+	PTHREAD_MUTEX_init(&ht->retired_lock, NULL);
+	ht->retired_tail = &ht->retired;
 	for (index = 0; index < hparam->index_size; ++index) {
 		partition = (&ht->partitions[index]);
 		RBT_HEAD_INIT(&(partition->rbt));
@@ -341,8 +987,15 @@ hashtable_init(struct hash_param *hparam)
 			goto deconstruct;
 		}
 
-		/* Allocate a cache if requested */
-		if (hparam->flags & HT_FLAG_CACHE) {
+		if (hparam->flags & HT_FLAG_RESIZE) {
+			partition->chains =
+			    chains_alloc(HASH_CHAINS_MIN_BITS);
+			if (!(partition->chains)) {
+				PTHREAD_RWLOCK_destroy(&partition->lock);
+				goto deconstruct;
+			}
+		} else if (hparam->flags & HT_FLAG_CACHE) {
+			/* Allocate a cache if requested */
 			partition->cache = gsh_calloc(1, cache_page_size(ht));
 			if (!(partition->cache)) {
 				PTHREAD_RWLOCK_destroy(&partition->lock);
@@ -370,12 +1023,14 @@ hashtable_init(struct hash_param *hparam)
  deconstruct:
 
 	while (completed != 0) {
-		if (hparam->flags & HT_FLAG_CACHE)
-			gsh_free(ht->partitions[completed - 1].cache);
+		gsh_free(ht->partitions[completed - 1].cache);
+		gsh_free(ht->partitions[completed - 1].chains);
 
 		PTHREAD_RWLOCK_destroy(&(ht->partitions[completed - 1].lock));
 		completed--;
 	}
+	if (ht != NULL)
+		PTHREAD_MUTEX_destroy(&ht->retired_lock);
 	if (ht->node_pool)
 		pool_destroy(ht->node_pool);
 	if (ht->data_pool)
@@ -411,14 +1066,23 @@ hashtable_destroy(struct hash_table *ht,
 	if (hrc != HASHTABLE_SUCCESS)
 		goto out;
 
+	if (ht->parameter.flags & HT_FLAG_RESIZE) {
+		hash_synchronize();
+		hash_reclaim(ht);
+	}
+
 	for (index = 0; index < ht->parameter.index_size; ++index) {
 		if (ht->partitions[index].cache) {
 			gsh_free(ht->partitions[index].cache);
 			ht->partitions[index].cache = NULL;
 		}
 
+		gsh_free(ht->partitions[index].chains);
+		gsh_free(ht->partitions[index].old_chains);
+
 		PTHREAD_RWLOCK_destroy(&(ht->partitions[index].lock));
 	}
+	PTHREAD_MUTEX_destroy(&ht->retired_lock);
 	pool_destroy(ht->node_pool);
 	pool_destroy(ht->data_pool);
 	gsh_free(ht);
@@ -459,8 +1123,12 @@ hashtable_getlatch(struct hash_table *ht,
 	uint32_t index = 0;
 	/* The node found for the key */
 	struct rbt_node *locator = NULL;
+	/* The entry found for the key (HT_FLAG_RESIZE) */
+	struct hash_chain_node *chain_node = NULL;
 	/* The buffer descritpros for the key and value for the found entry */
 	struct hash_data *data = NULL;
+	/* Read section for an unlatched lookup */
+	struct hash_reader *reader;
 	/* The hash value to be searched for within the Red-Black tree */
 	uint64_t rbt_hash = 0;
 	/* Stored error return */
@@ -473,17 +1141,40 @@ hashtable_getlatch(struct hash_table *ht,
 	if (rc != HASHTABLE_SUCCESS)
 		return rc;
 
+	if ((ht->parameter.flags & HT_FLAG_RESIZE) && latch == NULL) {
+		/* Nothing to latch, don't lock */
+		reader = hash_read_lock();
+		chain_node = chains_locate(ht, &ht->partitions[index], key,
+					   rbt_hash);
+		if (chain_node == NULL)
+			rc = HASHTABLE_ERROR_NO_SUCH_KEY;
+		else if (val)
+			*val = chain_node->data.val;
+		hash_read_unlock(reader);
+		return rc;
+	}
+
 	/* Acquire mutex */
 	if (may_write)
 		PTHREAD_RWLOCK_wrlock(&(ht->partitions[index].lock));
 	else
 		PTHREAD_RWLOCK_rdlock(&(ht->partitions[index].lock));
 
-	rc = key_locate(ht, key, index, rbt_hash, &locator);
+	if (ht->parameter.flags & HT_FLAG_RESIZE) {
+		chain_node = chains_locate(ht, &ht->partitions[index], key,
+					   rbt_hash);
+		if (chain_node == NULL)
+			rc = HASHTABLE_ERROR_NO_SUCH_KEY;
+		else
+			data = &chain_node->data;
+	} else {
+		rc = key_locate(ht, key, index, rbt_hash, &locator);
+		if (rc == HASHTABLE_SUCCESS)
+			data = RBT_OPAQ(locator);
+	}
 
 	if (rc == HASHTABLE_SUCCESS) {
 		/* Key was found */
-		data = RBT_OPAQ(locator);
 		if (val) {
 			val->addr = data->val.addr;
 			val->len = data->val.len;
@@ -510,6 +1201,7 @@ hashtable_getlatch(struct hash_table *ht,
 		latch->index = index;
 		latch->rbt_hash = rbt_hash;
 		latch->locator = locator;
+		latch->chain_node = chain_node;
 	} else {
 		PTHREAD_RWLOCK_unlock(&ht->partitions[index].lock);
 	}
@@ -589,6 +1281,9 @@ hashtable_setlatched(struct hash_table *ht,
 	struct rbt_node *locator = NULL;
 	/* New node for the case of non-overwrite */
 	struct rbt_node *mutator = NULL;
+	/* New and replaced entries (HT_FLAG_RESIZE) */
+	struct hash_chain_node *chain_node = NULL;
+	struct hash_chain_node *retired = NULL;
 
 	if (isDebug(COMPONENT_HASHTABLE)
 	    && isFullDebug(ht->parameter.ht_log_component)) {
@@ -613,13 +1308,16 @@ hashtable_setlatched(struct hash_table *ht,
 	}
 
 	/* In the case of collision */
-	if (latch->locator) {
+	if (latch->locator || latch->chain_node) {
 		if (!overwrite) {
 			rc = HASHTABLE_ERROR_KEY_ALREADY_EXISTS;
 			goto out;
 		}
 
-		descriptors = RBT_OPAQ(latch->locator);
+		if (latch->chain_node)
+			descriptors = &latch->chain_node->data;
+		else
+			descriptors = RBT_OPAQ(latch->locator);
 
 		if (isDebug(COMPONENT_HASHTABLE)
 		    && isFullDebug(ht->parameter.ht_log_component)) {
@@ -653,6 +1351,23 @@ hashtable_setlatched(struct hash_table *ht,
 		if (stored_val)
 			*stored_val = descriptors->val;
 
+		if (latch->chain_node) {
+			/* Readers may be looking at it, replace it */
+			chain_node = gsh_malloc(sizeof(*chain_node));
+			if (chain_node == NULL) {
+				rc = HASHTABLE_INSERT_MALLOC_ERROR;
+				goto out;
+			}
+			chain_node->rbt_hash = latch->rbt_hash;
+			chain_node->data.key = *key;
+			chain_node->data.val = *val;
+			retired = latch->chain_node;
+			chains_unlink(&ht->partitions[latch->index], retired,
+				      chain_node);
+			rc = HASHTABLE_OVERWRITTEN;
+			goto out;
+		}
+
 		descriptors->key = *key;
 		descriptors->val = *val;
 		rc = HASHTABLE_OVERWRITTEN;
@@ -662,6 +1377,30 @@ hashtable_setlatched(struct hash_table *ht,
 	/* We have no collision, so go about creating and inserting a new
 	   node. */
 
+	if (ht->parameter.flags & HT_FLAG_RESIZE) {
+		struct hash_partition *partition =
+		    &ht->partitions[latch->index];
+		struct hash_chain_node **head;
+
+		chain_node = gsh_malloc(sizeof(*chain_node));
+		if (chain_node == NULL) {
+			rc = HASHTABLE_INSERT_MALLOC_ERROR;
+			goto out;
+		}
+		chain_node->rbt_hash = latch->rbt_hash;
+		chain_node->data.key = *key;
+		chain_node->data.val = *val;
+
+		head = chain_head(partition->chains, latch->rbt_hash);
+		chain_node->next = *head;
+		atomic_store_voidptr((void **)head, chain_node);
+		++partition->count;
+
+		chains_maintain(ht, partition);
+		rc = HASHTABLE_SUCCESS;
+		goto out;
+	}
+
 	RBT_FIND(&ht->partitions[latch->index].rbt, locator, latch->rbt_hash);
 
 	mutator = pool_alloc(ht->node_pool, NULL);
@@ -693,8 +1432,17 @@ hashtable_setlatched(struct hash_table *ht,
 	rc = HASHTABLE_SUCCESS;
 
  out:
+	if (retired != NULL) {
+		retired->retired.kind = HASH_RETIRED_ENTRY;
+		retired->retired.next = NULL;
+		hash_retire(ht, &retired->retired, &retired->retired);
+	}
+
 	hashtable_releaselatched(ht, latch);
 
+	if (ht->parameter.flags & HT_FLAG_RESIZE)
+		hash_reclaim(ht);
+
 	if (rc != HASHTABLE_SUCCESS && isDebug(COMPONENT_HASHTABLE)
 	    && isFullDebug(ht->parameter.ht_log_component))
 		LogFullDebug(ht->parameter.ht_log_component,
@@ -736,13 +1484,18 @@ hashtable_deletelatched(struct hash_table *ht,
 	struct hash_data *data = NULL;
 	/* Its partition */
 	struct hash_partition *partition = &ht->partitions[latch->index];
+	/* The entry to remove (HT_FLAG_RESIZE) */
+	struct hash_chain_node *chain_node = latch->chain_node;
 
-	if (!latch->locator) {
+	if (!latch->locator && !chain_node) {
 		hashtable_releaselatched(ht, latch);
 		return HASHTABLE_SUCCESS;
 	}
 
-	data = RBT_OPAQ(latch->locator);
+	if (chain_node)
+		data = &chain_node->data;
+	else
+		data = RBT_OPAQ(latch->locator);
 
 	if (isDebug(COMPONENT_HASHTABLE)
 	    && isFullDebug(ht->parameter.ht_log_component)) {
@@ -773,6 +1526,20 @@ hashtable_deletelatched(struct hash_table *ht,
 	if (stored_val)
 		*stored_val = data->val;
 
+	if (chain_node) {
+		chains_unlink(partition, chain_node, NULL);
+		--partition->count;
+
+		/* Lock free readers may still see the entry */
+		chain_node->retired.kind = HASH_RETIRED_ENTRY;
+		chain_node->retired.next = NULL;
+		hash_retire(ht, &chain_node->retired, &chain_node->retired);
+
+		hashtable_releaselatched(ht, latch);
+		hash_reclaim(ht);
+		return HASHTABLE_SUCCESS;
+	}
+
 	/* Clear cache */
 	if (partition->cache) {
 		uint32_t offset = cache_offsetof(ht, latch->rbt_hash);
@@ -833,6 +1600,16 @@ hashtable_delall(struct hash_table *ht,
 		/* Pointer to node in tree for removal */
 		struct rbt_node *cursor = NULL;
 
+		if (ht->parameter.flags & HT_FLAG_RESIZE) {
+			hash_error_t hrc;
+
+			hrc = chains_delall(ht, &ht->partitions[index],
+					    free_func);
+			if (hrc != HASHTABLE_SUCCESS)
+				return hrc;
+			continue;
+		}
+
 		PTHREAD_RWLOCK_wrlock(&ht->partitions[index].lock);
 
 		/* Continue until there are no more entries in the red-black
@@ -875,6 +1652,60 @@ hashtable_delall(struct hash_table *ht,
 	return HASHTABLE_SUCCESS;
 }
 
+/**
+ * @brief Log the entries of a chained hash table
+ *
+ * @param[in] component The component debugging config to use.
+ * @param[in] ht        The hashtable to be used.
+ */
+
+static void
+chains_log(log_components_t component, struct hash_table *ht)
+{
+	struct hash_partition *partition;
+	struct hash_chains *lists[2];
+	struct hash_chain_node *node;
+	char dispkey[HASHTABLE_DISPLAY_STRLEN];
+	char dispval[HASHTABLE_DISPLAY_STRLEN];
+	uint32_t i, c;
+	int l;
+
+	for (i = 0; i < ht->parameter.index_size; i++) {
+		partition = &ht->partitions[i];
+
+		PTHREAD_RWLOCK_rdlock(&partition->lock);
+
+		lists[0] = partition->old_chains;
+		lists[1] = partition->chains;
+		LogFullDebug(component,
+			     "The partition in position %" PRIu32
+			     " contains: %zu entries in %u chains%s", i,
+			     partition->count, 1U << lists[1]->bits,
+			     lists[0] != NULL ? " (growing)" : "");
+
+		for (l = 0; l < 2; l++) {
+			if (lists[l] == NULL)
+				continue;
+			for (c = 0; c < (1U << lists[l]->bits); c++) {
+				for (node = lists[l]->heads[c]; node != NULL;
+				     node = node->next) {
+					ht->parameter.key_to_str(
+						&node->data.key, dispkey);
+					ht->parameter.val_to_str(
+						&node->data.val, dispval);
+					LogFullDebug(component,
+						     "%s => %s; index=%" PRIu32
+						     " rbt_hash=%" PRIu64,
+						     dispkey, dispval, i,
+						     node->rbt_hash);
+				}
+			}
+		}
+
+		PTHREAD_RWLOCK_unlock(&partition->lock);
+	}
+}
+
 /**
  * @brief Log information about the hashtable
  *
@@ -907,6 +1738,11 @@ hashtable_log(log_components_t component, struct hash_table *ht)
 	/* Recomputed hash for Red-Black tree */
 	uint64_t rbt_hash = 0;
 
+	if (ht->parameter.flags & HT_FLAG_RESIZE) {
+		chains_log(component, ht);
+		return;
+	}
+
 	LogFullDebug(component, "The hash is partitioned into %d trees",
 		     ht->parameter.index_size);
 
@@ -1010,6 +1846,9 @@ hashtable_test_and_set(struct hash_table *ht,
  * a reference before releasing the partition lock.  It is implemented
  * as a wrapper around hashtable_getlatched.
  *
+ * For HT_FLAG_RESIZE tables, the lookup and get_ref are done in a
+ * read section, without locking.
+ *
  * @param[in]  ht      The hash store to be searched
  * @param[in]  key     A buffer descriptore locating the key to find
  * @param[out] val     A buffer descriptor locating the value found
@@ -1028,6 +1867,31 @@ hashtable_getref(hash_table_t *ht, struct gsh_buffdesc *key,
 	/* Stored return code */
 	hash_error_t rc = 0;
 
+	if (ht->parameter.flags & HT_FLAG_RESIZE) {
+		struct hash_chain_node *chain_node;
+		struct hash_reader *reader;
+		uint32_t index;
+		uint64_t rbt_hash;
+
+		rc = compute(ht, key, &index, &rbt_hash);
+		if (rc != HASHTABLE_SUCCESS)
+			return rc;
+
+		reader = hash_read_lock();
+		chain_node = chains_locate(ht, &ht->partitions[index], key,
+					   rbt_hash);
+		if (chain_node != NULL) {
+			*val = chain_node->data.val;
+			if (get_ref != NULL)
+				get_ref(val);
+		} else {
+			rc = HASHTABLE_ERROR_NO_SUCH_KEY;
+		}
+		hash_read_unlock(reader);
+
+		return rc;
+	}
+
 	rc = hashtable_getlatch(ht, key, val, false, &latch);
 
 	switch (rc) {
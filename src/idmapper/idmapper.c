@@ -52,10 +52,33 @@
 #include "common_utils.h"
 #include "gsh_rpc.h"
 #include "nfs_core.h"
+#include "fridgethr.h"
 #include "idmapper.h"
 
 static struct gsh_buffdesc owner_domain;
 
+/**
+ * @brief Threads refreshing expired cache entries
+ *
+ * Entries are used past their expiry while they are refreshed, so a
+ * slow directory service only ever delays the first lookup of a name
+ * or ID.
+ */
+
+#define IDMAPPER_REFRESH_THREADS 4
+
+static struct fridgethr *refresh_fridge;
+
+/**
+ * @brief Cache entry to look up again
+ */
+
+struct idmapper_refresh {
+	bool group;		/*< Group or user */
+	uint32_t id;		/*< ID to look up, if no name */
+	struct gsh_buffdesc name;	/*< Name to look up, if any */
+};
+
 /**
  * @brief Initialize the ID Mapper
  *
@@ -64,6 +87,9 @@ static struct gsh_buffdesc owner_domain;
 
 bool idmapper_init(void)
 {
+	struct fridgethr_params frp;
+	int rc;
+
 #ifdef USE_NFSIDMAP
 	if (!nfs_param.nfsv4_param.use_getpwnam) {
 		if (nfs4_init_name_mapping(nfs_param.nfsv4_param.idmapconf)
@@ -92,9 +118,186 @@ bool idmapper_init(void)
 	}
 
 	idmapper_cache_init();
+
+	memset(&frp, 0, sizeof(struct fridgethr_params));
+	frp.thr_max = IDMAPPER_REFRESH_THREADS;
+	frp.thr_min = 1;
+	frp.flavor = fridgethr_flavor_worker;
+	/* Refreshes left out are asked for again later */
+	frp.deferment = fridgethr_defer_fail;
+
+	rc = fridgethr_init(&refresh_fridge, "Idmapper", &frp);
+	if (rc != 0) {
+		LogMajor(COMPONENT_IDMAPPER,
+			 "Unable to initialize refresh threads: %d", rc);
+		refresh_fridge = NULL;
+		return false;
+	}
+
 	return true;
 }
 
+/**
+ * @brief Stop the refresh threads
+ *
+ * @return 0 or errors from the fridge.
+ */
+
+int idmapper_shutdown(void)
+{
+	return fridgethr_shutdown(refresh_fridge);
+}
+
+/**
+ * @brief Add an entry to the user or group cache
+ *
+ * @param[in] group True for the group cache
+ * @param[in] name  The name
+ * @param[in] id    The UID or GID
+ * @param[in] gid   Optional GID of a user
+ * @param[in] flags IDMAP_NAME, IDMAP_ID and IDMAP_NEGATIVE
+ */
+
+static void idmapper_cache_add(bool group, const struct gsh_buffdesc *name,
+			       uint32_t id, const gid_t *gid, uint32_t flags)
+{
+	bool success;
+
+	idmapper_wrlock(group);
+	if (group)
+		success = idmapper_add_group(name, id, flags);
+	else
+		success = idmapper_add_user(name, id, gid, flags);
+	idmapper_wrunlock(group);
+
+	if (unlikely(!success)) {
+		LogMajor(COMPONENT_IDMAPPER, "%s(%.*s %u) failed",
+			 (group ? "idmapper_add_group" : "idmapper_add_user"),
+			 (int)name->len, (char *)name->addr, id);
+	}
+}
+
+/**
+ * @brief Size of the buffer for id2name
+ *
+ * @param[in] group True if this is a GID, false for a UID
+ */
+
+static size_t id2name_size(bool group)
+{
+	long size;
+
+	if (!nfs_param.nfsv4_param.use_getpwnam)
+		return NFS4_MAX_DOMAIN_LEN + 2;
+
+	if (group)
+		size = sysconf(_SC_GETGR_R_SIZE_MAX);
+	else
+		size = sysconf(_SC_GETPW_R_SIZE_MAX);
+	if (size == -1)
+		size = PWENT_BEST_GUESS_LEN;
+
+	return size + owner_domain.len + 2;
+}
+
+/**
+ * @brief Look up the name of a UID or GID
+ *
+ * When the lookup fails, the name is the one to reply with instead:
+ * the number or nobody.
+ *
+ * @param[in]     id       UID or GID
+ * @param[in]     group    True if this is a GID, false for a UID
+ * @param[in,out] new_name In, a buffer of id2name_size bytes.  Out,
+ *                         the name.
+ *
+ * @retval true if the ID was found.
+ * @retval false if the name is a stand-in.
+ */
+
+static bool id2name(uint32_t id, bool group, struct gsh_buffdesc *new_name)
+{
+	char *namebuff = new_name->addr;
+	bool looked_up = false;
+	int rc;
+
+	if (nfs_param.nfsv4_param.use_getpwnam) {
+		size_t size = new_name->len - owner_domain.len - 2;
+		char *cursor;
+		bool nulled;
+
+		if (group) {
+			struct group g;
+			struct group *gres;
+
+			rc = getgrgid_r(id, &g, namebuff, size, &gres);
+			nulled = (gres == NULL);
+		} else {
+			struct passwd p;
+			struct passwd *pres;
+
+			rc = getpwuid_r(id, &p, namebuff, size, &pres);
+			nulled = (pres == NULL);
+		}
+
+		if ((rc == 0) && !nulled) {
+			new_name->len = strlen(namebuff);
+			cursor = namebuff + new_name->len;
+			*(cursor++) = '@';
+			++new_name->len;
+			memcpy(cursor, owner_domain.addr, owner_domain.len);
+			new_name->len += owner_domain.len;
+			looked_up = true;
+		} else {
+			LogInfo(COMPONENT_IDMAPPER,
+				"%s failed with code %d.",
+				(group ? "getgrgid_r" : "getpwuid_r"), rc);
+		}
+	} else {
+#ifdef USE_NFSIDMAP
+		if (group) {
+			rc = nfs4_gid_to_name(id, owner_domain.addr, namebuff,
+					      NFS4_MAX_DOMAIN_LEN + 1);
+		} else {
+			rc = nfs4_uid_to_name(id, owner_domain.addr, namebuff,
+					      NFS4_MAX_DOMAIN_LEN + 1);
+		}
+		if (rc == 0) {
+			new_name->len = strlen(namebuff);
+			looked_up = true;
+		} else {
+			LogInfo(COMPONENT_IDMAPPER,
+				"%s failed with code %d.",
+				(group ? "nfs4_gid_to_name" :
+				"nfs4_uid_to_name"), rc);
+		}
+#else				/* USE_NFSIDMAP */
+		looked_up = false;
+#endif				/* !USE_NFSIDMAP */
+	}
+
+	if (!looked_up) {
+		if (nfs_param.nfsv4_param.allow_numeric_owners) {
+			LogInfo(COMPONENT_IDMAPPER,
+				"Lookup for %d failed, using numeric %s", id,
+				(group ? "group" : "owner"));
+			/* 2**32 is 10 digits long in decimal */
+			sprintf(namebuff, "%u", id);
+			new_name->len = strlen(namebuff);
+		} else {
+			LogInfo(COMPONENT_IDMAPPER,
+				"Lookup for %d failed, using nobody.", id);
+			memcpy(namebuff, "nobody", 6);
+			new_name->len = 6;
+		}
+	}
+
+	return looked_up;
+}
+
+static void idmapper_refresh(bool group, const struct gsh_buffdesc *name,
+			     uint32_t id);
+
 /**
  * @brief Encode a UID or GID as a string
  *
@@ -110,16 +313,18 @@ static bool xdr_encode_nfs4_princ(XDR *xdrs, uint32_t id, bool group)
 {
 	const struct gsh_buffdesc *found;
 	uint32_t not_a_size_t;
+	uint32_t status;
 	bool success = false;
+	bool looked_up;
+	struct gsh_buffdesc new_name;
 
-	PTHREAD_RWLOCK_rdlock(group ? &idmapper_group_lock :
-			      &idmapper_user_lock);
+	idmapper_rdlock(group);
 	if (group)
-		success = idmapper_lookup_by_gid(id, &found);
+		status = idmapper_lookup_by_gid(id, &found);
 	else
-		success = idmapper_lookup_by_uid(id, &found, NULL);
+		status = idmapper_lookup_by_uid(id, &found, NULL);
 
-	if (likely(success)) {
+	if (likely(status & IDMAP_FOUND)) {
 		not_a_size_t = found->len;
 
 		/* Fully qualified owners are always stored in the
@@ -127,132 +332,29 @@ static bool xdr_encode_nfs4_princ(XDR *xdrs, uint32_t id, bool group)
 		success =
 		    inline_xdr_bytes(xdrs, (char **)&found->addr, &not_a_size_t,
 				     UINT32_MAX);
-		PTHREAD_RWLOCK_unlock(group ? &idmapper_group_lock :
-				      &idmapper_user_lock);
-		return success;
-	} else {
-		PTHREAD_RWLOCK_unlock(group ? &idmapper_group_lock :
-				      &idmapper_user_lock);
-		int rc;
-		int size;
-		bool looked_up = false;
-		char *namebuff = NULL;
-		struct gsh_buffdesc new_name;
-
-		if (nfs_param.nfsv4_param.use_getpwnam) {
-			if (group)
-				size = sysconf(_SC_GETGR_R_SIZE_MAX);
-			else
-				size = sysconf(_SC_GETPW_R_SIZE_MAX);
-			if (size == -1)
-				size = PWENT_BEST_GUESS_LEN;
-			new_name.len = size;
-			size += owner_domain.len + 2;
-		} else {
-			size = NFS4_MAX_DOMAIN_LEN + 2;
-		}
-
-		namebuff = alloca(size);
+		idmapper_rdunlock(group);
 
-		new_name.addr = namebuff;
+		if (unlikely(status & IDMAP_STALE))
+			idmapper_refresh(group, NULL, id);
+		return success;
+	}
 
-		if (nfs_param.nfsv4_param.use_getpwnam) {
-			char *cursor;
-			bool nulled;
+	idmapper_rdunlock(group);
 
-			if (group) {
-				struct group g;
-				struct group *gres;
+	new_name.len = id2name_size(group);
+	new_name.addr = alloca(new_name.len);
 
-				rc = getgrgid_r(id, &g, namebuff, new_name.len,
-						&gres);
-				nulled = (gres == NULL);
-			} else {
-				struct passwd p;
-				struct passwd *pres;
+	looked_up = id2name(id, group, &new_name);
 
-				rc = getpwuid_r(id, &p, namebuff, new_name.len,
-						&pres);
-				nulled = (pres == NULL);
-			}
+	/* Add to the cache and encode the result.  A stand-in name
+	   does not map back to the ID. */
+	idmapper_cache_add(group, &new_name, id, NULL,
+			   looked_up ? IDMAP_NAME | IDMAP_ID :
+			   IDMAP_ID | IDMAP_NEGATIVE);
 
-			if ((rc == 0) && !nulled) {
-				new_name.len = strlen(namebuff);
-				cursor = namebuff + new_name.len;
-				*(cursor++) = '@';
-				++new_name.len;
-				memcpy(cursor, owner_domain.addr,
-				       owner_domain.len);
-				new_name.len += owner_domain.len;
-				looked_up = true;
-			} else {
-				LogInfo(COMPONENT_IDMAPPER,
-					"%s failed with code %d.",
-					(group ? "getgrgid_r" : "getpwuid_r"),
-					rc);
-			}
-		} else {
-#ifdef USE_NFSIDMAP
-			if (group) {
-				rc = nfs4_gid_to_name(id, owner_domain.addr,
-						      namebuff,
-						      NFS4_MAX_DOMAIN_LEN + 1);
-			} else {
-				rc = nfs4_uid_to_name(id, owner_domain.addr,
-						      namebuff,
-						      NFS4_MAX_DOMAIN_LEN + 1);
-			}
-			if (rc == 0) {
-				new_name.len = strlen(namebuff);
-				looked_up = true;
-			} else {
-				LogInfo(COMPONENT_IDMAPPER,
-					"%s failed with code %d.",
-					(group ? "nfs4_gid_to_name" :
-					"nfs4_uid_to_name"), rc);
-			}
-#else				/* USE_NFSIDMAP */
-			looked_up = false;
-#endif				/* !USE_NFSIDMAP */
-		}
-
-		if (!looked_up) {
-			if (nfs_param.nfsv4_param.allow_numeric_owners) {
-				LogInfo(COMPONENT_IDMAPPER,
-					"Lookup for %d failed, "
-					"using numeric %s", id,
-					(group ? "group" : "owner"));
-				/* 2**32 is 10 digits long in decimal */
-				sprintf(namebuff, "%u", id);
-				new_name.len = strlen(namebuff);
-			} else {
-				LogInfo(COMPONENT_IDMAPPER,
-					"Lookup for %d failed, using nobody.",
-					id);
-				memcpy(new_name.addr, "nobody", 6);
-				new_name.len = 6;
-			}
-		}
-
-		/* Add to the cache and encode the result. */
-		PTHREAD_RWLOCK_wrlock(group ? &idmapper_group_lock :
-				      &idmapper_user_lock);
-		if (group)
-			success = idmapper_add_group(&new_name, id);
-		else
-			success = idmapper_add_user(&new_name, id, NULL, false);
-
-		PTHREAD_RWLOCK_unlock(group ? &idmapper_group_lock :
-				      &idmapper_user_lock);
-		if (unlikely(!success)) {
-			LogMajor(COMPONENT_IDMAPPER, "%s failed.",
-				 group ? "idmapper_add_group" :
-				 "idmaper_add_user");
-		}
-		not_a_size_t = new_name.len;
-		return inline_xdr_bytes(xdrs, (char **)&new_name.addr,
-					&not_a_size_t, UINT32_MAX);
-	}
+	not_a_size_t = new_name.len;
+	return inline_xdr_bytes(xdrs, (char **)&new_name.addr,
+				&not_a_size_t, UINT32_MAX);
 }
 
 /**
@@ -380,7 +482,6 @@ static int name_to_gid(const char *name, gid_t *gid)
  * @param[in]  name       C string of name
  * @param[in]  len        Length of name
  * @param[out] id         ID found
- * @param[in]  anon       ID to use in case of nobody
  * @param[in]  group      Whether this a group lookup
  * @param[out] gss_gid    Found GID
  * @param[out] gss_uid    Found UID
@@ -390,8 +491,7 @@ static int name_to_gid(const char *name, gid_t *gid)
  * @return true on success, false not making the grade
  */
 static bool pwentname2id(char *name, size_t len, uint32_t *id,
-			 const uint32_t anon, bool group, gid_t *gid,
-			 bool *got_gid, char *at)
+			 bool group, gid_t *gid, bool *got_gid, char *at)
 {
 	if (at != NULL) {
 		if (strcmp(at + 1, owner_domain.addr) != 0) {
@@ -469,7 +569,6 @@ static bool pwentname2id(char *name, size_t len, uint32_t *id,
  * @param[in]  name       C string of name
  * @param[in]  len        Length of name
  * @param[out] id         ID found
- * @param[in]  anon       ID to use in case of nobody
  * @param[in]  group      Whether this a group lookup
  * @param[out] gss_gid    Found GID
  * @param[out] gss_uid    Found UID
@@ -480,8 +579,7 @@ static bool pwentname2id(char *name, size_t len, uint32_t *id,
  */
 
 static bool idmapname2id(char *name, size_t len, uint32_t *id,
-			 const uint32_t anon, bool group, gid_t *gid,
-			 bool *got_gid, char *at)
+			 bool group, gid_t *gid, bool *got_gid, char *at)
 {
 #ifdef USE_NFSIDMAP
 	int rc;
@@ -505,9 +603,123 @@ static bool idmapname2id(char *name, size_t len, uint32_t *id,
 #endif				/* USE_NFSIDMAP */
 }
 
+/**
+ * @brief Look up the ID of a name
+ *
+ * @param[in]  name    The name of the user or group
+ * @param[out] id      The resulting id
+ * @param[in]  group   True if this is a group name
+ * @param[out] gid     GID of the user
+ * @param[out] got_gid Whether gid was found
+ *
+ * @return true if the name was found.
+ */
+
+static bool name2id_lookup(const struct gsh_buffdesc *name, uint32_t *id,
+			   bool group, gid_t *gid, bool *got_gid)
+{
+	/* Something we can mutate and count on as terminated */
+	char *namebuff = alloca(name->len + 1);
+	char *at;
+
+	memcpy(namebuff, name->addr, name->len);
+	*(namebuff + name->len) = '\0';
+	at = memchr(namebuff, '@', name->len);
+
+	if (at == NULL)
+		return pwentname2id(namebuff, name->len, id, group, gid,
+				    got_gid, NULL);
+	else if (nfs_param.nfsv4_param.use_getpwnam)
+		return pwentname2id(namebuff, name->len, id, group, gid,
+				    got_gid, at);
+	else
+		return idmapname2id(namebuff, name->len, id, group, gid,
+				    got_gid, at);
+}
+
+/**
+ * @brief Look a cache entry up again
+ *
+ * @param[in] ctx Thread context, with the entry to refresh
+ */
+
+static void idmapper_refresh_run(struct fridgethr_context *ctx)
+{
+	struct idmapper_refresh *refresh = ctx->arg;
+	struct gsh_buffdesc new_name;
+	uint32_t id;
+	gid_t gid;
+	bool got_gid = false;
+
+	if (refresh->name.addr != NULL) {
+		if (name2id_lookup(&refresh->name, &id, refresh->group, &gid,
+				   &got_gid))
+			idmapper_cache_add(refresh->group, &refresh->name, id,
+					   got_gid ? &gid : NULL,
+					   IDMAP_NAME | IDMAP_ID);
+		else
+			idmapper_cache_add(refresh->group, &refresh->name, -1,
+					   NULL, IDMAP_NAME | IDMAP_NEGATIVE);
+	} else {
+		new_name.len = id2name_size(refresh->group);
+		new_name.addr = alloca(new_name.len);
+
+		if (id2name(refresh->id, refresh->group, &new_name))
+			idmapper_cache_add(refresh->group, &new_name,
+					   refresh->id, NULL,
+					   IDMAP_NAME | IDMAP_ID);
+		else
+			idmapper_cache_add(refresh->group, &new_name,
+					   refresh->id, NULL,
+					   IDMAP_ID | IDMAP_NEGATIVE);
+	}
+
+	gsh_free(refresh);
+}
+
+/**
+ * @brief Have an expired cache entry looked up again
+ *
+ * The entry stays in use until the refresh replaces it.
+ *
+ * @param[in] group True for a group entry
+ * @param[in] name  Name of the entry found by name, or NULL
+ * @param[in] id    ID of the entry found by ID
+ */
+
+static void idmapper_refresh(bool group, const struct gsh_buffdesc *name,
+			     uint32_t id)
+{
+	struct idmapper_refresh *refresh;
+	size_t len = name != NULL ? name->len : 0;
+
+	refresh = gsh_malloc(sizeof(struct idmapper_refresh) + len);
+	if (refresh == NULL)
+		return;
+
+	refresh->group = group;
+	refresh->id = id;
+	refresh->name.addr = NULL;
+	refresh->name.len = len;
+	if (name != NULL) {
+		refresh->name.addr = (char *)refresh +
+				     sizeof(struct idmapper_refresh);
+		memcpy(refresh->name.addr, name->addr, len);
+	}
+
+	if (fridgethr_submit(refresh_fridge, idmapper_refresh_run,
+			     refresh) != 0) {
+		LogFullDebug(COMPONENT_IDMAPPER,
+			     "Refresh threads busy, entry kept as is");
+		gsh_free(refresh);
+	}
+}
+
 /**
  * @brief Convert a name to an ID
  *
+ * Names that can't be looked up are remembered as such for a while.
+ *
  * @param[in]  name  The name of the user
  * @param[out] id    The resulting id
  * @param[in]  group True if this is a group name
@@ -519,75 +731,47 @@ static bool idmapname2id(char *name, size_t len, uint32_t *id,
 static bool name2id(const struct gsh_buffdesc *name, uint32_t *id, bool group,
 		    const uint32_t anon)
 {
-	bool success;
+	uint32_t status;
+	gid_t gid;
+	bool got_gid = false;
+	char *namebuff;
 
-	PTHREAD_RWLOCK_rdlock(group ? &idmapper_group_lock :
-			      &idmapper_user_lock);
+	idmapper_rdlock(group);
 	if (group)
-		success = idmapper_lookup_by_gname(name, id);
+		status = idmapper_lookup_by_gname(name, id);
 	else
-		success = idmapper_lookup_by_uname(name, id, NULL, false);
-	PTHREAD_RWLOCK_unlock(group ? &idmapper_group_lock :
-			      &idmapper_user_lock);
+		status = idmapper_lookup_by_uname(name, id, NULL);
+	idmapper_rdunlock(group);
 
-	if (success)
-		return true;
-	else {
-		gid_t gid;
-		bool got_gid = false;
-		/* Something we can mutate and count on as terminated */
-		char *namebuff = alloca(name->len + 1);
-		char *at;
-		bool looked_up = false;
-
-		memcpy(namebuff, name->addr, name->len);
-		*(namebuff + name->len) = '\0';
-		at = memchr(namebuff, '@', name->len);
-
-		if (at == NULL) {
-			if (pwentname2id
-			    (namebuff, name->len, id, anon, group, &gid,
-			     &got_gid, NULL))
-				looked_up = true;
-			else if (atless2id(namebuff, name->len, id, anon))
-				looked_up = true;
-			else
-				return false;
-		} else if (nfs_param.nfsv4_param.use_getpwnam) {
-			looked_up =
-			    pwentname2id(namebuff, name->len, id, anon, group,
-					 &gid, &got_gid, at);
-		} else {
-			looked_up =
-			    idmapname2id(namebuff, name->len, id, anon, group,
-					 &gid, &got_gid, at);
-		}
+	if (unlikely(status & IDMAP_STALE))
+		idmapper_refresh(group, name, 0);
 
-		if (!looked_up) {
-			LogInfo(COMPONENT_IDMAPPER,
-				"All lookups failed for %s, using anonymous.",
-				namebuff);
-			*id = anon;
-		}
+	if (likely(status & IDMAP_FOUND)) {
+		if (likely(!(status & IDMAP_NEGATIVE)))
+			return true;
+	} else if (name2id_lookup(name, id, group, &gid, &got_gid)) {
+		idmapper_cache_add(group, name, *id, got_gid ? &gid : NULL,
+				   IDMAP_NAME | IDMAP_ID);
+		return true;
+	} else {
+		idmapper_cache_add(group, name, -1, NULL,
+				   IDMAP_NAME | IDMAP_NEGATIVE);
+	}
 
-		PTHREAD_RWLOCK_wrlock(group ? &idmapper_group_lock :
-				      &idmapper_user_lock);
-		if (group)
-			success = idmapper_add_group(name, *id);
-		else
-			success =
-			    idmapper_add_user(name, *id, got_gid ? &gid : NULL,
-					      false);
+	/* The name is unknown */
+	namebuff = alloca(name->len + 1);
+	memcpy(namebuff, name->addr, name->len);
+	*(namebuff + name->len) = '\0';
 
-		PTHREAD_RWLOCK_unlock(group ? &idmapper_group_lock :
-				      &idmapper_user_lock);
+	if (memchr(namebuff, '@', name->len) == NULL)
+		return atless2id(namebuff, name->len, id, anon);
 
-		if (!success)
-			LogMajor(COMPONENT_IDMAPPER, "%s(%s %u) failed",
-				 (group ? "gidmap_add" : "uidmap_add"),
-				 namebuff, *id);
-		return true;
-	}
+	if (!(status & IDMAP_FOUND))
+		LogInfo(COMPONENT_IDMAPPER,
+			"All lookups failed for %s, using anonymous.",
+			namebuff);
+	*id = anon;
+	return true;
 }
 
 /**
@@ -649,6 +833,7 @@ bool principal2uid(char *principal, uid_t *uid, gid_t *gid)
 	gid_t gss_gid = ANON_GID;
 	const gid_t *gss_gidres = NULL;
 	int rc;
+	uint32_t status;
 	bool success;
 	struct gsh_buffdesc princbuff = {
 		.addr = principal,
@@ -660,12 +845,14 @@ bool principal2uid(char *principal, uid_t *uid, gid_t *gid)
 		return false;
 
 #ifdef USE_NFSIDMAP
-	PTHREAD_RWLOCK_rdlock(&idmapper_user_lock);
-	success =
-	    idmapper_lookup_by_uname(&princbuff, &gss_uid, &gss_gidres, true);
+	idmapper_rdlock(false);
+	status = idmapper_lookup_by_uname(&princbuff, &gss_uid, &gss_gidres);
+	/* Expired principals are looked up again right away */
+	success = (status & (IDMAP_FOUND | IDMAP_NEGATIVE | IDMAP_STALE)) ==
+		  IDMAP_FOUND;
 	if (success && gss_gidres)
 		gss_gid = *gss_gidres;
-	PTHREAD_RWLOCK_unlock(&idmapper_user_lock);
+	idmapper_rdunlock(false);
 	if (unlikely(!success)) {
 		if ((princbuff.len >= 4)
 		    && (!memcmp(princbuff.addr, "nfs/", 4)
@@ -761,16 +948,9 @@ bool principal2uid(char *principal, uid_t *uid, gid_t *gid)
  principal_found:
 #endif
 
-		PTHREAD_RWLOCK_wrlock(&idmapper_user_lock);
-		success =
-		    idmapper_add_user(&princbuff, gss_uid, &gss_gid, true);
-		PTHREAD_RWLOCK_unlock(&idmapper_user_lock);
-
-		if (!success) {
-			LogMajor(COMPONENT_IDMAPPER,
-				 "idmapper_add_user(%s, %d, %d) failed",
-				 principal, gss_uid, gss_gid);
-		}
+		/* The uid to name map is not added for gss principals */
+		idmapper_cache_add(false, &princbuff, gss_uid, &gss_gid,
+				   IDMAP_NAME);
 	}
 
 	*uid = gss_uid;
@@ -43,6 +43,8 @@
 #include "avltree.h"
 #include "idmapper.h"
 #include "abstract_atomic.h"
+#include "sharded_rwlock.h"
+#include "nfs_core.h"
 
 /**
  * @brief User entry in the IDMapper cache
@@ -53,9 +55,12 @@ struct cache_user {
 	uid_t uid;		/*< Corresponding UID */
 	gid_t gid;		/*< Corresponding GID */
 	bool gid_set;		/*< if the GID has been set */
+	bool negative;		/*< The lookup failed */
 	struct avltree_node uname_node;	/*< Node in the name tree */
 	struct avltree_node uid_node;	/*< Node in the UID tree */
+	bool in_unametree;	/* true iff this is in uname_tree */
 	bool in_uidtree;		/* true iff this is in uid_tree */
+	uint64_t expire;	/*< Time to refresh the entry */
 };
 
 /**
@@ -65,8 +70,12 @@ struct cache_user {
 struct cache_group {
 	struct gsh_buffdesc gname;	/*< Group name */
 	gid_t gid;		/*< Group ID */
+	bool negative;		/*< The lookup failed */
 	struct avltree_node gname_node;	/*< Node in the name tree */
 	struct avltree_node gid_node;	/*< Node in the GID tree */
+	bool in_gnametree;	/* true iff this is in gname_tree */
+	bool in_gidtree;	/* true iff this is in gid_tree */
+	uint64_t expire;	/*< Time to refresh the entry */
 };
 
 /**
@@ -76,34 +85,42 @@ struct cache_group {
 #define id_cache_size 1009
 
 /**
- * @brief UID cache, may only be accessed with idmapper_user_lock
- * held.  If idmapper_user_lock is held for read, it must be accessed
- * atomically.  (For a write, normal fetch/store is sufficient since
- * others are kept out.)
+ * @brief UID cache, may only be accessed with the user cache locked.
+ * If it is locked for read, it must be accessed atomically.  (For a
+ * write, normal fetch/store is sufficient since others are kept out.)
  */
 
 static struct avltree_node *uid_cache[id_cache_size];
 
 /**
- * @brief GID cache, may only be accessed with idmapper_group_lock
- * held.  If idmapper_group_lock is held for read, it must be accessed
- * atomically.  (For a write, normal fetch/store is sufficient since
- * others are kept out.)
+ * @brief GID cache, may only be accessed with the group cache locked.
+ * If it is locked for read, it must be accessed atomically.  (For a
+ * write, normal fetch/store is sufficient since others are kept out.)
  */
 
 static struct avltree_node *gid_cache[id_cache_size];
 
 /**
  * @brief Lock that protects the idmapper user cache
+ *
+ * Owners are looked up for every attribute reply, the lock is sharded
+ * so those readers don't contend.
  */
 
-pthread_rwlock_t idmapper_user_lock = PTHREAD_RWLOCK_INITIALIZER;
+static struct sharded_rwlock idmapper_user_lock;
 
 /**
  * @brief Lock that protects the idmapper group cache
  */
 
-pthread_rwlock_t idmapper_group_lock = PTHREAD_RWLOCK_INITIALIZER;
+static struct sharded_rwlock idmapper_group_lock;
+
+/**
+ * @brief Seconds before an entry being refreshed may be refreshed
+ * again, should the refresh never complete.
+ */
+
+#define IDMAPPER_REFRESH_RETRY 10
 
 /**
  * @brief Tree of users, by name
@@ -278,25 +295,165 @@ void idmapper_cache_init(void)
 	avltree_init(&gname_tree, gname_comparator, 0);
 	avltree_init(&gid_tree, gid_comparator, 0);
 	memset(gid_cache, 0, id_cache_size * sizeof(struct avltree_node *));
+
+	sharded_rwlock_init(&idmapper_user_lock);
+	sharded_rwlock_init(&idmapper_group_lock);
+}
+
+/**
+ * @brief Lock of the user or group cache
+ */
+
+static inline struct sharded_rwlock *idmapper_lock(bool group)
+{
+	return group ? &idmapper_group_lock : &idmapper_user_lock;
+}
+
+/**
+ * @brief Lock the user or group cache for lookups
+ *
+ * @param[in] group true for the group cache
+ */
+
+void idmapper_rdlock(bool group)
+{
+	sharded_rwlock_rdlock(idmapper_lock(group));
+}
+
+/**
+ * @brief Unlock the user or group cache after lookups
+ *
+ * @param[in] group true for the group cache
+ */
+
+void idmapper_rdunlock(bool group)
+{
+	sharded_rwlock_rdunlock(idmapper_lock(group));
+}
+
+/**
+ * @brief Lock the user or group cache for changes
+ *
+ * @param[in] group true for the group cache
+ */
+
+void idmapper_wrlock(bool group)
+{
+	sharded_rwlock_wrlock(idmapper_lock(group));
+}
+
+/**
+ * @brief Unlock the user or group cache after changes
+ *
+ * @param[in] group true for the group cache
+ */
+
+void idmapper_wrunlock(bool group)
+{
+	sharded_rwlock_wrunlock(idmapper_lock(group));
+}
+
+/**
+ * @brief Time at which a new entry is to be refreshed
+ *
+ * @param[in] flags IDMAP_NEGATIVE for a failed lookup
+ */
+
+static uint64_t idmapper_expire(uint32_t flags)
+{
+	return time(NULL) +
+	    ((flags & IDMAP_NEGATIVE) ?
+	     nfs_param.nfsv4_param.idmap_negative_cache_expiration :
+	     nfs_param.nfsv4_param.idmap_cache_expiration);
+}
+
+/**
+ * @brief Result of a lookup that found an entry
+ *
+ * The first lookup to find the entry expired is told to refresh it.
+ * The expiry is pushed back so the others keep using the entry in
+ * the meantime, and so that another refresh is asked for if this one
+ * never makes it.
+ *
+ * @param[in,out] expire   Expiry of the entry
+ * @param[in]     negative Whether the entry is negative
+ *
+ * @return IDMAP_FOUND, with IDMAP_NEGATIVE and IDMAP_STALE as needed.
+ */
+
+static uint32_t idmapper_found(uint64_t *expire, bool negative)
+{
+	uint32_t result = IDMAP_FOUND;
+	uint64_t when = atomic_fetch_uint64_t(expire);
+	uint64_t now = time(NULL);
+
+	if (negative)
+		result |= IDMAP_NEGATIVE;
+
+	if (unlikely(now >= when) &&
+	    atomic_cas_uint64_t(expire, when, now + IDMAPPER_REFRESH_RETRY))
+		result |= IDMAP_STALE;
+
+	return result;
+}
+
+/**
+ * @brief Remove a user entry from the trees it is in and free it
+ *
+ * @note The caller must hold the user cache for write.
+ */
+
+static void idmapper_remove_user(struct cache_user *user)
+{
+	if (user->in_unametree)
+		avltree_remove(&user->uname_node, &uname_tree);
+	if (user->in_uidtree) {
+		uid_cache[user->uid % id_cache_size] = NULL;
+		avltree_remove(&user->uid_node, &uid_tree);
+	}
+	gsh_free(user);
+}
+
+/**
+ * @brief Remove a group entry from the trees it is in and free it
+ *
+ * @note The caller must hold the group cache for write.
+ */
+
+static void idmapper_remove_group(struct cache_group *group)
+{
+	if (group->in_gnametree)
+		avltree_remove(&group->gname_node, &gname_tree);
+	if (group->in_gidtree) {
+		gid_cache[group->gid % id_cache_size] = NULL;
+		avltree_remove(&group->gid_node, &gid_tree);
+	}
+	gsh_free(group);
 }
 
 /**
  * @brief Add a user entry to the cache
  *
- * @note The caller must hold idmapper_user_lock for write.
+ * A positive entry for a name looked up is usually added with both
+ * IDMAP_NAME and IDMAP_ID, a GSS principal with IDMAP_NAME only.  A
+ * negative entry only goes the way the lookup failed: by name it
+ * records that the name is unknown, by ID it holds the name to reply
+ * with instead (nobody or the number) without making that name map
+ * to the ID.
  *
- * @param[in] name The user name
- * @param[in] uid  The user ID
- * @param[in] gid  Optional.  Set to NULL if no gid is known.
- * @param[in] gss_princ true when name is gss principal.
- *                      The uid to name map is not added for gss principals.
+ * @note The caller must hold the user cache for write.
+ *
+ * @param[in] name  The user name
+ * @param[in] uid   The user ID
+ * @param[in] gid   Optional.  Set to NULL if no gid is known.
+ * @param[in] flags IDMAP_NAME, IDMAP_ID and IDMAP_NEGATIVE
  *
  * @retval true on success.
  * @retval false if our reach exceeds our grasp.
  */
 
 bool idmapper_add_user(const struct gsh_buffdesc *name, uid_t uid,
-		       const gid_t *gid, bool gss_princ)
+		       const gid_t *gid, uint32_t flags)
 {
 	struct avltree_node *found_name;
 	struct avltree_node *found_id;
@@ -321,72 +478,72 @@ bool idmapper_add_user(const struct gsh_buffdesc *name, uid_t uid,
 		new->gid = -1;
 		new->gid_set = false;
 	}
+	new->negative = (flags & IDMAP_NEGATIVE) != 0;
+	new->in_unametree = false;
+	new->in_uidtree = false;
+	new->expire = idmapper_expire(flags);
 
 	/*
-	 * The threads that lookup by-name or by-id use the read lock. If
-	 * they don't find an entry, then they release the read lock,
-	 * acquire the write lock and then add the entry. So it is
-	 * possible that multiple threads may fail to find an entry at
-	 * one point and they all try to add. In this case, we will be
-	 * trying to insert same name,id mapping. It is also possible
-	 * that name got a different id or an id got a different name
-	 * causing us to find an existing entry when we are trying to
-	 * add an entry!
+	 * The threads that lookup by-name or by-id lock the cache for
+	 * read. If they don't find an entry, then they unlock, lock it
+	 * for write and then add the entry. So it is possible that
+	 * multiple threads may fail to find an entry at one point and
+	 * they all try to add. In this case, we will be trying to
+	 * insert same name,id mapping. It is also possible that name
+	 * got a different id or an id got a different name causing us
+	 * to find an existing entry when we are trying to add an entry!
+	 * Refreshes replace entries the same way.
 	 *
 	 * If we find an existing entry, we remove it from both the name
 	 * and the id AVL trees, and then add the new entry.
 	 */
-	found_name = avltree_insert(&new->uname_node, &uname_tree);
-	if (unlikely(found_name)) {
-		tmp = avltree_container_of(found_name, struct cache_user,
-					   uname_node);
-		avltree_remove(found_name, &uname_tree);
-		if (tmp->in_uidtree) {
-			uid_cache[tmp->uid % id_cache_size] = NULL;
-			avltree_remove(&tmp->uid_node, &uid_tree);
-		}
-		gsh_free(tmp);
+	if (flags & IDMAP_NAME) {
 		found_name = avltree_insert(&new->uname_node, &uname_tree);
-		assert(found_name == NULL);
-	}
-
-	/* If this is gss principal, we don't add to uid_tree */
-	if (gss_princ) {
-		new->in_uidtree = false;
-		goto out;
+		if (unlikely(found_name)) {
+			tmp = avltree_container_of(found_name,
+						   struct cache_user,
+						   uname_node);
+			idmapper_remove_user(tmp);
+			found_name = avltree_insert(&new->uname_node,
+						    &uname_tree);
+			assert(found_name == NULL);
+		}
+		new->in_unametree = true;
 	}
 
-	new->in_uidtree = true; /* we will sure insert it! */
-	found_id = avltree_insert(&new->uid_node, &uid_tree);
-	if (unlikely(found_id)) {
-		tmp = avltree_container_of(found_id, struct cache_user,
-					   uid_node);
-		uid_cache[tmp->uid % id_cache_size] = NULL;
-		avltree_remove(found_id, &uid_tree);
-		avltree_remove(&tmp->uname_node, &uname_tree);
-		gsh_free(tmp);
+	if (flags & IDMAP_ID) {
 		found_id = avltree_insert(&new->uid_node, &uid_tree);
-		assert(found_id == NULL);
+		if (unlikely(found_id)) {
+			tmp = avltree_container_of(found_id, struct cache_user,
+						   uid_node);
+			idmapper_remove_user(tmp);
+			found_id = avltree_insert(&new->uid_node, &uid_tree);
+			assert(found_id == NULL);
+		}
+		new->in_uidtree = true;
+		uid_cache[uid % id_cache_size] = &new->uid_node;
 	}
-	uid_cache[uid % id_cache_size] = &new->uid_node;
 
-out:
 	return true;
 }
 
 /**
  * @brief Add a group entry to the cache
  *
- * @note The caller must hold idmapper_group_lock for write.
+ * Entries are added as for users, see idmapper_add_user.
  *
- * @param[in] name The user name
- * @param[in] gid  The group id
+ * @note The caller must hold the group cache for write.
+ *
+ * @param[in] name  The user name
+ * @param[in] gid   The group id
+ * @param[in] flags IDMAP_NAME, IDMAP_ID and IDMAP_NEGATIVE
  *
  * @retval true on success.
  * @retval false if our reach exceeds our grasp.
  */
 
-bool idmapper_add_group(const struct gsh_buffdesc *name, const gid_t gid)
+bool idmapper_add_group(const struct gsh_buffdesc *name, const gid_t gid,
+			uint32_t flags)
 {
 	struct avltree_node *found_name;
 	struct avltree_node *found_id;
@@ -404,46 +561,39 @@ bool idmapper_add_group(const struct gsh_buffdesc *name, const gid_t gid)
 	new->gname.len = name->len;
 	new->gid = gid;
 	memcpy(new->gname.addr, name->addr, name->len);
+	new->negative = (flags & IDMAP_NEGATIVE) != 0;
+	new->in_gnametree = false;
+	new->in_gidtree = false;
+	new->expire = idmapper_expire(flags);
 
-	/*
-	 * The threads that lookup by-name or by-id use the read lock. If
-	 * they don't find an entry, then they release the read lock,
-	 * acquire the write lock and then add the entry. So it is
-	 * possible that multiple threads may fail to find an entry at
-	 * one point and they all try to add. In this case, we will be
-	 * trying to insert same name,id mapping. It is also possible
-	 * that name got a different id or an id got a different name
-	 * causing us to find an existing entry when we are trying to
-	 * add an entry!
-	 *
-	 * If we find an existing entry, we remove it from both the name
-	 * and the id AVL trees, and then add the new entry.
-	 */
-	found_name = avltree_insert(&new->gname_node, &gname_tree);
-	if (unlikely(found_name)) {
-		tmp = avltree_container_of(found_name, struct cache_group,
-					   gname_node);
-		avltree_remove(found_name, &gname_tree);
-		avltree_remove(&tmp->gid_node, &gid_tree);
-		gid_cache[tmp->gid % id_cache_size] = NULL;
-		gsh_free(tmp);
+	/* See idmapper_add_user about finding existing entries */
+	if (flags & IDMAP_NAME) {
 		found_name = avltree_insert(&new->gname_node, &gname_tree);
-		assert(found_name == NULL);
+		if (unlikely(found_name)) {
+			tmp = avltree_container_of(found_name,
+						   struct cache_group,
+						   gname_node);
+			idmapper_remove_group(tmp);
+			found_name = avltree_insert(&new->gname_node,
+						    &gname_tree);
+			assert(found_name == NULL);
+		}
+		new->in_gnametree = true;
 	}
 
-	found_id = avltree_insert(&new->gid_node, &gid_tree);
-	if (unlikely(found_id)) {
-		tmp = avltree_container_of(found_id, struct cache_group,
-					   gid_node);
-
-		gid_cache[tmp->gid % id_cache_size] = NULL;
-		avltree_remove(found_id, &gid_tree);
-		avltree_remove(&tmp->gname_node, &gname_tree);
-		gsh_free(tmp);
+	if (flags & IDMAP_ID) {
 		found_id = avltree_insert(&new->gid_node, &gid_tree);
-		assert(found_id == NULL);
+		if (unlikely(found_id)) {
+			tmp = avltree_container_of(found_id,
+						   struct cache_group,
+						   gid_node);
+			idmapper_remove_group(tmp);
+			found_id = avltree_insert(&new->gid_node, &gid_tree);
+			assert(found_id == NULL);
+		}
+		new->in_gidtree = true;
+		gid_cache[gid % id_cache_size] = &new->gid_node;
 	}
-	gid_cache[gid % id_cache_size] = &new->gid_node;
 
 	return true;
 }
@@ -451,7 +601,7 @@ bool idmapper_add_group(const struct gsh_buffdesc *name, const gid_t gid)
 /**
  * @brief Look up a user by name
  *
- * @note The caller must hold idmapper_user_lock for read.
+ * @note The caller must hold the user cache for read.
  *
  * @param[in]  name The user name to look up.
  * @param[out] uid  The user ID found.  May be NULL if the caller
@@ -461,12 +611,14 @@ bool idmapper_add_group(const struct gsh_buffdesc *name, const gid_t gid)
  *                  none. The caller may specify NULL if it isn't
  *                  interested.
  *
- * @retval true on success.
- * @retval false if we need to try, try again.
+ * @return 0 if we need to try, try again, IDMAP_FOUND otherwise,
+ *         with IDMAP_NEGATIVE if the name is unknown (uid and gid
+ *         are not set) and IDMAP_STALE if the caller is to refresh
+ *         the entry.
  */
 
-bool idmapper_lookup_by_uname(const struct gsh_buffdesc *name, uid_t *uid,
-			      const gid_t **gid, bool gss_princ)
+uint32_t idmapper_lookup_by_uname(const struct gsh_buffdesc *name,
+				  uid_t *uid, const gid_t **gid)
 {
 	struct cache_user prototype = {
 		.uname = *name
@@ -477,11 +629,15 @@ bool idmapper_lookup_by_uname(const struct gsh_buffdesc *name, uid_t *uid,
 	void **cache_slot;
 
 	if (unlikely(!found_node))
-		return false;
+		return 0;
 
 	found_user =
 	    avltree_container_of(found_node, struct cache_user, uname_node);
-	if (!gss_princ) {
+
+	if (found_user->negative)
+		return idmapper_found(&found_user->expire, true);
+
+	if (found_user->in_uidtree) {
 		/* I assume that if someone likes this user enough to look it
 		   up by name, they'll like it enough to look it up by ID
 		   later.
@@ -500,13 +656,13 @@ bool idmapper_lookup_by_uname(const struct gsh_buffdesc *name, uid_t *uid,
 	if (unlikely(gid))
 		*gid = (found_user->gid_set ? &found_user->gid : NULL);
 
-	return true;
+	return idmapper_found(&found_user->expire, false);
 }
 
 /**
  * @brief Look up a user by ID
  *
- * @note The caller must hold idmapper_user_lock for read.
+ * @note The caller must hold the user cache for read.
  *
  * @param[in]  uid  The user ID to look up.
  * @param[out] name The user name to look up. (May be NULL if the user
@@ -515,12 +671,15 @@ bool idmapper_lookup_by_uname(const struct gsh_buffdesc *name, uid_t *uid,
  *                  none. The caller may specify NULL if it isn't
  *                  interested.
  *
- * @retval true on success.
- * @retval false if we weren't so successful.
+ * @return 0 if we weren't so successful, IDMAP_FOUND otherwise, with
+ *         IDMAP_NEGATIVE if the ID is unknown (the name is the one
+ *         to use instead) and IDMAP_STALE if the caller is to refresh
+ *         the entry.
  */
 
-bool idmapper_lookup_by_uid(const uid_t uid, const struct gsh_buffdesc **name,
-			    const gid_t **gid)
+uint32_t idmapper_lookup_by_uid(const uid_t uid,
+				const struct gsh_buffdesc **name,
+				const gid_t **gid)
 {
 	struct cache_user prototype = {
 		.uid = uid
@@ -541,7 +700,7 @@ bool idmapper_lookup_by_uid(const uid_t uid, const struct gsh_buffdesc **name,
 	if (unlikely(!found)) {
 		found_node = avltree_lookup(&prototype.uid_node, &uid_tree);
 		if (unlikely(!found_node))
-			return false;
+			return 0;
 
 		atomic_store_voidptr(cache_slot, found_node);
 		found_user = avltree_container_of(found_node,
@@ -555,13 +714,13 @@ bool idmapper_lookup_by_uid(const uid_t uid, const struct gsh_buffdesc **name,
 	if (gid)
 		*gid = (found_user->gid_set ? &found_user->gid : NULL);
 
-	return true;
+	return idmapper_found(&found_user->expire, found_user->negative);
 }
 
 /**
  * @brief Lookup a group by name
  *
- * @note The caller must hold idmapper_group_lock for read.
+ * @note The caller must hold the group cache for read.
  *
  * @param[in]  name The user name to look up.
  * @param[out] gid  The group ID found.  May be NULL if the caller
@@ -569,11 +728,11 @@ bool idmapper_lookup_by_uid(const uid_t uid, const struct gsh_buffdesc **name,
  *                  unlikely, since you can't get anything else from
  *                  this function.)
  *
- * @retval true on success.
- * @retval false if we need to try, try again.
+ * @return As idmapper_lookup_by_uname.
  */
 
-bool idmapper_lookup_by_gname(const struct gsh_buffdesc *name, uid_t *gid)
+uint32_t idmapper_lookup_by_gname(const struct gsh_buffdesc *name,
+				  uid_t *gid)
 {
 	struct cache_group prototype = {
 		.gname = *name
@@ -584,40 +743,46 @@ bool idmapper_lookup_by_gname(const struct gsh_buffdesc *name, uid_t *gid)
 	void **cache_slot;
 
 	if (unlikely(!found_node))
-		return false;
+		return 0;
 
 	found_group =
 	    avltree_container_of(found_node, struct cache_group, gname_node);
 
+	if (found_group->negative)
+		return idmapper_found(&found_group->expire, true);
+
 	/* I assume that if someone likes this group enough to look it
 	   up by name, they'll like it enough to look it up by ID
 	   later. */
 
-	cache_slot = (void **)&gid_cache[found_group->gid % id_cache_size];
-	atomic_store_voidptr(cache_slot, &found_group->gid_node);
+	if (found_group->in_gidtree) {
+		cache_slot =
+		    (void **)&gid_cache[found_group->gid % id_cache_size];
+		atomic_store_voidptr(cache_slot, &found_group->gid_node);
+	}
 
 	if (likely(gid))
 		*gid = found_group->gid;
 	else
 		LogDebug(COMPONENT_IDMAPPER, "Caller is being weird.");
 
-	return true;
+	return idmapper_found(&found_group->expire, false);
 }
 
 /**
  * @brief Look up a group by ID
  *
- * @note The caller must hold idmapper_group_lock for read.
+ * @note The caller must hold the group cache for read.
  *
  * @param[in]  gid  The group ID to look up.
  * @param[out] name The user name to look up. (May be NULL if the user
  *                  doesn't care about the name, which would be weird.)
  *
- * @retval true on success.
- * @retval false if we're most unfortunate.
+ * @return As idmapper_lookup_by_uid.
  */
 
-bool idmapper_lookup_by_gid(const gid_t gid, const struct gsh_buffdesc **name)
+uint32_t idmapper_lookup_by_gid(const gid_t gid,
+				const struct gsh_buffdesc **name)
 {
 	struct cache_group prototype = {
 		.gid = gid
@@ -638,7 +803,7 @@ bool idmapper_lookup_by_gid(const gid_t gid, const struct gsh_buffdesc **name)
 	if (unlikely(!found)) {
 		found_node = avltree_lookup(&prototype.gid_node, &gid_tree);
 		if (unlikely(!found_node))
-			return false;
+			return 0;
 
 		atomic_store_voidptr(cache_slot, found_node);
 		found_group = avltree_container_of(found_node,
@@ -651,7 +816,7 @@ bool idmapper_lookup_by_gid(const gid_t gid, const struct gsh_buffdesc **name)
 	else
 		LogDebug(COMPONENT_IDMAPPER, "Caller is being weird.");
 
-	return true;
+	return idmapper_found(&found_group->expire, found_group->negative);
 }
 
 /**
@@ -662,8 +827,8 @@ void idmapper_clear_cache(void)
 {
 	struct avltree_node *node;
 
-	PTHREAD_RWLOCK_wrlock(&idmapper_user_lock);
-	PTHREAD_RWLOCK_wrlock(&idmapper_group_lock);
+	idmapper_wrlock(false);
+	idmapper_wrlock(true);
 
 	memset(uid_cache, 0, id_cache_size * sizeof(struct avltree_node *));
 	memset(gid_cache, 0, id_cache_size * sizeof(struct avltree_node *));
@@ -671,33 +836,37 @@ void idmapper_clear_cache(void)
 	for (node = avltree_first(&uname_tree);
 	     node != NULL;
 	     node = avltree_first(&uname_tree)) {
-		struct cache_user *user;
-
-		user = avltree_container_of(node,
-					    struct cache_user, uname_node);
-		avltree_remove(&user->uname_node, &uname_tree);
-		avltree_remove(&user->uid_node, &uid_tree);
-		gsh_free(user);
+		idmapper_remove_user(avltree_container_of(node,
+							  struct cache_user,
+							  uname_node));
 	}
 
-	assert(avltree_first(&uid_tree) == NULL);
+	for (node = avltree_first(&uid_tree);
+	     node != NULL;
+	     node = avltree_first(&uid_tree)) {
+		idmapper_remove_user(avltree_container_of(node,
+							  struct cache_user,
+							  uid_node));
+	}
 
 	for (node = avltree_first(&gname_tree);
 	     node != NULL;
 	     node = avltree_first(&gname_tree)) {
-		struct cache_group *group;
-
-		group = avltree_container_of(node,
-					     struct cache_group, gname_node);
-		avltree_remove(&group->gname_node, &gname_tree);
-		avltree_remove(&group->gid_node, &gid_tree);
-		gsh_free(group);
+		idmapper_remove_group(avltree_container_of(node,
+							   struct cache_group,
+							   gname_node));
 	}
 
-	assert(avltree_first(&gid_tree) == NULL);
+	for (node = avltree_first(&gid_tree);
+	     node != NULL;
+	     node = avltree_first(&gid_tree)) {
+		idmapper_remove_group(avltree_container_of(node,
+							   struct cache_group,
+							   gid_node));
+	}
 
-	PTHREAD_RWLOCK_unlock(&idmapper_group_lock);
-	PTHREAD_RWLOCK_unlock(&idmapper_user_lock);
+	idmapper_wrunlock(true);
+	idmapper_wrunlock(false);
 }
 
 /** @} */
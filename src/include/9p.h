@@ -39,6 +39,7 @@
 #include "9p_types.h"
 #include "fsal_types.h"
 #include "cache_inode.h"
+#include "abstract_atomic.h"
 
 #ifdef _USE_9P_RDMA
 #include <infiniband/arch.h>
@@ -52,7 +53,10 @@
 
 #define _9P_LOCK_CLIENT_LEN 64
 
-#define _9P_FID_PER_CONN        1024
+/* Fids are found from their number in leaves of _9P_FID_LEAF_SIZE
+ * pointers, allocated as the client uses fid numbers in their range */
+#define _9P_FID_LEAF_SHIFT 8
+#define _9P_FID_LEAF_SIZE (1 << _9P_FID_LEAF_SHIFT)
 
 /* _9P_MSG_SIZE: maximum message size for 9P/TCP */
 #define _9P_MSG_SIZE 70000
@@ -349,7 +353,7 @@ struct _9p_conn {
 	struct gsh_client *client;
 	struct timeval birth;	/* This is useful if same sockfd is
 				   reused on socket's close/open */
-	struct _9p_fid *fids[_9P_FID_PER_CONN];
+	struct _9p_fid ***fids;	/* Fid leaves, see _9p_fid_get() */
 	struct _9p_flush_bucket flush_buckets[FLUSH_BUCKETS];
 	unsigned long sequence;
 	pthread_mutex_t sock_lock;
@@ -399,18 +403,37 @@ struct _9p_function_desc {
 
 extern const struct _9p_function_desc _9pfuncdesc[];
 
-#define _9p_getptr(__cursor, __pvar, __type) \
-do {                                         \
-	__pvar = (__type *)__cursor;         \
-	__cursor += sizeof(__type);          \
+/* _9p_msgend:
+ * End of the bytes received for a request.  _9p_process_buffer has
+ * checked its length against msize.
+ */
+#define _9p_msgend(__req9p) \
+	((__req9p)->_9pmsg + *((u32 *)(__req9p)->_9pmsg))
+
+/* _9p_getptr, _9p_getstr:
+ * Get a field of a request.  A field running past the bytes received
+ * fails the request with EINVAL, so like the service functions they
+ * are used in, they expect req9p, worker_data, msgtag, plenout and
+ * preply.  The tag itself is always there.
+ */
+#define _9p_getptr(__cursor, __pvar, __type)                   \
+do {                                                           \
+	if (_9p_msgend(req9p) - (__cursor) <                   \
+	    (ptrdiff_t)sizeof(__type))                         \
+		return _9p_rerror(req9p, worker_data, msgtag,  \
+				  EINVAL, plenout, preply);    \
+	__pvar = (__type *)__cursor;                           \
+	__cursor += sizeof(__type);                            \
 } while (0)
 
-#define _9p_getstr(__cursor, __len, __str) \
-do {                                       \
-	__len = (u16 *)__cursor;           \
-	__cursor += sizeof(u16);           \
-	__str = __cursor;                  \
-	__cursor += *__len;                \
+#define _9p_getstr(__cursor, __len, __str)                     \
+do {                                                           \
+	_9p_getptr(__cursor, __len, u16);                      \
+	if (_9p_msgend(req9p) - (__cursor) < *__len)           \
+		return _9p_rerror(req9p, worker_data, msgtag,  \
+				  EINVAL, plenout, preply);    \
+	__str = __cursor;                                      \
+	__cursor += *__len;                                    \
 } while (0)
 
 #define _9p_setptr(__cursor, __pvar, __type) \
@@ -579,6 +602,16 @@ do {                                                   \
  */
 #define _9P_TCP_MSIZE 65536
 
+/**
+ * @brief Default number of 9P/TCP reactor threads
+ */
+#define _9P_TCP_REACTORS 4
+
+/**
+ * @brief Default value for _9p_max_fids
+ */
+#define _9P_MAX_FIDS 65536
+
 /**
  * @brief Default value for _9p_rdma_msize
  */
@@ -618,6 +651,12 @@ struct _9p_param {
 	/** Msize for 9P operation on tcp.  Defaults to _9P_TCP_MSIZE,
 	    settable by _9P_TCP_Msize */
 	uint32_t _9p_tcp_msize;
+	/** Threads polling the 9P/TCP connections.  Defaults to
+	    _9P_TCP_REACTORS, settable by _9P_TCP_Reactors */
+	uint32_t _9p_tcp_reactors;
+	/** Fid numbers allowed per connection.  Defaults to _9P_MAX_FIDS,
+	    settable by _9P_Max_Fids */
+	uint32_t _9p_max_fids;
 	/** Msize for 9P operation on rdma.  Defaults to _9P_RDMA_MSIZE,
 	    settable by _9P_RDMA_Msize */
 	uint32_t _9p_rdma_msize;
@@ -652,8 +691,61 @@ int _9p_tools_get_req_context_by_name(int uname_len, char *uname_str,
 int _9p_tools_errno(cache_inode_status_t cache_status);
 void _9p_openflags2FSAL(u32 *inflags, fsal_openflags_t *outflags);
 int _9p_tools_clunk(struct _9p_fid *pfid);
+int _9p_fid_reserve(struct _9p_conn *conn, u32 fid);
 void _9p_cleanup_fids(struct _9p_conn *conn);
 
+/**
+ * @brief Find a fid of a connection
+ *
+ * Lock free: leaves are only allocated while the connection lives,
+ * and freed by _9p_cleanup_fids() once no request uses it.
+ *
+ * @param[in] conn The connection
+ * @param[in] fid  Fid number
+ *
+ * @return The fid, NULL if there is none with this number.
+ */
+
+static inline struct _9p_fid *_9p_fid_get(struct _9p_conn *conn, u32 fid)
+{
+	struct _9p_fid ***fids = atomic_fetch_voidptr((void **)&conn->fids);
+	struct _9p_fid **leaf;
+
+	if (fids == NULL || fid >= _9p_param._9p_max_fids)
+		return NULL;
+
+	leaf = atomic_fetch_voidptr((void **)&fids[fid >> _9P_FID_LEAF_SHIFT]);
+	if (leaf == NULL)
+		return NULL;
+
+	return atomic_fetch_voidptr(
+		(void **)&leaf[fid & (_9P_FID_LEAF_SIZE - 1)]);
+}
+
+/**
+ * @brief Install or remove a fid of a connection
+ *
+ * The slot must have been reserved with _9p_fid_reserve().
+ *
+ * @param[in] conn The connection
+ * @param[in] fid  Fid number
+ * @param[in] pfid The fid, NULL to remove it
+ */
+
+static inline void _9p_fid_set(struct _9p_conn *conn, u32 fid,
+			       struct _9p_fid *pfid)
+{
+	struct _9p_fid **leaf = conn->fids[fid >> _9P_FID_LEAF_SHIFT];
+
+	atomic_store_voidptr((void **)&leaf[fid & (_9P_FID_LEAF_SIZE - 1)],
+			     pfid);
+}
+
+/* 9P/TCP receive buffers */
+void _9p_msgbuf_init(void);
+char *_9p_msgbuf_get(uint32_t size, bool *hit);
+void _9p_msgbuf_put(char *buf);
+
 #ifdef _USE_9P_RDMA
 /* 9P/RDMA callbacks */
 void *_9p_rdma_handle_trans(void *arg);
@@ -37,6 +37,8 @@
 #ifndef FSAL_COMMONLIB_H
 #define FSAL_COMMONLIB_H
 
+#include <sys/uio.h>
+
 /*
  * fsal common utility functions
  */
@@ -126,4 +128,12 @@ int decode_fsid(char *buf,
 		struct fsal_fsid__ *fsid,
 		enum fsid_type fsid_type);
 
+/* vectored I/O helpers
+ */
+
+uint32_t fsal_io_range_run(struct fsal_io_range *ranges, uint32_t count,
+			   struct iovec *iov, uint32_t iovmax);
+bool fsal_io_range_done(struct fsal_io_range *ranges, uint32_t n,
+			size_t moved);
+
 #endif				/* FSAL_COMMONLIB_H */
@@ -58,6 +58,7 @@ typedef struct cache_entry_t cache_entry_t;
 #include "abstract_mem.h"
 #include "hashtable.h"
 #include "avltree.h"
+#include "interval_tree.h"
 #include "log.h"
 #include "gsh_config.h"
 #include "common_utils.h"
@@ -143,6 +144,46 @@ struct cache_inode_parameter {
 	    client a partial reply based on what we have.
 	    Defaults to false, settable with Retry_Readdir */
 	bool retry_readdir;
+	/** Bytes of file data to cache for exports with Data_Cache set,
+	    0 disables the data cache.  Defaults to 0, settable with
+	    Data_Cache_Size */
+	uint64_t data_cache_size;
+	/** Bytes of UNSTABLE writes gathered per file before they are
+	    written to the FSAL, 0 disables write gathering.  Defaults
+	    to 0, settable with Write_Gather_Size */
+	uint32_t write_gather_size;
+	/** Milliseconds a gathered extent may wait.  Defaults to 100,
+	    settable with Write_Gather_Delay */
+	uint32_t write_gather_delay;
+	/** Bytes gathered in all files at once, past which UNSTABLE
+	    writes go straight to the FSAL.  Defaults to 256MB,
+	    settable with Write_Gather_Limit */
+	uint64_t write_gather_limit;
+	/** Bytes read ahead of sequential readers into the data cache,
+	    0 disables readahead.  Defaults to 1MB, settable with
+	    Readahead_Size */
+	uint32_t readahead_size;
+	/** Threads issuing readahead.  Defaults to 4, settable with
+	    Readahead_Threads */
+	uint32_t readahead_threads;
+	/** Entries per chunk when directories are read in chunks, 0
+	    reads whole directories.  Defaults to 0, settable with
+	    Dir_Chunk */
+	uint32_t dir_chunk;
+	/** Chunks read past the one asked for.  Defaults to 1,
+	    settable with Dir_Chunk_Prefetch */
+	uint32_t dir_chunk_prefetch;
+	/** Directory entries held in chunks before the least recently
+	    used chunks are dropped.  Defaults to 1000000, settable with
+	    Dir_Chunk_HWMark */
+	uint32_t dir_chunk_hwmark;
+	/** Threads looking up the names of directories being read, 0
+	    leaves the lookups to readdir_plus.  Defaults to 0, settable
+	    with Readdir_Lookup_Threads */
+	uint32_t readdir_lookup_threads;
+	/** Lookups in flight per directory being read.  Defaults to 16,
+	    settable with Readdir_Lookup_Depth */
+	uint32_t readdir_lookup_depth;
 };
 
 /** @} */
@@ -191,6 +232,19 @@ typedef struct cache_inode_lru__ {
 	uint32_t cf;		/*< Confounder */
 } cache_inode_lru_t;
 
+/**
+ * @brief Read pattern of a file
+ *
+ * Protected by the data cache lane lock of the entry.
+ */
+
+struct cache_inode_readahead {
+	uint64_t next;		/*< Offset a sequential read would be at */
+	uint64_t end;		/*< End of the data read ahead */
+	uint32_t seq;		/*< Reads in a row at the expected offset */
+	bool busy;		/*< A readahead is in progress */
+};
+
 /**
  * cache inode statistics.
  */
@@ -201,6 +255,10 @@ struct cache_stats {
 	uint64_t inode_conf;
 	uint64_t inode_added;
 	uint64_t inode_mapping;
+	uint64_t data_hit;
+	uint64_t data_miss;
+	uint64_t data_evict;
+	uint64_t data_bytes;
 };
 
 extern struct cache_stats *cache_stp;
@@ -214,7 +272,8 @@ typedef enum io_direction__ {
 	CACHE_INODE_READ = 1,		/*< Reading */
 	CACHE_INODE_WRITE = 2,		/*< Writing */
 	CACHE_INODE_READ_PLUS = 3,	/*< Reading plus */
-	CACHE_INODE_WRITE_PLUS = 4	/*< Writing plus */
+	CACHE_INODE_WRITE_PLUS = 4,	/*< Writing plus */
+	CACHE_INODE_READ_REF = 5	/*< Reading by reference */
 } cache_inode_io_direction_t;
 
 /**
@@ -340,6 +399,18 @@ typedef struct cache_inode_dir_entry__ {
 	char name[];		/*< The NUL-terminated filename */
 } cache_inode_dir_entry_t;
 
+/**
+ * @brief Version of an object, from its change attribute and ctime
+ *
+ * @param[in] attrs Attributes, the attr_lock is held
+ */
+
+static inline uint64_t cache_inode_attr_version(struct attrlist *attrs)
+{
+	return attrs->change * 0x9e3779b97f4a7c15ULL ^
+	       timespec_to_nsecs(&attrs->chgtime);
+}
+
 /**
  * @brief Deep free a dirent.
  *
@@ -357,6 +428,32 @@ cache_inode_free_dirent(cache_inode_dir_entry_t *dirent)
 	gsh_free(dirent);
 }
 
+/**
+ * @brief A run of directory entries read in one go
+ *
+ * When directories are read in chunks, the cookie of an entry is the
+ * FSAL cookie to resume reading after it, so a chunk can be read
+ * again at any time and the cookies stay the same.  The entries are
+ * in FSAL order and the chunk does not change once read.
+ */
+
+struct cache_inode_dir_chunk {
+	struct glist_head lru;		/*< In the lane, MRU at tail */
+	struct glist_head dir_list;	/*< In the directory's chunks */
+	uint64_t gen;			/*< Directory chunk_gen read at */
+	uint64_t version;		/*< Directory version read at */
+	uint64_t whence;		/*< Cookie it was read from */
+	int32_t refcnt;			/*< The cache's and readers' */
+	uint32_t count;			/*< Number of entries */
+	bool eod;			/*< The directory ends with it */
+	struct cache_inode_dir_chunk_cookie {
+		uint64_t cookie;
+		uint32_t index;
+	} *cookies;			/*< Entry indexes by cookie */
+	cache_inode_dir_entry_t *dirents[];	/*< Entries, hk.k the
+						    cookie */
+};
+
 /**
  * @brief Stats for file-specific and client-file delegation heuristics
  */
@@ -477,6 +574,9 @@ struct cache_entry_t {
 	void *first_export;
 	/** Layout recalls on this entry */
 	struct glist_head layoutrecall_list;
+	/** Blocks of file data in the data cache (protected by the
+	    data cache lane lock) */
+	struct glist_head data_blocks;
 	/** Lock on type-specific cached content.  See locking
 	    discipline for details. */
 	pthread_rwlock_t content_lock;
@@ -487,6 +587,11 @@ struct cache_entry_t {
 		struct cache_inode_file {
 			/** Pointers for lock list */
 			struct glist_head lock_list;
+			/** The locks of lock_list indexed by range */
+			struct interval_tree lock_tree;
+			/** Export all the locks were taken through, NULL
+			    if they came through several */
+			struct gsh_export *lock_export;
 			/** Pointers for NLM share list */
 			struct glist_head nlm_share_list;
 			/** Share reservation state for this file. */
@@ -498,6 +603,11 @@ struct cache_entry_t {
 					      * happening at the moment which
 					      * prevents delegations from being
 					      * granted */
+			/** Read pattern of the file, for readahead */
+			struct cache_inode_readahead readahead;
+			/** UNSTABLE writes being gathered, created on
+			    first use */
+			struct cache_inode_gather *gather;
 		} file;		/*< REGULAR_FILE data */
 
 		struct {
@@ -513,6 +623,15 @@ struct cache_entry_t {
 				/** Heuristic. Expect 0. */
 				uint32_t collisions;
 			} avl;
+			/** Chunks read when directories are read in
+			    chunks, protected by the LRU lane lock */
+			struct glist_head chunks;
+			/** Raised each time the chunks are invalidated,
+			    protected by the LRU lane lock */
+			uint64_t chunk_gen;
+			/** Latest version of the directory seen by
+			    readdir, protected by the LRU lane lock */
+			uint64_t chunk_version;
 			/** If this is a junction, the export this node points
 			    to. Protected by the attr_lock. */
 			struct gsh_export *junction_export;
@@ -809,6 +928,10 @@ cache_inode_status_t cache_inode_new_entry(struct fsal_obj_handle *new_obj,
 					   uint32_t flags,
 					   cache_entry_t **entry);
 
+cache_inode_status_t cache_inode_read_ref(cache_entry_t *entry,
+					  uint64_t offset, size_t io_size,
+					  size_t *bytes_moved, bool *eof,
+					  struct gsh_read_ref **ref);
 cache_inode_status_t cache_inode_rdwr(cache_entry_t *entry,
 				      cache_inode_io_direction_t io_direction,
 				      uint64_t offset, size_t io_size,
@@ -833,6 +956,9 @@ cache_inode_status_t cache_inode_readdir(cache_entry_t *directory,
 					 cache_inode_getattr_cb_t cb,
 					 void *opaque);
 
+cache_inode_status_t cache_inode_insert_cached_dirent(
+	cache_entry_t *parent, const char *name, cache_entry_t *entry,
+	cache_inode_dir_entry_t **dir_entry);
 cache_inode_status_t cache_inode_add_cached_dirent(
 	cache_entry_t *parent, const char *name, cache_entry_t *entry,
 	cache_inode_dir_entry_t **dir_entry);
@@ -856,6 +982,47 @@ void cache_inode_kill_entry(cache_entry_t *entry);
 cache_inode_status_t cache_inode_invalidate(cache_entry_t *entry,
 					    uint32_t flags);
 
+int cache_inode_data_pkginit(void);
+int cache_inode_data_pkgshutdown(void);
+bool cache_inode_data_enabled(void);
+cache_inode_status_t cache_inode_data_version(cache_entry_t *entry,
+					      uint64_t *version);
+bool cache_inode_data_read(cache_entry_t *entry, uint64_t version,
+			   uint64_t offset, size_t io_size, void *buffer,
+			   size_t *bytes_moved, bool *eof);
+struct gsh_read_ref *cache_inode_data_read_ref(cache_entry_t *entry,
+					       uint64_t version,
+					       uint64_t offset,
+					       size_t io_size,
+					       size_t *bytes_moved,
+					       bool *eof);
+fsal_status_t cache_inode_data_fill(cache_entry_t *entry, uint64_t version,
+				    uint64_t offset, size_t io_size,
+				    void *buffer, size_t *bytes_moved,
+				    bool *eof);
+void cache_inode_data_invalidate(cache_entry_t *entry);
+
+int cache_inode_readdir_pkginit(void);
+int cache_inode_readdir_pkgshutdown(void);
+
+int cache_inode_dir_chunk_pkginit(void);
+bool cache_inode_dir_chunked(void);
+cache_inode_status_t cache_inode_dir_chunk_get(cache_entry_t *directory,
+					       uint64_t version,
+					       uint64_t cookie,
+					       struct cache_inode_dir_chunk
+					       **chunk, uint32_t *index);
+void cache_inode_dir_chunk_put(cache_entry_t *directory,
+			       struct cache_inode_dir_chunk *chunk);
+void cache_inode_dir_chunk_invalidate(cache_entry_t *directory);
+void cache_inode_dir_chunk_reclaim(void);
+
+bool cache_inode_gather_write(cache_entry_t *entry, uint64_t offset,
+			      size_t io_size, void *buffer);
+void cache_inode_gather_flush(cache_entry_t *entry);
+fsal_status_t cache_inode_gather_commit(cache_entry_t *entry);
+void cache_inode_gather_release(cache_entry_t *entry);
+
 int cache_inode_set_time_current(struct timespec *time);
 
 void cache_inode_destroyer(void);
@@ -964,6 +1131,9 @@ cache_inode_refresh_attrs(cache_entry_t *entry)
 		entry->obj_handle->attributes.acl = NULL;
 	}
 
+	/* The FSAL must see the gathered writes to report them */
+	cache_inode_gather_flush(entry);
+
 	fsal_status =
 	    entry->obj_handle->obj_ops.getattrs(entry->obj_handle);
 	if (FSAL_IS_ERROR(fsal_status)) {
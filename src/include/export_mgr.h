@@ -38,6 +38,7 @@
 
 #include "gsh_list.h"
 #include "cache_inode.h"
+#include "rate_limit.h"
 
 #ifndef EXPORT_MGR_H
 #define EXPORT_MGR_H
@@ -77,6 +78,9 @@ struct gsh_export {
 	cache_entry_t *exp_root_cache_inode;
 	/** Allowed clients */
 	struct glist_head clients;
+	/** Compiled form of clients, built before the export is
+	    inserted and read only after */
+	struct client_index *client_index;
 	/** Entry for the junction of this export.  Protected by lock */
 	cache_entry_t *exp_junction_inode;
 	/** The export this export sits on. Protected by lock */
@@ -119,6 +123,9 @@ struct gsh_export {
 	uint32_t options;
 	/** Export non-permission options set */
 	uint32_t options_set;
+	/** Limits for all clients of the export together.  Settable
+	    with Max_Ops_Rate and Max_Bytes_Rate. */
+	struct rate_limit rate_limit;
 	/** Expiration time interval in seconds for attributes.  Settable with
 	    Attr_Expiration_Time. */
 	int32_t expire_time_attr;
@@ -127,6 +134,7 @@ struct gsh_export {
 
 	uint8_t export_status;		/*< current condition */
 	bool has_pnfs_ds;		/*< id_servers matches export_id */
+	bool rate_limited;		/*< export or a client has limits */
 };
 
 void export_pkginit(void);
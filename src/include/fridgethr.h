@@ -251,6 +251,7 @@ void fridgethr_setwait(struct fridgethr_context *ctx, time_t thread_delay);
 time_t fridgethr_getwait(struct fridgethr_context *ctx);
 
 void fridgethr_cancel(struct fridgethr *fr);
+int fridgethr_shutdown(struct fridgethr *fr);
 
 extern struct fridgethr *general_fridge;
 int general_fridge_init(void);
@@ -51,6 +51,7 @@
 */
 struct gsh_client;
 struct gsh_export;
+struct gsh_read_ref;
 struct fsal_up_vector;		/* From fsal_up.h */
 
 /**
@@ -318,7 +319,7 @@ struct fsal_up_vector;		/* From fsal_up.h */
  * rules), increment the minor version
  */
 
-#define FSAL_MINOR_VERSION 0
+#define FSAL_MINOR_VERSION 3
 
 /* Forward references for object methods */
 
@@ -359,6 +360,17 @@ struct io_hints {
 	uint32_t hints;
 };
 
+/**
+ * @brief One range of a vectored read or write
+ */
+
+struct fsal_io_range {
+	uint64_t offset;	/*< Position in the file */
+	size_t length;		/*< Amount of data to move */
+	void *buffer;		/*< Data */
+	size_t done;		/*< Out: amount of data moved */
+};
+
 /**
  * @brief request op context
  *
@@ -1098,6 +1110,27 @@ typedef uint64_t fsal_cookie_t;
 
 typedef bool(*fsal_readdir_cb) (const char *name, void *dir_state,
 				fsal_cookie_t cookie);
+
+/**
+ * @brief Callback receiving an entry and its object from readdir_plus
+ *
+ * @param[in] name      Name of the entry
+ * @param[in] obj       Object of the entry, with its attributes, now
+ *                      owned by the callback.  NULL if it could not be
+ *                      looked up.
+ * @param[in] status    Why the object could not be looked up
+ * @param[in] dir_state Opaque pointer passed to readdir_plus
+ * @param[in] cookie    Directory cookie of the entry
+ *
+ * @retval true if more entries are required
+ * @retval false if no more entries are required
+ */
+
+typedef bool(*fsal_readdir_plus_cb) (const char *name,
+				     struct fsal_obj_handle *obj,
+				     fsal_status_t status,
+				     void *dir_state,
+				     fsal_cookie_t cookie);
 /**
  * @brief FSAL object operations vector
  */
@@ -1946,6 +1979,128 @@ struct fsal_obj_ops {
 				  const struct fsal_layoutcommit_arg *arg,
 				  struct fsal_layoutcommit_res *res);
 /**@}*/
+
+/**@{*/
+
+/**
+ * Vectored I/O
+ */
+
+/**
+ * @brief Read several ranges of a file
+ *
+ * This function reads the ranges in order, as many calls to read
+ * would, but lets the FSAL move them in fewer system calls or round
+ * trips.  Reading stops at the first short range, the ranges after it
+ * are left with nothing done.  On error, the done field of the
+ * ranges tells how far reading went.
+ *
+ * The default calls read on each range.
+ *
+ * @param[in]     obj_hdl     File to read
+ * @param[in,out] ranges      Ranges to read, done is set on return
+ * @param[in]     count       Number of ranges
+ * @param[out]    end_of_file true if the end of file has been reached
+ *
+ * @return FSAL status.
+ */
+	 fsal_status_t(*read_vec) (struct fsal_obj_handle *obj_hdl,
+				   struct fsal_io_range *ranges,
+				   uint32_t count,
+				   bool *end_of_file);
+
+/**
+ * @brief Write several ranges of a file
+ *
+ * This function writes the ranges in order, as many calls to write
+ * would, but lets the FSAL move them in fewer system calls or round
+ * trips.  Writing stops at the first short range.  On error, the
+ * done field of the ranges tells how far writing went.
+ *
+ * The default calls write on each range.
+ *
+ * @param[in]     obj_hdl     File to be written
+ * @param[in,out] ranges      Ranges to write, done is set on return
+ * @param[in]     count       Number of ranges
+ * @param[in,out] fsal_stable In, if on, the fsal is requested to write
+ *                            data to stable store.  Out, the fsal
+ *                            reports what it did.
+ *
+ * @return FSAL status.
+ */
+	 fsal_status_t(*write_vec) (struct fsal_obj_handle *obj_hdl,
+				    struct fsal_io_range *ranges,
+				    uint32_t count,
+				    bool *fsal_stable);
+/**@}*/
+
+/**@{*/
+
+/**
+ * Bulk directory reading
+ */
+
+/**
+ * @brief Read a directory with the objects of its entries
+ *
+ * This function reads directory entries like readdir, and supplies
+ * each with its object handle and attributes, so that filling a
+ * cache from a directory doesn't take a lookup round trip per name.
+ * FSALs whose backend returns attributes with the names should
+ * implement it.
+ *
+ * The default calls readdir, then lookup on each name.
+ *
+ * @param[in]  dir_hdl   Directory to read
+ * @param[in]  whence    Point at which to start reading.  NULL to
+ *                       start at beginning.
+ * @param[in]  dir_state Opaque pointer to be passed to callback
+ * @param[in]  cb        Callback to receive entries
+ * @param[out] eof       true if the last entry was reached
+ *
+ * @return FSAL status.
+ */
+	 fsal_status_t(*readdir_plus) (struct fsal_obj_handle *dir_hdl,
+				       fsal_cookie_t *whence,
+				       void *dir_state,
+				       fsal_readdir_plus_cb cb,
+				       bool *eof);
+/**@}*/
+
+/**@{*/
+
+/**
+ * Reading by reference
+ */
+
+/**
+ * @brief Read data into buffers the FSAL owns
+ *
+ * This function reads like read, but hands out the data in segments
+ * the FSAL keeps alive until the reference is released, so that a
+ * READ reply can be encoded from them without a buffer of its own.
+ * FSALs which can recycle reply buffers or already hold the data
+ * should implement it.
+ *
+ * The default calls read into a newly allocated buffer.
+ *
+ * @param[in]  obj_hdl     File to read
+ * @param[in]  offset      Position from which to read
+ * @param[in]  size        Amount of data to read
+ * @param[out] ref         The data, to release once sent.  Left NULL
+ *                         on error.
+ * @param[out] read_amount Amount of data read
+ * @param[out] end_of_file true if the end of file has been reached
+ *
+ * @return FSAL status.
+ */
+	 fsal_status_t(*read_ref) (struct fsal_obj_handle *obj_hdl,
+				   uint64_t offset,
+				   size_t size,
+				   struct gsh_read_ref **ref,
+				   size_t *read_amount,
+				   bool *end_of_file);
+/**@}*/
 };
 
 /**
@@ -224,11 +224,26 @@ typedef struct nfs_core_param {
 	    specific transport.  Defaults to 512 and settable by
 	    Dispatch_Max_Reqs_Xprt. */
 	uint32_t dispatch_max_reqs_xprt;
+	/** Number of request queue sets, 0 for one per online CPU.
+	    Settable by Dispatch_Queue_Sets. */
+	uint32_t dispatch_queue_sets;
+	/** Requests served in a row from each queue class before
+	    moving on to the next.  Settable by Dispatch_Weight_Mount,
+	    Dispatch_Weight_Call, Dispatch_Weight_Low_Latency and
+	    Dispatch_Weight_High_Latency. */
+	uint32_t dispatch_weight_mount;
+	uint32_t dispatch_weight_call;
+	uint32_t dispatch_weight_low_latency;
+	uint32_t dispatch_weight_high_latency;
 	/** Parameters controlling the Duplicate Request Cache.  */
 	struct {
 		/** Whether to disable the DRC entirely.  Defaults to
 		    false, settable by DRC_Disabled. */
 		bool disabled;
+		/** Whether to cache replies encoded rather than
+		    decoded.  Defaults to false, settable by
+		    DRC_Encoded_Replies. */
+		bool encoded_replies;
 		/* Parameters controlling TCP specific DRC behavior. */
 		struct {
 			/** Number of partitions in the tree for the
@@ -249,6 +264,15 @@ typedef struct nfs_core_param {
 			    we can.  Defaults to DRC_TCP_HIWAT and
 			    settable by DRC_TCP_Hiwat. */
 			uint32_t hiwat;
+			/** Maximum bytes held by a transport's DRC, 0
+			    for no limit.  Defaults to 0 and settable by
+			    DRC_TCP_Max_Bytes. */
+			uint64_t max_bytes;
+			/** Bytes held by a transport's DRC at which to
+			    start retiring entries if we can, 0 for no
+			    mark.  Defaults to 0 and settable by
+			    DRC_TCP_Hiwat_Bytes. */
+			uint64_t hiwat_bytes;
 			/** Number of partitions in the recycle
 			    tree that holds per-connection DRCs so
 			    they can be used on reconnection (or
@@ -288,6 +312,15 @@ typedef struct nfs_core_param {
 			    Defaults to DRC_UDP_HIWAT and settable by
 			    DRC_UDP_Hiwat. */
 			uint32_t hiwat;
+			/** Maximum bytes held by the UDP DRC, 0 for no
+			    limit.  Defaults to 0 and settable by
+			    DRC_UDP_Max_Bytes. */
+			uint64_t max_bytes;
+			/** Bytes held by the UDP DRC at which to start
+			    retiring entries if we can, 0 for no mark.
+			    Defaults to 0 and settable by
+			    DRC_UDP_Hiwat_Bytes. */
+			uint64_t hiwat_bytes;
 			/** Whether to use a checksum to match
 			    requests as well as the XID.  Defaults to
 			    DRC_UDP_CHECKSUM and settable by
@@ -350,6 +383,10 @@ typedef struct nfs_core_param {
 	    calling getgroups() when "Manage_Gids = TRUE" is
 	    used in a export entry. */
 	time_t manage_gids_expiration;
+	/** Number of threads looking up group lists for "Manage_Gids
+	    = TRUE".  Defaults to 8 and settable with
+	    Manage_Gids_Lookup_Threads. */
+	uint32_t manage_gids_lookup_threads;
 	/** Path to the directory containing server specific
 	    modules.  In particular, this is where FSALs live. */
 	char *ganesha_modules_loc;
@@ -416,6 +453,14 @@ typedef struct nfs_version4_parameter {
 	    group identifiers.  Defaults to true and is settable with
 	    Allow_Numeric_Owners. */
 	bool allow_numeric_owners;
+	/** Seconds after which an ID mapping is looked up again, the
+	    old one being used until the new one is known.  Defaults
+	    to 30 minutes and is settable with Idmap_Cache_Expiration. */
+	time_t idmap_cache_expiration;
+	/** Seconds a failed ID mapping lookup is remembered.  Defaults
+	    to 5 minutes and is settable with
+	    Idmap_Negative_Cache_Expiration. */
+	time_t idmap_negative_cache_expiration;
 	/** Whether to allow delegations. Defaults to false and settable
 	    with Delegations */
 	bool allow_delegations;
@@ -0,0 +1,92 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * @file gsh_read_ref.h
+ * @brief READ data replied from buffers held by their owner
+ *
+ * A READ reply normally carries data the protocol layer read into a
+ * buffer of its own, which XDR then copies to the transport.  When
+ * the data already sits in memory (the cache_inode data cache), the
+ * reply can instead point at it: the owner hands out the segments
+ * with a reference, XDR copies them straight to the transport, and
+ * the protocol layer releases the reference once the reply is sent.
+ */
+
+#ifndef GSH_READ_REF_H
+#define GSH_READ_REF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/uio.h>
+#include "gsh_rpc.h"
+
+/**
+ * @brief Segments of READ data held by their owner
+ */
+
+struct gsh_read_ref {
+	/** Drop the reference, the segments may go away */
+	void (*release)(struct gsh_read_ref *ref);
+	void *priv;		/*< For the owner */
+	uint32_t count;		/*< Segments */
+	struct iovec iov[];
+};
+
+static inline void gsh_read_ref_release(struct gsh_read_ref *ref)
+{
+	ref->release(ref);
+}
+
+/**
+ * @brief Encode the segments as XDR opaque data
+ *
+ * Same encoding as xdr_bytes of the concatenated segments.
+ *
+ * @param[in] xdrs XDR stream, encoding
+ * @param[in] ref  The segments
+ * @param[in] len  Their total length
+ *
+ * @return true on success.
+ */
+
+static inline bool xdr_gsh_read_ref(XDR *xdrs, struct gsh_read_ref *ref,
+				    u_int len)
+{
+	static const char zero[BYTES_PER_XDR_UNIT];
+	u_int pad = (BYTES_PER_XDR_UNIT - len % BYTES_PER_XDR_UNIT) %
+		    BYTES_PER_XDR_UNIT;
+	uint32_t i;
+
+	if (!xdr_u_int(xdrs, &len))
+		return false;
+
+	for (i = 0; i < ref->count; i++) {
+		if (!XDR_PUTBYTES(xdrs, ref->iov[i].iov_base,
+				  ref->iov[i].iov_len))
+			return false;
+	}
+
+	if (pad != 0 && !XDR_PUTBYTES(xdrs, zero, pad))
+		return false;
+
+	return true;
+}
+
+#endif				/* GSH_READ_REF_H */
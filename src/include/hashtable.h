@@ -73,10 +73,15 @@ typedef int (*both_function_t)(struct hash_param *, struct gsh_buffdesc *,
 typedef int (*hash_comparator_t)(struct gsh_buffdesc *, struct gsh_buffdesc *);
 typedef int (*key_display_function_t)(struct gsh_buffdesc *, char *);
 typedef int (*val_display_function_t)(struct gsh_buffdesc *, char *);
+typedef void (*entry_release_function_t)(struct gsh_buffdesc *,
+					 struct gsh_buffdesc *);
 
 #define HT_FLAG_NONE 0x0000	/*< Null hash table flags */
 #define HT_FLAG_CACHE 0x0001	/*< Indicates that caching should be
 				   enabled */
+#define HT_FLAG_RESIZE 0x0002	/*< Use growable hash chains with lock
+				   free lookups instead of trees, see
+				   hashtable.c.  The cache is not used. */
 
 /**
  * @brief Hash parameters
@@ -116,6 +121,12 @@ struct hash_param {
 					       to a string. */
 	val_display_function_t val_to_str; /*< Function to convert a
 					       value to a string. */
+	entry_release_function_t release_entry; /*< HT_FLAG_RESIZE only,
+						    called with a deleted
+						    or replaced entry once
+						    lock free lookups can
+						    no longer find it.
+						    Must not block. */
 	char *ht_name; /*< Name of this hash table. */
 	log_components_t ht_log_component; /*< Log component to use for this
 					       hash table */
@@ -144,11 +155,19 @@ typedef struct hash_stat {
  * a hash table.
  */
 
+struct hash_chains;
+struct hash_chain_node;
+
 struct hash_partition {
 	size_t count; /*< Numer of entries in this partition */
 	struct rbt_head rbt; /*< The red-black tree */
 	pthread_rwlock_t lock; /*< Lock for this partition */
 	struct rbt_node **cache; /*< Expected entry cache */
+	struct hash_chains *chains; /*< Hash chains (HT_FLAG_RESIZE) */
+	struct hash_chains *old_chains; /*< Chains being migrated to
+					    chains while growing */
+	uint32_t migrated; /*< Number of old chains migrated */
+	uint64_t grow_epoch; /*< Epoch at which the chains were grown */
 };
 
 /**
@@ -162,6 +181,11 @@ typedef struct hash_table {
 					 HashTable */
 	pool_t *node_pool; /*< Pool of RBT nodes */
 	pool_t *data_pool; /*< Pool of buffer pairs */
+	pthread_mutex_t retired_lock; /*< Lock for the retired list */
+	struct hash_retired *retired; /*< Unlinked nodes and chains waiting
+					  for lock free readers to leave,
+					  oldest first (HT_FLAG_RESIZE) */
+	struct hash_retired **retired_tail; /*< End of the retired list */
 	struct hash_partition partitions[]; /*< Parameter.index_size
 						partitions of the hash
 						table. */
@@ -178,6 +202,8 @@ struct hash_latch {
 	uint32_t index;	/*< Saved partition index */
 	uint64_t rbt_hash; /*< Saved red-black hash */
 	struct rbt_node *locator; /*< Saved location in the tree */
+	struct hash_chain_node *chain_node; /*< Saved entry
+					       (HT_FLAG_RESIZE) */
 };
 
 typedef enum hash_set_how {
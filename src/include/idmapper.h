@@ -54,22 +54,30 @@
  * @{
  */
 
-extern pthread_rwlock_t idmapper_user_lock;
-extern pthread_rwlock_t idmapper_group_lock;
+#define IDMAP_NAME 0x01		/*< Entry maps the name to the ID */
+#define IDMAP_ID 0x02		/*< Entry maps the ID to the name */
+#define IDMAP_NEGATIVE 0x04	/*< The lookup behind the entry failed */
+#define IDMAP_FOUND 0x08	/*< Lookup found an entry */
+#define IDMAP_STALE 0x10	/*< The caller is to refresh the entry */
 
 void idmapper_cache_init(void);
+void idmapper_rdlock(bool group);
+void idmapper_rdunlock(bool group);
+void idmapper_wrlock(bool group);
+void idmapper_wrunlock(bool group);
 bool idmapper_add_user(const struct gsh_buffdesc *, uid_t, const gid_t *,
-		       bool);
-bool idmapper_add_group(const struct gsh_buffdesc *, gid_t);
-bool idmapper_lookup_by_uname(const struct gsh_buffdesc *, uid_t *,
-			      const gid_t **, bool);
-bool idmapper_lookup_by_uid(const uid_t, const struct gsh_buffdesc **,
-			    const gid_t **);
-bool idmapper_lookup_by_gname(const struct gsh_buffdesc *, uid_t *);
-bool idmapper_lookup_by_gid(const gid_t, const struct gsh_buffdesc **);
+		       uint32_t);
+bool idmapper_add_group(const struct gsh_buffdesc *, gid_t, uint32_t);
+uint32_t idmapper_lookup_by_uname(const struct gsh_buffdesc *, uid_t *,
+				  const gid_t **);
+uint32_t idmapper_lookup_by_uid(const uid_t, const struct gsh_buffdesc **,
+				const gid_t **);
+uint32_t idmapper_lookup_by_gname(const struct gsh_buffdesc *, uid_t *);
+uint32_t idmapper_lookup_by_gid(const gid_t, const struct gsh_buffdesc **);
 /** @} */
 
 bool idmapper_init(void);
+int idmapper_shutdown(void);
 void idmapper_clear_cache(void);
 
 bool xdr_encode_nfs4_owner(XDR *, uid_t);
@@ -0,0 +1,107 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * @defgroup interval_tree Interval tree
+ *
+ * An AVL tree of closed intervals ordered by start, each node also
+ * holding the largest end found in its subtree.  That is enough to
+ * find all the intervals overlapping a range in O(log n + k), k being
+ * the number of matches, and to visit them in order of start.
+ *
+ * Nodes are embedded in the indexed object, the tree allocates
+ * nothing.  Intervals may share a start and may overlap each other.
+ * The caller serializes access.
+ *
+ * @{
+ */
+
+/**
+ * @file interval_tree.h
+ * @brief Interval tree
+ */
+
+#ifndef INTERVAL_TREE_H
+#define INTERVAL_TREE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Tree node, embedded in the indexed object
+ */
+
+struct interval_node {
+	struct interval_node *in_left;
+	struct interval_node *in_right;
+	struct interval_node *in_parent; /*< Self if not linked */
+	uint64_t in_start;		/*< First point of the interval */
+	uint64_t in_last;		/*< Last point of the interval */
+	uint64_t in_max;		/*< Largest in_last in the subtree */
+	int32_t in_height;		/*< Height of the subtree */
+};
+
+/**
+ * @brief The tree
+ */
+
+struct interval_tree {
+	struct interval_node *it_root;
+	uint64_t it_count;		/*< Number of linked nodes */
+};
+
+#define interval_entry(node, type, member) \
+	((type *)((char *)(node) - offsetof(type, member)))
+
+static inline void interval_tree_init(struct interval_tree *tree)
+{
+	tree->it_root = NULL;
+	tree->it_count = 0;
+}
+
+static inline void interval_node_init(struct interval_node *node)
+{
+	node->in_parent = node;
+}
+
+/**
+ * @brief Check whether a node is in a tree
+ *
+ * @param[in] node The node, initialized by interval_node_init()
+ */
+
+static inline bool interval_node_linked(const struct interval_node *node)
+{
+	return node->in_parent != node;
+}
+
+void interval_tree_insert(struct interval_tree *tree,
+			  struct interval_node *node,
+			  uint64_t start, uint64_t last);
+void interval_tree_remove(struct interval_tree *tree,
+			  struct interval_node *node);
+struct interval_node *interval_tree_first(struct interval_tree *tree,
+					  uint64_t start, uint64_t last);
+struct interval_node *interval_tree_next(struct interval_node *node,
+					 uint64_t start, uint64_t last);
+
+#endif				/* INTERVAL_TREE_H */
+
+/** @} */
@@ -8,6 +8,7 @@
 
 #include "gsh_rpc.h"
 #include "extended_types.h"
+#include "gsh_read_ref.h"
 
 #include "mount.h"
 
@@ -446,6 +447,8 @@ struct READ3resok {
 		u_int data_len;
 		char *data_val;
 	} data;
+	/* Not on the wire, data when data_val is NULL */
+	struct gsh_read_ref *data_ref;
 };
 typedef struct READ3resok READ3resok;
 
@@ -131,6 +131,8 @@ extern time_t ServerEpoch;
 extern verifier4 NFS4_write_verifier;	/*< NFS V4 write verifier */
 extern writeverf3 NFS3_write_verifier;	/*< NFS V3 write verifier */
 
+void nfs_change_write_verifier(void);
+
 extern nfs_worker_data_t *workers_data;
 extern char *config_path;
 extern char *pidfile_path;
@@ -38,6 +38,7 @@
 #include "nfs23.h"
 #include "nfs4.h"
 #include "nfs_core.h"
+#include "gsh_intrinsic.h"
 #include <misc/rbtree_x.h>
 #include <misc/queue.h>
 
@@ -56,19 +57,34 @@ enum drc_type {
 #define DRC_FLAG_RECYCLE 0x0020
 #define DRC_FLAG_RELEASE 0x0040
 
+/**
+ * @brief Retire queue and counters of one partition of a DRC
+ *
+ * Protected by the lock of the same partition of the DRC tree, so
+ * inserting and retiring requests takes no DRC-wide lock.  The limits
+ * of the DRC hold approximately, each partition keeping to its share.
+ */
+struct drc_part {
+	TAILQ_HEAD(drc_tailq, dupreq_entry) dupreq_q;
+	uint32_t size;
+	uint32_t retwnd;
+	uint64_t bytes;		/* held by the entries */
+	CACHE_PAD(0);
+};
+
 typedef struct drc {
 	enum drc_type type;
 	struct rbtree_x xt;
-	TAILQ_HEAD(drc_tailq, dupreq_entry) dupreq_q;
+	struct drc_part *parts;	/* one per partition of xt */
 	pthread_mutex_t mtx;
 	uint32_t npart;
 	uint32_t cachesz;
-	uint32_t size;
 	uint32_t maxsize;
 	uint32_t hiwat;
+	uint64_t max_bytes;
+	uint64_t hiwat_bytes;
 	uint32_t flags;
 	uint32_t refcnt; /* call path refs */
-	uint32_t retwnd;
 	union {
 		struct {
 			sockaddr_t addr;
@@ -80,6 +96,16 @@ typedef struct drc {
 	} d_u;
 } drc_t;
 
+/**
+ * @brief An encoded reply, shared by the entry and its replays
+ */
+
+struct dupreq_reply {
+	int32_t refcnt;
+	uint32_t len;
+	char data[];
+};
+
 typedef enum dupreq_state {
 	DUPREQ_START = 0,
 	DUPREQ_COMPLETE,
@@ -105,6 +131,8 @@ struct dupreq_entry {
 	dupreq_state_t state;
 	uint32_t refcnt;
 	nfs_res_t *res;
+	struct dupreq_reply *reply;	/* instead of res if encoded */
+	uint64_t bytes;		/* counted in the DRC */
 	time_t timestamp;
 };
 
@@ -144,5 +172,7 @@ dupreq_status_t nfs_dupreq_start(nfs_request_data_t *,
 dupreq_status_t nfs_dupreq_finish(struct svc_req *, nfs_res_t *);
 dupreq_status_t nfs_dupreq_delete(struct svc_req *);
 void nfs_dupreq_rele(struct svc_req *, const nfs_function_desc_t *);
+void dupreq_reply_put(struct dupreq_reply *);
+bool xdr_dupreq_reply(XDR *, struct dupreq_reply *);
 
 #endif /* NFS_DUPREQ_H */
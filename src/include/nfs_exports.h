@@ -103,6 +103,7 @@ typedef struct exportlist_client_entry__ {
 		} gssprinc;
 	} client;
 	struct export_perms client_perms;	/*< Available mount options */
+	struct rate_limit rate_limit;	/*< Limits for the matching clients */
 } exportlist_client_entry_t;
 
 /* Constants for export options masks */
@@ -112,6 +113,8 @@ typedef struct exportlist_client_entry__ {
 /** Controls whether a directory's dirent cache is trusted for
     negative results. */
 #define EXPORT_OPTION_TRUST_READIR_NEGATIVE_CACHE 0x00000008
+/** Cache the data read through this export, see Data_Cache_Size */
+#define EXPORT_OPTION_DATA_CACHE 0x00000010
 
 /* Constants for export permissions masks */
 #define EXPORT_OPTION_ROOT 0x00000001	/*< Allow root access as root uid */
@@ -198,6 +201,11 @@ typedef struct exportlist_client_entry__ {
 
 /* Export list related functions */
 void export_check_access(void);
+void export_client_cache_purge(void);
+
+extern uint32_t export_rate_limits;
+nsecs_elapsed_t export_rate_limit(struct gsh_export *export,
+				  sockaddr_t *hostaddr, uint64_t bytes);
 
 bool export_check_security(struct svc_req *req);
 
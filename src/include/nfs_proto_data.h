@@ -209,6 +209,8 @@ typedef struct nfs_request_data {
 	struct nfs_request_lookahead lookahead;
 	nfs_arg_t arg_nfs;
 	nfs_res_t *res_nfs;
+	struct dupreq_reply *reply;	/*< Encoded reply of a duplicate,
+					    replayed instead of res_nfs */
 	const nfs_function_desc_t *funcdesc;
 } nfs_request_data_t;
 
@@ -35,6 +35,7 @@
 #ifndef NFS_REQ_QUEUE_H
 #define NFS_REQ_QUEUE_H
 
+#include <sched.h>
 #include "gsh_list.h"
 #include "wait_queue.h"
 
@@ -52,13 +53,17 @@ struct req_q {
 	uint32_t waiters;
 };
 
-struct req_q_pair {
+/* Number of flows in a class.  Requests are hashed to a flow by
+ * client address and the flows of a class are served in turn, so a
+ * few busy clients mostly queue behind each other.
+ */
+#define REQ_Q_FLOWS 8
+
+struct req_q_class {
 	const char *s;
+	uint32_t next;		/* next flow to serve */
 	 CACHE_PAD(0);
-	struct req_q producer;	/* from decoder */
-	 CACHE_PAD(1);
-	struct req_q consumer;	/* to executor */
-	 CACHE_PAD(2);
+	struct req_q flow[REQ_Q_FLOWS];
 };
 
 #define REQ_Q_MOUNT 0
@@ -69,18 +74,37 @@ struct req_q_pair {
 
 extern const char *req_q_s[N_REQ_QUEUES];	/* for debug prints */
 
+/**
+ * @brief The queues of one CPU
+ *
+ * Decoders queue requests on the set of the CPU they run on and
+ * workers serve the set of their own CPU first.  A worker finding its
+ * set empty steals from the other sets before going to sleep on the
+ * wait list of its set.
+ *
+ * The classes of a set are served by deficit round robin: the class
+ * being served gets as many requests as its weight before moving on,
+ * and a class found empty gives up the rest of its turn.
+ */
+
 struct req_q_set {
-	struct req_q_pair qset[N_REQ_QUEUES];
-};
+	struct req_q_class qset[N_REQ_QUEUES];
+	pthread_spinlock_t sched_sp;	/* protects cur and deficit */
+	uint32_t cur;		/* class being served */
+	int32_t deficit[N_REQ_QUEUES];	/* requests left in its turn */
+	pthread_spinlock_t sp;	/* protects wait_list */
+	struct glist_head wait_list;	/* idle workers */
+	uint32_t waiters;
+	uint64_t enqueued;	/* requests queued on this set */
+	uint64_t stolen;	/* requests taken by workers of other sets */
+} __attribute__ ((aligned(CACHE_LINE_SIZE)));
 
 struct nfs_req_st {
 	struct {
 		uint32_t ctr;
-		struct req_q_set nfs_request_q;
+		uint32_t nsets;	/* number of queue sets */
+		struct req_q_set *nfs_request_q;	/* nsets queue sets */
 		uint64_t size;
-		pthread_spinlock_t sp;
-		struct glist_head wait_list;
-		uint32_t waiters;
 	} reqs;
 	 CACHE_PAD(1);
 	struct {
@@ -103,6 +127,22 @@ static inline void nfs_rpc_q_init(struct req_q *q)
 	q->waiters = 0;
 }
 
+/**
+ * @brief Number of requests queued in a class
+ *
+ * Read without locking, only an estimate.
+ */
+static inline uint32_t nfs_rpc_q_class_size(struct req_q_class *qclass)
+{
+	uint32_t size = 0;
+	int ix;
+
+	for (ix = 0; ix < REQ_Q_FLOWS; ++ix)
+		size += atomic_fetch_uint32_t(&qclass->flow[ix].size);
+
+	return size;
+}
+
 static inline uint32_t nfs_rpc_q_next_slot(void)
 {
 	uint32_t ix = atomic_inc_uint32_t(&nfs_req_st.reqs.ctr);
@@ -111,19 +151,38 @@ static inline uint32_t nfs_rpc_q_next_slot(void)
 	return ix;
 }
 
+/**
+ * @brief Index of the queue set of the calling thread's CPU
+ */
+static inline uint32_t nfs_rpc_q_set_self(void)
+{
+	int cpu = sched_getcpu();
+
+	if (cpu < 0)
+		return nfs_rpc_q_next_slot() % nfs_req_st.reqs.nsets;
+
+	return (uint32_t) cpu % nfs_req_st.reqs.nsets;
+}
+
 static inline void nfs_rpc_queue_awaken(void *arg)
 {
 	struct nfs_req_st *st = arg;
+	struct req_q_set *qset;
 	struct glist_head *g = NULL;
 	struct glist_head *n = NULL;
-
-	pthread_spin_lock(&st->reqs.sp);
-	glist_for_each_safe(g, n, &st->reqs.wait_list) {
-		wait_q_entry_t *wqe = glist_entry(g, wait_q_entry_t, waitq);
-		pthread_cond_signal(&wqe->lwe.cv);
-		pthread_cond_signal(&wqe->rwe.cv);
+	uint32_t ix;
+
+	for (ix = 0; ix < st->reqs.nsets; ++ix) {
+		qset = &st->reqs.nfs_request_q[ix];
+		pthread_spin_lock(&qset->sp);
+		glist_for_each_safe(g, n, &qset->wait_list) {
+			wait_q_entry_t *wqe =
+			    glist_entry(g, wait_q_entry_t, waitq);
+			pthread_cond_signal(&wqe->lwe.cv);
+			pthread_cond_signal(&wqe->rwe.cv);
+		}
+		pthread_spin_unlock(&qset->sp);
 	}
-	pthread_spin_unlock(&st->reqs.sp);
 }
 
 #endif				/* NFS_REQ_QUEUE_H */
@@ -21,6 +21,7 @@ extern "C" {
 
 #include "gsh_rpc.h"
 #include "nfs_fh.h"
+#include "gsh_read_ref.h"
 
 	typedef struct authsys_parms authsys_parms;
 #endif				/* _AUTH_SYS_DEFINE_FOR_NFSv41 */
@@ -1634,6 +1635,8 @@ extern "C" {
 			u_int data_len;
 			char *data_val;
 		} data;
+		/* Not on the wire, data when data_val is NULL */
+		struct gsh_read_ref *data_ref;
 	};
 	typedef struct READ4resok READ4resok;
 
@@ -5997,6 +6000,10 @@ extern "C" {
 	{
 		if (!inline_xdr_bool(xdrs, &objp->eof))
 			return false;
+		if (xdrs->x_op == XDR_ENCODE && objp->data.data_val == NULL &&
+		    objp->data_ref != NULL)
+			return xdr_gsh_read_ref(xdrs, objp->data_ref,
+						objp->data.data_len);
 		if (!inline_xdr_bytes
 		    (xdrs, (char **)&objp->data.data_val,
 		     (u_int *) & objp->data.data_len, ~0))
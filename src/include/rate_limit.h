@@ -0,0 +1,92 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * @defgroup rate_limit Request rate limits
+ *
+ * Limits on the operations and bytes per second allowed to an export,
+ * or to the clients matching one of its client entries.
+ *
+ * Each limit is a token bucket holding up to one second worth of
+ * tokens.  Like the generic cell rate algorithm, the bucket is kept
+ * as the single time at which it will be full again, pushed forward
+ * by the cost of each request, so taking tokens is one compare and
+ * swap without any lock.
+ *
+ * @{
+ */
+
+/**
+ * @file rate_limit.h
+ * @brief Request rate limits
+ */
+
+#ifndef RATE_LIMIT_H
+#define RATE_LIMIT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "gsh_types.h"
+
+/**
+ * @brief Operation and byte rate limit
+ */
+
+struct rate_limit {
+	uint64_t ops_rate;	/*< Operations per second, 0 for no limit */
+	uint64_t bytes_rate;	/*< Bytes per second, 0 for no limit */
+	uint64_t ops_full;	/*< Time the ops bucket is full again */
+	uint64_t bytes_full;	/*< Time the bytes bucket is full again */
+};
+
+/**
+ * @brief Check whether any limit is set
+ *
+ * @param[in] rl The limit
+ */
+
+static inline bool rate_limit_set(const struct rate_limit *rl)
+{
+	return rl->ops_rate != 0 || rl->bytes_rate != 0;
+}
+
+/**
+ * @brief Copy the configured rates of a limit, with full buckets
+ *
+ * @param[out] dst Limit to set up
+ * @param[in]  src Configured limit
+ */
+
+static inline void rate_limit_init(struct rate_limit *dst,
+				   const struct rate_limit *src)
+{
+	dst->ops_rate = src->ops_rate;
+	dst->bytes_rate = src->bytes_rate;
+	dst->ops_full = 0;
+	dst->bytes_full = 0;
+}
+
+nsecs_elapsed_t rate_limit_clock(void);
+nsecs_elapsed_t rate_limit_take(struct rate_limit *rl, uint64_t bytes,
+				nsecs_elapsed_t now);
+void rate_limit_refund(struct rate_limit *rl, uint64_t bytes);
+
+#endif				/* RATE_LIMIT_H */
+
+/** @} */
@@ -47,6 +47,8 @@
 #include "abstract_atomic.h"
 #include "abstract_mem.h"
 #include "hashtable.h"
+#include "timer_wheel.h"
+#include "interval_tree.h"
 #include "fsal_pnfs.h"
 #include "config_parsing.h"
 
@@ -404,6 +406,7 @@ extern hash_table_t *ht_nlm_owner;
 extern hash_table_t *ht_9p_owner;
 #endif
 extern hash_table_t *ht_nfs4_owner;
+extern struct timer_wheel open_owner_wheel;
 
 /**
  * @brief A structure identifying the owner of an NFSv4 open or lock state
@@ -555,6 +558,8 @@ struct state_nfs4_owner_t {
 	struct glist_head so_perclient;  /*< open owner entry to be
 					   linked to client */
 	time_t last_close_time; /* time last CLOSE op performed */
+	struct timer_wheel_entry so_expiry; /*< Reaper timer for cached
+					      open owners */
 };
 
 /**
@@ -687,6 +692,7 @@ struct nfs_client_id_t {
 				       this client */
 	uint32_t num_revokes;       /* Num revokes for the client */
 	struct gsh_client *gsh_client; /* for client specific statistics. */
+	struct timer_wheel_entry cid_expiry; /*< Reaper timer for the lease */
 };
 
 /**
@@ -722,6 +728,7 @@ extern pool_t *client_id_pool;
 extern hash_table_t *ht_client_record;
 extern hash_table_t *ht_confirmed_client_id;
 extern hash_table_t *ht_unconfirmed_client_id;
+extern struct timer_wheel clientid_wheel;
 
 /******************************************************************************
  *
@@ -789,6 +796,7 @@ struct state_block_data_t {
 
 struct state_lock_entry_t {
 	struct glist_head sle_list;	/*< Locks on this file */
+	struct interval_node sle_range;	/*< Link in the file's lock tree */
 	struct glist_head sle_owner_locks; /*< Link on the owner lock list */
 	struct glist_head sle_locks;	/*< Locks on this state/client */
 #ifdef DEBUG_SAL
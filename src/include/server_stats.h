@@ -41,6 +41,8 @@
 
 #include <sys/types.h>
 
+void server_stats_init(void);
+
 void server_stats_nfs_done(request_data_t *reqdata, int rc, bool dup);
 
 void server_stats_io_done(size_t requested,
@@ -48,10 +50,19 @@ void server_stats_io_done(size_t requested,
 void server_stats_compound_done(int num_ops, int status);
 void server_stats_nfsv4_op_done(int proto_op,
 				nsecs_elapsed_t start_time, int status);
+void server_stats_queue_wait(uint32_t qclass, nsecs_elapsed_t qwait);
+void server_stats_uid2grp_lookup(nsecs_elapsed_t latency, bool success,
+				 bool refresh);
+void server_stats_uid2grp_coalesced(void);
+void server_stats_throttled(struct gsh_client *client,
+			    struct gsh_export *export);
+void server_stats_readahead(struct gsh_export *export, uint64_t read,
+			    uint64_t hit, uint64_t wasted);
 void server_stats_transport_done(struct gsh_client *client,
 				uint64_t rx_bytes, uint64_t rx_pkt,
 				uint64_t rx_err, uint64_t tx_bytes,
 				uint64_t tx_pkt, uint64_t tx_err);
+void server_stats_9p_msgbuf(struct gsh_client *client, bool hit);
 
 /* For delegations */
 void inc_grants(struct gsh_client *client);
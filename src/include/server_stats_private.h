@@ -71,6 +71,11 @@ struct gsh_stats {
 	struct nfsv41_stats *nfsv42;
 	struct deleg_stats *deleg;
 	struct _9p_stats *_9p;
+	uint64_t throttled;	/* requests deferred by rate limits */
+	uint64_t ra_bytes;	/* bytes read ahead (exports) */
+	uint64_t ra_hit;	/* bytes read ahead then read */
+	uint64_t ra_wasted;	/* bytes read ahead then dropped unread */
+	uint32_t shards;	/* per worker copies of each proto struct */
 };
 
 /**
@@ -135,6 +140,53 @@ struct export_stats {
 	.direction = "out" \
 }
 
+/* Latency histograms are (samples, p50, p90, p99, p999,
+ * array of (bucket upper bound, count)), all times in nsecs.
+ */
+
+#define LATENCY_HIST_TYPE "(ttttta(tt))"
+
+#define LATENCY_REPLY			\
+{					\
+	.name = "read_latency",		\
+	.type = LATENCY_HIST_TYPE,	\
+	.direction = "out"		\
+},					\
+{					\
+	.name = "read_queue_wait",	\
+	.type = LATENCY_HIST_TYPE,	\
+	.direction = "out"		\
+},					\
+{					\
+	.name = "write_latency",	\
+	.type = LATENCY_HIST_TYPE,	\
+	.direction = "out"		\
+},					\
+{					\
+	.name = "write_queue_wait",	\
+	.type = LATENCY_HIST_TYPE,	\
+	.direction = "out"		\
+},					\
+{					\
+	.name = "other_latency",	\
+	.type = LATENCY_HIST_TYPE,	\
+	.direction = "out"		\
+},					\
+{					\
+	.name = "other_queue_wait",	\
+	.type = LATENCY_HIST_TYPE,	\
+	.direction = "out"		\
+}
+
+#define OP_LATENCY_REPLY_ARRAY_TYPE "(sttttt)"
+#define OP_LATENCY_REPLY			\
+{						\
+	.name = "op_latency",			\
+	.type = DBUS_TYPE_ARRAY_AS_STRING	\
+		OP_LATENCY_REPLY_ARRAY_TYPE,	\
+	.direction = "out"			\
+}
+
 #define TRANSPORT_REPLY    \
 {                          \
 	.name = "rx_bytes",\
@@ -165,6 +217,16 @@ struct export_stats {
 	.name = "tx_err",  \
 	.type = "(t)",     \
 	.direction = "out" \
+},                         \
+{                          \
+	.name = "rx_buf_hits",\
+	.type = "(t)",     \
+	.direction = "out" \
+},                         \
+{                          \
+	.name = "rx_buf_misses",\
+	.type = "(t)",     \
+	.direction = "out" \
 }
 
 #define TOTAL_OPS_REPLY      \
@@ -210,6 +272,44 @@ struct export_stats {
 	.direction = "out"	       \
 }
 
+/* requests deferred by rate limits */
+#define THROTTLED_REPLY			\
+{					\
+	.name = "throttled",		\
+	.type = "(t)",			\
+	.direction = "out"		\
+}
+
+/* bytes read ahead, read ahead then read, dropped unread */
+#define READAHEAD_REPLY			\
+{					\
+	.name = "readahead",		\
+	.type = "(ttt)",		\
+	.direction = "out"		\
+}
+
+/* configured operations and bytes per second, 0 if unlimited */
+#define RATE_LIMIT_REPLY		\
+{					\
+	.name = "rate_limit",		\
+	.type = "(tt)",			\
+	.direction = "out"		\
+}
+
+/* managed gids lookups, failed lookups, callers that waited on
+ * another's lookup, lookups of expired lists, lookup latency */
+#define UID2GRP_REPLY			\
+{					\
+	.name = "lookups",		\
+	.type = "(tttt)",		\
+	.direction = "out"		\
+},					\
+{					\
+	.name = "lookup_latency",	\
+	.type = LATENCY_HIST_TYPE,	\
+	.direction = "out"		\
+}
+
 #define NFS_ALL_IO_REPLY_ARRAY_TYPE "(qs(tttttt)(tttttt))"
 #define NFS_ALL_IO_REPLY			\
 {						\
@@ -219,14 +319,52 @@ struct export_stats {
 	.direction = "out"			\
 }						\
 
+/* set, depth of each class queue (mount, call, low and high latency),
+ * requests enqueued on the set, requests stolen by other sets */
+#define REQ_QUEUES_REPLY_ARRAY_TYPE "(uuuuutt)"
+#define REQ_QUEUES_REPLY			\
+{						\
+	.name = "queues",			\
+	.type = DBUS_TYPE_ARRAY_AS_STRING	\
+		REQ_QUEUES_REPLY_ARRAY_TYPE,	\
+	.direction = "out"			\
+},						\
+{						\
+	.name = "mount_queue_wait",		\
+	.type = LATENCY_HIST_TYPE,		\
+	.direction = "out"			\
+},						\
+{						\
+	.name = "call_queue_wait",		\
+	.type = LATENCY_HIST_TYPE,		\
+	.direction = "out"			\
+},						\
+{						\
+	.name = "low_latency_queue_wait",	\
+	.type = LATENCY_HIST_TYPE,		\
+	.direction = "out"			\
+},						\
+{						\
+	.name = "high_latency_queue_wait",	\
+	.type = LATENCY_HIST_TYPE,		\
+	.direction = "out"			\
+}
+
 void server_stats_summary(DBusMessageIter *iter, struct gsh_stats *st);
-void server_dbus_v3_iostats(struct nfsv3_stats *v3p, DBusMessageIter *iter);
-void server_dbus_v40_iostats(struct nfsv40_stats *v40p, DBusMessageIter *iter);
-void server_dbus_v41_iostats(struct nfsv41_stats *v41p, DBusMessageIter *iter);
-void server_dbus_v41_layouts(struct nfsv41_stats *v41p, DBusMessageIter *iter);
-void server_dbus_v42_iostats(struct nfsv41_stats *v42p, DBusMessageIter *iter);
-void server_dbus_v42_layouts(struct nfsv41_stats *v42p, DBusMessageIter *iter);
+void server_dbus_v3_iostats(struct gsh_stats *st, DBusMessageIter *iter);
+void server_dbus_v40_iostats(struct gsh_stats *st, DBusMessageIter *iter);
+void server_dbus_v41_iostats(struct gsh_stats *st, DBusMessageIter *iter);
+void server_dbus_v41_layouts(struct gsh_stats *st, DBusMessageIter *iter);
+void server_dbus_v42_iostats(struct gsh_stats *st, DBusMessageIter *iter);
+void server_dbus_v42_layouts(struct gsh_stats *st, DBusMessageIter *iter);
+void server_dbus_v3_latency(struct gsh_stats *st, DBusMessageIter *iter);
+void server_dbus_v40_latency(struct gsh_stats *st, DBusMessageIter *iter);
+void server_dbus_v41_latency(struct gsh_stats *st, DBusMessageIter *iter);
+void server_dbus_v42_latency(struct gsh_stats *st, DBusMessageIter *iter);
+void server_dbus_global_latency(DBusMessageIter *iter);
 void server_dbus_delegations(struct deleg_stats *ds, DBusMessageIter *iter);
+void server_dbus_throttled(struct gsh_stats *st, DBusMessageIter *iter);
+void server_dbus_readahead(struct gsh_stats *st, DBusMessageIter *iter);
 void server_dbus_all_iostats(struct export_stats *export_statistics,
 			     DBusMessageIter *iter);
 void server_dbus_total_ops(struct export_stats *export_st,
@@ -234,16 +372,19 @@ void server_dbus_total_ops(struct export_stats *export_st,
 void global_dbus_total_ops(DBusMessageIter *iter);
 void server_dbus_fast_ops(DBusMessageIter *iter);
 void cache_inode_dbus_show(DBusMessageIter *iter);
+void nfs_rpc_queue_dbus_show(DBusMessageIter *iter);
+void server_dbus_queue_wait(DBusMessageIter *iter);
+void server_dbus_uid2grp(DBusMessageIter *iter);
 
-void server_dbus_9p_iostats(struct _9p_stats *_9pp, DBusMessageIter *iter);
-void server_dbus_9p_transstats(struct _9p_stats *_9pp, DBusMessageIter *iter);
-void server_dbus_9p_tcpstats(struct _9p_stats *_9pp, DBusMessageIter *iter);
-void server_dbus_9p_rdmastats(struct _9p_stats *_9pp, DBusMessageIter *iter);
+void server_dbus_9p_iostats(struct gsh_stats *st, DBusMessageIter *iter);
+void server_dbus_9p_transstats(struct gsh_stats *st, DBusMessageIter *iter);
+void server_dbus_9p_tcpstats(struct gsh_stats *st, DBusMessageIter *iter);
+void server_dbus_9p_rdmastats(struct gsh_stats *st, DBusMessageIter *iter);
 #endif				/* USE_DBUS */
 
 void server_stats_free(struct gsh_stats *statsp);
 
-void server_stats_init(void);
+void server_stats_set_sharded(struct gsh_stats *statsp);
 
 #endif				/* !SERVER_STATS_PRIVATE_H */
 /** @} */
@@ -0,0 +1,109 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * @file sharded_rwlock.h
+ * @brief A rwlock for data read by every request and rarely changed
+ *
+ * With a single rwlock, the cache line of the lock bounces between
+ * all the threads taking it, even though they only read.  The lock
+ * is instead made of shards: a reader takes the shard of its thread
+ * for read, a writer takes all of them for write.  Writers pay for
+ * it, so this is only for data that rarely changes, such as the
+ * idmapper and uid2grp caches.
+ */
+
+#ifndef SHARDED_RWLOCK_H
+#define SHARDED_RWLOCK_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "gsh_intrinsic.h"
+#include "abstract_atomic.h"
+#include "common_utils.h"
+
+/**
+ * @brief Number of shards, a power of 2
+ */
+
+#define SHARDED_RWLOCK_SHARDS 16
+
+struct sharded_rwlock_shard {
+	pthread_rwlock_t lock;
+} __attribute__ ((aligned(CACHE_LINE_SIZE)));
+
+struct sharded_rwlock {
+	struct sharded_rwlock_shard shards[SHARDED_RWLOCK_SHARDS];
+};
+
+/**
+ * @brief Read shard of the calling thread
+ *
+ * Each thread picks a shard round robin the first time it reads and
+ * sticks to it.
+ */
+
+static inline uint32_t sharded_rwlock_this_shard(void)
+{
+	static uint32_t next_shard;
+	static __thread int32_t shard = -1;
+
+	if (unlikely(shard < 0))
+		shard = atomic_postinc_uint32_t(&next_shard) &
+			(SHARDED_RWLOCK_SHARDS - 1);
+	return shard;
+}
+
+static inline void sharded_rwlock_init(struct sharded_rwlock *lock)
+{
+	int i;
+
+	for (i = 0; i < SHARDED_RWLOCK_SHARDS; i++)
+		PTHREAD_RWLOCK_init(&lock->shards[i].lock, NULL);
+}
+
+static inline void sharded_rwlock_rdlock(struct sharded_rwlock *lock)
+{
+	PTHREAD_RWLOCK_rdlock(
+		&lock->shards[sharded_rwlock_this_shard()].lock);
+}
+
+static inline void sharded_rwlock_rdunlock(struct sharded_rwlock *lock)
+{
+	PTHREAD_RWLOCK_unlock(
+		&lock->shards[sharded_rwlock_this_shard()].lock);
+}
+
+static inline void sharded_rwlock_wrlock(struct sharded_rwlock *lock)
+{
+	int i;
+
+	for (i = 0; i < SHARDED_RWLOCK_SHARDS; i++)
+		PTHREAD_RWLOCK_wrlock(&lock->shards[i].lock);
+}
+
+static inline void sharded_rwlock_wrunlock(struct sharded_rwlock *lock)
+{
+	int i;
+
+	for (i = SHARDED_RWLOCK_SHARDS - 1; i >= 0; i--)
+		PTHREAD_RWLOCK_unlock(&lock->shards[i].lock);
+}
+
+#endif				/* SHARDED_RWLOCK_H */
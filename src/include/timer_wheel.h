@@ -0,0 +1,118 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * @defgroup timer_wheel Timer wheel
+ *
+ * A hashed timer wheel with one second ticks, used to find the
+ * objects whose expiry time has passed without walking all of them.
+ *
+ * Entries are embedded in the object they time.  Arming an entry is
+ * O(1).  Entries due further away than the wheel spans are simply
+ * looked at again once per revolution, so the wheel should be sized
+ * to cover the usual expiry delay (the lease time for the reaper).
+ *
+ * Re-arming is lazy: the owner of an entry may push its deadline
+ * back without touching the wheel, the expiry callback is expected
+ * to check the real deadline and call timer_wheel_arm() again if it
+ * is not due yet.
+ *
+ * @{
+ */
+
+/**
+ * @file timer_wheel.h
+ * @brief Timer wheel for object expiry
+ */
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+#include "gsh_list.h"
+
+#define TW_ARMED 0x01		/*< Linked in a slot */
+#define TW_RUNNING 0x02		/*< Expiry callback is running */
+
+/**
+ * @brief Timer entry, embedded in the timed object
+ */
+
+struct timer_wheel_entry {
+	struct glist_head twe_list;	/*< Slot or expiry list link */
+	time_t twe_when;		/*< Deadline */
+	uint32_t twe_flags;		/*< TW_ARMED, TW_RUNNING */
+};
+
+/**
+ * @brief The wheel
+ */
+
+struct timer_wheel {
+	pthread_mutex_t tw_mtx;		/*< Protects everything below */
+	pthread_cond_t tw_cv;		/*< Signalled when a callback ends */
+	struct glist_head *tw_slots;	/*< One list per second */
+	uint32_t tw_mask;		/*< Number of slots - 1 */
+	time_t tw_now;			/*< First tick not yet expired */
+	pthread_t tw_runner;		/*< Thread running callbacks */
+	struct timer_wheel_entry *tw_current;	/*< Entry in the callback */
+	uint64_t tw_armed;		/*< Number of armed entries */
+};
+
+/**
+ * @brief Expiry callback
+ *
+ * Called without the wheel lock held, the entry is neither armed
+ * nor freeable (timer_wheel_cancel() from other threads waits) until
+ * it returns.  The callback may re-arm or cancel the entry and may
+ * free the object once it is unreachable.
+ */
+
+typedef void (*timer_wheel_cb_t)(struct timer_wheel_entry *entry,
+				 time_t now, void *arg);
+
+int timer_wheel_init(struct timer_wheel *wheel, uint32_t span);
+void timer_wheel_destroy(struct timer_wheel *wheel);
+
+/**
+ * @brief Initialize a timer entry
+ *
+ * @param[in] entry The entry
+ */
+
+static inline void timer_wheel_entry_init(struct timer_wheel_entry *entry)
+{
+	glist_init(&entry->twe_list);
+	entry->twe_when = 0;
+	entry->twe_flags = 0;
+}
+
+void timer_wheel_arm(struct timer_wheel *wheel,
+		     struct timer_wheel_entry *entry, time_t when);
+void timer_wheel_cancel(struct timer_wheel *wheel,
+			struct timer_wheel_entry *entry);
+uint64_t timer_wheel_expire(struct timer_wheel *wheel, time_t now,
+			    timer_wheel_cb_t cb, void *arg);
+
+#endif				/* TIMER_WHEEL_H */
+
+/** @} */
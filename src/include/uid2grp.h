@@ -58,12 +58,15 @@ typedef struct group_data {
 	int nbgroups;
 	unsigned int refcount;
 	pthread_mutex_t lock;
+	bool refreshing;	/*< A lookup will replace it, under lock */
 	gid_t *groups;
 } group_data_t;
 
-extern pthread_rwlock_t uid2grp_user_lock;
-
 void uid2grp_cache_init(void);
+void uid2grp_rdlock(void);
+void uid2grp_rdunlock(void);
+void uid2grp_wrlock(void);
+void uid2grp_wrunlock(void);
 
 bool uid2grp_add_user(struct group_data *);
 bool uid2grp_lookup_by_uname(const struct gsh_buffdesc *, uid_t *,
@@ -75,6 +78,9 @@ void uid2grp_remove_by_uid(const uid_t);
 
 void uid2grp_clear_cache(void);
 
+bool uid2grp_init(void);
+int uid2grp_shutdown(void);
+
 bool uid2grp(uid_t uid, struct group_data **);
 bool name2grp(const struct gsh_buffdesc *name, struct group_data **gdata);
 void uid2grp_unref(struct group_data *gdata);
@@ -37,6 +37,8 @@
 #include <sys/types.h>
 #include <sys/param.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <limits.h>
 #include <errno.h>
 #include <string.h>
 #include <signal.h>
@@ -219,11 +221,64 @@ static int log_to_file(log_header_t headers, void *private,
 		       struct display_buffer *buffer, char *compstr,
 		       char *message);
 
+static int log_to_file_async(log_header_t headers, void *private,
+			     log_levels_t level,
+			     struct display_buffer *buffer, char *compstr,
+			     char *message);
+
 static int log_to_stream(log_header_t headers, void *private,
 			 log_levels_t level,
 			 struct display_buffer *buffer, char *compstr,
 			 char *message);
 
+/**
+ * @brief A slot in the ring of an asynchronous file facility
+ *
+ * The slot sequence number makes the ring a bounded multi-producer
+ * queue.  The slot for ring position pos is free for a producer when
+ * seq == pos and holds a complete line for the writer when
+ * seq == pos + 1.
+ */
+struct async_log_slot {
+	uint64_t seq;		/*< Slot ticket */
+	uint32_t len;		/*< Length of line including newline */
+	char line[LOG_BUFF_LEN + 2];	/*< Formatted line */
+};
+
+/**
+ * @brief Private data of an asynchronous file facility
+ *
+ * Callers copy their formatted line into the ring and return.  A
+ * dedicated writer thread drains the ring with writev() into a file
+ * descriptor that stays open for the life of the facility.
+ */
+struct async_log_file {
+	struct glist_head alf_list;	/*< Link in async_log_files */
+	char *path;		/*< Log file path */
+	int fd;			/*< Long-lived file descriptor */
+	bool reopen;		/*< Path changed, writer must reopen */
+	bool shutdown;		/*< Writer should drain and exit */
+	uint32_t flush_interval;	/*< Max msecs a line waits in ring */
+	uint64_t size;		/*< Number of slots, a power of 2 */
+	uint64_t head;		/*< Next position producers claim */
+	uint64_t tail;		/*< Next position the writer drains */
+	uint64_t dropped;	/*< Lines dropped because ring was full */
+	uint64_t reported;	/*< Drops already reported in the file */
+	struct async_log_slot *ring;	/*< The ring itself */
+	pthread_mutex_t mtx;	/*< Serializes draining and the fd */
+	pthread_cond_t cv;	/*< Wakes the writer */
+	pthread_t writer;	/*< Writer thread */
+};
+
+/* Maximum number of lines written by one writev() */
+#define ASYNC_LOG_IOV 64
+
+static struct glist_head async_log_files = GLIST_HEAD_INIT(async_log_files);
+static pthread_mutex_t async_log_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+static void async_log_file_release(struct async_log_file *alf);
+static void async_log_flush_all(void);
+
 static struct glist_head facility_list;
 static struct glist_head active_facility_list;
 
@@ -303,6 +358,11 @@ void Cleanup(void)
 		c->clean();
 		c = c->next;
 	}
+
+	/* Anything still queued for an asynchronous facility must
+	 * make it to disk before we go away.
+	 */
+	async_log_flush_all();
 }
 
 void Fatal(void)
@@ -806,6 +866,8 @@ void release_log_facility(char *name)
 	if (facility->lf_func == log_to_file &&
 	    facility->lf_private != NULL)
 		gsh_free(facility->lf_private);
+	else if (facility->lf_func == log_to_file_async)
+		async_log_file_release(facility->lf_private);
 	gsh_free(facility->lf_name);
 	gsh_free(facility);
 	return;
@@ -992,7 +1054,8 @@ int set_log_destination(char *name, char *dest)
 			 name);
 		return -ENOENT;
 	}
-	if (facility->lf_func == log_to_file) {
+	if (facility->lf_func == log_to_file ||
+	    facility->lf_func == log_to_file_async) {
 		char *logfile, *dir;
 
 		dir = alloca(strlen(dest) + 1);
@@ -1014,9 +1077,20 @@ int set_log_destination(char *name, char *dest)
 				dest, facility->lf_name);
 			return -ENOMEM;
 		}
-		if (facility->lf_private != NULL)
-			gsh_free(facility->lf_private);
-		facility->lf_private = logfile;
+		if (facility->lf_func == log_to_file_async) {
+			struct async_log_file *alf = facility->lf_private;
+
+			/* Lines already queued go to the new file */
+			pthread_mutex_lock(&alf->mtx);
+			gsh_free(alf->path);
+			alf->path = logfile;
+			alf->reopen = true;
+			pthread_mutex_unlock(&alf->mtx);
+		} else {
+			if (facility->lf_private != NULL)
+				gsh_free(facility->lf_private);
+			facility->lf_private = logfile;
+		}
 	} else if (facility->lf_func == log_to_stream) {
 		FILE *out;
 
@@ -1243,6 +1317,357 @@ static int log_to_file(log_header_t headers, void *private,
 	return rc;
 }
 
+/**
+ * @brief Write a batch of lines for an asynchronous file facility
+ *
+ * Called by the writer with alf->mtx held.  The file is (re)opened
+ * here when needed so that a missing or rotated file only costs the
+ * writer, never the threads doing the logging.
+ *
+ * @param[in] alf The facility
+ * @param[in] iov Lines to write
+ * @param[in] cnt Number of entries in iov
+ */
+
+static void async_log_writev(struct async_log_file *alf,
+			     struct iovec *iov, int cnt)
+{
+	ssize_t rc;
+	int my_status;
+
+	if (alf->reopen) {
+		if (alf->fd != -1)
+			(void)close(alf->fd);
+		alf->fd = -1;
+		alf->reopen = false;
+	}
+
+	if (alf->fd == -1) {
+		alf->fd = open(alf->path, O_WRONLY | O_APPEND | O_CREAT,
+			       log_mask);
+		if (alf->fd == -1) {
+			my_status = errno;
+			goto error;
+		}
+	}
+
+	while (cnt > 0) {
+		rc = writev(alf->fd, iov, cnt);
+
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			my_status = errno;
+			goto error;
+		}
+		if (rc == 0) {
+			my_status = ENOSPC;
+			goto error;
+		}
+
+		/* Skip over whatever made it out */
+		while (cnt > 0 && rc >= iov->iov_len) {
+			rc -= iov->iov_len;
+			iov++;
+			cnt--;
+		}
+		if (cnt > 0) {
+			iov->iov_base = (char *)iov->iov_base + rc;
+			iov->iov_len -= rc;
+		}
+	}
+
+	return;
+
+ error:
+
+	fprintf(stderr,
+		"Error: couldn't complete write to the log file %s "
+		"status=%d (%s), %d messages lost\n", alf->path, my_status,
+		strerror(my_status), cnt);
+}
+
+/**
+ * @brief Drain the ring of an asynchronous file facility
+ *
+ * Called with alf->mtx held, either by the writer thread or by
+ * async_log_flush_all().  This must never call the logging
+ * functions, the caller may be holding log_rwlock for write while
+ * it waits for the writer.
+ *
+ * @param[in] alf The facility
+ */
+
+static void async_log_drain(struct async_log_file *alf)
+{
+	struct iovec iov[ASYNC_LOG_IOV];
+	struct async_log_slot *slot;
+	uint64_t mask = alf->size - 1;
+	uint64_t first, pos, dropped;
+	int cnt;
+
+	for (;;) {
+		first = pos = alf->tail;
+		for (cnt = 0; cnt < ASYNC_LOG_IOV; cnt++, pos++) {
+			slot = &alf->ring[pos & mask];
+			if (atomic_fetch_uint64_t(&slot->seq) != pos + 1)
+				break;
+			iov[cnt].iov_base = slot->line;
+			iov[cnt].iov_len = slot->len;
+		}
+
+		if (cnt == 0)
+			break;
+
+		async_log_writev(alf, iov, cnt);
+
+		/* Hand the slots back to the producers */
+		for (; first != pos; first++)
+			atomic_store_uint64_t(&alf->ring[first & mask].seq,
+					      first + alf->size);
+		atomic_store_uint64_t(&alf->tail, pos);
+	}
+
+	dropped = atomic_fetch_uint64_t(&alf->dropped);
+
+	if (dropped != alf->reported) {
+		char msg[128];
+
+		iov[0].iov_base = msg;
+		iov[0].iov_len =
+		    snprintf(msg, sizeof(msg),
+			     "%s: %"PRIu64" log messages dropped, ring full\n",
+			     program_name, dropped - alf->reported);
+		async_log_writev(alf, iov, 1);
+		alf->reported = dropped;
+	}
+}
+
+/**
+ * @brief Writer thread of an asynchronous file facility
+ *
+ * Wakes up every flush_interval, or sooner when producers find the
+ * ring half full, and drains everything that is ready.
+ *
+ * @param[in] arg The facility
+ *
+ * @return NULL.
+ */
+
+static void *async_log_writer(void *arg)
+{
+	struct async_log_file *alf = arg;
+	struct timespec timeout;
+
+	SetNameFunction("log_writer");
+
+	pthread_mutex_lock(&alf->mtx);
+	while (!alf->shutdown) {
+		clock_gettime(CLOCK_REALTIME, &timeout);
+		timespec_add_nsecs(alf->flush_interval * NS_PER_MSEC,
+				   &timeout);
+		(void)pthread_cond_timedwait(&alf->cv, &alf->mtx, &timeout);
+		async_log_drain(alf);
+	}
+	async_log_drain(alf);
+	pthread_mutex_unlock(&alf->mtx);
+
+	return NULL;
+}
+
+/**
+ * @brief Create the private data of an asynchronous file facility
+ *
+ * Allocates the ring and starts the writer thread.
+ *
+ * @param[in] path           Log file path
+ * @param[in] queue_len      Ring slots, rounded up to a power of 2
+ * @param[in] flush_interval Max msecs a line waits in the ring
+ *
+ * @return The facility private data or NULL on failure.
+ */
+
+static struct async_log_file *async_log_file_create(const char *path,
+						    uint32_t queue_len,
+						    uint32_t flush_interval)
+{
+	struct async_log_file *alf;
+	char *dir;
+	uint64_t i;
+	int rc;
+
+	if (*path == '\0' || strlen(path) >= MAXPATHLEN) {
+		LogCrit(COMPONENT_LOG,
+			"New log file path empty or too long");
+		return NULL;
+	}
+	dir = alloca(strlen(path) + 1);
+	strcpy(dir, path);
+	dir = dirname(dir);
+	rc = access(dir, W_OK);
+	if (rc != 0) {
+		LogCrit(COMPONENT_LOG,
+			"Cannot create new log file (%s), because: %s",
+			path, strerror(errno));
+		return NULL;
+	}
+
+	alf = gsh_calloc(1, sizeof(*alf));
+	if (alf == NULL)
+		goto nomem;
+
+	alf->path = gsh_strdup(path);
+	if (alf->path == NULL)
+		goto nomem;
+
+	alf->size = 1;
+	while (alf->size < queue_len)
+		alf->size <<= 1;
+
+	alf->ring = gsh_malloc(alf->size * sizeof(struct async_log_slot));
+	if (alf->ring == NULL)
+		goto nomem;
+
+	for (i = 0; i < alf->size; i++)
+		alf->ring[i].seq = i;
+
+	alf->fd = -1;
+	alf->flush_interval = flush_interval;
+	glist_init(&alf->alf_list);
+	pthread_mutex_init(&alf->mtx, NULL);
+	pthread_cond_init(&alf->cv, NULL);
+
+	rc = pthread_create(&alf->writer, NULL, async_log_writer, alf);
+	if (rc != 0) {
+		LogCrit(COMPONENT_LOG,
+			"Could not start log writer for %s, because: %s",
+			path, strerror(rc));
+		pthread_cond_destroy(&alf->cv);
+		pthread_mutex_destroy(&alf->mtx);
+		gsh_free(alf->ring);
+		gsh_free(alf->path);
+		gsh_free(alf);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&async_log_mtx);
+	glist_add_tail(&async_log_files, &alf->alf_list);
+	pthread_mutex_unlock(&async_log_mtx);
+
+	return alf;
+
+ nomem:
+	LogCrit(COMPONENT_LOG,
+		"No memory for asynchronous log file (%s)", path);
+	if (alf != NULL) {
+		if (alf->path != NULL)
+			gsh_free(alf->path);
+		gsh_free(alf);
+	}
+	return NULL;
+}
+
+/**
+ * @brief Stop the writer and free an asynchronous file facility
+ *
+ * Everything queued is written before the file is closed.
+ *
+ * @param[in] alf The facility
+ */
+
+static void async_log_file_release(struct async_log_file *alf)
+{
+	pthread_mutex_lock(&async_log_mtx);
+	glist_del(&alf->alf_list);
+	pthread_mutex_unlock(&async_log_mtx);
+
+	pthread_mutex_lock(&alf->mtx);
+	alf->shutdown = true;
+	pthread_cond_signal(&alf->cv);
+	pthread_mutex_unlock(&alf->mtx);
+
+	pthread_join(alf->writer, NULL);
+
+	if (alf->fd != -1)
+		(void)close(alf->fd);
+	pthread_cond_destroy(&alf->cv);
+	pthread_mutex_destroy(&alf->mtx);
+	gsh_free(alf->ring);
+	gsh_free(alf->path);
+	gsh_free(alf);
+}
+
+/**
+ * @brief Flush all asynchronous file facilities to stable storage
+ *
+ * Used by Cleanup() (and thus Fatal()) so that the messages leading
+ * up to an exit are not lost in a ring.
+ */
+
+static void async_log_flush_all(void)
+{
+	struct glist_head *glist;
+	struct async_log_file *alf;
+
+	pthread_mutex_lock(&async_log_mtx);
+	glist_for_each(glist, &async_log_files) {
+		alf = glist_entry(glist, struct async_log_file, alf_list);
+
+		pthread_mutex_lock(&alf->mtx);
+		async_log_drain(alf);
+		if (alf->fd != -1)
+			(void)fdatasync(alf->fd);
+		pthread_mutex_unlock(&alf->mtx);
+	}
+	pthread_mutex_unlock(&async_log_mtx);
+}
+
+/**
+ * @brief Queue a message for an asynchronous file facility
+ *
+ * The caller never waits for the disk.  If the ring is full the
+ * message is dropped and counted, the writer reports the count in
+ * the log file.
+ */
+
+static int log_to_file_async(log_header_t headers, void *private,
+			     log_levels_t level,
+			     struct display_buffer *buffer, char *compstr,
+			     char *message)
+{
+	struct async_log_file *alf = private;
+	struct async_log_slot *slot;
+	uint64_t pos, seq;
+	int len;
+
+	pos = atomic_fetch_uint64_t(&alf->head);
+	for (;;) {
+		slot = &alf->ring[pos & (alf->size - 1)];
+		seq = atomic_fetch_uint64_t(&slot->seq);
+		if (seq == pos) {
+			if (atomic_cas_uint64_t(&alf->head, pos, pos + 1))
+				break;
+		} else if ((int64_t)(seq - pos) < 0) {
+			/* The writer has not caught up, don't stall */
+			(void)atomic_inc_uint64_t(&alf->dropped);
+			return -1;
+		}
+		pos = atomic_fetch_uint64_t(&alf->head);
+	}
+
+	len = display_buffer_len(buffer);
+	memcpy(slot->line, buffer->b_start, len);
+	slot->line[len] = '\n';
+	slot->len = len + 1;
+	atomic_store_uint64_t(&slot->seq, pos + 1);
+
+	/* Wake the writer early when the ring is filling up */
+	if (pos - atomic_fetch_uint64_t(&alf->tail) >= alf->size / 2)
+		pthread_cond_signal(&alf->cv);
+
+	return 0;
+}
+
 static int log_to_stream(log_header_t headers, void *private,
 			 log_levels_t level,
 			 struct display_buffer *buffer, char *compstr,
@@ -1836,6 +2261,9 @@ struct facility_config {
 	lf_function_t *func;
 	log_header_t headers;
 	log_levels_t max_level;
+	bool async;
+	uint32_t async_queue_len;
+	uint32_t flush_interval;
 	void *lf_private;
 };
 
@@ -2193,6 +2621,12 @@ static struct config_item facility_params[] = {
 			facility_config, headers),
 	CONF_ITEM_TOKEN("enable", FAC_IDLE, enable_options,
 			facility_config, state),
+	CONF_ITEM_BOOL("async", false,
+		       facility_config, async),
+	CONF_ITEM_UI32("async_queue_length", 64, 65536, 1024,
+		       facility_config, async_queue_len),
+	CONF_ITEM_UI32("flush_interval", 1, 60000, 100,
+		       facility_config, flush_interval),
 	CONFIG_EOL
 };
 
@@ -2275,6 +2709,11 @@ static int facility_commit(void *node, void *link_mem, void *self_struct,
 			conf->func = log_to_syslog;
 			if (conf->headers == NB_LH_TYPES)
 				conf->headers = LH_COMPONENT;
+		} else if (conf->async) {
+			/* The ring and writer are set up at create time */
+			conf->func = log_to_file_async;
+			if (conf->headers == NB_LH_TYPES)
+				conf->headers = LH_ALL;
 		} else {
 			conf->func = log_to_file;
 			conf->lf_private = conf->dest;
@@ -2289,6 +2728,10 @@ static int facility_commit(void *node, void *link_mem, void *self_struct,
 		errcnt++;
 		goto out;
 	}
+	if (conf->async && conf->func != log_to_file_async)
+		LogWarn(COMPONENT_CONFIG,
+			"Async is only supported for file destinations, ignored for %s",
+			conf->facility_name);
 	if (conf->func != log_to_syslog && conf->headers < LH_ALL)
 		LogWarn(COMPONENT_CONFIG,
 			"Headers setting for %s could drop some format fields!",
@@ -2364,11 +2807,27 @@ static int log_conf_commit(void *node, void *link_mem, void *self_struct,
 				 conf->facility_name);
 			goto done;
 		}
+		if (conf->func == log_to_file_async) {
+			conf->lf_private =
+				async_log_file_create(conf->dest,
+						      conf->async_queue_len,
+						      conf->flush_interval);
+			if (conf->lf_private == NULL) {
+				err_type->resource = true;
+				errcnt++;
+				goto done;
+			}
+		}
 		rc = create_log_facility(conf->facility_name,
 					 conf->func,
 					 conf->max_level,
 					 conf->headers,
 					 conf->lf_private);
+		if (rc != 0 && conf->func == log_to_file_async) {
+			/* An existing facility keeps its own writer */
+			async_log_file_release(conf->lf_private);
+			conf->lf_private = NULL;
+		}
 		if (rc != 0 && rc != -EEXIST) {
 			LogCrit(COMPONENT_CONFIG,
 				"Failed to create facility (%s), (%s)",
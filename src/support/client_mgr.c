@@ -590,7 +590,7 @@ static bool get_nfsv3_stats_io(DBusMessageIter *args,
 	}
 	dbus_status_reply(&iter, success, errormsg);
 	if (success)
-		server_dbus_v3_iostats(server_st->st.nfsv3, &iter);
+		server_dbus_v3_iostats(&server_st->st, &iter);
 
 	if (client != NULL)
 		put_gsh_client(client);
@@ -637,7 +637,7 @@ static bool get_nfsv40_stats_io(DBusMessageIter *args,
 	}
 	dbus_status_reply(&iter, success, errormsg);
 	if (success)
-		server_dbus_v40_iostats(server_st->st.nfsv40, &iter);
+		server_dbus_v40_iostats(&server_st->st, &iter);
 
 	if (client != NULL)
 		put_gsh_client(client);
@@ -684,7 +684,7 @@ static bool get_nfsv41_stats_io(DBusMessageIter *args,
 	}
 	dbus_status_reply(&iter, success, errormsg);
 	if (success)
-		server_dbus_v41_iostats(server_st->st.nfsv41, &iter);
+		server_dbus_v41_iostats(&server_st->st, &iter);
 
 	if (client != NULL)
 		put_gsh_client(client);
@@ -732,7 +732,7 @@ static bool get_nfsv41_stats_layouts(DBusMessageIter *args,
 	}
 	dbus_status_reply(&iter, success, errormsg);
 	if (success)
-		server_dbus_v41_layouts(server_st->st.nfsv41, &iter);
+		server_dbus_v41_layouts(&server_st->st, &iter);
 
 	if (client != NULL)
 		put_gsh_client(client);
@@ -796,6 +796,50 @@ static struct gsh_dbus_method cltmgr_show_delegations = {
 		 END_ARG_LIST}
 };
 
+/**
+ * DBUS method to report requests deferred by rate limits
+ *
+ */
+
+static bool get_throttle_stats(DBusMessageIter *args,
+			       DBusMessage *reply,
+			       DBusError *error)
+{
+	char *errormsg = "OK";
+	struct gsh_client *client = NULL;
+	struct server_stats *server_st = NULL;
+	bool success = true;
+	DBusMessageIter iter;
+
+	dbus_message_iter_init_append(reply, &iter);
+	client = lookup_client(args, &errormsg);
+	if (client == NULL) {
+		success = false;
+		errormsg = "Client IP address not found";
+	} else {
+		server_st = container_of(client, struct server_stats, client);
+	}
+
+	dbus_status_reply(&iter, success, errormsg);
+	if (success)
+		server_dbus_throttled(&server_st->st, &iter);
+
+	if (client != NULL)
+		put_gsh_client(client);
+
+	return true;
+}
+
+static struct gsh_dbus_method cltmgr_show_throttle_stats = {
+	.name = "GetThrottleStats",
+	.method = get_throttle_stats,
+	.args = {IPADDR_ARG,
+		 STATUS_REPLY,
+		 TIMESTAMP_REPLY,
+		 THROTTLED_REPLY,
+		 END_ARG_LIST}
+};
+
 /**
  * DBUS method to report 9p I/O statistics
  *
@@ -826,7 +870,7 @@ static bool get_9p_stats_io(DBusMessageIter *args,
 	}
 	dbus_status_reply(&iter, success, errormsg);
 	if (success)
-		server_dbus_9p_iostats(server_st->st._9p, &iter);
+		server_dbus_9p_iostats(&server_st->st, &iter);
 
 	if (client != NULL)
 		put_gsh_client(client);
@@ -873,7 +917,7 @@ static bool get_9p_stats_trans(DBusMessageIter *args,
 	}
 	dbus_status_reply(&iter, success, errormsg);
 	if (success)
-		server_dbus_9p_transstats(server_st->st._9p, &iter);
+		server_dbus_9p_transstats(&server_st->st, &iter);
 
 	if (client != NULL)
 		put_gsh_client(client);
@@ -891,12 +935,205 @@ static struct gsh_dbus_method cltmgr_show_9p_trans = {
 };
 
 
+/**
+ * DBUS method to report NFSv3 latency histograms
+ *
+ */
+
+static bool get_nfsv3_stats_latency(DBusMessageIter *args,
+				    DBusMessage *reply,
+				    DBusError *error)
+{
+	struct gsh_client *client = NULL;
+	struct server_stats *server_st = NULL;
+	bool success = true;
+	char *errormsg = "OK";
+	DBusMessageIter iter;
+
+	dbus_message_iter_init_append(reply, &iter);
+	client = lookup_client(args, &errormsg);
+	if (client == NULL) {
+		success = false;
+		if (errormsg == NULL)
+			errormsg = "Client IP address not found";
+	} else {
+		server_st = container_of(client, struct server_stats, client);
+		if (server_st->st.nfsv3 == NULL) {
+			success = false;
+			errormsg = "Client does not have any NFSv3 activity";
+		}
+	}
+	dbus_status_reply(&iter, success, errormsg);
+	if (success)
+		server_dbus_v3_latency(&server_st->st, &iter);
+
+	if (client != NULL)
+		put_gsh_client(client);
+	return true;
+}
+
+static struct gsh_dbus_method cltmgr_show_v3_latency = {
+	.name = "GetNFSv3Latency",
+	.method = get_nfsv3_stats_latency,
+	.args = {IPADDR_ARG,
+		 STATUS_REPLY,
+		 TIMESTAMP_REPLY,
+		 LATENCY_REPLY,
+		 END_ARG_LIST}
+};
+
+/**
+ * DBUS method to report NFSv40 latency histograms
+ *
+ */
+
+static bool get_nfsv40_stats_latency(DBusMessageIter *args,
+				     DBusMessage *reply,
+				     DBusError *error)
+{
+	struct gsh_client *client = NULL;
+	struct server_stats *server_st = NULL;
+	bool success = true;
+	char *errormsg = "OK";
+	DBusMessageIter iter;
+
+	dbus_message_iter_init_append(reply, &iter);
+	client = lookup_client(args, &errormsg);
+	if (client == NULL) {
+		success = false;
+		if (errormsg == NULL)
+			errormsg = "Client IP address not found";
+	} else {
+		server_st = container_of(client, struct server_stats, client);
+		if (server_st->st.nfsv40 == NULL) {
+			success = false;
+			errormsg = "Client does not have any NFSv4.0 activity";
+		}
+	}
+	dbus_status_reply(&iter, success, errormsg);
+	if (success)
+		server_dbus_v40_latency(&server_st->st, &iter);
+
+	if (client != NULL)
+		put_gsh_client(client);
+	return true;
+}
+
+static struct gsh_dbus_method cltmgr_show_v40_latency = {
+	.name = "GetNFSv40Latency",
+	.method = get_nfsv40_stats_latency,
+	.args = {IPADDR_ARG,
+		 STATUS_REPLY,
+		 TIMESTAMP_REPLY,
+		 LATENCY_REPLY,
+		 END_ARG_LIST}
+};
+
+/**
+ * DBUS method to report NFSv41 latency histograms
+ *
+ */
+
+static bool get_nfsv41_stats_latency(DBusMessageIter *args,
+				     DBusMessage *reply,
+				     DBusError *error)
+{
+	struct gsh_client *client = NULL;
+	struct server_stats *server_st = NULL;
+	bool success = true;
+	char *errormsg = "OK";
+	DBusMessageIter iter;
+
+	dbus_message_iter_init_append(reply, &iter);
+	client = lookup_client(args, &errormsg);
+	if (client == NULL) {
+		success = false;
+		if (errormsg == NULL)
+			errormsg = "Client IP address not found";
+	} else {
+		server_st = container_of(client, struct server_stats, client);
+		if (server_st->st.nfsv41 == NULL) {
+			success = false;
+			errormsg = "Client does not have any NFSv4.1 activity";
+		}
+	}
+	dbus_status_reply(&iter, success, errormsg);
+	if (success)
+		server_dbus_v41_latency(&server_st->st, &iter);
+
+	if (client != NULL)
+		put_gsh_client(client);
+	return true;
+}
+
+static struct gsh_dbus_method cltmgr_show_v41_latency = {
+	.name = "GetNFSv41Latency",
+	.method = get_nfsv41_stats_latency,
+	.args = {IPADDR_ARG,
+		 STATUS_REPLY,
+		 TIMESTAMP_REPLY,
+		 LATENCY_REPLY,
+		 END_ARG_LIST}
+};
+
+/**
+ * DBUS method to report NFSv42 latency histograms
+ *
+ */
+
+static bool get_nfsv42_stats_latency(DBusMessageIter *args,
+				     DBusMessage *reply,
+				     DBusError *error)
+{
+	struct gsh_client *client = NULL;
+	struct server_stats *server_st = NULL;
+	bool success = true;
+	char *errormsg = "OK";
+	DBusMessageIter iter;
+
+	dbus_message_iter_init_append(reply, &iter);
+	client = lookup_client(args, &errormsg);
+	if (client == NULL) {
+		success = false;
+		if (errormsg == NULL)
+			errormsg = "Client IP address not found";
+	} else {
+		server_st = container_of(client, struct server_stats, client);
+		if (server_st->st.nfsv42 == NULL) {
+			success = false;
+			errormsg = "Client does not have any NFSv4.2 activity";
+		}
+	}
+	dbus_status_reply(&iter, success, errormsg);
+	if (success)
+		server_dbus_v42_latency(&server_st->st, &iter);
+
+	if (client != NULL)
+		put_gsh_client(client);
+	return true;
+}
+
+static struct gsh_dbus_method cltmgr_show_v42_latency = {
+	.name = "GetNFSv42Latency",
+	.method = get_nfsv42_stats_latency,
+	.args = {IPADDR_ARG,
+		 STATUS_REPLY,
+		 TIMESTAMP_REPLY,
+		 LATENCY_REPLY,
+		 END_ARG_LIST}
+};
+
 static struct gsh_dbus_method *cltmgr_stats_methods[] = {
 	&cltmgr_show_v3_io,
 	&cltmgr_show_v40_io,
 	&cltmgr_show_v41_io,
 	&cltmgr_show_v41_layouts,
+	&cltmgr_show_v3_latency,
+	&cltmgr_show_v40_latency,
+	&cltmgr_show_v41_latency,
+	&cltmgr_show_v42_latency,
 	&cltmgr_show_delegations,
+	&cltmgr_show_throttle_stats,
 	&cltmgr_show_9p_io,
 	&cltmgr_show_9p_trans,
 	NULL
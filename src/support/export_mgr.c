@@ -231,6 +231,7 @@ struct gsh_export *alloc_export(void)
 	glist_init(&export->clients);
 
 	PTHREAD_RWLOCK_init(&export->lock, NULL);
+	server_stats_set_sharded(&export_st->st);
 
 	return export;
 }
@@ -1227,11 +1228,48 @@ static struct gsh_dbus_method export_show_exports = {
 		 END_ARG_LIST}
 };
 
+/**
+ * @brief Forget cached client access decisions of all exports
+ *
+ * @param[in]  args
+ * @param[out] reply
+ */
+static bool gsh_export_purge_access_cache(DBusMessageIter *args,
+					  DBusMessage *reply,
+					  DBusError *error)
+{
+	char *errormsg = "Purge access cache";
+	bool success = true;
+	DBusMessageIter iter;
+
+	dbus_message_iter_init_append(reply, &iter);
+	if (args != NULL) {
+		errormsg = "PurgeAccessCache takes no arguments.";
+		success = false;
+		LogWarn(COMPONENT_DBUS, "%s", errormsg);
+		goto out;
+	}
+
+	export_client_cache_purge();
+
+ out:
+	dbus_status_reply(&iter, success, errormsg);
+	return success;
+}
+
+static struct gsh_dbus_method export_purge_access_cache = {
+	.name = "PurgeAccessCache",
+	.method = gsh_export_purge_access_cache,
+	.args = {STATUS_REPLY,
+		 END_ARG_LIST}
+};
+
 static struct gsh_dbus_method *export_mgr_methods[] = {
 	&export_add_export,
 	&export_remove_export,
 	&export_display_export,
 	&export_show_exports,
+	&export_purge_access_cache,
 	NULL
 };
 
@@ -1275,7 +1313,7 @@ static bool get_nfsv3_export_io(DBusMessageIter *args,
 	}
 	dbus_status_reply(&iter, success, errormsg);
 	if (success)
-		server_dbus_v3_iostats(export_st->st.nfsv3, &iter);
+		server_dbus_v3_iostats(&export_st->st, &iter);
 
 	if (export != NULL)
 		put_gsh_export(export);
@@ -1320,7 +1358,7 @@ static bool get_nfsv40_export_io(DBusMessageIter *args,
 	}
 	dbus_status_reply(&iter, success, errormsg);
 	if (success)
-		server_dbus_v40_iostats(export_st->st.nfsv40, &iter);
+		server_dbus_v40_iostats(&export_st->st, &iter);
 
 	if (export != NULL)
 		put_gsh_export(export);
@@ -1365,7 +1403,7 @@ static bool get_nfsv41_export_io(DBusMessageIter *args,
 	}
 	dbus_status_reply(&iter, success, errormsg);
 	if (success)
-		server_dbus_v41_iostats(export_st->st.nfsv41, &iter);
+		server_dbus_v41_iostats(&export_st->st, &iter);
 
 	if (export != NULL)
 		put_gsh_export(export);
@@ -1382,6 +1420,186 @@ static struct gsh_dbus_method export_show_v41_io = {
 		 END_ARG_LIST}
 };
 
+/**
+ * DBUS method to report NFSv3 latency histograms
+ *
+ */
+
+static bool get_nfsv3_export_latency(DBusMessageIter *args,
+				     DBusMessage *reply,
+				     DBusError *error)
+{
+	struct gsh_export *export = NULL;
+	struct export_stats *export_st = NULL;
+	bool success = true;
+	char *errormsg = "OK";
+	DBusMessageIter iter;
+
+	dbus_message_iter_init_append(reply, &iter);
+	export = lookup_export(args, &errormsg);
+	if (export == NULL) {
+		success = false;
+	} else {
+		export_st = container_of(export, struct export_stats, export);
+		if (export_st->st.nfsv3 == NULL) {
+			success = false;
+			errormsg = "Export does not have any NFSv3 activity";
+		}
+	}
+	dbus_status_reply(&iter, success, errormsg);
+	if (success)
+		server_dbus_v3_latency(&export_st->st, &iter);
+
+	if (export != NULL)
+		put_gsh_export(export);
+	return true;
+}
+
+static struct gsh_dbus_method export_show_v3_latency = {
+	.name = "GetNFSv3Latency",
+	.method = get_nfsv3_export_latency,
+	.args = {EXPORT_ID_ARG,
+		 STATUS_REPLY,
+		 TIMESTAMP_REPLY,
+		 LATENCY_REPLY,
+		 END_ARG_LIST}
+};
+
+/**
+ * DBUS method to report NFSv40 latency histograms
+ *
+ */
+
+static bool get_nfsv40_export_latency(DBusMessageIter *args,
+				      DBusMessage *reply,
+				      DBusError *error)
+{
+	struct gsh_export *export = NULL;
+	struct export_stats *export_st = NULL;
+	bool success = true;
+	char *errormsg = "OK";
+	DBusMessageIter iter;
+
+	dbus_message_iter_init_append(reply, &iter);
+	export = lookup_export(args, &errormsg);
+	if (export == NULL) {
+		success = false;
+	} else {
+		export_st = container_of(export, struct export_stats, export);
+		if (export_st->st.nfsv40 == NULL) {
+			success = false;
+			errormsg = "Export does not have any NFSv4.0 activity";
+		}
+	}
+	dbus_status_reply(&iter, success, errormsg);
+	if (success)
+		server_dbus_v40_latency(&export_st->st, &iter);
+
+	if (export != NULL)
+		put_gsh_export(export);
+	return true;
+}
+
+static struct gsh_dbus_method export_show_v40_latency = {
+	.name = "GetNFSv40Latency",
+	.method = get_nfsv40_export_latency,
+	.args = {EXPORT_ID_ARG,
+		 STATUS_REPLY,
+		 TIMESTAMP_REPLY,
+		 LATENCY_REPLY,
+		 END_ARG_LIST}
+};
+
+/**
+ * DBUS method to report NFSv41 latency histograms
+ *
+ */
+
+static bool get_nfsv41_export_latency(DBusMessageIter *args,
+				      DBusMessage *reply,
+				      DBusError *error)
+{
+	struct gsh_export *export = NULL;
+	struct export_stats *export_st = NULL;
+	bool success = true;
+	char *errormsg = "OK";
+	DBusMessageIter iter;
+
+	dbus_message_iter_init_append(reply, &iter);
+	export = lookup_export(args, &errormsg);
+	if (export == NULL) {
+		success = false;
+	} else {
+		export_st = container_of(export, struct export_stats, export);
+		if (export_st->st.nfsv41 == NULL) {
+			success = false;
+			errormsg = "Export does not have any NFSv4.1 activity";
+		}
+	}
+	dbus_status_reply(&iter, success, errormsg);
+	if (success)
+		server_dbus_v41_latency(&export_st->st, &iter);
+
+	if (export != NULL)
+		put_gsh_export(export);
+	return true;
+}
+
+static struct gsh_dbus_method export_show_v41_latency = {
+	.name = "GetNFSv41Latency",
+	.method = get_nfsv41_export_latency,
+	.args = {EXPORT_ID_ARG,
+		 STATUS_REPLY,
+		 TIMESTAMP_REPLY,
+		 LATENCY_REPLY,
+		 END_ARG_LIST}
+};
+
+/**
+ * DBUS method to report NFSv42 latency histograms
+ *
+ */
+
+static bool get_nfsv42_export_latency(DBusMessageIter *args,
+				      DBusMessage *reply,
+				      DBusError *error)
+{
+	struct gsh_export *export = NULL;
+	struct export_stats *export_st = NULL;
+	bool success = true;
+	char *errormsg = "OK";
+	DBusMessageIter iter;
+
+	dbus_message_iter_init_append(reply, &iter);
+	export = lookup_export(args, &errormsg);
+	if (export == NULL) {
+		success = false;
+	} else {
+		export_st = container_of(export, struct export_stats, export);
+		if (export_st->st.nfsv42 == NULL) {
+			success = false;
+			errormsg = "Export does not have any NFSv4.2 activity";
+		}
+	}
+	dbus_status_reply(&iter, success, errormsg);
+	if (success)
+		server_dbus_v42_latency(&export_st->st, &iter);
+
+	if (export != NULL)
+		put_gsh_export(export);
+	return true;
+}
+
+static struct gsh_dbus_method export_show_v42_latency = {
+	.name = "GetNFSv42Latency",
+	.method = get_nfsv42_export_latency,
+	.args = {EXPORT_ID_ARG,
+		 STATUS_REPLY,
+		 TIMESTAMP_REPLY,
+		 LATENCY_REPLY,
+		 END_ARG_LIST}
+};
+
 /**
  * DBUS method to report NFSv41 layout statistics
  *
@@ -1410,7 +1628,7 @@ static bool get_nfsv41_export_layouts(DBusMessageIter *args,
 	}
 	dbus_status_reply(&iter, success, errormsg);
 	if (success)
-		server_dbus_v41_layouts(export_st->st.nfsv41, &iter);
+		server_dbus_v41_layouts(&export_st->st, &iter);
 
 	if (export != NULL)
 		put_gsh_export(export);
@@ -1447,6 +1665,77 @@ static bool get_nfsv_export_total_ops(DBusMessageIter *args,
 	return true;
 }
 
+/**
+ * DBUS method to report requests deferred by rate limits
+ *
+ */
+
+static bool get_export_throttle_stats(DBusMessageIter *args,
+				      DBusMessage *reply,
+				      DBusError *error)
+{
+	struct gsh_export *export = NULL;
+	struct export_stats *export_st = NULL;
+	bool success = true;
+	char *errormsg = "OK";
+	DBusMessageIter iter, struct_iter;
+
+	dbus_message_iter_init_append(reply, &iter);
+	export = lookup_export(args, &errormsg);
+	if (export == NULL) {
+		success = false;
+		errormsg = "No export available";
+		dbus_status_reply(&iter, success, errormsg);
+		return true;
+	}
+
+	export_st = container_of(export, struct export_stats, export);
+	dbus_status_reply(&iter, success, errormsg);
+	server_dbus_throttled(&export_st->st, &iter);
+	dbus_message_iter_open_container(&iter, DBUS_TYPE_STRUCT, NULL,
+					 &struct_iter);
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+				       &export->rate_limit.ops_rate);
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+				       &export->rate_limit.bytes_rate);
+	dbus_message_iter_close_container(&iter, &struct_iter);
+	put_gsh_export(export);
+
+	return true;
+}
+
+/**
+ * DBUS method to report the readahead of an export
+ *
+ */
+
+static bool get_export_readahead_stats(DBusMessageIter *args,
+				       DBusMessage *reply,
+				       DBusError *error)
+{
+	struct gsh_export *export = NULL;
+	struct export_stats *export_st = NULL;
+	bool success = true;
+	char *errormsg = "OK";
+	DBusMessageIter iter;
+
+	dbus_message_iter_init_append(reply, &iter);
+	export = lookup_export(args, &errormsg);
+	if (export == NULL) {
+		success = false;
+		errormsg = "No export available";
+		dbus_status_reply(&iter, success, errormsg);
+		return true;
+	}
+
+	export_st = container_of(export, struct export_stats, export);
+	dbus_status_reply(&iter, success, errormsg);
+	server_dbus_readahead(&export_st->st, &iter);
+	put_gsh_export(export);
+
+	return true;
+}
+
 static bool get_nfsv_global_total_ops(DBusMessageIter *args,
 				      DBusMessage *reply,
 				      DBusError *error)
@@ -1495,6 +1784,72 @@ static bool show_cache_inode_stats(DBusMessageIter *args,
 	return true;
 }
 
+/**
+ * DBUS method to report request queue depths and steal counters
+ *
+ */
+
+static bool show_req_queues(DBusMessageIter *args,
+			    DBusMessage *reply,
+			    DBusError *error)
+{
+	bool success = true;
+	char *errormsg = "OK";
+	DBusMessageIter iter;
+
+	dbus_message_iter_init_append(reply, &iter);
+	dbus_status_reply(&iter, success, errormsg);
+
+	nfs_rpc_queue_dbus_show(&iter);
+
+	return true;
+}
+
+/**
+ * DBUS method to report server wide latency of each NFS operation
+ *
+ */
+
+static bool get_global_op_latency(DBusMessageIter *args,
+				  DBusMessage *reply,
+				  DBusError *error)
+{
+	bool success = true;
+	char *errormsg = "OK";
+	DBusMessageIter iter;
+
+	dbus_message_iter_init_append(reply, &iter);
+	if (nfs_param.core_param.enable_FASTSTATS) {
+		success = false;
+		errormsg = "Latency is not recorded with fast stats enabled";
+	}
+	dbus_status_reply(&iter, success, errormsg);
+	if (success)
+		server_dbus_global_latency(&iter);
+
+	return true;
+}
+
+/**
+ * DBUS method to report the group list lookups for managed gids
+ *
+ */
+
+static bool get_uid2grp_stats(DBusMessageIter *args,
+			      DBusMessage *reply,
+			      DBusError *error)
+{
+	bool success = true;
+	char *errormsg = "OK";
+	DBusMessageIter iter;
+
+	dbus_message_iter_init_append(reply, &iter);
+	dbus_status_reply(&iter, success, errormsg);
+	server_dbus_uid2grp(&iter);
+
+	return true;
+}
+
 static struct gsh_dbus_method export_show_v41_layouts = {
 	.name = "GetNFSv41Layouts",
 	.method = get_nfsv41_export_layouts,
@@ -1532,7 +1887,7 @@ static bool get_9p_export_io(DBusMessageIter *args,
 	}
 	dbus_status_reply(&iter, success, errormsg);
 	if (success)
-		server_dbus_9p_iostats(export_st->st._9p, &iter);
+		server_dbus_9p_iostats(&export_st->st, &iter);
 
 	if (export != NULL)
 		put_gsh_export(export);
@@ -1559,6 +1914,27 @@ static struct gsh_dbus_method export_show_total_ops = {
 		 END_ARG_LIST}
 };
 
+static struct gsh_dbus_method export_show_throttle_stats = {
+	.name = "GetThrottleStats",
+	.method = get_export_throttle_stats,
+	.args = {EXPORT_ID_ARG,
+		 STATUS_REPLY,
+		 TIMESTAMP_REPLY,
+		 THROTTLED_REPLY,
+		 RATE_LIMIT_REPLY,
+		 END_ARG_LIST}
+};
+
+static struct gsh_dbus_method export_show_readahead_stats = {
+	.name = "GetReadaheadStats",
+	.method = get_export_readahead_stats,
+	.args = {EXPORT_ID_ARG,
+		 STATUS_REPLY,
+		 TIMESTAMP_REPLY,
+		 READAHEAD_REPLY,
+		 END_ARG_LIST}
+};
+
 static struct gsh_dbus_method global_show_total_ops = {
 	.name = "GetGlobalOPS",
 	.method = get_nfsv_global_total_ops,
@@ -1577,6 +1953,24 @@ static struct gsh_dbus_method global_show_fast_ops = {
 		 END_ARG_LIST}
 };
 
+static struct gsh_dbus_method global_show_op_latency = {
+	.name = "GetOPLatency",
+	.method = get_global_op_latency,
+	.args = {STATUS_REPLY,
+		 TIMESTAMP_REPLY,
+		 OP_LATENCY_REPLY,
+		 END_ARG_LIST}
+};
+
+static struct gsh_dbus_method uid2grp_show = {
+	.name = "GetManageGidsStats",
+	.method = get_uid2grp_stats,
+	.args = {STATUS_REPLY,
+		 TIMESTAMP_REPLY,
+		 UID2GRP_REPLY,
+		 END_ARG_LIST}
+};
+
 static struct gsh_dbus_method cache_inode_show = {
 	.name = "ShowCacheInode",
 	.method = show_cache_inode_stats,
@@ -1586,6 +1980,15 @@ static struct gsh_dbus_method cache_inode_show = {
 		 END_ARG_LIST}
 };
 
+static struct gsh_dbus_method req_queues_show = {
+	.name = "GetReqQueues",
+	.method = show_req_queues,
+	.args = {STATUS_REPLY,
+		 TIMESTAMP_REPLY,
+		 REQ_QUEUES_REPLY,
+		 END_ARG_LIST}
+};
+
 /**
  * @brief Report all IO stats of all exports in one call
  *
@@ -1645,11 +2048,20 @@ static struct gsh_dbus_method *export_stats_methods[] = {
 	&export_show_v40_io,
 	&export_show_v41_io,
 	&export_show_v41_layouts,
+	&export_show_v3_latency,
+	&export_show_v40_latency,
+	&export_show_v41_latency,
+	&export_show_v42_latency,
 	&export_show_total_ops,
+	&export_show_throttle_stats,
+	&export_show_readahead_stats,
 	&export_show_9p_io,
 	&global_show_total_ops,
 	&global_show_fast_ops,
+	&global_show_op_latency,
 	&cache_inode_show,
+	&req_queues_show,
+	&uid2grp_show,
 	&export_show_all_io,
 	NULL
 };
@@ -40,6 +40,7 @@
 #include "nfs_dupreq.h"
 #include "config_parsing.h"
 #include "common_utils.h"
+#include "abstract_atomic.h"
 #include "nodelist.h"
 #include <stdlib.h>
 #include <fnmatch.h>
@@ -70,6 +71,12 @@ struct global_export_perms export_opt = {
 };
 
 static void FreeClientList(struct glist_head *clients);
+static struct client_index *client_index_build(struct gsh_export *export);
+static void client_index_free(struct client_index *idx);
+static bool export_has_rate_limits(struct gsh_export *export);
+
+/** Number of exports with rate limits */
+uint32_t export_rate_limits;
 
 static void StrExportOptions(struct export_perms *p_perms, char *buffer)
 {
@@ -267,6 +274,7 @@ void LogClientListEntry(log_components_t component,
  * @param client_tok [IN] the name string.  We modify it.
  * @param type_hint  [IN] type hint from parser for client_tok
  * @param perms      [IN] pointer to the permissions to copy into each
+ * @param limit      [IN] pointer to the rate limit to copy into each
  * @param cnode      [IN] opaque pointer needed for config_proc_error()
  * @param err_type   [OUT] error handling ref
  *
@@ -277,6 +285,7 @@ static int add_client(struct glist_head *client_list,
 		      const char *client_tok,
 		      enum term_type type_hint,
 		      struct export_perms *perms,
+		      struct rate_limit *limit,
 		      void *cnode,
 		      struct config_error_type *err_type)
 {
@@ -426,6 +435,7 @@ static int add_client(struct glist_head *client_list,
 				} else
 					continue;
 				cli->client_perms = *perms;
+				rate_limit_init(&cli->rate_limit, limit);
 				LogClientListEntry(COMPONENT_CONFIG, cli);
 				glist_add_tail(client_list, &cli->cle_list);
 				cli = NULL; /* let go of it */
@@ -450,6 +460,7 @@ static int add_client(struct glist_head *client_list,
 		goto out;
 	}
 	cli->client_perms = *perms;
+	rate_limit_init(&cli->rate_limit, limit);
 	LogClientListEntry(COMPONENT_CONFIG, cli);
 	glist_add_tail(client_list, &cli->cle_list);
 	cli = NULL;
@@ -790,6 +801,8 @@ static int export_commit_common(void *node, void *link_mem, void *self_struct,
 		goto err_out;  /* have errors. don't init or load a fsal */
 	}
 
+	export->client_index = client_index_build(export);
+
 	/* now probe the fsal and init it */
 	/* pass along the block that is/was the FS_Specific */
 	if (!insert_gsh_export(export)) {
@@ -801,6 +814,11 @@ static int export_commit_common(void *node, void *link_mem, void *self_struct,
 		goto err_out;
 	}
 
+	if (export_has_rate_limits(export)) {
+		export->rate_limited = true;
+		atomic_inc_uint32_t(&export_rate_limits);
+	}
+
 	/* add_export_commit shouldn't add this export to mount work as
 	 * add_export_commit deals with creating pseudo mount directly.
 	 * So add this export to mount work only if NFSv4 exported and
@@ -1129,7 +1147,8 @@ static int client_adder(const char *token,
 	LogMidDebug(COMPONENT_CONFIG, "Adding client %s", token);
 	rc = add_client(&proto_cli->cle_list,
 			token, type_hint,
-			&proto_cli->client_perms, cnode, err_type);
+			&proto_cli->client_perms, &proto_cli->rate_limit,
+			cnode, err_type);
 	return rc;
 }
 
@@ -1143,6 +1162,10 @@ static int client_adder(const char *token,
 
 static struct config_item client_params[] = {
 	CONF_EXPORT_PERMS(exportlist_client_entry__, client_perms),
+	CONF_ITEM_UI64("Max_Ops_Rate", 0, UINT64_MAX, 0,
+		       exportlist_client_entry__, rate_limit.ops_rate),
+	CONF_ITEM_UI64("Max_Bytes_Rate", 0, UINT64_MAX, 0,
+		       exportlist_client_entry__, rate_limit.bytes_rate),
 	CONF_ITEM_PROC("Clients", noop_conf_init, client_adder,
 		       exportlist_client_entry__, cle_list),
 	CONFIG_EOL
@@ -1216,7 +1239,14 @@ static struct config_item export_params[] = {
 	CONF_ITEM_BOOLBIT_SET("Trust_Readdir_Negative_Cache",
 		false, EXPORT_OPTION_TRUST_READIR_NEGATIVE_CACHE,
 		gsh_export, options, options_set),
+	CONF_ITEM_BOOLBIT_SET("Data_Cache",
+		false, EXPORT_OPTION_DATA_CACHE,
+		gsh_export, options, options_set),
 	CONF_EXPORT_PERMS(gsh_export, export_perms),
+	CONF_ITEM_UI64("Max_Ops_Rate", 0, UINT64_MAX, 0,
+		       gsh_export, rate_limit.ops_rate),
+	CONF_ITEM_UI64("Max_Bytes_Rate", 0, UINT64_MAX, 0,
+		       gsh_export, rate_limit.bytes_rate),
 	CONF_ITEM_BLOCK("Client", client_params,
 			client_init, client_commit,
 			gsh_export, clients),
@@ -1493,6 +1523,12 @@ static void FreeClientList(struct glist_head *clients)
 
 void free_export_resources(struct gsh_export *export)
 {
+	if (export->rate_limited) {
+		atomic_dec_uint32_t(&export_rate_limits);
+		export->rate_limited = false;
+	}
+	client_index_free(export->client_index);
+	export->client_index = NULL;
 	FreeClientList(&export->clients);
 	if (export->fsal_export != NULL) {
 		struct fsal_module *fsal = export->fsal_export->fsal;
@@ -1869,6 +1905,129 @@ static char *client_types[] = {
 	[BAD_CLIENT] = "BAD_CLIENT"
 	 };
 
+/**
+ * @brief State shared by the matches of one address
+ */
+
+struct client_match_state {
+	int ipvalid;	/* -1 need to print, 0 - invalid, 1 - ok */
+	bool cacheable;	/* false if a name lookup failed */
+	char hostname[MAXHOSTNAMELEN + 1];
+	char ipstring[SOCK_NAME_MAX + 1];
+};
+
+/**
+ * @brief Match an IPv4 address against one client entry
+ *
+ * @param[in]     client   Client entry
+ * @param[in]     hostaddr Host to match
+ * @param[in]     addr     IPv4 address of the host, network order
+ * @param[in,out] state    Match state
+ *
+ * @return true if the client entry matches.
+ */
+static bool client_match_entry(exportlist_client_entry_t *client,
+			       sockaddr_t *hostaddr, in_addr_t addr,
+			       struct client_match_state *state)
+{
+	int rc;
+
+	LogMidDebug(COMPONENT_EXPORT,
+		    "Match %p, type = %s, options 0x%X",
+		    client,
+		    client_types[client->type],
+		    client->client_perms.options);
+	LogClientListEntry(COMPONENT_EXPORT, client);
+
+	switch (client->type) {
+	case HOSTIF_CLIENT:
+		return client->client.hostif.clientaddr == addr;
+
+	case NETWORK_CLIENT:
+		return (client->client.network.netmask & ntohl(addr)) ==
+			client->client.network.netaddr;
+
+	case NETGROUP_CLIENT:
+		/* Try to get the entry from th IP/name cache */
+		rc = nfs_ip_name_get(hostaddr, state->hostname,
+				     sizeof(state->hostname));
+
+		if (rc == IP_NAME_NOT_FOUND) {
+			/* IPaddr was not cached, add it to the cache */
+			rc = nfs_ip_name_add(hostaddr,
+					     state->hostname,
+					     sizeof(state->hostname));
+		}
+
+		if (rc != IP_NAME_SUCCESS) {
+			/* Fatal failure */
+			state->cacheable = false;
+			return false;
+		}
+
+		/* At this point 'hostname' should contain the
+		 * name that was found
+		 */
+		return innetgr(client->client.netgroup.netgroupname,
+			       state->hostname, NULL, NULL) == 1;
+
+	case WILDCARDHOST_CLIENT:
+		/* Now checking for IP wildcards */
+		if (state->ipvalid < 0)
+			state->ipvalid = sprint_sockip(hostaddr,
+						       state->ipstring,
+						       sizeof(state->ipstring));
+
+		if (state->ipvalid &&
+		    (fnmatch(client->client.wildcard.wildcard,
+			     state->ipstring,
+			     FNM_PATHNAME) == 0)) {
+			return true;
+		}
+
+		/* Try to get the entry from th IP/name cache */
+		rc = nfs_ip_name_get(hostaddr, state->hostname,
+				     sizeof(state->hostname));
+
+		if (rc == IP_NAME_NOT_FOUND) {
+			/* IPaddr was not cached, add it to the cache */
+
+			/** @todo this change from 1.5 is not IPv6
+			 * useful.  come back to this and use the
+			 * string from client mgr inside req_ctx...
+			 */
+			rc = nfs_ip_name_add(hostaddr,
+					     state->hostname,
+					     sizeof(state->hostname));
+		}
+
+		if (rc != IP_NAME_SUCCESS) {
+			state->cacheable = false;
+			return false;
+		}
+
+		/* At this point 'hostname' should contain the
+		 * name that was found
+		 */
+		return fnmatch(client->client.wildcard.wildcard,
+			       state->hostname, FNM_PATHNAME) == 0;
+
+	case GSSPRINCIPAL_CLIENT:
+	  /** @todo BUGAZOMEU a completer lors de l'integration de RPCSEC_GSS */
+		LogCrit(COMPONENT_EXPORT,
+			"Unsupported type GSS_PRINCIPAL_CLIENT");
+		return false;
+
+	case MATCH_ANY_CLIENT:
+		return true;
+
+	case HOSTIF_CLIENT_V6:
+	case BAD_CLIENT:
+	default:
+		return false;
+	}
+}
+
 /**
  * @brief Match a specific option in the client export list
  *
@@ -1884,123 +2043,279 @@ static exportlist_client_entry_t *client_match(sockaddr_t *hostaddr,
 {
 	struct glist_head *glist;
 	in_addr_t addr = get_in_addr(hostaddr);
-	int rc;
-	int ipvalid = -1;	/* -1 need to print, 0 - invalid, 1 - ok */
-	char hostname[MAXHOSTNAMELEN + 1];
-	char ipstring[SOCK_NAME_MAX + 1];
+	struct client_match_state state = {
+		.ipvalid = -1,
+		.cacheable = true,
+	};
 
 	glist_for_each(glist, &export->clients) {
 		exportlist_client_entry_t *client;
 
 		client = glist_entry(glist, exportlist_client_entry_t,
 				     cle_list);
-		LogMidDebug(COMPONENT_EXPORT,
-			    "Match %p, type = %s, options 0x%X",
-			    client,
-			    client_types[client->type],
-			    client->client_perms.options);
-		LogClientListEntry(COMPONENT_EXPORT, client);
+		if (client_match_entry(client, hostaddr, addr, &state))
+			return client;
+	}
 
-		switch (client->type) {
-		case HOSTIF_CLIENT:
-			if (client->client.hostif.clientaddr == addr)
-				return client;
-			break;
+	/* no export found for this option */
+	return NULL;
 
-		case NETWORK_CLIENT:
-			if ((client->client.network.netmask & ntohl(addr)) ==
-			    client->client.network.netaddr)
-				return client;
-			break;
+}
 
-		case NETGROUP_CLIENT:
-			/* Try to get the entry from th IP/name cache */
-			rc = nfs_ip_name_get(hostaddr, hostname,
-					     sizeof(hostname));
-
-			if (rc == IP_NAME_NOT_FOUND) {
-				/* IPaddr was not cached, add it to the cache */
-				rc = nfs_ip_name_add(hostaddr,
-						     hostname,
-						     sizeof(hostname));
-			}
+/**
+ * @brief Compiled client list of an export
+ *
+ * HOSTIF and NETWORK clients are loaded in a binary trie keyed on
+ * the IPv4 address bits.  The node where a client's prefix ends
+ * holds the position of that client in the list (its rank), the
+ * lowest one if several clients share the prefix.  One walk down the
+ * trie thus gives the first address client matching a host.
+ *
+ * Netgroup, wildcard and match-any clients are kept aside in list
+ * order and only those ranked ahead of the trie result are tried,
+ * so the result is exactly the first match of the linear walk.
+ *
+ * Decisions for IPv4 hosts are remembered in a small direct mapped
+ * cache.  A slot holds the host address in the upper 32 bits and
+ * the rank + 1 of the matching client (CLIENT_RANK_NONE for no
+ * match) in the lower ones, 0 being an empty slot, so it can be read
+ * and written without a lock.  Decisions depending on a name lookup
+ * that failed are not cached.  The cache is dropped with the index
+ * and can be purged over DBus after netgroup or DNS changes.
+ */
 
-			if (rc != IP_NAME_SUCCESS)
-				break; /* Fatal failure */
+#define CLIENT_RANK_NONE UINT32_MAX
+#define CLIENT_CACHE_BITS 10
+#define CLIENT_CACHE_SLOTS (1 << CLIENT_CACHE_BITS)
 
-			/* At this point 'hostname' should contain the
-			 * name that was found
-			 */
-			if (innetgr(client->client.netgroup.netgroupname,
-				    hostname, NULL, NULL) == 1) {
-				return client;
-			}
-			break;
+struct client_trie_node {
+	struct client_trie_node *child[2];
+	uint32_t rank;		/*< First client ending here */
+};
 
-		case WILDCARDHOST_CLIENT:
-			/* Now checking for IP wildcards */
-			if (ipvalid < 0)
-				ipvalid = sprint_sockip(hostaddr,
-							ipstring,
-							sizeof(ipstring));
-
-			if (ipvalid &&
-			    (fnmatch(client->client.wildcard.wildcard,
-				     ipstring,
-				     FNM_PATHNAME) == 0)) {
-				return client;
-			}
+struct client_index {
+	exportlist_client_entry_t **by_rank;	/*< Clients in list order */
+	uint32_t *others;	/*< Ranks of clients not in the trie */
+	uint32_t nothers;
+	struct client_trie_node *nodes;	/*< Node pool, nodes[0] is root */
+	uint32_t nnodes;
+	uint64_t cache[CLIENT_CACHE_SLOTS];
+};
 
-			/* Try to get the entry from th IP/name cache */
-			rc = nfs_ip_name_get(hostaddr, hostname,
-					     sizeof(hostname));
+/**
+ * @brief Get the trie prefix of an address client
+ *
+ * @param[in]  client Client entry
+ * @param[out] prefix Prefix, host order
+ * @param[out] len    Prefix length in bits
+ *
+ * @return false if the client can't go in the trie.
+ */
+static bool client_trie_prefix(exportlist_client_entry_t *client,
+			       uint32_t *prefix, uint32_t *len)
+{
+	uint32_t mask;
 
-			if (rc == IP_NAME_NOT_FOUND) {
-				/* IPaddr was not cached, add it to the cache */
+	switch (client->type) {
+	case HOSTIF_CLIENT:
+		*prefix = ntohl(client->client.hostif.clientaddr);
+		*len = 32;
+		return true;
 
-				/** @todo this change from 1.5 is not IPv6
-				 * useful.  come back to this and use the
-				 * string from client mgr inside req_ctx...
-				 */
-				rc = nfs_ip_name_add(hostaddr,
-						     hostname,
-						     sizeof(hostname));
-			}
+	case NETWORK_CLIENT:
+		mask = client->client.network.netmask;
+		*len = __builtin_popcount(mask);
+		*prefix = client->client.network.netaddr;
+		/* Non contiguous masks and host bits set in the network
+		 * address need the slow path.
+		 */
+		if (*len != 0 && mask != UINT32_MAX << (32 - *len))
+			return false;
+		return (*prefix & ~mask) == 0;
 
-			if (rc != IP_NAME_SUCCESS)
-					break;
+	default:
+		return false;
+	}
+}
 
-			/* At this point 'hostname' should contain the
-			 * name that was found
-			 */
-			if (fnmatch
-			    (client->client.wildcard.wildcard, hostname,
-			     FNM_PATHNAME) == 0) {
-				return client;
-			}
-			break;
+static void client_trie_insert(struct client_index *idx, uint32_t prefix,
+			       uint32_t len, uint32_t rank)
+{
+	struct client_trie_node *node = &idx->nodes[0];
+	uint32_t i, bit;
+
+	for (i = 0; i < len; i++) {
+		bit = (prefix >> (31 - i)) & 1;
+		if (node->child[bit] == NULL) {
+			node->child[bit] = &idx->nodes[idx->nnodes++];
+			node->child[bit]->rank = CLIENT_RANK_NONE;
+		}
+		node = node->child[bit];
+	}
 
-		case GSSPRINCIPAL_CLIENT:
-	  /** @todo BUGAZOMEU a completer lors de l'integration de RPCSEC_GSS */
-			LogCrit(COMPONENT_EXPORT,
-				"Unsupported type GSS_PRINCIPAL_CLIENT");
-			break;
+	if (rank < node->rank)
+		node->rank = rank;
+}
 
-		case HOSTIF_CLIENT_V6:
+static uint32_t client_trie_lookup(struct client_index *idx, uint32_t haddr)
+{
+	struct client_trie_node *node = &idx->nodes[0];
+	uint32_t rank = node->rank;
+	uint32_t i;
+
+	for (i = 0; i < 32; i++) {
+		node = node->child[(haddr >> (31 - i)) & 1];
+		if (node == NULL)
 			break;
+		if (node->rank < rank)
+			rank = node->rank;
+	}
 
-		case MATCH_ANY_CLIENT:
-			return client;
+	return rank;
+}
 
-		case BAD_CLIENT:
-		default:
-			continue;
+/**
+ * @brief Compile the client list of an export
+ *
+ * @param[in] export The export
+ *
+ * @return The index, NULL if the export has no clients or on error
+ *         (the linear match is used then).
+ */
+static struct client_index *client_index_build(struct gsh_export *export)
+{
+	struct glist_head *glist;
+	exportlist_client_entry_t *client;
+	struct client_index *idx;
+	uint32_t prefix, len;
+	uint32_t nclients = 0, ntrie = 0, rank = 0;
+
+	glist_for_each(glist, &export->clients) {
+		client = glist_entry(glist, exportlist_client_entry_t,
+				     cle_list);
+		nclients++;
+		if (client_trie_prefix(client, &prefix, &len))
+			ntrie++;
+	}
+
+	if (nclients == 0)
+		return NULL;
+
+	idx = gsh_calloc(1, sizeof(*idx));
+	if (idx == NULL)
+		return NULL;
+
+	idx->by_rank = gsh_calloc(nclients, sizeof(*idx->by_rank));
+	idx->others = gsh_calloc(nclients, sizeof(*idx->others));
+	idx->nodes = gsh_calloc(1 + 32 * ntrie, sizeof(*idx->nodes));
+	if (idx->by_rank == NULL || idx->others == NULL ||
+	    idx->nodes == NULL) {
+		LogCrit(COMPONENT_EXPORT,
+			"Could not index clients of export %d",
+			export->export_id);
+		client_index_free(idx);
+		return NULL;
+	}
+
+	idx->nodes[0].rank = CLIENT_RANK_NONE;
+	idx->nnodes = 1;
+
+	glist_for_each(glist, &export->clients) {
+		client = glist_entry(glist, exportlist_client_entry_t,
+				     cle_list);
+		idx->by_rank[rank] = client;
+		if (client_trie_prefix(client, &prefix, &len))
+			client_trie_insert(idx, prefix, len, rank);
+		else if (client->type != HOSTIF_CLIENT_V6 &&
+			 client->type != BAD_CLIENT)
+			idx->others[idx->nothers++] = rank;
+		rank++;
+	}
+
+	LogDebug(COMPONENT_EXPORT,
+		 "Export %d: %u clients, %u in trie (%u nodes)",
+		 export->export_id, nclients, ntrie, idx->nnodes);
+
+	return idx;
+}
+
+static void client_index_free(struct client_index *idx)
+{
+	if (idx == NULL)
+		return;
+
+	gsh_free(idx->by_rank);
+	gsh_free(idx->others);
+	gsh_free(idx->nodes);
+	gsh_free(idx);
+}
+
+static bool client_cache_purge_cb(struct gsh_export *export, void *state)
+{
+	struct client_index *idx = export->client_index;
+	uint32_t i;
+
+	if (idx != NULL)
+		for (i = 0; i < CLIENT_CACHE_SLOTS; i++)
+			atomic_store_uint64_t(&idx->cache[i], 0);
+
+	return true;
+}
+
+/**
+ * @brief Forget all cached access decisions
+ *
+ * Needed when netgroups or host names change.
+ */
+void export_client_cache_purge(void)
+{
+	(void)foreach_gsh_export(client_cache_purge_cb, NULL);
+}
+
+/**
+ * @brief Match an IPv4 host using the compiled client list
+ *
+ * @param[in] hostaddr Host to search for
+ * @param[in] idx      Compiled client list
+ *
+ * @return The first matching client entry, NULL if none.
+ */
+static exportlist_client_entry_t *client_match_indexed(sockaddr_t *hostaddr,
+						       struct client_index *idx)
+{
+	in_addr_t addr = get_in_addr(hostaddr);
+	uint32_t haddr = ntohl(addr);
+	uint64_t *slot;
+	uint64_t val;
+	uint32_t rank, code, i;
+	struct client_match_state state = {
+		.ipvalid = -1,
+		.cacheable = true,
+	};
+
+	slot = &idx->cache[(haddr * 2654435761U) >> (32 - CLIENT_CACHE_BITS)];
+	val = atomic_fetch_uint64_t(slot);
+	code = (uint32_t) val;
+	if (code != 0 && (uint32_t) (val >> 32) == haddr)
+		return code == CLIENT_RANK_NONE ? NULL
+						: idx->by_rank[code - 1];
+
+	rank = client_trie_lookup(idx, haddr);
+
+	for (i = 0; i < idx->nothers && idx->others[i] < rank; i++) {
+		if (client_match_entry(idx->by_rank[idx->others[i]],
+				       hostaddr, addr, &state)) {
+			rank = idx->others[i];
+			break;
 		}
 	}
 
-	/* no export found for this option */
-	return NULL;
+	if (state.cacheable) {
+		code = rank == CLIENT_RANK_NONE ? CLIENT_RANK_NONE : rank + 1;
+		atomic_store_uint64_t(slot, ((uint64_t) haddr << 32) | code);
+	}
 
+	return rank == CLIENT_RANK_NONE ? NULL : idx->by_rank[rank];
 }
 
 /**
@@ -2068,6 +2383,8 @@ static exportlist_client_entry_t *client_match_any(sockaddr_t *hostaddr,
 		struct sockaddr_in6 *psockaddr_in6 =
 		    (struct sockaddr_in6 *)hostaddr;
 		return client_matchv6(&(psockaddr_in6->sin6_addr), export);
+	} else if (export->client_index != NULL) {
+		return client_match_indexed(hostaddr, export->client_index);
 	} else {
 		return client_match(hostaddr, export);
 	}
@@ -2219,6 +2536,68 @@ sockaddr_t *convert_ipv6_to_ipv4(sockaddr_t *ipv6, sockaddr_t *ipv4)
 	}
 }
 
+/**
+ * @brief Check whether an export or any of its clients has limits
+ */
+
+static bool export_has_rate_limits(struct gsh_export *export)
+{
+	struct glist_head *glist;
+	exportlist_client_entry_t *client;
+
+	if (rate_limit_set(&export->rate_limit))
+		return true;
+
+	glist_for_each(glist, &export->clients) {
+		client = glist_entry(glist, exportlist_client_entry_t,
+				     cle_list);
+		if (rate_limit_set(&client->rate_limit))
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * @brief Charge a request to the rate limits of an export
+ *
+ * Both the limits of the client entry the caller matches and those of
+ * the export as a whole must allow the request.
+ *
+ * @param[in] export   The export
+ * @param[in] hostaddr Caller address
+ * @param[in] bytes    Data the request reads or writes
+ *
+ * @return 0 if the request may go on, else how long to defer it.
+ */
+
+nsecs_elapsed_t export_rate_limit(struct gsh_export *export,
+				  sockaddr_t *hostaddr, uint64_t bytes)
+{
+	exportlist_client_entry_t *client;
+	sockaddr_t alt_hostaddr;
+	nsecs_elapsed_t now, wait;
+
+	if (!export->rate_limited)
+		return 0;
+
+	now = rate_limit_clock();
+	client = client_match_any(convert_ipv6_to_ipv4(hostaddr,
+						       &alt_hostaddr),
+				  export);
+	if (client != NULL) {
+		wait = rate_limit_take(&client->rate_limit, bytes, now);
+		if (wait != 0)
+			return wait;
+	}
+
+	wait = rate_limit_take(&export->rate_limit, bytes, now);
+	if (wait != 0 && client != NULL)
+		rate_limit_refund(&client->rate_limit, bytes);
+
+	return wait;
+}
+
 /**
  * @brief Checks if a machine is authorized to access an export entry
  *
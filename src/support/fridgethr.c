@@ -1524,6 +1524,36 @@ void fridgethr_cancel(struct fridgethr *fr)
 	LogEvent(COMPONENT_THREAD, "All threads in %s cancelled.", fr->s);
 }
 
+/**
+ * @brief Stop the threads of a fridge, cancelling them on timeout
+ *
+ * @param[in,out] fr Fridge to stop, may be NULL if it was never
+ *                   initialized
+ *
+ * @return 0 or errors from fridgethr_sync_command.
+ */
+
+int fridgethr_shutdown(struct fridgethr *fr)
+{
+	int rc;
+
+	if (fr == NULL)
+		return 0;
+
+	rc = fridgethr_sync_command(fr, fridgethr_comm_stop, 120);
+	if (rc == ETIMEDOUT) {
+		LogMajor(COMPONENT_THREAD,
+			 "Shutdown of fridge %s timed out, cancelling threads.",
+			 fr->s);
+		fridgethr_cancel(fr);
+	} else if (rc != 0) {
+		LogMajor(COMPONENT_THREAD,
+			 "Failed shutting down fridge %s: %d", fr->s, rc);
+	}
+
+	return rc;
+}
+
 struct fridgethr *general_fridge;
 
 int general_fridge_init(void)
@@ -1550,20 +1580,7 @@ int general_fridge_init(void)
 
 int general_fridge_shutdown(void)
 {
-	int rc = fridgethr_sync_command(general_fridge,
-					fridgethr_comm_stop,
-					120);
-
-	if (rc == ETIMEDOUT) {
-		LogMajor(COMPONENT_THREAD,
-			 "Shutdown timed out, cancelling threads.");
-		fridgethr_cancel(general_fridge);
-	} else if (rc != 0) {
-		LogMajor(COMPONENT_THREAD,
-			 "Failed shutting down general fridge: %d", rc);
-	}
-
-	return rc;
+	return fridgethr_shutdown(general_fridge);
 }
 
 /** @} */
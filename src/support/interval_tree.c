@@ -0,0 +1,317 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * @addtogroup interval_tree
+ * @{
+ */
+
+/**
+ * @file interval_tree.c
+ * @brief Interval tree
+ */
+
+#include "config.h"
+#include "interval_tree.h"
+
+static inline int32_t node_height(struct interval_node *node)
+{
+	return node != NULL ? node->in_height : 0;
+}
+
+/**
+ * @brief Recompute the height and largest end of a node's subtree
+ */
+
+static void node_update(struct interval_node *node)
+{
+	int32_t hl = node_height(node->in_left);
+	int32_t hr = node_height(node->in_right);
+
+	node->in_height = (hl > hr ? hl : hr) + 1;
+	node->in_max = node->in_last;
+	if (node->in_left != NULL && node->in_left->in_max > node->in_max)
+		node->in_max = node->in_left->in_max;
+	if (node->in_right != NULL && node->in_right->in_max > node->in_max)
+		node->in_max = node->in_right->in_max;
+}
+
+/**
+ * @brief Put child where old was under parent
+ */
+
+static void replace_child(struct interval_tree *tree,
+			  struct interval_node *parent,
+			  struct interval_node *old,
+			  struct interval_node *child)
+{
+	if (parent == NULL)
+		tree->it_root = child;
+	else if (parent->in_left == old)
+		parent->in_left = child;
+	else
+		parent->in_right = child;
+
+	if (child != NULL)
+		child->in_parent = parent;
+}
+
+static struct interval_node *rotate_left(struct interval_tree *tree,
+					 struct interval_node *node)
+{
+	struct interval_node *pivot = node->in_right;
+
+	node->in_right = pivot->in_left;
+	if (pivot->in_left != NULL)
+		pivot->in_left->in_parent = node;
+	replace_child(tree, node->in_parent, node, pivot);
+	pivot->in_left = node;
+	node->in_parent = pivot;
+	node_update(node);
+	node_update(pivot);
+
+	return pivot;
+}
+
+static struct interval_node *rotate_right(struct interval_tree *tree,
+					  struct interval_node *node)
+{
+	struct interval_node *pivot = node->in_left;
+
+	node->in_left = pivot->in_right;
+	if (pivot->in_right != NULL)
+		pivot->in_right->in_parent = node;
+	replace_child(tree, node->in_parent, node, pivot);
+	pivot->in_right = node;
+	node->in_parent = pivot;
+	node_update(node);
+	node_update(pivot);
+
+	return pivot;
+}
+
+/**
+ * @brief Restore balance and subtree maxima from node up to the root
+ */
+
+static void rebalance(struct interval_tree *tree, struct interval_node *node)
+{
+	struct interval_node *child;
+	int32_t balance;
+
+	while (node != NULL) {
+		node_update(node);
+		balance = node_height(node->in_left) -
+			  node_height(node->in_right);
+
+		if (balance > 1) {
+			child = node->in_left;
+			if (node_height(child->in_left) <
+			    node_height(child->in_right))
+				rotate_left(tree, child);
+			node = rotate_right(tree, node);
+		} else if (balance < -1) {
+			child = node->in_right;
+			if (node_height(child->in_right) <
+			    node_height(child->in_left))
+				rotate_right(tree, child);
+			node = rotate_left(tree, node);
+		}
+
+		node = node->in_parent;
+	}
+}
+
+/**
+ * @brief Index an interval
+ *
+ * @param[in] tree  The tree
+ * @param[in] node  Node, not linked in any tree
+ * @param[in] start First point of the interval
+ * @param[in] last  Last point of the interval, not less than start
+ */
+
+void interval_tree_insert(struct interval_tree *tree,
+			  struct interval_node *node,
+			  uint64_t start, uint64_t last)
+{
+	struct interval_node *parent = NULL;
+	struct interval_node **link = &tree->it_root;
+
+	node->in_start = start;
+	node->in_last = last;
+
+	/* Equal starts are ordered by address, any order would do */
+	while (*link != NULL) {
+		parent = *link;
+		if (start < parent->in_start ||
+		    (start == parent->in_start && node < parent))
+			link = &parent->in_left;
+		else
+			link = &parent->in_right;
+	}
+
+	node->in_left = NULL;
+	node->in_right = NULL;
+	node->in_parent = parent;
+	*link = node;
+	tree->it_count++;
+
+	rebalance(tree, node);
+}
+
+/**
+ * @brief Remove an interval
+ *
+ * The node is left unlinked, as after interval_node_init().
+ *
+ * @param[in] tree The tree
+ * @param[in] node Node linked in the tree
+ */
+
+void interval_tree_remove(struct interval_tree *tree,
+			  struct interval_node *node)
+{
+	struct interval_node *succ, *fix;
+
+	if (node->in_left != NULL && node->in_right != NULL) {
+		/* Put the successor, which has no left child, in place
+		 * of the node.
+		 */
+		succ = node->in_right;
+		while (succ->in_left != NULL)
+			succ = succ->in_left;
+
+		if (succ->in_parent != node) {
+			fix = succ->in_parent;
+			replace_child(tree, fix, succ, succ->in_right);
+			succ->in_right = node->in_right;
+			succ->in_right->in_parent = succ;
+		} else {
+			fix = succ;
+		}
+
+		succ->in_left = node->in_left;
+		succ->in_left->in_parent = succ;
+		replace_child(tree, node->in_parent, node, succ);
+	} else {
+		fix = node->in_parent;
+		replace_child(tree, fix, node,
+			      node->in_left != NULL ? node->in_left
+						    : node->in_right);
+	}
+
+	tree->it_count--;
+	interval_node_init(node);
+
+	rebalance(tree, fix);
+}
+
+/**
+ * @brief Find the first match in a subtree
+ *
+ * The subtree is known to hold an interval ending at or after start.
+ */
+
+static struct interval_node *subtree_first(struct interval_node *node,
+					   uint64_t start, uint64_t last)
+{
+	while (true) {
+		if (node->in_left != NULL && node->in_left->in_max >= start) {
+			/* The leftmost interval ending late enough is in
+			 * the left subtree.  If it starts too late, so do
+			 * all the intervals after it.
+			 */
+			node = node->in_left;
+			continue;
+		}
+
+		if (node->in_start > last)
+			return NULL;
+
+		if (node->in_last >= start)
+			return node;
+
+		if (node->in_right == NULL || node->in_right->in_max < start)
+			return NULL;
+
+		node = node->in_right;
+	}
+}
+
+/**
+ * @brief Find the first interval overlapping a range
+ *
+ * @param[in] tree  The tree
+ * @param[in] start First point of the range
+ * @param[in] last  Last point of the range
+ *
+ * @return The matching interval with the lowest start, or NULL.
+ */
+
+struct interval_node *interval_tree_first(struct interval_tree *tree,
+					  uint64_t start, uint64_t last)
+{
+	if (tree->it_root == NULL || tree->it_root->in_max < start)
+		return NULL;
+
+	return subtree_first(tree->it_root, start, last);
+}
+
+/**
+ * @brief Find the next interval overlapping a range
+ *
+ * The tree may have changed since node was returned as long as node
+ * is still linked.
+ *
+ * @param[in] node  Previous match
+ * @param[in] start First point of the range
+ * @param[in] last  Last point of the range
+ *
+ * @return The next match in order of start, or NULL.
+ */
+
+struct interval_node *interval_tree_next(struct interval_node *node,
+					 uint64_t start, uint64_t last)
+{
+	struct interval_node *right = node->in_right;
+	struct interval_node *prev;
+
+	while (true) {
+		if (right != NULL && right->in_max >= start)
+			return subtree_first(right, start, last);
+
+		/* Go up until we come from a left child */
+		do {
+			prev = node;
+			node = node->in_parent;
+			if (node == NULL)
+				return NULL;
+			right = node->in_right;
+		} while (prev == right);
+
+		if (node->in_start > last)
+			return NULL;
+
+		if (node->in_last >= start)
+			return node;
+	}
+}
+
+/** @} */
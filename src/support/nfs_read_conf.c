@@ -102,8 +102,20 @@ static struct config_item core_params[] = {
 		       nfs_core_param, dispatch_max_reqs),
 	CONF_ITEM_UI32("Dispatch_Max_Reqs_Xprt", 1, 2048, 512,
 		       nfs_core_param, dispatch_max_reqs_xprt),
+	CONF_ITEM_UI32("Dispatch_Queue_Sets", 0, 1024, 0,
+		       nfs_core_param, dispatch_queue_sets),
+	CONF_ITEM_UI32("Dispatch_Weight_Mount", 1, 1024, 1,
+		       nfs_core_param, dispatch_weight_mount),
+	CONF_ITEM_UI32("Dispatch_Weight_Call", 1, 1024, 4,
+		       nfs_core_param, dispatch_weight_call),
+	CONF_ITEM_UI32("Dispatch_Weight_Low_Latency", 1, 1024, 8,
+		       nfs_core_param, dispatch_weight_low_latency),
+	CONF_ITEM_UI32("Dispatch_Weight_High_Latency", 1, 1024, 2,
+		       nfs_core_param, dispatch_weight_high_latency),
 	CONF_ITEM_BOOL("DRC_Disabled", false,
 		       nfs_core_param, drc.disabled),
+	CONF_ITEM_BOOL("DRC_Encoded_Replies", false,
+		       nfs_core_param, drc.encoded_replies),
 	CONF_ITEM_UI32("DRC_TCP_Npart", 1, 20, DRC_TCP_NPART,
 		       nfs_core_param, drc.tcp.npart),
 	CONF_ITEM_UI32("DRC_TCP_Size", 1, 32767, DRC_TCP_SIZE,
@@ -112,6 +124,10 @@ static struct config_item core_params[] = {
 		       nfs_core_param, drc.tcp.cachesz),
 	CONF_ITEM_UI32("DRC_TCP_Hiwat", 1, 256, DRC_TCP_HIWAT,
 		       nfs_core_param, drc.tcp.hiwat),
+	CONF_ITEM_UI64("DRC_TCP_Max_Bytes", 0, UINT64_MAX, 0,
+		       nfs_core_param, drc.tcp.max_bytes),
+	CONF_ITEM_UI64("DRC_TCP_Hiwat_Bytes", 0, UINT64_MAX, 0,
+		       nfs_core_param, drc.tcp.hiwat_bytes),
 	CONF_ITEM_UI32("DRC_TCP_Recycle_Npart", 1, 20, DRC_TCP_RECYCLE_NPART,
 		       nfs_core_param, drc.tcp.recycle_npart),
 	CONF_ITEM_UI32("DRC_TCP_Recycle_Expire_S", 0, 60*60, 600,
@@ -126,6 +142,10 @@ static struct config_item core_params[] = {
 		       nfs_core_param, drc.udp.cachesz),
 	CONF_ITEM_UI32("DRC_UDP_Hiwat", 1, 32768, DRC_UDP_HIWAT,
 		       nfs_core_param, drc.udp.hiwat),
+	CONF_ITEM_UI64("DRC_UDP_Max_Bytes", 0, UINT64_MAX, 0,
+		       nfs_core_param, drc.udp.max_bytes),
+	CONF_ITEM_UI64("DRC_UDP_Hiwat_Bytes", 0, UINT64_MAX, 0,
+		       nfs_core_param, drc.udp.hiwat_bytes),
 	CONF_ITEM_BOOL("DRC_UDP_Checksum", DRC_UDP_CHECKSUM,
 		       nfs_core_param, drc.udp.checksum),
 	CONF_ITEM_UI32("RPC_Debug_Flags", 0, UINT32_MAX, TIRPC_DEBUG_FLAGS,
@@ -162,6 +182,8 @@ static struct config_item core_params[] = {
 		       nfs_core_param, enable_FASTSTATS),
 	CONF_ITEM_I64("Manage_Gids_Expiration", 0, 7*24*60*60, 30*60,
 			nfs_core_param, manage_gids_expiration),
+	CONF_ITEM_UI32("Manage_Gids_Lookup_Threads", 1, 256, 8,
+		       nfs_core_param, manage_gids_lookup_threads),
 	CONF_ITEM_PATH("Plugins_Dir", 1, MAXPATHLEN, FSAL_MODULE_LOC,
 		       nfs_core_param, ganesha_modules_loc),
 	CONF_ITEM_UI32("heartbeat_freq", 0, 5000, 1000,
@@ -232,6 +254,11 @@ static struct config_item version4_params[] = {
 		       nfs_version4_parameter, use_getpwnam),
 	CONF_ITEM_BOOL("Allow_Numeric_Owners", true,
 		       nfs_version4_parameter, allow_numeric_owners),
+	CONF_ITEM_I64("Idmap_Cache_Expiration", 1, 7*24*60*60, 30*60,
+		      nfs_version4_parameter, idmap_cache_expiration),
+	CONF_ITEM_I64("Idmap_Negative_Cache_Expiration", 1, 24*60*60, 5*60,
+		      nfs_version4_parameter,
+		      idmap_negative_cache_expiration),
 	CONF_ITEM_BOOL("Delegations", false,
 		       nfs_version4_parameter, allow_delegations),
 	CONF_ITEM_UI32("Deleg_Recall_Retry_Delay", 0, 10,
@@ -0,0 +1,147 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * @addtogroup rate_limit
+ * @{
+ */
+
+/**
+ * @file rate_limit.c
+ * @brief Request rate limits
+ */
+
+#include "config.h"
+#include <time.h>
+#include "abstract_atomic.h"
+#include "rate_limit.h"
+
+/**
+ * @brief Monotonic time in nsecs, for rate_limit_take()
+ */
+
+nsecs_elapsed_t rate_limit_clock(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+}
+
+/**
+ * @brief Time worth of tokens for an amount at a given rate
+ */
+
+static inline uint64_t rate_limit_cost(uint64_t amount, uint64_t rate)
+{
+	return (amount / rate) * NS_PER_SEC +
+	       (amount % rate) * NS_PER_SEC / rate;
+}
+
+/**
+ * @brief Take tokens from one bucket
+ *
+ * The bucket is full at time *full and holds NS_PER_SEC worth of
+ * tokens.  A request needing more than a full bucket goes through as
+ * soon as the bucket is full.
+ *
+ * @param[in,out] full Time the bucket is full
+ * @param[in]     cost Time worth of tokens to take
+ * @param[in]     now  Current time
+ *
+ * @return 0 if the tokens were taken, else how long until they are
+ *         there.
+ */
+
+static nsecs_elapsed_t bucket_take(uint64_t *full, uint64_t cost,
+				   nsecs_elapsed_t now)
+{
+	uint64_t cur, ready, next;
+
+	do {
+		cur = atomic_fetch_uint64_t(full);
+		ready = cur + cost > NS_PER_SEC ? cur + cost - NS_PER_SEC : 0;
+		if (ready > cur)
+			ready = cur;
+		if (ready > now)
+			return ready - now;
+		next = (cur > now ? cur : now) + cost;
+	} while (!atomic_cas_uint64_t(full, cur, next));
+
+	return 0;
+}
+
+/**
+ * @brief Charge a request to a limit
+ *
+ * Either both the operation and its bytes are charged, or nothing is.
+ *
+ * @param[in,out] rl    The limit
+ * @param[in]     bytes Data read or written by the request
+ * @param[in]     now   Current time from rate_limit_clock()
+ *
+ * @return 0 if the request is within the limit, else how long to wait
+ *         before trying again.
+ */
+
+nsecs_elapsed_t rate_limit_take(struct rate_limit *rl, uint64_t bytes,
+				nsecs_elapsed_t now)
+{
+	nsecs_elapsed_t wait;
+	uint64_t ops_cost = 0;
+
+	if (rl->ops_rate != 0) {
+		ops_cost = rate_limit_cost(1, rl->ops_rate);
+		wait = bucket_take(&rl->ops_full, ops_cost, now);
+		if (wait != 0)
+			return wait;
+	}
+
+	if (rl->bytes_rate != 0 && bytes != 0) {
+		wait = bucket_take(&rl->bytes_full,
+				   rate_limit_cost(bytes, rl->bytes_rate), now);
+		if (wait != 0) {
+			if (ops_cost != 0)
+				atomic_sub_uint64_t(&rl->ops_full, ops_cost);
+			return wait;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Give back what rate_limit_take() charged
+ *
+ * @param[in,out] rl    The limit
+ * @param[in]     bytes Data of the request
+ */
+
+void rate_limit_refund(struct rate_limit *rl, uint64_t bytes)
+{
+	if (rl->ops_rate != 0)
+		atomic_sub_uint64_t(&rl->ops_full,
+				    rate_limit_cost(1, rl->ops_rate));
+
+	if (rl->bytes_rate != 0 && bytes != 0)
+		atomic_sub_uint64_t(&rl->bytes_full,
+				    rate_limit_cost(bytes, rl->bytes_rate));
+}
+
+/** @} */
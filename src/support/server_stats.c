@@ -60,6 +60,7 @@
 #include "server_stats.h"
 #include <abstract_atomic.h>
 #include "nfs_proto_functions.h"
+#include "nfs_req_queue.h"
 
 #define NFS_V3_NB_COMMAND (NFSPROC3_COMMIT + 1)
 #define NFS_V4_NB_COMMAND 2
@@ -265,6 +266,27 @@ struct op_latency {
 	uint64_t max;
 };
 
+/* latency histograms
+ *
+ * Log-linear buckets in the style of HDR histograms.  Latencies are
+ * first scaled to units of 2^LAT_HIST_SHIFT nsecs (~1 usec).  Values
+ * below LAT_HIST_SUB units get a bucket each, above that every power
+ * of 2 is split into LAT_HIST_SUB buckets, so the reported value is
+ * never off by more than 1/LAT_HIST_SUB.  Anything above 2^(LAT_HIST_MAX_MSB
+ * + 1) units (~137 secs) lands in the last bucket.
+ */
+
+#define LAT_HIST_SHIFT 10
+#define LAT_HIST_SUB_BITS 2
+#define LAT_HIST_SUB (1 << LAT_HIST_SUB_BITS)
+#define LAT_HIST_MAX_MSB 26
+#define LAT_HIST_BUCKETS \
+	((LAT_HIST_MAX_MSB - LAT_HIST_SUB_BITS + 2) * LAT_HIST_SUB)
+
+struct latency_hist {
+	uint64_t bucket[LAT_HIST_BUCKETS];
+};
+
 /* v3 ops
  */
 struct nfsv3_ops {
@@ -305,6 +327,8 @@ struct proto_op {
 	struct op_latency latency;	/* either executed ops latency */
 	struct op_latency dup_latency;	/* or latency (runtime) to replay */
 	struct op_latency queue_latency;	/* queue wait time */
+	struct latency_hist latency_hist;	/* executed ops latency */
+	struct latency_hist queue_hist;		/* queue wait time */
 };
 
 /* basic I/O transfer counter
@@ -331,21 +355,21 @@ struct nfsv3_stats {
 	struct proto_op cmds;	/* non-I/O ops = cmds - (read+write) */
 	struct xfer_op read;
 	struct xfer_op write;
-};
+} __attribute__ ((aligned(CACHE_LINE_SIZE)));
 
 /* Mount statistics counters
  */
 struct mnt_stats {
 	struct proto_op v1_ops;
 	struct proto_op v3_ops;
-};
+} __attribute__ ((aligned(CACHE_LINE_SIZE)));
 
 /* lock manager counters
  */
 
 struct nlmv4_stats {
 	struct proto_op ops;
-};
+} __attribute__ ((aligned(CACHE_LINE_SIZE)));
 
 /* Quota counters
  */
@@ -353,7 +377,7 @@ struct nlmv4_stats {
 struct rquota_stats {
 	struct proto_op ops;
 	struct proto_op ext_ops;
-};
+} __attribute__ ((aligned(CACHE_LINE_SIZE)));
 
 /* NFSv4 statistics counters
  */
@@ -363,7 +387,7 @@ struct nfsv40_stats {
 	uint64_t ops_per_compound;	/* avg = total / ops_per */
 	struct xfer_op read;
 	struct xfer_op write;
-};
+} __attribute__ ((aligned(CACHE_LINE_SIZE)));
 
 struct nfsv41_stats {
 	struct proto_op compounds;
@@ -375,7 +399,7 @@ struct nfsv41_stats {
 	struct layout_op layout_commit;
 	struct layout_op layout_return;
 	struct layout_op recall;
-};
+} __attribute__ ((aligned(CACHE_LINE_SIZE)));
 
 struct _9p_stats {
 	struct proto_op cmds;	/* non-I/O ops */
@@ -388,8 +412,10 @@ struct _9p_stats {
 		uint64_t tx_bytes;
 		uint64_t tx_pkt;
 		uint64_t tx_err;
+		uint64_t rx_buf_hits;
+		uint64_t rx_buf_misses;
 	} trans;
-};
+} __attribute__ ((aligned(CACHE_LINE_SIZE)));
 
 struct global_stats {
 	struct nfsv3_stats nfsv3;
@@ -404,7 +430,17 @@ struct global_stats {
 	struct nlm_ops lm;
 	struct mnt_ops mn;
 	struct qta_ops qt;
-};
+	struct latency_hist v3_latency[NFS_V3_NB_COMMAND];
+	struct latency_hist v4_latency[NFS4_OP_LAST_ONE];
+	struct latency_hist queue_wait[N_REQ_QUEUES];	/* per class */
+	struct {
+		uint64_t lookups;	/* group lists looked up */
+		uint64_t failures;	/* lookups that failed */
+		uint64_t coalesced;	/* waited on another lookup */
+		uint64_t refreshes;	/* expired lists looked up again */
+		struct latency_hist latency;	/* of each lookup */
+	} uid2grp;
+} __attribute__ ((aligned(CACHE_LINE_SIZE)));
 
 struct deleg_stats {
 	uint32_t curr_deleg_grants; /* current num of delegations owned by
@@ -415,7 +451,24 @@ struct deleg_stats {
 	uint32_t num_revokes;	    /* Num revokes for the client */
 };
 
-static struct global_stats global_st;
+/* Stats shards
+ *
+ * Counters bumped by every request would otherwise live on cache
+ * lines shared by all workers.  The global stats, and the stats of
+ * each export, are instead allocated as an array of stats_shards
+ * copies, each worker thread updating only its own shard.  The
+ * shards are only summed when somebody asks for them over DBus.
+ * Client stats are not sharded, a single client is rarely busy
+ * enough to matter and there can be a great many clients.
+ */
+
+#define STATS_MAX_SHARDS 32
+
+static uint32_t stats_shards = 1;	/* a power of 2 */
+static uint32_t stats_next_shard;
+static __thread int32_t stats_shard = -1;
+
+static struct global_stats *global_st;
 struct cache_stats cache_st;
 struct cache_stats *cache_stp = &cache_st;
 
@@ -423,125 +476,237 @@ struct cache_stats *cache_stp = &cache_st;
  */
 #include "server_stats_private.h"
 
+/**
+ * @brief Shard of the calling thread
+ *
+ * Each thread picks a shard round robin the first time it records
+ * anything and sticks to it.
+ */
+
+static inline uint32_t this_shard(void)
+{
+	if (unlikely(stats_shard < 0))
+		stats_shard = atomic_postinc_uint32_t(&stats_next_shard)
+			      & (stats_shards - 1);
+	return stats_shard;
+}
+
+/**
+ * @brief Shard to update in a stats block
+ */
+
+static inline uint32_t stats_shard_of(struct gsh_stats *stats)
+{
+	return stats->shards > 1 ? this_shard() : 0;
+}
+
+/**
+ * @brief Number of shards in a stats block
+ */
+
+static inline uint32_t stats_nshards(struct gsh_stats *stats)
+{
+	return stats->shards > 1 ? stats->shards : 1;
+}
+
+static inline struct global_stats *global_shard(void)
+{
+	return &global_st[this_shard()];
+}
+
+/**
+ * @brief Allocate the shards of a protocol stats struct
+ *
+ * The struct is installed with compare and swap, if another thread
+ * beat us to it we use theirs.
+ *
+ * @param statp  [IN] where the struct pointer lives
+ * @param size   [IN] size of one shard
+ * @param shards [IN] number of shards
+ *
+ * @return the installed struct, NULL on OOM
+ */
+
+static void *stats_alloc(void **statp, size_t size, uint32_t shards)
+{
+	void *sp = gsh_malloc_aligned(CACHE_LINE_SIZE, size * shards);
+
+	if (sp == NULL)
+		return NULL;
+	memset(sp, 0, size * shards);
+	if (!atomic_cas_voidptr(statp, NULL, sp)) {
+		gsh_free(sp);
+		sp = atomic_fetch_voidptr(statp);
+	}
+	return sp;
+}
+
 /**
  * @brief Get stats struct helpers
  *
  * These functions dereference the protocol specific struct
- * silently calloc the struct on first use.
+ * silently allocating it on first use, and return the shard
+ * the calling thread should update.  No locks are taken.
  *
  * @param stats [IN] the stats structure to dereference in
- * @param lock  [IN] the lock in the stats owning struct
  *
  * @return pointer to proto struct, NULL on OOM
- *
- * @TODO make them inlines for release
  */
 
-static struct nfsv3_stats *get_v3(struct gsh_stats *stats,
-				  pthread_rwlock_t *lock)
+static struct nfsv3_stats *get_v3(struct gsh_stats *stats)
 {
-	if (unlikely(stats->nfsv3 == NULL)) {
-		PTHREAD_RWLOCK_wrlock(lock);
-		if (stats->nfsv3 == NULL)
-			stats->nfsv3 =
-			    gsh_calloc(sizeof(struct nfsv3_stats), 1);
-		PTHREAD_RWLOCK_unlock(lock);
-	}
-	return stats->nfsv3;
+	struct nfsv3_stats *sp = atomic_fetch_voidptr((void **)&stats->nfsv3);
+
+	if (unlikely(sp == NULL))
+		sp = stats_alloc((void **)&stats->nfsv3,
+				 sizeof(struct nfsv3_stats),
+				 stats_nshards(stats));
+	return sp == NULL ? NULL : sp + stats_shard_of(stats);
 }
 
-static struct mnt_stats *get_mnt(struct gsh_stats *stats,
-				 pthread_rwlock_t *lock)
+static struct mnt_stats *get_mnt(struct gsh_stats *stats)
 {
-	if (unlikely(stats->mnt == NULL)) {
-		PTHREAD_RWLOCK_wrlock(lock);
-		if (stats->mnt == NULL)
-			stats->mnt = gsh_calloc(sizeof(struct mnt_stats), 1);
-		PTHREAD_RWLOCK_unlock(lock);
-	}
-	return stats->mnt;
+	struct mnt_stats *sp = atomic_fetch_voidptr((void **)&stats->mnt);
+
+	if (unlikely(sp == NULL))
+		sp = stats_alloc((void **)&stats->mnt,
+				 sizeof(struct mnt_stats),
+				 stats_nshards(stats));
+	return sp == NULL ? NULL : sp + stats_shard_of(stats);
 }
 
-static struct nlmv4_stats *get_nlm4(struct gsh_stats *stats,
-				    pthread_rwlock_t *lock)
+static struct nlmv4_stats *get_nlm4(struct gsh_stats *stats)
 {
-	if (unlikely(stats->nlm4 == NULL)) {
-		PTHREAD_RWLOCK_wrlock(lock);
-		if (stats->nlm4 == NULL)
-			stats->nlm4 = gsh_calloc(sizeof(struct nlmv4_stats), 1);
-		PTHREAD_RWLOCK_unlock(lock);
-	}
-	return stats->nlm4;
+	struct nlmv4_stats *sp = atomic_fetch_voidptr((void **)&stats->nlm4);
+
+	if (unlikely(sp == NULL))
+		sp = stats_alloc((void **)&stats->nlm4,
+				 sizeof(struct nlmv4_stats),
+				 stats_nshards(stats));
+	return sp == NULL ? NULL : sp + stats_shard_of(stats);
 }
 
-static struct rquota_stats *get_rquota(struct gsh_stats *stats,
-				       pthread_rwlock_t *lock)
+static struct rquota_stats *get_rquota(struct gsh_stats *stats)
 {
-	if (unlikely(stats->rquota == NULL)) {
-		PTHREAD_RWLOCK_wrlock(lock);
-		if (stats->rquota == NULL)
-			stats->rquota =
-			    gsh_calloc(sizeof(struct rquota_stats), 1);
-		PTHREAD_RWLOCK_unlock(lock);
-	}
-	return stats->rquota;
+	struct rquota_stats *sp =
+	    atomic_fetch_voidptr((void **)&stats->rquota);
+
+	if (unlikely(sp == NULL))
+		sp = stats_alloc((void **)&stats->rquota,
+				 sizeof(struct rquota_stats),
+				 stats_nshards(stats));
+	return sp == NULL ? NULL : sp + stats_shard_of(stats);
 }
 
-static struct nfsv40_stats *get_v40(struct gsh_stats *stats,
-				    pthread_rwlock_t *lock)
+static struct nfsv40_stats *get_v40(struct gsh_stats *stats)
 {
-	if (unlikely(stats->nfsv40 == NULL)) {
-		PTHREAD_RWLOCK_wrlock(lock);
-		if (stats->nfsv40 == NULL)
-			stats->nfsv40 =
-			    gsh_calloc(sizeof(struct nfsv40_stats), 1);
-		PTHREAD_RWLOCK_unlock(lock);
-	}
-	return stats->nfsv40;
+	struct nfsv40_stats *sp =
+	    atomic_fetch_voidptr((void **)&stats->nfsv40);
+
+	if (unlikely(sp == NULL))
+		sp = stats_alloc((void **)&stats->nfsv40,
+				 sizeof(struct nfsv40_stats),
+				 stats_nshards(stats));
+	return sp == NULL ? NULL : sp + stats_shard_of(stats);
 }
 
-static struct nfsv41_stats *get_v41(struct gsh_stats *stats,
-				    pthread_rwlock_t *lock)
+static struct nfsv41_stats *get_v41(struct gsh_stats *stats)
 {
-	if (unlikely(stats->nfsv41 == NULL)) {
-		PTHREAD_RWLOCK_wrlock(lock);
-		if (stats->nfsv41 == NULL)
-			stats->nfsv41 =
-			    gsh_calloc(sizeof(struct nfsv41_stats), 1);
-		PTHREAD_RWLOCK_unlock(lock);
-	}
-	return stats->nfsv41;
+	struct nfsv41_stats *sp =
+	    atomic_fetch_voidptr((void **)&stats->nfsv41);
+
+	if (unlikely(sp == NULL))
+		sp = stats_alloc((void **)&stats->nfsv41,
+				 sizeof(struct nfsv41_stats),
+				 stats_nshards(stats));
+	return sp == NULL ? NULL : sp + stats_shard_of(stats);
 }
 
-static struct nfsv41_stats *get_v42(struct gsh_stats *stats,
-				    pthread_rwlock_t *lock)
+static struct nfsv41_stats *get_v42(struct gsh_stats *stats)
 {
-	if (unlikely(stats->nfsv42 == NULL)) {
-		PTHREAD_RWLOCK_wrlock(lock);
-		if (stats->nfsv42 == NULL)
-			stats->nfsv42 =
-			    gsh_calloc(sizeof(struct nfsv41_stats), 1);
-		PTHREAD_RWLOCK_unlock(lock);
-	}
-	return stats->nfsv42;
+	struct nfsv41_stats *sp =
+	    atomic_fetch_voidptr((void **)&stats->nfsv42);
+
+	if (unlikely(sp == NULL))
+		sp = stats_alloc((void **)&stats->nfsv42,
+				 sizeof(struct nfsv41_stats),
+				 stats_nshards(stats));
+	return sp == NULL ? NULL : sp + stats_shard_of(stats);
 }
 
 #ifdef _USE_9P
-static struct _9p_stats *get_9p(struct gsh_stats *stats, pthread_rwlock_t *lock)
+static struct _9p_stats *get_9p(struct gsh_stats *stats)
 {
-	if (unlikely(stats->_9p == NULL)) {
-		PTHREAD_RWLOCK_wrlock(lock);
-		if (stats->_9p == NULL)
-			stats->_9p = gsh_calloc(sizeof(struct _9p_stats), 1);
-		PTHREAD_RWLOCK_unlock(lock);
-	}
-	return stats->_9p;
+	struct _9p_stats *sp = atomic_fetch_voidptr((void **)&stats->_9p);
+
+	if (unlikely(sp == NULL))
+		sp = stats_alloc((void **)&stats->_9p,
+				 sizeof(struct _9p_stats),
+				 stats_nshards(stats));
+	return sp == NULL ? NULL : sp + stats_shard_of(stats);
 }
 #endif
 
 /* Functions for recording statistics
  */
 
+/**
+ * @brief Find the histogram bucket for a latency
+ *
+ * @param ns [IN] latency in nsecs
+ *
+ * @return bucket index
+ */
+
+static inline int latency_hist_index(nsecs_elapsed_t ns)
+{
+	uint64_t val = ns >> LAT_HIST_SHIFT;
+	int msb;
+
+	if (val < LAT_HIST_SUB)
+		return val;
+	msb = 63 - __builtin_clzll(val);
+	if (msb > LAT_HIST_MAX_MSB)
+		return LAT_HIST_BUCKETS - 1;
+	return ((msb - LAT_HIST_SUB_BITS + 1) << LAT_HIST_SUB_BITS)
+		+ ((val >> (msb - LAT_HIST_SUB_BITS)) & (LAT_HIST_SUB - 1));
+}
+
+/**
+ * @brief Upper bound of a histogram bucket
+ *
+ * @param idx [IN] bucket index
+ *
+ * @return the smallest latency in nsecs above the bucket
+ */
+
+static inline uint64_t latency_hist_bound(int idx)
+{
+	int octave = idx >> LAT_HIST_SUB_BITS;
+	int sub = idx & (LAT_HIST_SUB - 1);
+
+	if (octave == 0)
+		return (uint64_t)(idx + 1) << LAT_HIST_SHIFT;
+	return (uint64_t)(LAT_HIST_SUB + sub + 1)
+		<< (octave - 1 + LAT_HIST_SHIFT);
+}
+
+/**
+ * @brief Count a latency in a histogram
+ *
+ * Only the bucket counter is touched so the cost is one atomic add
+ * on a line that is shared only with requests of similar latency.
+ *
+ * @param hist [IN] histogram
+ * @param ns   [IN] latency in nsecs
+ */
+
+static inline void record_latency_hist(struct latency_hist *hist,
+				       nsecs_elapsed_t ns)
+{
+	(void)atomic_inc_uint64_t(&hist->bucket[latency_hist_index(ns)]);
+}
+
 /**
  * @brief Record latency stats
  *
@@ -563,6 +728,7 @@ void record_latency(struct proto_op *op, nsecs_elapsed_t request_time,
 		if (op->latency.max == 0L || op->latency.max < request_time)
 			(void)atomic_store_uint64_t(&op->latency.max,
 						    request_time);
+		record_latency_hist(&op->latency_hist, request_time);
 	} else {
 		(void)atomic_add_uint64_t(&op->dup_latency.latency,
 					  request_time);
@@ -581,6 +747,7 @@ void record_latency(struct proto_op *op, nsecs_elapsed_t request_time,
 		(void)atomic_store_uint64_t(&op->queue_latency.min, qwait_time);
 	if (op->queue_latency.max == 0L || op->queue_latency.max < qwait_time)
 		(void)atomic_store_uint64_t(&op->queue_latency.max, qwait_time);
+	record_latency_hist(&op->queue_hist, qwait_time);
 }
 
 /**
@@ -612,7 +779,7 @@ static void record_io(struct xfer_op *iop, size_t requested, size_t transferred,
  * @brief record i/o stats by protocol
  */
 
-static void record_io_stats(struct gsh_stats *gsh_st, pthread_rwlock_t *lock,
+static void record_io_stats(struct gsh_stats *gsh_st,
 			    size_t requested,
 			    size_t transferred, bool success, bool is_write)
 {
@@ -620,26 +787,26 @@ static void record_io_stats(struct gsh_stats *gsh_st, pthread_rwlock_t *lock,
 
 	if (op_ctx->req_type == NFS_REQUEST) {
 		if (op_ctx->nfs_vers == NFS_V3) {
-			struct nfsv3_stats *sp = get_v3(gsh_st, lock);
+			struct nfsv3_stats *sp = get_v3(gsh_st);
 
 			if (sp == NULL)
 				return;
 			iop = is_write ? &sp->write : &sp->read;
 		} else if (op_ctx->nfs_vers == NFS_V4) {
 			if (op_ctx->nfs_minorvers == 0) {
-				struct nfsv40_stats *sp = get_v40(gsh_st, lock);
+				struct nfsv40_stats *sp = get_v40(gsh_st);
 
 				if (sp == NULL)
 					return;
 				iop = is_write ? &sp->write : &sp->read;
 			} else if (op_ctx->nfs_minorvers == 1) {
-				struct nfsv41_stats *sp = get_v41(gsh_st, lock);
+				struct nfsv41_stats *sp = get_v41(gsh_st);
 
 				if (sp == NULL)
 					return;
 				iop = is_write ? &sp->write : &sp->read;
 			} else if (op_ctx->nfs_minorvers == 2) {
-				struct nfsv41_stats *sp = get_v42(gsh_st, lock);
+				struct nfsv41_stats *sp = get_v42(gsh_st);
 
 				if (sp == NULL)
 					return;
@@ -651,7 +818,7 @@ static void record_io_stats(struct gsh_stats *gsh_st, pthread_rwlock_t *lock,
 		}
 #ifdef _USE_9P
 	} else if (op_ctx->req_type == _9P_REQUEST) {
-		struct _9p_stats *sp = get_9p(gsh_st, lock);
+		struct _9p_stats *sp = get_9p(gsh_st);
 
 		if (sp == NULL)
 			return;
@@ -725,13 +892,13 @@ static void record_layout(struct nfsv41_stats *sp, int proto_op, int status)
  * @brief Record NFS V4 compound stats
  */
 
-static void record_nfsv4_op(struct gsh_stats *gsh_st, pthread_rwlock_t *lock,
+static void record_nfsv4_op(struct gsh_stats *gsh_st,
 			    int proto_op, int minorversion,
 			    nsecs_elapsed_t request_time,
 			    nsecs_elapsed_t qwait_time, int status)
 {
 	if (minorversion == 0) {
-		struct nfsv40_stats *sp = get_v40(gsh_st, lock);
+		struct nfsv40_stats *sp = get_v40(gsh_st);
 
 		if (sp == NULL)
 			return;
@@ -750,7 +917,7 @@ static void record_nfsv4_op(struct gsh_stats *gsh_st, pthread_rwlock_t *lock,
 				  status == NFS4_OK, false);
 		}
 	} else if (minorversion == 1) {
-		struct nfsv41_stats *sp = get_v41(gsh_st, lock);
+		struct nfsv41_stats *sp = get_v41(gsh_st);
 
 		if (sp == NULL)
 			return;
@@ -772,7 +939,7 @@ static void record_nfsv4_op(struct gsh_stats *gsh_st, pthread_rwlock_t *lock,
 				  status == NFS4_OK, false);
 		}
 	} else if (minorversion == 2) {
-		struct nfsv41_stats *sp = get_v42(gsh_st, lock);
+		struct nfsv41_stats *sp = get_v42(gsh_st);
 
 		if (sp == NULL)
 			return;
@@ -801,14 +968,14 @@ static void record_nfsv4_op(struct gsh_stats *gsh_st, pthread_rwlock_t *lock,
  * @brief Record NFS V4 compound stats
  */
 
-static void record_compound(struct gsh_stats *gsh_st, pthread_rwlock_t *lock,
+static void record_compound(struct gsh_stats *gsh_st,
 			    int minorversion, uint64_t num_ops,
 			    nsecs_elapsed_t request_time,
 			    nsecs_elapsed_t qwait_time, bool success)
 {
 	if (minorversion == 0) {
 
-		struct nfsv40_stats *sp = get_v40(gsh_st, lock);
+		struct nfsv40_stats *sp = get_v40(gsh_st);
 
 		if (sp == NULL)
 			return;
@@ -817,7 +984,7 @@ static void record_compound(struct gsh_stats *gsh_st, pthread_rwlock_t *lock,
 			  false);
 		(void)atomic_add_uint64_t(&sp->ops_per_compound, num_ops);
 	} else if (minorversion == 1) {
-		struct nfsv41_stats *sp = get_v41(gsh_st, lock);
+		struct nfsv41_stats *sp = get_v41(gsh_st);
 
 		if (sp == NULL)
 			return;
@@ -826,7 +993,7 @@ static void record_compound(struct gsh_stats *gsh_st, pthread_rwlock_t *lock,
 			  false);
 		(void)atomic_add_uint64_t(&sp->ops_per_compound, num_ops);
 	} else if (minorversion == 2) {
-		struct nfsv41_stats *sp = get_v42(gsh_st, lock);
+		struct nfsv41_stats *sp = get_v42(gsh_st);
 
 		if (sp == NULL)
 			return;
@@ -845,7 +1012,6 @@ static void record_compound(struct gsh_stats *gsh_st, pthread_rwlock_t *lock,
  * Once we found the stats block, do the update(s).
  *
  * @param gsh_st       [IN] stats struct from client or export
- * @param lock         [IN] lock on client|export for malloc
  * @param reqdata      [IN] info about the proto request
  * @param success      [IN] the op returned OK (or error)
  * @param request_time [IN] time consumed by request
@@ -853,25 +1019,26 @@ static void record_compound(struct gsh_stats *gsh_st, pthread_rwlock_t *lock,
  * @param dup          [IN] detected this was a dup request
  */
 
-static void record_stats(struct gsh_stats *gsh_st, pthread_rwlock_t *lock,
+static void record_stats(struct gsh_stats *gsh_st,
 			 request_data_t *reqdata, nsecs_elapsed_t request_time,
 			 nsecs_elapsed_t qwait_time, bool success, bool dup,
 			 bool global)
 {
 	struct svc_req *req = &reqdata->r_u.nfs->req;
 	uint32_t proto_op = req->rq_proc;
+	struct global_stats *gs = global_shard();
 
 	if (req->rq_prog == nfs_param.core_param.program[P_NFS]) {
 		if (proto_op == 0)
 			return;	/* we don't count NULL ops */
 		if (req->rq_vers == NFS_V3) {
-			struct nfsv3_stats *sp = get_v3(gsh_st, lock);
+			struct nfsv3_stats *sp = get_v3(gsh_st);
 
 			if (sp == NULL)
 				return;
 			/* record stuff */
 			if (global)
-				record_op(&global_st.nfsv3.cmds, request_time,
+				record_op(&gs->nfsv3.cmds, request_time,
 					  qwait_time, success, dup);
 			switch (nfsv3_optype[proto_op]) {
 			case READ_OP:
@@ -891,13 +1058,13 @@ static void record_stats(struct gsh_stats *gsh_st, pthread_rwlock_t *lock,
 			return;
 		}
 	} else if (req->rq_prog == nfs_param.core_param.program[P_MNT]) {
-		struct mnt_stats *sp = get_mnt(gsh_st, lock);
+		struct mnt_stats *sp = get_mnt(gsh_st);
 
 		if (global && req->rq_vers == MOUNT_V1)
-			record_op(&global_st.mnt.v1_ops, request_time,
+			record_op(&gs->mnt.v1_ops, request_time,
 				  qwait_time, success, dup);
 		else if (global)
-			record_op(&global_st.mnt.v3_ops, request_time,
+			record_op(&gs->mnt.v3_ops, request_time,
 				  qwait_time, success, dup);
 
 		if (sp == NULL)
@@ -910,20 +1077,20 @@ static void record_stats(struct gsh_stats *gsh_st, pthread_rwlock_t *lock,
 			record_op(&sp->v3_ops, request_time, qwait_time,
 				  success, dup);
 	} else if (req->rq_prog == nfs_param.core_param.program[P_NLM]) {
-		struct nlmv4_stats *sp = get_nlm4(gsh_st, lock);
+		struct nlmv4_stats *sp = get_nlm4(gsh_st);
 
 		if (global)
-			record_op(&global_st.nlm4.ops, request_time,
+			record_op(&gs->nlm4.ops, request_time,
 				  qwait_time, success, dup);
 		if (sp == NULL)
 			return;
 		/* record stuff */
 		record_op(&sp->ops, request_time, qwait_time, success, dup);
 	} else if (req->rq_prog == nfs_param.core_param.program[P_RQUOTA]) {
-		struct rquota_stats *sp = get_rquota(gsh_st, lock);
+		struct rquota_stats *sp = get_rquota(gsh_st);
 
 		if (global)
-			record_op(&global_st.rquota.ops, request_time,
+			record_op(&gs->rquota.ops, request_time,
 				  qwait_time, success, dup);
 		if (sp == NULL)
 			return;
@@ -974,7 +1141,7 @@ void server_stats_transport_done(struct gsh_client *client,
 {
 	struct server_stats *server_st =
 		container_of(client, struct server_stats, client);
-	struct _9p_stats *sp = get_9p(&server_st->st, &client->lock);
+	struct _9p_stats *sp = get_9p(&server_st->st);
 
 	if (sp != NULL)
 		record_transport_stats(&sp->trans, rx_bytes, rx_pkt, rx_err,
@@ -982,6 +1149,32 @@ void server_stats_transport_done(struct gsh_client *client,
 }
 #endif
 
+/**
+ * @brief record 9P receive buffer pool hit or miss
+ *
+ * Called from the 9P/TCP reactor for each incoming message
+ */
+#ifdef _USE_9P
+void server_stats_9p_msgbuf(struct gsh_client *client, bool hit)
+{
+	struct server_stats *server_st;
+	struct _9p_stats *sp;
+
+	if (client == NULL)
+		return;
+
+	server_st = container_of(client, struct server_stats, client);
+	sp = get_9p(&server_st->st);
+	if (sp == NULL)
+		return;
+
+	if (hit)
+		atomic_inc_uint64_t(&sp->trans.rx_buf_hits);
+	else
+		atomic_inc_uint64_t(&sp->trans.rx_buf_misses);
+}
+#endif
+
 /**
  * @brief record NFS op finished
  *
@@ -995,25 +1188,29 @@ void server_stats_nfs_done(request_data_t *reqdata, int rc, bool dup)
 	nsecs_elapsed_t stop_time;
 	struct svc_req *req = &reqdata->r_u.nfs->req;
 	uint32_t proto_op = req->rq_proc;
+	struct global_stats *gs = global_shard();
 
 	if (req->rq_prog == NFS_PROGRAM && op_ctx->nfs_vers == NFS_V3)
-			global_st.v3.op[proto_op]++;
+		gs->v3.op[proto_op]++;
 	else if (req->rq_prog == nfs_param.core_param.program[P_NLM])
-		global_st.lm.op[proto_op]++;
+		gs->lm.op[proto_op]++;
 	else if (req->rq_prog == nfs_param.core_param.program[P_MNT])
-		global_st.mn.op[proto_op]++;
+		gs->mn.op[proto_op]++;
 	else if (req->rq_prog == nfs_param.core_param.program[P_RQUOTA])
-		global_st.qt.op[proto_op]++;
+		gs->qt.op[proto_op]++;
 
 	if (nfs_param.core_param.enable_FASTSTATS)
 		return;
 
 	now(&current_time);
 	stop_time = timespec_diff(&ServerBootTime, &current_time);
+	if (req->rq_prog == NFS_PROGRAM && op_ctx->nfs_vers == NFS_V3 && !dup)
+		record_latency_hist(&gs->v3_latency[proto_op],
+				    stop_time - op_ctx->start_time);
 	if (client != NULL) {
 		struct server_stats *server_st;
 		server_st = container_of(client, struct server_stats, client);
-		record_stats(&server_st->st, &client->lock, reqdata,
+		record_stats(&server_st->st, reqdata,
 			     stop_time - op_ctx->start_time,
 			     op_ctx->queue_wait,
 			     rc == NFS_REQ_OK, dup, true);
@@ -1024,7 +1221,7 @@ void server_stats_nfs_done(request_data_t *reqdata, int rc, bool dup)
 
 		exp_st =
 		    container_of(op_ctx->export, struct export_stats, export);
-		record_stats(&exp_st->st, &op_ctx->export->lock, reqdata,
+		record_stats(&exp_st->st, reqdata,
 			     stop_time - op_ctx->start_time,
 			     op_ctx->queue_wait, rc == NFS_REQ_OK, dup, false);
 		(void)atomic_store_uint64_t(&op_ctx->export->last_update,
@@ -1033,6 +1230,96 @@ void server_stats_nfs_done(request_data_t *reqdata, int rc, bool dup)
 	return;
 }
 
+/**
+ * @brief Record the time a request waited in its queue class
+ *
+ * Called by the worker that dequeued the request.
+ *
+ * @param[in] qclass Queue class, REQ_Q_*
+ * @param[in] qwait  Time spent queued
+ */
+
+void server_stats_queue_wait(uint32_t qclass, nsecs_elapsed_t qwait)
+{
+	if (qclass < N_REQ_QUEUES)
+		record_latency_hist(&global_shard()->queue_wait[qclass],
+				    qwait);
+}
+
+/**
+ * @brief Record a group list lookup for managed gids
+ *
+ * @param[in] latency Time the lookup took
+ * @param[in] success Whether the user was found
+ * @param[in] refresh Whether it replaces an expired list
+ */
+
+void server_stats_uid2grp_lookup(nsecs_elapsed_t latency, bool success,
+				 bool refresh)
+{
+	struct global_stats *gs = global_shard();
+
+	(void)atomic_inc_uint64_t(&gs->uid2grp.lookups);
+	if (!success)
+		(void)atomic_inc_uint64_t(&gs->uid2grp.failures);
+	if (refresh)
+		(void)atomic_inc_uint64_t(&gs->uid2grp.refreshes);
+	record_latency_hist(&gs->uid2grp.latency, latency);
+}
+
+/**
+ * @brief Count a caller that waited on a lookup started by another
+ */
+
+void server_stats_uid2grp_coalesced(void)
+{
+	(void)atomic_inc_uint64_t(&global_shard()->uid2grp.coalesced);
+}
+
+/**
+ * @brief Count a request deferred by rate limits
+ *
+ * @param[in] client Client that sent it, may be NULL
+ * @param[in] export Export it was charged to
+ */
+
+void server_stats_throttled(struct gsh_client *client,
+			    struct gsh_export *export)
+{
+	struct server_stats *server_st;
+	struct export_stats *exp_st;
+
+	if (client != NULL) {
+		server_st = container_of(client, struct server_stats, client);
+		(void)atomic_inc_uint64_t(&server_st->st.throttled);
+	}
+	exp_st = container_of(export, struct export_stats, export);
+	(void)atomic_inc_uint64_t(&exp_st->st.throttled);
+}
+
+/**
+ * @brief Count readahead bytes of an export
+ *
+ * @param[in] export Export the data was read ahead for
+ * @param[in] read   Bytes read ahead
+ * @param[in] hit    Bytes read ahead then read by a client
+ * @param[in] wasted Bytes read ahead then dropped unread
+ */
+
+void server_stats_readahead(struct gsh_export *export, uint64_t read,
+			    uint64_t hit, uint64_t wasted)
+{
+	struct export_stats *exp_st;
+
+	exp_st = container_of(export, struct export_stats, export);
+	if (read != 0)
+		(void)atomic_add_uint64_t(&exp_st->st.ra_bytes, read);
+	if (hit != 0)
+		(void)atomic_add_uint64_t(&exp_st->st.ra_hit, hit);
+	if (wasted != 0)
+		(void)atomic_add_uint64_t(&exp_st->st.ra_wasted, wasted);
+}
+
 /**
  * @brief record NFS V4 compound finished
  *
@@ -1045,9 +1332,10 @@ void server_stats_nfsv4_op_done(int proto_op,
 	struct gsh_client *client = op_ctx->client;
 	struct timespec current_time;
 	nsecs_elapsed_t stop_time;
+	struct global_stats *gs = global_shard();
 
 	if (op_ctx->nfs_vers == NFS_V4)
-		global_st.v4.op[proto_op]++;
+		gs->v4.op[proto_op]++;
 
 	if (nfs_param.core_param.enable_FASTSTATS)
 		return;
@@ -1055,23 +1343,27 @@ void server_stats_nfsv4_op_done(int proto_op,
 	now(&current_time);
 	stop_time = timespec_diff(&ServerBootTime, &current_time);
 
+	if (op_ctx->nfs_vers == NFS_V4 && proto_op < NFS4_OP_LAST_ONE)
+		record_latency_hist(&gs->v4_latency[proto_op],
+				    stop_time - start_time);
+
 	if (client != NULL) {
 		struct server_stats *server_st;
 		server_st = container_of(client, struct server_stats, client);
-		record_nfsv4_op(&server_st->st, &client->lock, proto_op,
+		record_nfsv4_op(&server_st->st, proto_op,
 				op_ctx->nfs_minorvers, stop_time - start_time,
 				op_ctx->queue_wait, status);
 		(void)atomic_store_uint64_t(&client->last_update, stop_time);
 	}
 
 	if (op_ctx->nfs_minorvers == 0)
-		record_op(&global_st.nfsv40.compounds, stop_time - start_time,
+		record_op(&gs->nfsv40.compounds, stop_time - start_time,
 			  op_ctx->queue_wait, status == NFS4_OK, false);
 	else if (op_ctx->nfs_minorvers == 1)
-		record_op(&global_st.nfsv41.compounds, stop_time - start_time,
+		record_op(&gs->nfsv41.compounds, stop_time - start_time,
 			  op_ctx->queue_wait, status == NFS4_OK, false);
 	else if (op_ctx->nfs_minorvers == 2)
-		record_op(&global_st.nfsv42.compounds, stop_time - start_time,
+		record_op(&gs->nfsv42.compounds, stop_time - start_time,
 			  op_ctx->queue_wait, status == NFS4_OK, false);
 
 	if (op_ctx->export != NULL) {
@@ -1079,7 +1371,7 @@ void server_stats_nfsv4_op_done(int proto_op,
 
 		exp_st =
 		    container_of(op_ctx->export, struct export_stats, export);
-		record_nfsv4_op(&exp_st->st, &op_ctx->export->lock, proto_op,
+		record_nfsv4_op(&exp_st->st, proto_op,
 				op_ctx->nfs_minorvers, stop_time - start_time,
 				op_ctx->queue_wait, status);
 		(void)atomic_store_uint64_t(&op_ctx->export->last_update,
@@ -1105,7 +1397,7 @@ void server_stats_compound_done(int num_ops, int status)
 	if (client != NULL) {
 		struct server_stats *server_st;
 		server_st = container_of(client, struct server_stats, client);
-		record_compound(&server_st->st, &client->lock,
+		record_compound(&server_st->st,
 				op_ctx->nfs_minorvers,
 				num_ops, stop_time - op_ctx->start_time,
 				op_ctx->queue_wait, status == NFS4_OK);
@@ -1116,7 +1408,7 @@ void server_stats_compound_done(int num_ops, int status)
 
 		exp_st =
 		    container_of(op_ctx->export, struct export_stats, export);
-		record_compound(&exp_st->st, &op_ctx->export->lock,
+		record_compound(&exp_st->st,
 				op_ctx->nfs_minorvers, num_ops,
 				stop_time - op_ctx->start_time,
 				op_ctx->queue_wait, status == NFS4_OK);
@@ -1141,7 +1433,7 @@ void server_stats_io_done(size_t requested,
 
 		server_st = container_of(op_ctx->client, struct server_stats,
 					 client);
-		record_io_stats(&server_st->st, &op_ctx->client->lock,
+		record_io_stats(&server_st->st,
 				requested, transferred, success,
 				is_write);
 	}
@@ -1150,7 +1442,7 @@ void server_stats_io_done(size_t requested,
 
 		exp_st =
 		    container_of(op_ctx->export, struct export_stats, export);
-		record_io_stats(&exp_st->st, &op_ctx->export->lock,
+		record_io_stats(&exp_st->st,
 				requested, transferred, success, is_write);
 	}
 	return;
@@ -1274,6 +1566,153 @@ void server_stats_summary(DBusMessageIter *iter, struct gsh_stats *st)
 				       &stats_available);
 }
 
+/* Summing the shards for reporting
+ *
+ * Shards are read without locks, like the unsharded counters always
+ * were, so a report may miss the odd op still in flight.
+ */
+
+static void sum_op_latency(struct op_latency *dst, struct op_latency *src)
+{
+	uint64_t min = atomic_fetch_uint64_t(&src->min);
+	uint64_t max = atomic_fetch_uint64_t(&src->max);
+
+	dst->latency += atomic_fetch_uint64_t(&src->latency);
+	if (min != 0 && (dst->min == 0 || min < dst->min))
+		dst->min = min;
+	if (max > dst->max)
+		dst->max = max;
+}
+
+static void sum_latency_hist(struct latency_hist *dst,
+			     struct latency_hist *src)
+{
+	int i;
+
+	for (i = 0; i < LAT_HIST_BUCKETS; i++)
+		dst->bucket[i] += atomic_fetch_uint64_t(&src->bucket[i]);
+}
+
+static void sum_proto_op(struct proto_op *dst, struct proto_op *src)
+{
+	dst->total += atomic_fetch_uint64_t(&src->total);
+	dst->errors += atomic_fetch_uint64_t(&src->errors);
+	dst->dups += atomic_fetch_uint64_t(&src->dups);
+	sum_op_latency(&dst->latency, &src->latency);
+	sum_op_latency(&dst->dup_latency, &src->dup_latency);
+	sum_op_latency(&dst->queue_latency, &src->queue_latency);
+	sum_latency_hist(&dst->latency_hist, &src->latency_hist);
+	sum_latency_hist(&dst->queue_hist, &src->queue_hist);
+}
+
+static void sum_xfer_op(struct xfer_op *dst, struct xfer_op *src)
+{
+	sum_proto_op(&dst->cmd, &src->cmd);
+	dst->requested += atomic_fetch_uint64_t(&src->requested);
+	dst->transferred += atomic_fetch_uint64_t(&src->transferred);
+}
+
+static void sum_layout_op(struct layout_op *dst, struct layout_op *src)
+{
+	dst->total += atomic_fetch_uint64_t(&src->total);
+	dst->errors += atomic_fetch_uint64_t(&src->errors);
+	dst->delays += atomic_fetch_uint64_t(&src->delays);
+}
+
+/**
+ * @brief Sum the shards of a protocol stats struct
+ *
+ * @param st  [IN]  stats owning the shards
+ * @param sp  [IN]  the shards
+ * @param sum [OUT] totals
+ */
+
+static void sum_v3(struct gsh_stats *st, struct nfsv3_stats *sp,
+		   struct nfsv3_stats *sum)
+{
+	uint32_t i;
+
+	memset(sum, 0, sizeof(*sum));
+	for (i = 0; i < stats_nshards(st); i++) {
+		sum_proto_op(&sum->cmds, &sp[i].cmds);
+		sum_xfer_op(&sum->read, &sp[i].read);
+		sum_xfer_op(&sum->write, &sp[i].write);
+	}
+}
+
+static void sum_v40(struct gsh_stats *st, struct nfsv40_stats *sp,
+		    struct nfsv40_stats *sum)
+{
+	uint32_t i;
+
+	memset(sum, 0, sizeof(*sum));
+	for (i = 0; i < stats_nshards(st); i++) {
+		sum_proto_op(&sum->compounds, &sp[i].compounds);
+		sum->ops_per_compound +=
+		    atomic_fetch_uint64_t(&sp[i].ops_per_compound);
+		sum_xfer_op(&sum->read, &sp[i].read);
+		sum_xfer_op(&sum->write, &sp[i].write);
+	}
+}
+
+static void sum_v41(struct gsh_stats *st, struct nfsv41_stats *sp,
+		    struct nfsv41_stats *sum)
+{
+	uint32_t i;
+
+	memset(sum, 0, sizeof(*sum));
+	for (i = 0; i < stats_nshards(st); i++) {
+		sum_proto_op(&sum->compounds, &sp[i].compounds);
+		sum->ops_per_compound +=
+		    atomic_fetch_uint64_t(&sp[i].ops_per_compound);
+		sum_xfer_op(&sum->read, &sp[i].read);
+		sum_xfer_op(&sum->write, &sp[i].write);
+		sum_layout_op(&sum->getdevinfo, &sp[i].getdevinfo);
+		sum_layout_op(&sum->layout_get, &sp[i].layout_get);
+		sum_layout_op(&sum->layout_commit, &sp[i].layout_commit);
+		sum_layout_op(&sum->layout_return, &sp[i].layout_return);
+		sum_layout_op(&sum->recall, &sp[i].recall);
+	}
+}
+
+static void sum_9p(struct gsh_stats *st, struct _9p_stats *sp,
+		   struct _9p_stats *sum)
+{
+	uint32_t i;
+
+	memset(sum, 0, sizeof(*sum));
+	for (i = 0; i < stats_nshards(st); i++) {
+		sum_proto_op(&sum->cmds, &sp[i].cmds);
+		sum_xfer_op(&sum->read, &sp[i].read);
+		sum_xfer_op(&sum->write, &sp[i].write);
+		sum->trans.rx_bytes += sp[i].trans.rx_bytes;
+		sum->trans.rx_pkt += sp[i].trans.rx_pkt;
+		sum->trans.rx_err += sp[i].trans.rx_err;
+		sum->trans.tx_bytes += sp[i].trans.tx_bytes;
+		sum->trans.tx_pkt += sp[i].trans.tx_pkt;
+		sum->trans.tx_err += sp[i].trans.tx_err;
+		sum->trans.rx_buf_hits += sp[i].trans.rx_buf_hits;
+		sum->trans.rx_buf_misses += sp[i].trans.rx_buf_misses;
+	}
+}
+
+/**
+ * @brief Sum a counter over the global stats shards
+ *
+ * @param offset [IN] offset of the uint64_t in struct global_stats
+ */
+
+static uint64_t global_sum(size_t offset)
+{
+	uint64_t total = 0;
+	uint32_t i;
+
+	for (i = 0; i < stats_shards; i++)
+		total += atomic_fetch_uint64_t(
+			(uint64_t *)((char *)&global_st[i] + offset));
+	return total;
+}
+
 /**
  * @brief Report I/O statistics as a struct
  *
@@ -1311,6 +1750,112 @@ static void server_dbus_iostats(struct xfer_op *iop, DBusMessageIter *iter)
 	dbus_message_iter_close_container(iter, &struct_iter);
 }
 
+/**
+ * @brief Find a percentile in a latency histogram
+ *
+ * @param hist   [IN] histogram
+ * @param total  [IN] number of samples in the histogram
+ * @param permil [IN] percentile in tenths of a percent
+ *
+ * @return upper bound in nsecs of the bucket holding the percentile
+ */
+
+static uint64_t latency_hist_percentile(struct latency_hist *hist,
+					uint64_t total, uint64_t permil)
+{
+	uint64_t rank = (total * permil + 999) / 1000;
+	uint64_t seen = 0;
+	int i;
+
+	if (total == 0)
+		return 0;
+	for (i = 0; i < LAT_HIST_BUCKETS; i++) {
+		seen += hist->bucket[i];
+		if (seen >= rank)
+			return latency_hist_bound(i);
+	}
+	return latency_hist_bound(LAT_HIST_BUCKETS - 1);
+}
+
+/**
+ * @brief Report a latency histogram as a struct
+ *
+ * struct latency {
+ *       uint64_t samples;
+ *       uint64_t p50;
+ *       uint64_t p90;
+ *       uint64_t p99;
+ *       uint64_t p999;
+ *       struct {
+ *              uint64_t upper_bound;
+ *              uint64_t count;
+ *       } buckets[];
+ * }
+ *
+ * Percentiles and bounds are in nsecs.  Only non-empty buckets are
+ * sent.
+ *
+ * @param hist  [IN] histogram to report
+ * @param iter  [IN] interator in reply stream to fill
+ */
+
+static void server_dbus_latency_hist(struct latency_hist *hist,
+				     DBusMessageIter *iter)
+{
+	DBusMessageIter struct_iter, array_iter, bucket_iter;
+	struct latency_hist snap;
+	uint64_t total = 0, val;
+	int i;
+
+	/* Work on a snapshot so the percentiles are consistent */
+	for (i = 0; i < LAT_HIST_BUCKETS; i++) {
+		snap.bucket[i] = atomic_fetch_uint64_t(&hist->bucket[i]);
+		total += snap.bucket[i];
+	}
+
+	dbus_message_iter_open_container(iter, DBUS_TYPE_STRUCT, NULL,
+					 &struct_iter);
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+				       &total);
+	val = latency_hist_percentile(&snap, total, 500);
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64, &val);
+	val = latency_hist_percentile(&snap, total, 900);
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64, &val);
+	val = latency_hist_percentile(&snap, total, 990);
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64, &val);
+	val = latency_hist_percentile(&snap, total, 999);
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64, &val);
+	dbus_message_iter_open_container(&struct_iter, DBUS_TYPE_ARRAY, "(tt)",
+					 &array_iter);
+	for (i = 0; i < LAT_HIST_BUCKETS; i++) {
+		if (snap.bucket[i] == 0)
+			continue;
+		val = latency_hist_bound(i);
+		dbus_message_iter_open_container(&array_iter, DBUS_TYPE_STRUCT,
+						 NULL, &bucket_iter);
+		dbus_message_iter_append_basic(&bucket_iter, DBUS_TYPE_UINT64,
+					       &val);
+		dbus_message_iter_append_basic(&bucket_iter, DBUS_TYPE_UINT64,
+					       &snap.bucket[i]);
+		dbus_message_iter_close_container(&array_iter, &bucket_iter);
+	}
+	dbus_message_iter_close_container(&struct_iter, &array_iter);
+	dbus_message_iter_close_container(iter, &struct_iter);
+}
+
+/**
+ * @brief Report execution and queue wait histograms of an op
+ *
+ * @param op    [IN] protocol op stats
+ * @param iter  [IN] interator in reply stream to fill
+ */
+
+static void server_dbus_op_latency(struct proto_op *op, DBusMessageIter *iter)
+{
+	server_dbus_latency_hist(&op->latency_hist, iter);
+	server_dbus_latency_hist(&op->queue_hist, iter);
+}
+
 static void server_dbus_transportstats(struct transport_stats *tstats,
 				       DBusMessageIter *iter)
 {
@@ -1330,13 +1875,19 @@ static void server_dbus_transportstats(struct transport_stats *tstats,
 				       &tstats->tx_pkt);
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
 				       &tstats->tx_err);
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+				       &tstats->rx_buf_hits);
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+				       &tstats->rx_buf_misses);
 	dbus_message_iter_close_container(iter, &struct_iter);
 }
 
 void server_dbus_total(struct export_stats *export_st, DBusMessageIter *iter)
 {
 	DBusMessageIter struct_iter;
-	uint64_t total = 0;
+	struct gsh_stats *st = &export_st->st;
+	uint64_t total;
+	uint32_t i;
 	char *version;
 
 	dbus_message_iter_open_container(iter, DBUS_TYPE_STRUCT, NULL,
@@ -1345,45 +1896,46 @@ void server_dbus_total(struct export_stats *export_st, DBusMessageIter *iter)
 	version = "NFSv3";
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING,
 				       &version);
-	if (export_st->st.nfsv3 == NULL)
-		dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
-				&total);
-	else
-		dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
-				&export_st->st.nfsv3->cmds.total);
+	total = 0;
+	if (st->nfsv3 != NULL)
+		for (i = 0; i < stats_nshards(st); i++)
+			total += st->nfsv3[i].cmds.total;
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+				       &total);
 	version = "NFSv40";
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING,
 				       &version);
-	if (export_st->st.nfsv40 == NULL)
-		dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
-				&total);
-	else
-		dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
-				&export_st->st.nfsv40->compounds.total);
+	total = 0;
+	if (st->nfsv40 != NULL)
+		for (i = 0; i < stats_nshards(st); i++)
+			total += st->nfsv40[i].compounds.total;
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+				       &total);
 	version = "NFSv41";
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING,
 				       &version);
-	if (export_st->st.nfsv41 == NULL)
-		dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
-				&total);
-	else
-		dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
-				&export_st->st.nfsv41->compounds.total);
+	total = 0;
+	if (st->nfsv41 != NULL)
+		for (i = 0; i < stats_nshards(st); i++)
+			total += st->nfsv41[i].compounds.total;
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+				       &total);
 	version = "NFSv42";
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING,
 				       &version);
-	if (export_st->st.nfsv42 == NULL)
-		dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
-				&total);
-	else
-		dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
-				&export_st->st.nfsv42->compounds.total);
+	total = 0;
+	if (st->nfsv42 != NULL)
+		for (i = 0; i < stats_nshards(st); i++)
+			total += st->nfsv42[i].compounds.total;
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+				       &total);
 	dbus_message_iter_close_container(iter, &struct_iter);
 }
 
 void global_dbus_total(DBusMessageIter *iter)
 {
 	DBusMessageIter struct_iter;
+	uint64_t total;
 	char *version;
 
 	dbus_message_iter_open_container(iter, DBUS_TYPE_STRUCT, NULL,
@@ -1392,43 +1944,54 @@ void global_dbus_total(DBusMessageIter *iter)
 	version = "NFSv3";
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING,
 				       &version);
+	total = global_sum(offsetof(struct global_stats, nfsv3.cmds.total));
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
-					&global_st.nfsv3.cmds.total);
+				       &total);
 	version = "NFSv40";
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING,
 				       &version);
+	total = global_sum(offsetof(struct global_stats,
+				    nfsv40.compounds.total));
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
-					&global_st.nfsv40.compounds.total);
+				       &total);
 	version = "NFSv41";
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING,
 				       &version);
+	total = global_sum(offsetof(struct global_stats,
+				    nfsv41.compounds.total));
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
-					&global_st.nfsv41.compounds.total);
+				       &total);
 	version = "NFSv42";
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING,
 				       &version);
+	total = global_sum(offsetof(struct global_stats,
+				    nfsv42.compounds.total));
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
-					&global_st.nfsv42.compounds.total);
+				       &total);
 	version = "NLM4";
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING,
 				       &version);
+	total = global_sum(offsetof(struct global_stats, nlm4.ops.total));
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
-					&global_st.nlm4.ops.total);
+				       &total);
 	version = "MNTv1";
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING,
 				       &version);
+	total = global_sum(offsetof(struct global_stats, mnt.v1_ops.total));
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
-					&global_st.mnt.v1_ops.total);
+				       &total);
 	version = "MNTv3";
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING,
 				       &version);
+	total = global_sum(offsetof(struct global_stats, mnt.v3_ops.total));
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
-					&global_st.mnt.v3_ops.total);
+				       &total);
 	version = "RQUOTA";
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING,
 				       &version);
+	total = global_sum(offsetof(struct global_stats, rquota.ops.total));
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
-					&global_st.rquota.ops.total);
+				       &total);
 	dbus_message_iter_close_container(iter, &struct_iter);
 }
 
@@ -1436,6 +1999,7 @@ void global_dbus_fast(DBusMessageIter *iter)
 {
 	DBusMessageIter struct_iter;
 	char *version;
+	uint64_t total;
 	char *op;
 	int i;
 
@@ -1446,103 +2010,317 @@ void global_dbus_fast(DBusMessageIter *iter)
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING,
 				       &version);
 	for (i = 0; i < NFSPROC3_COMMIT; i++) {
-		if (global_st.v3.op[i] > 0) {
+		total = global_sum(offsetof(struct global_stats,
+					    v3.op[i]));
+		if (total > 0) {
 			op = optabv3[i].name;
 			dbus_message_iter_append_basic(&struct_iter,
 					DBUS_TYPE_STRING, &op);
 			dbus_message_iter_append_basic(&struct_iter,
-					DBUS_TYPE_UINT64, &global_st.v3.op[i]);
+					DBUS_TYPE_UINT64, &total);
 		}
 	}
 	version = "\nNFSv4:";
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING,
 				       &version);
 	for (i = 0; i < NFS4_OP_LAST_ONE; i++) {
-		if (global_st.v4.op[i] > 0) {
+		total = global_sum(offsetof(struct global_stats,
+					    v4.op[i]));
+		if (total > 0) {
 			op = optabv4[i].name;
 			dbus_message_iter_append_basic(&struct_iter,
 					DBUS_TYPE_STRING, &op);
 			dbus_message_iter_append_basic(&struct_iter,
-					DBUS_TYPE_UINT64, &global_st.v4.op[i]);
+					DBUS_TYPE_UINT64, &total);
 		}
 	}
 	version = "\nNLM:";
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING,
 				       &version);
 	for (i = 0; i < NLM4_FAILED; i++) {
-		if (global_st.lm.op[i] > 0) {
+		total = global_sum(offsetof(struct global_stats,
+					    lm.op[i]));
+		if (total > 0) {
 			op = optnlm[i].name;
 			dbus_message_iter_append_basic(&struct_iter,
 					DBUS_TYPE_STRING, &op);
 			dbus_message_iter_append_basic(&struct_iter,
-					DBUS_TYPE_UINT64, &global_st.lm.op[i]);
+					DBUS_TYPE_UINT64, &total);
 		}
 	}
 	version = "\nMNT:";
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING,
 				       &version);
 	for (i = 0; i < MOUNTPROC3_EXPORT; i++) {
-		if (global_st.mn.op[i] > 0) {
+		total = global_sum(offsetof(struct global_stats,
+					    mn.op[i]));
+		if (total > 0) {
 			op = optmnt[i].name;
 			dbus_message_iter_append_basic(&struct_iter,
 					DBUS_TYPE_STRING, &op);
 			dbus_message_iter_append_basic(&struct_iter,
-					DBUS_TYPE_UINT64, &global_st.mn.op[i]);
+					DBUS_TYPE_UINT64, &total);
 		}
 	}
 	version = "\nQUOTA:";
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING,
 				       &version);
 	for (i = 0; i < RQUOTAPROC_SETACTIVEQUOTA; i++) {
-		if (global_st.qt.op[i] > 0) {
+		total = global_sum(offsetof(struct global_stats,
+					    qt.op[i]));
+		if (total > 0) {
 			op = optqta[i].name;
 			dbus_message_iter_append_basic(&struct_iter,
 					DBUS_TYPE_STRING, &op);
 			dbus_message_iter_append_basic(&struct_iter,
-					DBUS_TYPE_UINT64, &global_st.qt.op[i]);
+					DBUS_TYPE_UINT64, &total);
 		}
 	}
 	dbus_message_iter_close_container(iter, &struct_iter);
 }
 
-void server_dbus_v3_iostats(struct nfsv3_stats *v3p, DBusMessageIter *iter)
+void server_dbus_v3_iostats(struct gsh_stats *st, DBusMessageIter *iter)
+{
+	struct nfsv3_stats v3p;
+	struct timespec timestamp;
+
+	sum_v3(st, st->nfsv3, &v3p);
+	now(&timestamp);
+	dbus_append_timestamp(iter, &timestamp);
+	server_dbus_iostats(&v3p.read, iter);
+	server_dbus_iostats(&v3p.write, iter);
+}
+
+void server_dbus_v40_iostats(struct gsh_stats *st, DBusMessageIter *iter)
+{
+	struct nfsv40_stats v40p;
+	struct timespec timestamp;
+
+	sum_v40(st, st->nfsv40, &v40p);
+	now(&timestamp);
+	dbus_append_timestamp(iter, &timestamp);
+	server_dbus_iostats(&v40p.read, iter);
+	server_dbus_iostats(&v40p.write, iter);
+}
+
+void server_dbus_v41_iostats(struct gsh_stats *st, DBusMessageIter *iter)
+{
+	struct nfsv41_stats v41p;
+	struct timespec timestamp;
+
+	sum_v41(st, st->nfsv41, &v41p);
+	now(&timestamp);
+	dbus_append_timestamp(iter, &timestamp);
+	server_dbus_iostats(&v41p.read, iter);
+	server_dbus_iostats(&v41p.write, iter);
+}
+
+void server_dbus_v42_iostats(struct gsh_stats *st, DBusMessageIter *iter)
+{
+	struct nfsv41_stats v42p;
+	struct timespec timestamp;
+
+	sum_v41(st, st->nfsv42, &v42p);
+	now(&timestamp);
+	dbus_append_timestamp(iter, &timestamp);
+	server_dbus_iostats(&v42p.read, iter);
+	server_dbus_iostats(&v42p.write, iter);
+}
+
+void server_dbus_v3_latency(struct gsh_stats *st, DBusMessageIter *iter)
+{
+	struct nfsv3_stats v3p;
+	struct timespec timestamp;
+
+	sum_v3(st, st->nfsv3, &v3p);
+	now(&timestamp);
+	dbus_append_timestamp(iter, &timestamp);
+	server_dbus_op_latency(&v3p.read.cmd, iter);
+	server_dbus_op_latency(&v3p.write.cmd, iter);
+	server_dbus_op_latency(&v3p.cmds, iter);
+}
+
+void server_dbus_v40_latency(struct gsh_stats *st, DBusMessageIter *iter)
+{
+	struct nfsv40_stats v40p;
+	struct timespec timestamp;
+
+	sum_v40(st, st->nfsv40, &v40p);
+	now(&timestamp);
+	dbus_append_timestamp(iter, &timestamp);
+	server_dbus_op_latency(&v40p.read.cmd, iter);
+	server_dbus_op_latency(&v40p.write.cmd, iter);
+	server_dbus_op_latency(&v40p.compounds, iter);
+}
+
+void server_dbus_v41_latency(struct gsh_stats *st, DBusMessageIter *iter)
 {
+	struct nfsv41_stats v41p;
 	struct timespec timestamp;
 
+	sum_v41(st, st->nfsv41, &v41p);
 	now(&timestamp);
 	dbus_append_timestamp(iter, &timestamp);
-	server_dbus_iostats(&v3p->read, iter);
-	server_dbus_iostats(&v3p->write, iter);
+	server_dbus_op_latency(&v41p.read.cmd, iter);
+	server_dbus_op_latency(&v41p.write.cmd, iter);
+	server_dbus_op_latency(&v41p.compounds, iter);
 }
 
-void server_dbus_v40_iostats(struct nfsv40_stats *v40p, DBusMessageIter *iter)
+void server_dbus_v42_latency(struct gsh_stats *st, DBusMessageIter *iter)
 {
+	struct nfsv41_stats v42p;
 	struct timespec timestamp;
 
+	sum_v41(st, st->nfsv42, &v42p);
 	now(&timestamp);
 	dbus_append_timestamp(iter, &timestamp);
-	server_dbus_iostats(&v40p->read, iter);
-	server_dbus_iostats(&v40p->write, iter);
+	server_dbus_op_latency(&v42p.read.cmd, iter);
+	server_dbus_op_latency(&v42p.write.cmd, iter);
+	server_dbus_op_latency(&v42p.compounds, iter);
+}
+
+/**
+ * @brief Report server wide latency of each NFS operation
+ *
+ * An array of (op name, samples, p50, p90, p99, p999), one entry for
+ * each NFSv3 procedure and NFSv4 operation that has been seen.
+ * The histograms of each op are summed over the global stats shards.
+ *
+ * @param offset [IN] offset of the histogram array in struct global_stats
+ */
+
+static void global_dbus_op_latency(DBusMessageIter *iter,
+				   const char *prefix,
+				   const struct op_name *names,
+				   size_t offset, int nops)
+{
+	DBusMessageIter struct_iter;
+	struct latency_hist snap;
+	struct latency_hist *hists;
+	char opname[64];
+	char *op = opname;
+	uint64_t total, val;
+	uint32_t shard;
+	int i, j;
+
+	for (i = 0; i < nops; i++) {
+		memset(&snap, 0, sizeof(snap));
+		for (shard = 0; shard < stats_shards; shard++) {
+			hists = (struct latency_hist *)
+				((char *)&global_st[shard] + offset);
+			sum_latency_hist(&snap, &hists[i]);
+		}
+		total = 0;
+		for (j = 0; j < LAT_HIST_BUCKETS; j++)
+			total += snap.bucket[j];
+		if (total == 0 || names[i].name == NULL)
+			continue;
+		snprintf(opname, sizeof(opname), "%s%s", prefix,
+			 names[i].name);
+		dbus_message_iter_open_container(iter, DBUS_TYPE_STRUCT, NULL,
+						 &struct_iter);
+		dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING,
+					       &op);
+		dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+					       &total);
+		val = latency_hist_percentile(&snap, total, 500);
+		dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+					       &val);
+		val = latency_hist_percentile(&snap, total, 900);
+		dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+					       &val);
+		val = latency_hist_percentile(&snap, total, 990);
+		dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+					       &val);
+		val = latency_hist_percentile(&snap, total, 999);
+		dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+					       &val);
+		dbus_message_iter_close_container(iter, &struct_iter);
+	}
 }
 
-void server_dbus_v41_iostats(struct nfsv41_stats *v41p, DBusMessageIter *iter)
+void server_dbus_global_latency(DBusMessageIter *iter)
 {
+	DBusMessageIter array_iter;
 	struct timespec timestamp;
 
 	now(&timestamp);
 	dbus_append_timestamp(iter, &timestamp);
-	server_dbus_iostats(&v41p->read, iter);
-	server_dbus_iostats(&v41p->write, iter);
+	dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY,
+					 OP_LATENCY_REPLY_ARRAY_TYPE,
+					 &array_iter);
+	global_dbus_op_latency(&array_iter, "NFSv3:", optabv3,
+			       offsetof(struct global_stats, v3_latency),
+			       NFS_V3_NB_COMMAND);
+	global_dbus_op_latency(&array_iter, "NFSv4:", optabv4,
+			       offsetof(struct global_stats, v4_latency),
+			       NFS4_OP_LAST_ONE);
+	dbus_message_iter_close_container(iter, &array_iter);
+}
+
+/**
+ * @brief Report the queue wait histogram of each request class
+ *
+ * @param iter [IN] iterator in reply stream to fill
+ */
+
+void server_dbus_queue_wait(DBusMessageIter *iter)
+{
+	struct latency_hist snap;
+	uint32_t shard;
+	int ix;
+
+	for (ix = 0; ix < N_REQ_QUEUES; ix++) {
+		memset(&snap, 0, sizeof(snap));
+		for (shard = 0; shard < stats_shards; shard++)
+			sum_latency_hist(&snap,
+					 &global_st[shard].queue_wait[ix]);
+		server_dbus_latency_hist(&snap, iter);
+	}
 }
 
-void server_dbus_v42_iostats(struct nfsv41_stats *v42p, DBusMessageIter *iter)
+/**
+ * @brief Report the managed gids lookups
+ *
+ * @param iter [IN] iterator in reply stream to fill
+ */
+
+void server_dbus_uid2grp(DBusMessageIter *iter)
 {
+	DBusMessageIter struct_iter;
 	struct timespec timestamp;
+	struct latency_hist snap;
+	uint64_t lookups = 0, failures = 0, coalesced = 0, refreshes = 0;
+	uint32_t shard;
 
 	now(&timestamp);
 	dbus_append_timestamp(iter, &timestamp);
-	server_dbus_iostats(&v42p->read, iter);
-	server_dbus_iostats(&v42p->write, iter);
+
+	memset(&snap, 0, sizeof(snap));
+	for (shard = 0; shard < stats_shards; shard++) {
+		lookups += atomic_fetch_uint64_t(&global_st[shard]
+						 .uid2grp.lookups);
+		failures += atomic_fetch_uint64_t(&global_st[shard]
+						  .uid2grp.failures);
+		coalesced += atomic_fetch_uint64_t(&global_st[shard]
+						   .uid2grp.coalesced);
+		refreshes += atomic_fetch_uint64_t(&global_st[shard]
+						   .uid2grp.refreshes);
+		sum_latency_hist(&snap, &global_st[shard].uid2grp.latency);
+	}
+
+	dbus_message_iter_open_container(iter, DBUS_TYPE_STRUCT, NULL,
+					 &struct_iter);
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+				       &lookups);
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+				       &failures);
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+				       &coalesced);
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+				       &refreshes);
+	dbus_message_iter_close_container(iter, &struct_iter);
+	server_dbus_latency_hist(&snap, iter);
 }
 
 void server_dbus_fill_io(DBusMessageIter *array_iter, uint16_t *export_id,
@@ -1586,36 +2364,42 @@ void server_dbus_fill_io(DBusMessageIter *array_iter, uint16_t *export_id,
 void server_dbus_all_iostats(struct export_stats *export_statistics,
 			     DBusMessageIter *array_iter)
 {
-	if (export_statistics->st.nfsv3 != NULL) {
+	struct gsh_stats *st = &export_statistics->st;
+
+	if (st->nfsv3 != NULL) {
+		struct nfsv3_stats v3;
+
+		sum_v3(st, st->nfsv3, &v3);
 		server_dbus_fill_io(array_iter,
 				    &(export_statistics->export.export_id),
-				    "NFSv3",
-				    &(export_statistics->st.nfsv3->read),
-				    &(export_statistics->st.nfsv3->write));
+				    "NFSv3", &v3.read, &v3.write);
 	}
 
-	if (export_statistics->st.nfsv40 != NULL) {
+	if (st->nfsv40 != NULL) {
+		struct nfsv40_stats v40;
+
+		sum_v40(st, st->nfsv40, &v40);
 		server_dbus_fill_io(array_iter,
 				    &(export_statistics->export.export_id),
-				    "NFSv40",
-				    &(export_statistics->st.nfsv40->read),
-				    &(export_statistics->st.nfsv40->write));
+				    "NFSv40", &v40.read, &v40.write);
 	}
 
-	if (export_statistics->st.nfsv41 != NULL) {
+	if (st->nfsv41 != NULL) {
+		struct nfsv41_stats v41;
+
+		sum_v41(st, st->nfsv41, &v41);
 		server_dbus_fill_io(array_iter,
 				    &(export_statistics->export.export_id),
-				    "NFSv41",
-				    &(export_statistics->st.nfsv41->read),
-				    &(export_statistics->st.nfsv41->write));
+				    "NFSv41", &v41.read, &v41.write);
 	}
 
-	if (export_statistics->st.nfsv42 != NULL) {
+	if (st->nfsv42 != NULL) {
+		struct nfsv41_stats v42;
+
+		sum_v41(st, st->nfsv42, &v42);
 		server_dbus_fill_io(array_iter,
 				    &(export_statistics->export.export_id),
-				    "NFSv42",
-				    &(export_statistics->st.nfsv42->read),
-				    &(export_statistics->st.nfsv42->write));
+				    "NFSv42", &v42.read, &v42.write);
 	}
 }
 
@@ -1682,27 +2466,47 @@ void cache_inode_dbus_show(DBusMessageIter *iter)
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING, &type);
 	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
 					&cache_st.inode_mapping);
+	type = "data_hit";
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING, &type);
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+					&cache_st.data_hit);
+	type = "data_miss";
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING, &type);
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+					&cache_st.data_miss);
+	type = "data_evict";
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING, &type);
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+					&cache_st.data_evict);
+	type = "data_bytes";
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING, &type);
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+					&cache_st.data_bytes);
 
 	dbus_message_iter_close_container(iter, &struct_iter);
 }
 
-void server_dbus_9p_iostats(struct _9p_stats *_9pp, DBusMessageIter *iter)
+void server_dbus_9p_iostats(struct gsh_stats *st, DBusMessageIter *iter)
 {
+	struct _9p_stats _9pp;
 	struct timespec timestamp;
 
+	sum_9p(st, st->_9p, &_9pp);
 	now(&timestamp);
 	dbus_append_timestamp(iter, &timestamp);
-	server_dbus_iostats(&_9pp->read, iter);
-	server_dbus_iostats(&_9pp->write, iter);
+	server_dbus_iostats(&_9pp.read, iter);
+	server_dbus_iostats(&_9pp.write, iter);
 }
 
-void server_dbus_9p_transstats(struct _9p_stats *_9pp, DBusMessageIter *iter)
+void server_dbus_9p_transstats(struct gsh_stats *st, DBusMessageIter *iter)
 {
+	struct _9p_stats _9pp;
 	struct timespec timestamp;
 
+	sum_9p(st, st->_9p, &_9pp);
 	now(&timestamp);
 	dbus_append_timestamp(iter, &timestamp);
-	server_dbus_transportstats(&_9pp->trans, iter);
+	server_dbus_transportstats(&_9pp.trans, iter);
 }
 
 /**
@@ -1733,30 +2537,34 @@ static void server_dbus_layouts(struct layout_op *lop, DBusMessageIter *iter)
 	dbus_message_iter_close_container(iter, &struct_iter);
 }
 
-void server_dbus_v41_layouts(struct nfsv41_stats *v41p, DBusMessageIter *iter)
+void server_dbus_v41_layouts(struct gsh_stats *st, DBusMessageIter *iter)
 {
+	struct nfsv41_stats v41p;
 	struct timespec timestamp;
 
+	sum_v41(st, st->nfsv41, &v41p);
 	now(&timestamp);
 	dbus_append_timestamp(iter, &timestamp);
-	server_dbus_layouts(&v41p->getdevinfo, iter);
-	server_dbus_layouts(&v41p->layout_get, iter);
-	server_dbus_layouts(&v41p->layout_commit, iter);
-	server_dbus_layouts(&v41p->layout_return, iter);
-	server_dbus_layouts(&v41p->recall, iter);
+	server_dbus_layouts(&v41p.getdevinfo, iter);
+	server_dbus_layouts(&v41p.layout_get, iter);
+	server_dbus_layouts(&v41p.layout_commit, iter);
+	server_dbus_layouts(&v41p.layout_return, iter);
+	server_dbus_layouts(&v41p.recall, iter);
 }
 
-void server_dbus_v42_layouts(struct nfsv41_stats *v42p, DBusMessageIter *iter)
+void server_dbus_v42_layouts(struct gsh_stats *st, DBusMessageIter *iter)
 {
+	struct nfsv41_stats v42p;
 	struct timespec timestamp;
 
+	sum_v41(st, st->nfsv42, &v42p);
 	now(&timestamp);
 	dbus_append_timestamp(iter, &timestamp);
-	server_dbus_layouts(&v42p->getdevinfo, iter);
-	server_dbus_layouts(&v42p->layout_get, iter);
-	server_dbus_layouts(&v42p->layout_commit, iter);
-	server_dbus_layouts(&v42p->layout_return, iter);
-	server_dbus_layouts(&v42p->recall, iter);
+	server_dbus_layouts(&v42p.getdevinfo, iter);
+	server_dbus_layouts(&v42p.layout_get, iter);
+	server_dbus_layouts(&v42p.layout_commit, iter);
+	server_dbus_layouts(&v42p.layout_return, iter);
+	server_dbus_layouts(&v42p.recall, iter);
 }
 
 /**
@@ -1785,6 +2593,56 @@ void server_dbus_delegations(struct deleg_stats *ds, DBusMessageIter *iter)
 	dbus_message_iter_close_container(iter, &struct_iter);
 }
 
+/**
+ * @brief Report the requests deferred by rate limits
+ *
+ * @param[in]  st   Client or export stats
+ * @param[out] iter DBus message
+ */
+
+void server_dbus_throttled(struct gsh_stats *st, DBusMessageIter *iter)
+{
+	struct timespec timestamp;
+	DBusMessageIter struct_iter;
+	uint64_t throttled = atomic_fetch_uint64_t(&st->throttled);
+
+	now(&timestamp);
+	dbus_append_timestamp(iter, &timestamp);
+	dbus_message_iter_open_container(iter, DBUS_TYPE_STRUCT, NULL,
+					 &struct_iter);
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+				       &throttled);
+	dbus_message_iter_close_container(iter, &struct_iter);
+}
+
+/**
+ * @brief Report the readahead of an export
+ *
+ * @param[in]  st   Export stats
+ * @param[out] iter DBus message
+ */
+
+void server_dbus_readahead(struct gsh_stats *st, DBusMessageIter *iter)
+{
+	struct timespec timestamp;
+	DBusMessageIter struct_iter;
+	uint64_t ra_bytes = atomic_fetch_uint64_t(&st->ra_bytes);
+	uint64_t ra_hit = atomic_fetch_uint64_t(&st->ra_hit);
+	uint64_t ra_wasted = atomic_fetch_uint64_t(&st->ra_wasted);
+
+	now(&timestamp);
+	dbus_append_timestamp(iter, &timestamp);
+	dbus_message_iter_open_container(iter, DBUS_TYPE_STRUCT, NULL,
+					 &struct_iter);
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+				       &ra_bytes);
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+				       &ra_hit);
+	dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+				       &ra_wasted);
+	dbus_message_iter_close_container(iter, &struct_iter);
+}
+
 #endif				/* USE_DBUS */
 
 /**
@@ -1832,4 +2690,41 @@ void server_stats_free(struct gsh_stats *statsp)
 	}
 }
 
+/**
+ * @brief Make a stats block use the per worker shards
+ *
+ * Must be called before anything is recorded in the block.
+ *
+ * @param statsp [IN] pointer to stats to be sharded
+ */
+
+void server_stats_set_sharded(struct gsh_stats *statsp)
+{
+	statsp->shards = stats_shards;
+}
+
+/**
+ * @brief Size the stats shards and allocate the global stats
+ *
+ * One shard per online CPU, rounded up to a power of 2.
+ */
+
+void server_stats_init(void)
+{
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	uint32_t shards = 1;
+
+	while (shards < ncpu && shards < STATS_MAX_SHARDS)
+		shards <<= 1;
+	stats_shards = shards;
+
+	global_st = gsh_malloc_aligned(CACHE_LINE_SIZE,
+				       sizeof(struct global_stats) * shards);
+	if (global_st == NULL)
+		LogFatal(COMPONENT_INIT,
+			 "Could not allocate global stats");
+	memset(global_st, 0, sizeof(struct global_stats) * shards);
+	LogDebug(COMPONENT_INIT, "Server stats using %u shards", shards);
+}
+
 /** @} */
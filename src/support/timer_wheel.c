@@ -0,0 +1,254 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * @addtogroup timer_wheel
+ * @{
+ */
+
+/**
+ * @file timer_wheel.c
+ * @brief Timer wheel for object expiry
+ */
+
+#include "config.h"
+#include <errno.h>
+#include "abstract_mem.h"
+#include "common_utils.h"
+#include "log.h"
+#include "timer_wheel.h"
+
+/**
+ * @brief Initialize a timer wheel
+ *
+ * @param[in] wheel The wheel
+ * @param[in] span  Seconds the wheel should cover, rounded up to a
+ *                  power of 2
+ *
+ * @return 0 or ENOMEM.
+ */
+
+int timer_wheel_init(struct timer_wheel *wheel, uint32_t span)
+{
+	uint32_t nslots = 1;
+	uint32_t i;
+
+	while (nslots < span)
+		nslots <<= 1;
+
+	wheel->tw_slots = gsh_malloc(nslots * sizeof(struct glist_head));
+	if (wheel->tw_slots == NULL)
+		return ENOMEM;
+
+	for (i = 0; i < nslots; i++)
+		glist_init(&wheel->tw_slots[i]);
+
+	wheel->tw_mask = nslots - 1;
+	wheel->tw_now = time(NULL);
+	wheel->tw_armed = 0;
+	wheel->tw_current = NULL;
+	memset(&wheel->tw_runner, 0, sizeof(wheel->tw_runner));
+	PTHREAD_MUTEX_init(&wheel->tw_mtx, NULL);
+	PTHREAD_COND_init(&wheel->tw_cv, NULL);
+
+	return 0;
+}
+
+/**
+ * @brief Release a timer wheel
+ *
+ * Entries still armed are forgotten, not expired.
+ *
+ * @param[in] wheel The wheel
+ */
+
+void timer_wheel_destroy(struct timer_wheel *wheel)
+{
+	PTHREAD_COND_destroy(&wheel->tw_cv);
+	PTHREAD_MUTEX_destroy(&wheel->tw_mtx);
+	gsh_free(wheel->tw_slots);
+	wheel->tw_slots = NULL;
+}
+
+/**
+ * @brief Link an entry in the slot for its deadline
+ *
+ * The wheel lock must be held.  Deadlines already past go in the
+ * next slot to be expired.
+ */
+
+static void timer_wheel_link(struct timer_wheel *wheel,
+			     struct timer_wheel_entry *entry)
+{
+	time_t tick = entry->twe_when;
+
+	if (tick < wheel->tw_now)
+		tick = wheel->tw_now;
+
+	glist_add_tail(&wheel->tw_slots[tick & wheel->tw_mask],
+		       &entry->twe_list);
+	entry->twe_flags |= TW_ARMED;
+	wheel->tw_armed++;
+}
+
+static void timer_wheel_unlink(struct timer_wheel *wheel,
+			       struct timer_wheel_entry *entry)
+{
+	glist_del(&entry->twe_list);
+	entry->twe_flags &= ~TW_ARMED;
+	wheel->tw_armed--;
+}
+
+/**
+ * @brief Arm an entry
+ *
+ * If the entry is already armed for an earlier deadline it is left
+ * alone, the expiry callback will find out the real deadline.
+ *
+ * @param[in] wheel The wheel
+ * @param[in] entry The entry
+ * @param[in] when  Deadline
+ */
+
+void timer_wheel_arm(struct timer_wheel *wheel,
+		     struct timer_wheel_entry *entry, time_t when)
+{
+	PTHREAD_MUTEX_lock(&wheel->tw_mtx);
+
+	if (entry->twe_flags & TW_ARMED) {
+		if (entry->twe_when <= when) {
+			PTHREAD_MUTEX_unlock(&wheel->tw_mtx);
+			return;
+		}
+		timer_wheel_unlink(wheel, entry);
+	}
+
+	entry->twe_when = when;
+	timer_wheel_link(wheel, entry);
+
+	PTHREAD_MUTEX_unlock(&wheel->tw_mtx);
+}
+
+/**
+ * @brief Disarm an entry before its object is freed
+ *
+ * If the expiry callback is running on the entry in another thread,
+ * wait for it to finish.  Called from the callback itself, this lets
+ * the callback free the object.
+ *
+ * @param[in] wheel The wheel
+ * @param[in] entry The entry
+ */
+
+void timer_wheel_cancel(struct timer_wheel *wheel,
+			struct timer_wheel_entry *entry)
+{
+	PTHREAD_MUTEX_lock(&wheel->tw_mtx);
+
+	while ((entry->twe_flags & TW_RUNNING) &&
+	       !pthread_equal(wheel->tw_runner, pthread_self()))
+		pthread_cond_wait(&wheel->tw_cv, &wheel->tw_mtx);
+
+	if (entry->twe_flags & TW_ARMED)
+		timer_wheel_unlink(wheel, entry);
+
+	if (wheel->tw_current == entry) {
+		/* The callback is done with the entry */
+		wheel->tw_current = NULL;
+		entry->twe_flags &= ~TW_RUNNING;
+	}
+
+	PTHREAD_MUTEX_unlock(&wheel->tw_mtx);
+}
+
+/**
+ * @brief Run the callback on every entry due by now
+ *
+ * Only the slots for ticks elapsed since the previous call are
+ * looked at.  Entries found in those slots that are not due yet
+ * (they are a revolution or more away) are linked back.
+ *
+ * @param[in] wheel The wheel
+ * @param[in] now   Current time
+ * @param[in] cb    Expiry callback
+ * @param[in] arg   Callback argument
+ *
+ * @return Number of entries expired.
+ */
+
+uint64_t timer_wheel_expire(struct timer_wheel *wheel, time_t now,
+			    timer_wheel_cb_t cb, void *arg)
+{
+	struct glist_head due;
+	struct timer_wheel_entry *entry;
+	uint64_t count = 0;
+	time_t tick;
+
+	glist_init(&due);
+
+	PTHREAD_MUTEX_lock(&wheel->tw_mtx);
+
+	wheel->tw_runner = pthread_self();
+
+	/* No need to go around more than once */
+	if (now - wheel->tw_now > wheel->tw_mask)
+		wheel->tw_now = now - wheel->tw_mask;
+
+	for (tick = wheel->tw_now; tick <= now; tick++) {
+		glist_splice_tail(&due,
+				  &wheel->tw_slots[tick & wheel->tw_mask]);
+	}
+
+	wheel->tw_now = now + 1;
+
+	while (!glist_empty(&due)) {
+		entry = glist_first_entry(&due, struct timer_wheel_entry,
+					  twe_list);
+
+		timer_wheel_unlink(wheel, entry);
+
+		if (entry->twe_when > now) {
+			timer_wheel_link(wheel, entry);
+			continue;
+		}
+
+		entry->twe_flags |= TW_RUNNING;
+		wheel->tw_current = entry;
+		PTHREAD_MUTEX_unlock(&wheel->tw_mtx);
+
+		cb(entry, now, arg);
+		count++;
+
+		PTHREAD_MUTEX_lock(&wheel->tw_mtx);
+		/* The entry is gone if the callback cancelled it */
+		if (wheel->tw_current != NULL) {
+			entry->twe_flags &= ~TW_RUNNING;
+			wheel->tw_current = NULL;
+		}
+		pthread_cond_broadcast(&wheel->tw_cv);
+	}
+
+	memset(&wheel->tw_runner, 0, sizeof(wheel->tw_runner));
+
+	PTHREAD_MUTEX_unlock(&wheel->tw_mtx);
+
+	return count;
+}
+
+/** @} */
@@ -45,6 +45,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "common_utils.h"
+#include "fridgethr.h"
+#include "server_stats.h"
 #include "uid2grp.h"
 
 /* group_data has a reference counter. If it goes to zero, it implies
@@ -191,6 +193,7 @@ static struct group_data *uid2grp_allocate_by_name(
 	PTHREAD_MUTEX_init(&gdata->lock, NULL);
 	gdata->epoch = time(NULL);
 	gdata->refcount = 0;
+	gdata->refreshing = false;
 	return gdata;
 }
 
@@ -234,57 +237,368 @@ static struct group_data *uid2grp_allocate_by_uid(uid_t uid)
 	PTHREAD_MUTEX_init(&gdata->lock, NULL);
 	gdata->epoch = time(NULL);
 	gdata->refcount = 0;
+	gdata->refreshing = false;
 	return gdata;
 }
 
+/**
+ * @brief Threads looking up group lists
+ *
+ * A cold cache would otherwise have every worker serving a user ask
+ * the directory service for the same group list.  Lookups are queued
+ * to a bounded pool instead and each user is only looked up once at
+ * a time, the requests that miss the cache while the lookup is under
+ * way wait for its result.
+ */
+
+static struct fridgethr *uid2grp_fridge;
+
+/**
+ * @brief A group list lookup under way
+ */
+
+struct uid2grp_lookup {
+	struct glist_head list;	/*< Link in uid2grp_lookups */
+	pthread_cond_t cv;	/*< Signalled when done */
+	uid_t uid;		/*< User to look up, if no name */
+	struct gsh_buffdesc name;	/*< User to look up, if any */
+	bool refresh;		/*< Replaces an expired list */
+	bool done;		/*< The lookup finished */
+	struct group_data *gdata;	/*< Result, held for the waiters */
+	uint32_t refcount;	/*< Waiters and the lookup thread */
+};
+
+/**
+ * @brief Lock protecting the lookups under way
+ */
+
+static pthread_mutex_t uid2grp_lookup_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Lookups under way, there are only as many as users missing
+ * from the cache at once so a list will do.
+ */
+
+static struct glist_head uid2grp_lookups = GLIST_HEAD_INIT(uid2grp_lookups);
+
+/**
+ * @brief Initialize the uid2grp cache and lookup threads
+ *
+ * @return true on success, false on failure
+ */
+
+bool uid2grp_init(void)
+{
+	struct fridgethr_params frp;
+	int rc;
+
+	uid2grp_cache_init();
+
+	memset(&frp, 0, sizeof(struct fridgethr_params));
+	frp.thr_max = nfs_param.core_param.manage_gids_lookup_threads;
+	frp.thr_min = 1;
+	frp.flavor = fridgethr_flavor_worker;
+	frp.deferment = fridgethr_defer_queue;
+
+	rc = fridgethr_init(&uid2grp_fridge, "uid2grp", &frp);
+	if (rc != 0) {
+		LogMajor(COMPONENT_IDMAPPER,
+			 "Unable to initialize lookup threads: %d", rc);
+		uid2grp_fridge = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Stop the lookup threads
+ *
+ * Lookups asked for afterwards are done by the caller.
+ *
+ * @return 0 or errors from the fridge.
+ */
+
+int uid2grp_shutdown(void)
+{
+	return fridgethr_shutdown(uid2grp_fridge);
+}
+
+/**
+ * @brief Drop a reference to a lookup
+ *
+ * @note The caller must hold uid2grp_lookup_mtx.
+ *
+ * @return true if the caller must free the lookup.
+ */
+
+static inline bool uid2grp_lookup_put(struct uid2grp_lookup *lookup)
+{
+	return --lookup->refcount == 0;
+}
+
+static void uid2grp_lookup_free(struct uid2grp_lookup *lookup)
+{
+	if (lookup->gdata != NULL)
+		uid2grp_release_group_data(lookup->gdata);
+	PTHREAD_COND_destroy(&lookup->cv);
+	gsh_free(lookup);
+}
+
+/**
+ * @brief Look a user up and cache its group list
+ *
+ * The previous list of the user, if any, is replaced, or removed if
+ * the user is no longer known.
+ *
+ * @param[in] lookup The lookup
+ */
+
+static void uid2grp_lookup_do(struct uid2grp_lookup *lookup)
+{
+	struct group_data *gdata;
+	struct timespec start, end;
+	bool free_lookup;
+
+	now(&start);
+	if (lookup->name.addr != NULL)
+		gdata = uid2grp_allocate_by_name(&lookup->name);
+	else
+		gdata = uid2grp_allocate_by_uid(lookup->uid);
+	now(&end);
+
+	server_stats_uid2grp_lookup(timespec_diff(&start, &end),
+				    gdata != NULL, lookup->refresh);
+
+	uid2grp_wrlock();
+	if (gdata != NULL) {
+		/* Held for the waiters, even if it can't be cached */
+		uid2grp_hold_group_data(gdata);
+		if (uid2grp_add_user(gdata))
+			goto cached;
+	}
+	/* Don't leave an expired list nobody refreshes */
+	if (lookup->name.addr != NULL)
+		uid2grp_remove_by_uname(&lookup->name);
+	else
+		uid2grp_remove_by_uid(lookup->uid);
+ cached:
+	uid2grp_wrunlock();
+
+	PTHREAD_MUTEX_lock(&uid2grp_lookup_mtx);
+	glist_del(&lookup->list);
+	lookup->gdata = gdata;
+	lookup->done = true;
+	pthread_cond_broadcast(&lookup->cv);
+	free_lookup = uid2grp_lookup_put(lookup);
+	PTHREAD_MUTEX_unlock(&uid2grp_lookup_mtx);
+
+	if (free_lookup)
+		uid2grp_lookup_free(lookup);
+}
+
+/**
+ * @brief Run a lookup in a lookup thread
+ *
+ * @param[in] ctx Thread context, with the lookup
+ */
+
+static void uid2grp_lookup_run(struct fridgethr_context *ctx)
+{
+	uid2grp_lookup_do(ctx->arg);
+}
+
+/**
+ * @brief Find the lookup under way for a user
+ *
+ * @note The caller must hold uid2grp_lookup_mtx.
+ */
+
+static struct uid2grp_lookup *uid2grp_lookup_find(
+		const struct gsh_buffdesc *name, uid_t uid)
+{
+	struct glist_head *glist;
+	struct uid2grp_lookup *lookup;
+
+	glist_for_each(glist, &uid2grp_lookups) {
+		lookup = glist_entry(glist, struct uid2grp_lookup, list);
+		if (name == NULL) {
+			if (lookup->name.addr == NULL && lookup->uid == uid)
+				return lookup;
+		} else if (lookup->name.addr != NULL &&
+			   lookup->name.len == name->len &&
+			   memcmp(lookup->name.addr, name->addr,
+				  name->len) == 0) {
+			return lookup;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Look a user up, or join the lookup under way
+ *
+ * @param[in]  name  User name, NULL to look up by uid
+ * @param[in]  uid   User ID
+ * @param[out] gdata Group list found, held, NULL to only refresh
+ *                   the cache without waiting
+ *
+ * @return true if the user was found, or when only refreshing, if a
+ *         lookup is under way.
+ */
+
+static bool uid2grp_resolve(const struct gsh_buffdesc *name, uid_t uid,
+			    struct group_data **gdata)
+{
+	struct uid2grp_lookup *lookup;
+	size_t len = name != NULL ? name->len : 0;
+	bool success, free_lookup;
+
+	PTHREAD_MUTEX_lock(&uid2grp_lookup_mtx);
+
+	lookup = uid2grp_lookup_find(name, uid);
+	if (lookup != NULL) {
+		if (gdata == NULL) {
+			/* Already being refreshed */
+			PTHREAD_MUTEX_unlock(&uid2grp_lookup_mtx);
+			return true;
+		}
+		lookup->refcount++;
+		server_stats_uid2grp_coalesced();
+	} else {
+		lookup = gsh_calloc(1, sizeof(struct uid2grp_lookup) + len);
+		if (lookup == NULL) {
+			PTHREAD_MUTEX_unlock(&uid2grp_lookup_mtx);
+			LogEvent(COMPONENT_IDMAPPER, "memory alloc failed");
+			return false;
+		}
+		PTHREAD_COND_init(&lookup->cv, NULL);
+		lookup->uid = uid;
+		if (name != NULL) {
+			lookup->name.addr = (char *)lookup +
+					    sizeof(struct uid2grp_lookup);
+			lookup->name.len = len;
+			memcpy(lookup->name.addr, name->addr, len);
+		}
+		lookup->refresh = gdata == NULL;
+		lookup->refcount = gdata == NULL ? 1 : 2;
+		glist_add_tail(&uid2grp_lookups, &lookup->list);
+		PTHREAD_MUTEX_unlock(&uid2grp_lookup_mtx);
+
+		if (uid2grp_fridge == NULL ||
+		    fridgethr_submit(uid2grp_fridge, uid2grp_lookup_run,
+				     lookup) != 0)
+			uid2grp_lookup_do(lookup);
+
+		if (gdata == NULL)
+			return true;
+
+		PTHREAD_MUTEX_lock(&uid2grp_lookup_mtx);
+	}
+
+	while (!lookup->done)
+		pthread_cond_wait(&lookup->cv, &uid2grp_lookup_mtx);
+
+	success = lookup->gdata != NULL;
+	if (success) {
+		*gdata = lookup->gdata;
+		uid2grp_hold_group_data(*gdata);
+	}
+	free_lookup = uid2grp_lookup_put(lookup);
+
+	PTHREAD_MUTEX_unlock(&uid2grp_lookup_mtx);
+
+	if (free_lookup)
+		uid2grp_lookup_free(lookup);
+
+	return success;
+}
+
+#define uid2grp_expired(gdata) (time(NULL) - (gdata)->epoch > \
+		nfs_param.core_param.manage_gids_expiration)
+
+/**
+ * @brief Claim the refresh of an expired group list
+ *
+ * @param[in] gdata Group list found in the cache
+ *
+ * @return true if the caller must refresh it.
+ */
+
+static bool uid2grp_claim_refresh(struct group_data *gdata)
+{
+	bool claimed = false;
+
+	if (likely(!uid2grp_expired(gdata)))
+		return false;
+
+	PTHREAD_MUTEX_lock(&gdata->lock);
+	if (!gdata->refreshing) {
+		gdata->refreshing = true;
+		claimed = true;
+	}
+	PTHREAD_MUTEX_unlock(&gdata->lock);
+
+	return claimed;
+}
+
+/**
+ * @brief Give up the refresh of an expired group list
+ *
+ * Called when the lookup could not be started.  Nothing sleeps on
+ * the flag, the next caller finding the list expired claims the
+ * refresh again.
+ *
+ * @param[in] gdata Group list claimed by uid2grp_claim_refresh
+ */
+
+static void uid2grp_abandon_refresh(struct group_data *gdata)
+{
+	PTHREAD_MUTEX_lock(&gdata->lock);
+	gdata->refreshing = false;
+	PTHREAD_MUTEX_unlock(&gdata->lock);
+}
+
 /**
  * @brief Get supplementary groups given uname
  *
+ * An expired list is still returned while it is looked up again in
+ * the background.
+ *
  * @param[in]  name  The name of the user
  * @param[out]  group_data
  *
  * @return true if successful, false otherwise
  */
-#define uid2grp_expired(gdata) (time(NULL) - (gdata)->epoch > \
-		nfs_param.core_param.manage_gids_expiration)
 bool name2grp(const struct gsh_buffdesc *name, struct group_data **gdata)
 {
-	bool success = false;
+	bool success, refresh = false;
 	uid_t uid = -1;
 
-	PTHREAD_RWLOCK_rdlock(&uid2grp_user_lock);
+	uid2grp_rdlock();
 	success = uid2grp_lookup_by_uname(name, &uid, gdata);
-
-	/* Handle common case first */
-	if (success && !uid2grp_expired(*gdata)) {
+	if (success) {
 		uid2grp_hold_group_data(*gdata);
-		PTHREAD_RWLOCK_unlock(&uid2grp_user_lock);
-		return success;
+		refresh = uid2grp_claim_refresh(*gdata);
 	}
-	PTHREAD_RWLOCK_unlock(&uid2grp_user_lock);
+	uid2grp_rdunlock();
 
-	if (success) {
-		/* Cache entry is expired */
-		PTHREAD_RWLOCK_wrlock(&uid2grp_user_lock);
-		uid2grp_remove_by_uname(name);
-		PTHREAD_RWLOCK_unlock(&uid2grp_user_lock);
-	}
+	if (!success)
+		return uid2grp_resolve(name, uid, gdata);
 
-	*gdata = uid2grp_allocate_by_name(name);
-	PTHREAD_RWLOCK_wrlock(&uid2grp_user_lock);
-	if (*gdata)
-		uid2grp_add_user(*gdata);
-	success = uid2grp_lookup_by_uname(name, &uid, gdata);
-	if (success)
-		uid2grp_hold_group_data(*gdata);
-	PTHREAD_RWLOCK_unlock(&uid2grp_user_lock);
+	if (refresh && !uid2grp_resolve(name, uid, NULL))
+		uid2grp_abandon_refresh(*gdata);
 
-	return success;
+	return true;
 }
 
 /**
  * @brief Get supplementary groups given uid
  *
+ * An expired list is still returned while it is looked up again in
+ * the background.
+ *
  * @param[in]  uid  The uid of the user
  * @param[out]  group_data
  *
@@ -292,36 +606,23 @@ bool name2grp(const struct gsh_buffdesc *name, struct group_data **gdata)
  */
 bool uid2grp(uid_t uid, struct group_data **gdata)
 {
-	bool success = false;
+	bool success, refresh = false;
 
-	PTHREAD_RWLOCK_rdlock(&uid2grp_user_lock);
+	uid2grp_rdlock();
 	success = uid2grp_lookup_by_uid(uid, gdata);
-
-	/* Handle common case first */
-	if (success && !uid2grp_expired(*gdata)) {
+	if (success) {
 		uid2grp_hold_group_data(*gdata);
-		PTHREAD_RWLOCK_unlock(&uid2grp_user_lock);
-		return success;
+		refresh = uid2grp_claim_refresh(*gdata);
 	}
-	PTHREAD_RWLOCK_unlock(&uid2grp_user_lock);
+	uid2grp_rdunlock();
 
-	if (success) {
-		/* Cache entry is expired */
-		PTHREAD_RWLOCK_wrlock(&uid2grp_user_lock);
-		uid2grp_remove_by_uid(uid);
-		PTHREAD_RWLOCK_unlock(&uid2grp_user_lock);
-	}
+	if (!success)
+		return uid2grp_resolve(NULL, uid, gdata);
 
-	*gdata = uid2grp_allocate_by_uid(uid);
-	PTHREAD_RWLOCK_wrlock(&uid2grp_user_lock);
-	if (*gdata)
-		uid2grp_add_user(*gdata);
-	success = uid2grp_lookup_by_uid(uid, gdata);
-	if (success)
-		uid2grp_hold_group_data(*gdata);
-	PTHREAD_RWLOCK_unlock(&uid2grp_user_lock);
+	if (refresh && !uid2grp_resolve(NULL, uid, NULL))
+		uid2grp_abandon_refresh(*gdata);
 
-	return success;
+	return true;
 }
 
 /*
@@ -44,6 +44,7 @@
 #include "avltree.h"
 #include "uid2grp.h"
 #include "abstract_atomic.h"
+#include "sharded_rwlock.h"
 
 /**
  * @brief User entry in the IDMapper cache
@@ -64,19 +65,21 @@ struct cache_info {
 #define id_cache_size 1009
 
 /**
- * @brief UID cache, may only be accessed with uid2grp_user_lock
- * held.  If uid2grp_user_lock is held for read, it must be accessed
- * atomically.  (For a write, normal fetch/store is sufficient since
- * others are kept out.)
+ * @brief UID cache, may only be accessed with the cache locked.  If
+ * it is locked for read, it must be accessed atomically.  (For a
+ * write, normal fetch/store is sufficient since others are kept out.)
  */
 
 static struct avltree_node *uid_grplist_cache[id_cache_size];
 
 /**
- * @brief Lock that protects the idmapper user cache
+ * @brief Lock that protects the uid2grp cache
+ *
+ * Every AUTH_SYS request on an export with managed gids looks its
+ * user up, the lock is sharded so those readers don't contend.
  */
 
-pthread_rwlock_t uid2grp_user_lock = PTHREAD_RWLOCK_INITIALIZER;
+static struct sharded_rwlock uid2grp_user_lock;
 
 /**
  * @brief Tree of users, by name
@@ -184,11 +187,49 @@ void uid2grp_cache_init(void)
 	avltree_init(&uid_tree, uid_comparator, 0);
 	memset(uid_grplist_cache, 0,
 	       id_cache_size * sizeof(struct avltree_node *));
+
+	sharded_rwlock_init(&uid2grp_user_lock);
+}
+
+/**
+ * @brief Lock the cache for lookups
+ */
+
+void uid2grp_rdlock(void)
+{
+	sharded_rwlock_rdlock(&uid2grp_user_lock);
+}
+
+/**
+ * @brief Unlock the cache after lookups
+ */
+
+void uid2grp_rdunlock(void)
+{
+	sharded_rwlock_rdunlock(&uid2grp_user_lock);
+}
+
+/**
+ * @brief Lock the cache for changes
+ */
+
+void uid2grp_wrlock(void)
+{
+	sharded_rwlock_wrlock(&uid2grp_user_lock);
+}
+
+/**
+ * @brief Unlock the cache after changes
+ */
+
+void uid2grp_wrunlock(void)
+{
+	sharded_rwlock_wrunlock(&uid2grp_user_lock);
 }
 
 /* Remove given user/cache_info from the AVL trees
  *
- * @note The caller must hold uid2grp_user_lock for write.
+ * @note The caller must hold the cache locked for write.
  */
 static void uid2grp_remove_user(struct cache_info *info)
 {
@@ -205,7 +246,7 @@ static void uid2grp_remove_user(struct cache_info *info)
 /**
  * @brief Add a user entry to the cache
  *
- * @note The caller must hold uid2grp_user_lock for write.
+ * @note The caller must hold the cache locked for write.
  *
  * @param[in] group_data that has supplementary groups allocated
  *
@@ -343,7 +384,7 @@ static bool lookup_by_uid(const uid_t uid, struct cache_info **info)
 /**
  * @brief Look up a user by name
  *
- * @note The caller must hold uid2grp_user_lock for read.
+ * @note The caller must hold the cache locked for read.
  *
  * @param[in]  name The user name to look up.
  * @param[out] uid  The user ID found.  May be NULL if the caller
@@ -374,7 +415,7 @@ bool uid2grp_lookup_by_uname(const struct gsh_buffdesc *name, uid_t *uid,
 /**
  * @brief Look up a user by ID
  *
- * @note The caller must hold uid2grp_user_lock for read.
+ * @note The caller must hold the cache locked for read.
  *
  * @param[in]  uid  The user ID to look up.
  * @gdata[out] group_data containing supplementary groups.
@@ -423,7 +464,7 @@ void uid2grp_clear_cache(void)
 {
 	struct avltree_node *node;
 
-	PTHREAD_RWLOCK_wrlock(&uid2grp_user_lock);
+	uid2grp_wrlock();
 
 	while ((node = avltree_first(&uname_tree))) {
 		struct cache_info *info = avltree_container_of(node,
@@ -435,7 +476,7 @@ void uid2grp_clear_cache(void)
 
 	assert(avltree_first(&uid_tree) == NULL);
 
-	PTHREAD_RWLOCK_unlock(&uid2grp_user_lock);
+	uid2grp_wrunlock();
 }
 
 /** @} */
@@ -0,0 +1,328 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * @file test_9p_conn_bench.c
+ * @brief Load a 9P/TCP server with many idle and busy connections
+ *
+ * Opens the given number of idle connections, which never send
+ * anything, and of active ones, which send Tversion requests back to
+ * back for the given time.  All the active connections are driven
+ * from one epoll loop.  Reports the round trips per second and their
+ * mean latency, and, given the server pid, its thread count and
+ * resident size read from /proc.
+ *
+ * Usage: test_9p_conn_bench [-h host] [-p port] [-i idle] [-a active]
+ *                           [-s seconds] [-P server pid]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define BENCH_TVERSION 100
+#define BENCH_RVERSION 101
+#define BENCH_NOTAG 0xFFFF
+#define BENCH_MSIZE 8192
+#define BENCH_VERSION "9P2000.L"
+#define BENCH_EVENTS 256
+
+struct bench_conn {
+	int fd;
+	uint32_t readlen;		/*< Bytes of the reply received */
+	struct timespec sent;		/*< When the request was sent */
+	char reply[64];
+};
+
+static const char *host = "127.0.0.1";
+static const char *port = "564";
+static uint32_t nidle = 1000;
+static uint32_t nactive = 100;
+static uint32_t seconds = 10;
+static pid_t server_pid;
+
+static unsigned char tversion[64];
+static uint32_t tversion_len;
+
+static void bench_build_tversion(void)
+{
+	uint16_t vlen = strlen(BENCH_VERSION);
+	uint16_t tag = BENCH_NOTAG;
+	uint32_t msize = BENCH_MSIZE;
+	unsigned char *p = tversion + 4;
+
+	*p++ = BENCH_TVERSION;
+	memcpy(p, &tag, sizeof(tag));
+	p += sizeof(tag);
+	memcpy(p, &msize, sizeof(msize));
+	p += sizeof(msize);
+	memcpy(p, &vlen, sizeof(vlen));
+	p += sizeof(vlen);
+	memcpy(p, BENCH_VERSION, vlen);
+	p += vlen;
+
+	tversion_len = p - tversion;
+	memcpy(tversion, &tversion_len, sizeof(tversion_len));
+}
+
+static int bench_connect(struct addrinfo *ai)
+{
+	int one = 1;
+	int fd;
+
+	fd = socket(ai->ai_family, SOCK_STREAM, IPPROTO_TCP);
+	if (fd < 0)
+		return -1;
+
+	(void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	if (connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static int bench_send(struct bench_conn *conn)
+{
+	clock_gettime(CLOCK_MONOTONIC, &conn->sent);
+	conn->readlen = 0;
+
+	/* Small enough to always fit in the socket buffer */
+	if (send(conn->fd, tversion, tversion_len, 0) != tversion_len)
+		return -1;
+	return 0;
+}
+
+static double bench_elapsed(struct timespec *start, struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) +
+	       (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void bench_server_status(void)
+{
+	char path[64], line[256];
+	FILE *f;
+
+	if (server_pid == 0)
+		return;
+
+	snprintf(path, sizeof(path), "/proc/%d/status", (int)server_pid);
+	f = fopen(path, "r");
+	if (f == NULL) {
+		fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+		return;
+	}
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (strncmp(line, "Threads:", 8) == 0 ||
+		    strncmp(line, "VmRSS:", 6) == 0)
+			printf("server %s", line);
+	}
+
+	fclose(f);
+}
+
+int main(int argc, char **argv)
+{
+	struct addrinfo hints, *ai;
+	struct bench_conn *conns;
+	struct epoll_event ev, events[BENCH_EVENTS];
+	struct timespec start, now;
+	struct rlimit rl;
+	uint64_t ops = 0;
+	double latency = 0, elapsed;
+	uint32_t i, msglen;
+	ssize_t readlen;
+	int *idle;
+	int epfd, n, j, opt;
+
+	while ((opt = getopt(argc, argv, "h:p:i:a:s:P:")) != -1) {
+		switch (opt) {
+		case 'h':
+			host = optarg;
+			break;
+		case 'p':
+			port = optarg;
+			break;
+		case 'i':
+			nidle = atoi(optarg);
+			break;
+		case 'a':
+			nactive = atoi(optarg);
+			break;
+		case 's':
+			seconds = atoi(optarg);
+			break;
+		case 'P':
+			server_pid = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr,
+				"usage: %s [-h host] [-p port] [-i idle] [-a active] [-s seconds] [-P server pid]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	/* Room for all the sockets */
+	if (getrlimit(RLIMIT_NOFILE, &rl) == 0 &&
+	    rl.rlim_cur < nidle + nactive + 64) {
+		rl.rlim_cur = rl.rlim_max;
+		if (setrlimit(RLIMIT_NOFILE, &rl) != 0 ||
+		    rl.rlim_cur < nidle + nactive + 64)
+			fprintf(stderr, "warning: only %lu file descriptors\n",
+				(unsigned long)rl.rlim_cur);
+	}
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host, port, &hints, &ai) != 0) {
+		fprintf(stderr, "cannot resolve %s:%s\n", host, port);
+		return 1;
+	}
+
+	bench_build_tversion();
+
+	idle = calloc(nidle + 1, sizeof(*idle));
+	conns = calloc(nactive + 1, sizeof(*conns));
+	epfd = epoll_create1(0);
+	if (idle == NULL || conns == NULL || epfd < 0) {
+		fprintf(stderr, "setup failed\n");
+		return 1;
+	}
+
+	for (i = 0; i < nidle; i++) {
+		idle[i] = bench_connect(ai);
+		if (idle[i] < 0) {
+			fprintf(stderr, "idle connection %u failed: %s\n", i,
+				strerror(errno));
+			return 1;
+		}
+	}
+
+	printf("%u idle connections open\n", nidle);
+	bench_server_status();
+
+	for (i = 0; i < nactive; i++) {
+		conns[i].fd = bench_connect(ai);
+		if (conns[i].fd < 0) {
+			fprintf(stderr, "active connection %u failed: %s\n",
+				i, strerror(errno));
+			return 1;
+		}
+
+		ev.events = EPOLLIN;
+		ev.data.ptr = &conns[i];
+		if (epoll_ctl(epfd, EPOLL_CTL_ADD, conns[i].fd, &ev) != 0) {
+			perror("epoll_ctl");
+			return 1;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (i = 0; i < nactive; i++) {
+		if (bench_send(&conns[i]) != 0) {
+			perror("send");
+			return 1;
+		}
+	}
+
+	for (now = start; bench_elapsed(&start, &now) < seconds;) {
+		n = epoll_wait(epfd, events, BENCH_EVENTS, 1000);
+		if (n < 0 && errno != EINTR) {
+			perror("epoll_wait");
+			return 1;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+
+		for (j = 0; j < n; j++) {
+			struct bench_conn *conn = events[j].data.ptr;
+
+			readlen = recv(conn->fd, conn->reply + conn->readlen,
+				       sizeof(conn->reply) - conn->readlen,
+				       MSG_DONTWAIT);
+			if (readlen <= 0) {
+				if (readlen < 0 && errno == EAGAIN)
+					continue;
+				fprintf(stderr, "server closed connection\n");
+				return 1;
+			}
+
+			conn->readlen += readlen;
+			if (conn->readlen < 4)
+				continue;
+
+			memcpy(&msglen, conn->reply, sizeof(msglen));
+			if (msglen > sizeof(conn->reply)) {
+				fprintf(stderr, "reply too big: %u\n", msglen);
+				return 1;
+			}
+			if (conn->readlen < msglen)
+				continue;
+
+			if (conn->reply[4] != BENCH_RVERSION) {
+				fprintf(stderr, "unexpected reply type %u\n",
+					(unsigned char)conn->reply[4]);
+				return 1;
+			}
+
+			ops++;
+			latency += bench_elapsed(&conn->sent, &now);
+
+			if (bench_send(conn) != 0) {
+				perror("send");
+				return 1;
+			}
+		}
+	}
+
+	elapsed = bench_elapsed(&start, &now);
+
+	printf("%u idle %u active: %.0f round trips/s, %.1f us mean latency\n",
+	       nidle, nactive, ops / elapsed,
+	       ops ? latency / ops * 1e6 : 0.0);
+	bench_server_status();
+
+	for (i = 0; i < nactive; i++)
+		close(conns[i].fd);
+	for (i = 0; i < nidle; i++)
+		close(idle[i]);
+
+	close(epfd);
+	free(conns);
+	free(idle);
+	freeaddrinfo(ai);
+	return 0;
+}
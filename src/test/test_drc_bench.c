@@ -0,0 +1,305 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * @file test_drc_bench.c
+ * @brief Drive the shared duplicate request cache from many threads
+ *
+ * Each thread plays requests of random clients through
+ * nfs_dupreq_start, nfs_dupreq_finish and nfs_dupreq_rele the way the
+ * worker threads do.  For the given share of requests, a recent xid of
+ * the client is sent again, as a retransmission would be.
+ *
+ * Usage: test_drc_bench [-t threads] [-c clients] [-d dup%] [-p partitions]
+ *                       [-s seconds] [-e]
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include "nfs_core.h"
+#include "nfs_proto_functions.h"
+#include "nfs_dupreq.h"
+#include "abstract_atomic.h"
+
+#define BENCH_PROGRAM 100003
+#define BENCH_PROC 1
+#define BENCH_WINDOW 8
+
+/* Defined in MainNFSD, which the benchmark does not link */
+nfs_parameter_t nfs_param;
+pool_t *dupreq_pool;
+time_t ServerEpoch;
+char *config_path = GANESHA_CONFIG_PATH;
+
+static void bench_free_res(nfs_res_t *res)
+{
+}
+
+/* Only NFSv3 requests are played, the other tables are never looked at */
+const nfs_function_desc_t nfs3_func_desc[] = {
+	{
+	 .free_function = bench_free_res,
+	 .xdr_encode_func = (xdrproc_t) xdr_void,
+	 .funcname = "nfs3_null"},
+	{
+	 .free_function = bench_free_res,
+	 .xdr_encode_func = (xdrproc_t) xdr_void,
+	 .funcname = "nfs3_bench",
+	 .dispatch_behaviour = CAN_BE_DUP}
+};
+
+const nfs_function_desc_t nfs4_func_desc[1];
+const nfs_function_desc_t mnt1_func_desc[1];
+const nfs_function_desc_t mnt3_func_desc[1];
+const nfs_function_desc_t nlm4_func_desc[1];
+const nfs_function_desc_t rquota1_func_desc[1];
+const nfs_function_desc_t rquota2_func_desc[1];
+
+int nfs4_Compound(nfs_arg_t *arg, nfs_worker_data_t *worker,
+		  struct svc_req *req, nfs_res_t *res)
+{
+	return NFS_REQ_OK;
+}
+
+struct bench_client {
+	SVCXPRT *xprt;
+	struct sockaddr_in addr;
+	uint32_t xid;
+};
+
+static struct bench_client *clients;
+static uint32_t nclients = 64;
+static uint32_t nthreads = 4;
+static uint32_t dup_pct = 5;
+static uint32_t seconds = 5;
+static uint32_t stop;
+
+struct bench_thread {
+	pthread_t id;
+	uint64_t seed;
+	uint64_t ops;
+	uint64_t hits;
+};
+
+static inline uint64_t bench_random(uint64_t *seed)
+{
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 7;
+	*seed ^= *seed << 17;
+	return *seed;
+}
+
+/* Stands for the checksum TI-RPC computes over the call */
+static uint64_t bench_cksum(uint32_t client, uint32_t xid)
+{
+	uint64_t h = ((uint64_t)client << 32) | xid;
+
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return h;
+}
+
+static void bench_request(struct bench_thread *bt, uint32_t client,
+			  uint32_t xid)
+{
+	nfs_request_data_t reqnfs;
+	struct svc_req *req = &reqnfs.req;
+	dupreq_status_t status;
+
+	memset(req, 0, sizeof(*req));
+	memset(&reqnfs.lookahead, 0, sizeof(reqnfs.lookahead));
+	reqnfs.funcdesc = &nfs3_func_desc[BENCH_PROC];
+
+	req->rq_xprt = clients[client].xprt;
+	req->rq_xid = xid;
+	req->rq_cksum = bench_cksum(client, xid);
+	req->rq_prog = BENCH_PROGRAM;
+	req->rq_vers = NFS_V3;
+	req->rq_proc = BENCH_PROC;
+	req->rq_msg = alloc_rpc_msg();
+
+	status = nfs_dupreq_start(&reqnfs, req);
+	if (status == DUPREQ_SUCCESS)
+		(void)nfs_dupreq_finish(req, reqnfs.res_nfs);
+	else if (status == DUPREQ_EXISTS)
+		bt->hits++;
+
+	if (reqnfs.res_nfs || reqnfs.reply)
+		nfs_dupreq_rele(req, reqnfs.funcdesc);
+	else
+		(void)free_rpc_msg(req->rq_msg);
+
+	if (reqnfs.reply)
+		dupreq_reply_put(reqnfs.reply);
+}
+
+static void *bench_thread(void *arg)
+{
+	struct bench_thread *bt = arg;
+	uint32_t client, xid;
+	uint64_t r;
+
+	while (!atomic_fetch_uint32_t(&stop)) {
+		r = bench_random(&bt->seed);
+		client = (r >> 16) % nclients;
+
+		if ((r & 0xff) * 100 < dup_pct * 256) {
+			/* retransmit one of the last requests */
+			xid = atomic_fetch_uint32_t(&clients[client].xid) -
+			      ((r >> 8) & 0xff) % BENCH_WINDOW;
+		} else {
+			xid = atomic_inc_uint32_t(&clients[client].xid);
+		}
+
+		bench_request(bt, client, xid);
+		bt->ops++;
+	}
+
+	return NULL;
+}
+
+static void bench_clients(void)
+{
+	struct netbuf *nb;
+	uint32_t i;
+
+	clients = calloc(nclients, sizeof(*clients));
+	if (clients == NULL) {
+		fprintf(stderr, "allocation failed\n");
+		exit(1);
+	}
+
+	for (i = 0; i < nclients; i++) {
+		clients[i].addr.sin_family = AF_INET;
+		clients[i].addr.sin_addr.s_addr = htonl(0x0a000000 + i);
+		clients[i].addr.sin_port = htons(700 + i % 300);
+
+		clients[i].xprt = calloc(1, sizeof(SVCXPRT));
+		if (clients[i].xprt == NULL) {
+			fprintf(stderr, "allocation failed\n");
+			exit(1);
+		}
+		clients[i].xprt->xp_type = XPRT_UDP;
+		nb = svc_getcaller_netbuf(clients[i].xprt);
+		nb->buf = &clients[i].addr;
+		nb->len = sizeof(clients[i].addr);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	struct bench_thread *threads;
+	struct timespec start, end;
+	uint32_t npart = DRC_UDP_NPART;
+	uint64_t ops = 0, hits = 0;
+	bool encoded = false;
+	double elapsed;
+	uint32_t i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:c:d:p:s:e")) != -1) {
+		switch (opt) {
+		case 't':
+			nthreads = atoi(optarg);
+			break;
+		case 'c':
+			nclients = atoi(optarg);
+			break;
+		case 'd':
+			dup_pct = atoi(optarg);
+			break;
+		case 'p':
+			npart = atoi(optarg);
+			break;
+		case 's':
+			seconds = atoi(optarg);
+			break;
+		case 'e':
+			encoded = true;
+			break;
+		default:
+			fprintf(stderr,
+				"usage: %s [-t threads] [-c clients] [-d dup%%] [-p partitions] [-s seconds] [-e]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	if (nthreads == 0 || nclients == 0 || npart == 0 || dup_pct > 100) {
+		fprintf(stderr, "invalid arguments\n");
+		return 1;
+	}
+
+	nfs_param.core_param.program[P_NFS] = BENCH_PROGRAM;
+	nfs_param.core_param.drc.encoded_replies = encoded;
+	nfs_param.core_param.drc.udp.npart = npart;
+	nfs_param.core_param.drc.udp.size = DRC_UDP_SIZE;
+	nfs_param.core_param.drc.udp.cachesz = DRC_UDP_CACHESZ;
+	nfs_param.core_param.drc.udp.hiwat = DRC_UDP_HIWAT;
+	nfs_param.core_param.drc.tcp.recycle_npart = DRC_TCP_RECYCLE_NPART;
+	nfs_param.core_param.drc.tcp.recycle_expire_s =
+	    DRC_TCP_RECYCLE_EXPIRE_S;
+
+	dupreq2_pkginit();
+	bench_clients();
+
+	threads = calloc(nthreads, sizeof(*threads));
+	if (threads == NULL) {
+		fprintf(stderr, "allocation failed\n");
+		return 1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (i = 0; i < nthreads; i++) {
+		threads[i].seed = 0x9e3779b97f4a7c15ULL * (i + 1);
+		if (pthread_create(&threads[i].id, NULL, bench_thread,
+				   &threads[i]) != 0) {
+			fprintf(stderr, "pthread_create failed\n");
+			return 1;
+		}
+	}
+
+	sleep(seconds);
+	atomic_store_uint32_t(&stop, 1);
+
+	for (i = 0; i < nthreads; i++) {
+		pthread_join(threads[i].id, NULL);
+		ops += threads[i].ops;
+		hits += threads[i].hits;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	elapsed = (end.tv_sec - start.tv_sec) +
+		  (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	printf("%u threads %u clients %u partitions %u%% dups%s: ",
+	       nthreads, nclients, npart, dup_pct, encoded ? " encoded" : "");
+	printf("%.2f Mops/s, %.1f%% hits\n",
+	       ops / elapsed / 1e6, ops ? 100.0 * hits / ops : 0.0);
+
+	free(threads);
+	return 0;
+}
@@ -0,0 +1,251 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * @file test_hashtable_bench.c
+ * @brief Compare tree and chained hash tables under a mixed load
+ *
+ * Each thread picks random keys and either looks them up with
+ * hashtable_getref (taking a reference like the stateid lookup does)
+ * or, for the given share of operations, inserts or deletes them.
+ * Half of the keys are loaded beforehand.
+ *
+ * Usage: test_hashtable_bench [-t threads] [-k keys] [-w write%]
+ *                             [-s seconds]
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include "hashtable.h"
+#include "abstract_atomic.h"
+
+#define BENCH_PARTITIONS 17
+
+/* Defined in MainNFSD, which the benchmark does not link */
+time_t ServerEpoch;
+char *config_path = GANESHA_CONFIG_PATH;
+
+static uint64_t *keys;
+static uint64_t nkeys = 1000000;
+static uint32_t nthreads = 4;
+static uint32_t write_pct = 10;
+static uint32_t seconds = 5;
+static uint32_t stop;
+static uint64_t refs;
+
+struct bench_thread {
+	pthread_t id;
+	struct hash_table *ht;
+	uint64_t seed;
+	uint64_t ops;
+};
+
+static uint32_t bench_index(struct hash_param *hparam,
+			    struct gsh_buffdesc *key)
+{
+	return *(uint64_t *)key->addr % hparam->index_size;
+}
+
+static uint64_t bench_hash(struct hash_param *hparam,
+			   struct gsh_buffdesc *key)
+{
+	uint64_t h = *(uint64_t *)key->addr;
+
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return h;
+}
+
+static int bench_compare(struct gsh_buffdesc *k1, struct gsh_buffdesc *k2)
+{
+	return *(uint64_t *)k1->addr != *(uint64_t *)k2->addr;
+}
+
+static int bench_display(struct gsh_buffdesc *buff, char *str)
+{
+	return sprintf(str, "%" PRIu64, *(uint64_t *)buff->addr);
+}
+
+static void bench_get_ref(struct gsh_buffdesc *val)
+{
+	atomic_inc_uint64_t(&refs);
+}
+
+static inline uint64_t bench_random(uint64_t *seed)
+{
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 7;
+	*seed ^= *seed << 17;
+	return *seed;
+}
+
+static void bench_desc(uint64_t k, struct gsh_buffdesc *buff)
+{
+	buff->addr = &keys[k];
+	buff->len = sizeof(uint64_t);
+}
+
+static void *bench_thread(void *arg)
+{
+	struct bench_thread *bt = arg;
+	struct gsh_buffdesc key, val;
+	uint64_t r, k;
+
+	while (!atomic_fetch_uint32_t(&stop)) {
+		r = bench_random(&bt->seed);
+		k = (r >> 8) % nkeys;
+		bench_desc(k, &key);
+
+		if ((r & 0xff) * 100 < write_pct * 256) {
+			if (HashTable_Del(bt->ht, &key, NULL, NULL) ==
+			    HASHTABLE_ERROR_NO_SUCH_KEY) {
+				bench_desc(k, &val);
+				(void)HashTable_Set(bt->ht, &key, &val);
+			}
+		} else {
+			(void)hashtable_getref(bt->ht, &key, &val,
+					       bench_get_ref);
+		}
+		bt->ops++;
+	}
+
+	return NULL;
+}
+
+static int bench_free(struct gsh_buffdesc key, struct gsh_buffdesc val)
+{
+	return 1;
+}
+
+static void bench_run(const char *name, uint32_t flags)
+{
+	struct hash_param param = {
+		.flags = flags,
+		.index_size = BENCH_PARTITIONS,
+		.hash_func_key = bench_index,
+		.hash_func_rbt = bench_hash,
+		.compare_key = bench_compare,
+		.key_to_str = bench_display,
+		.val_to_str = bench_display,
+		.ht_name = (char *)name,
+		.ht_log_component = COMPONENT_HASHTABLE,
+	};
+	struct bench_thread *threads;
+	struct hash_table *ht;
+	struct gsh_buffdesc key, val;
+	struct timespec start, end;
+	uint64_t k, ops = 0;
+	double elapsed;
+	uint32_t i;
+
+	ht = hashtable_init(&param);
+	threads = calloc(nthreads, sizeof(*threads));
+	if (ht == NULL || threads == NULL) {
+		fprintf(stderr, "%s: allocation failed\n", name);
+		exit(1);
+	}
+
+	for (k = 0; k < nkeys; k += 2) {
+		bench_desc(k, &key);
+		bench_desc(k, &val);
+		(void)HashTable_Set(ht, &key, &val);
+	}
+
+	stop = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (i = 0; i < nthreads; i++) {
+		threads[i].ht = ht;
+		threads[i].seed = 0x9e3779b97f4a7c15ULL * (i + 1);
+		if (pthread_create(&threads[i].id, NULL, bench_thread,
+				   &threads[i]) != 0) {
+			fprintf(stderr, "%s: pthread_create failed\n", name);
+			exit(1);
+		}
+	}
+
+	sleep(seconds);
+	atomic_store_uint32_t(&stop, 1);
+
+	for (i = 0; i < nthreads; i++) {
+		pthread_join(threads[i].id, NULL);
+		ops += threads[i].ops;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	elapsed = (end.tv_sec - start.tv_sec) +
+		  (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	printf("%-8s %u threads %" PRIu64 " keys %u%% writes: %.2f Mops/s\n",
+	       name, nthreads, nkeys, write_pct, ops / elapsed / 1e6);
+
+	(void)hashtable_destroy(ht, bench_free);
+	free(threads);
+}
+
+int main(int argc, char **argv)
+{
+	uint64_t k;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:k:w:s:")) != -1) {
+		switch (opt) {
+		case 't':
+			nthreads = atoi(optarg);
+			break;
+		case 'k':
+			nkeys = strtoull(optarg, NULL, 10);
+			break;
+		case 'w':
+			write_pct = atoi(optarg);
+			break;
+		case 's':
+			seconds = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr,
+				"usage: %s [-t threads] [-k keys] [-w write%%] [-s seconds]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	if (nthreads == 0 || nkeys == 0 || write_pct > 100) {
+		fprintf(stderr, "invalid arguments\n");
+		return 1;
+	}
+
+	keys = malloc(nkeys * sizeof(*keys));
+	if (keys == NULL)
+		return 1;
+	for (k = 0; k < nkeys; k++)
+		keys[k] = k;
+
+	bench_run("rbtree", HT_FLAG_CACHE);
+	bench_run("chains", HT_FLAG_RESIZE);
+
+	free(keys);
+	return 0;
+}
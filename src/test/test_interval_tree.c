@@ -0,0 +1,331 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * @file test_interval_tree.c
+ * @brief Check the interval tree against a list of the same intervals
+ *
+ * Inserts and removes random intervals, some sharing a start, others
+ * in ascending and descending runs that rotate at every level.  After
+ * each change the whole tree is checked: order, parent links, AVL
+ * balance, heights, the largest end of every subtree and the count.
+ * Random overlap queries must then find exactly the intervals a walk
+ * of the list finds, in order of start.
+ *
+ * Exits non-zero on the first mismatch.
+ *
+ * Usage: test_interval_tree [-n intervals] [-o ops] [-s seed]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include "gsh_list.h"
+#include "interval_tree.h"
+
+struct test_interval {
+	struct glist_head list;
+	struct interval_node node;
+	uint64_t start;
+	uint64_t last;
+	bool seen;
+};
+
+static uint32_t nintervals = 2000;
+static uint32_t nops = 20000;
+static uint64_t seed = 88172645463325252ULL;
+
+static struct interval_tree tree;
+static struct glist_head intervals;
+static uint64_t count;
+
+#define check(cond, ...)						\
+	do {								\
+		if (!(cond)) {						\
+			fprintf(stderr, "%s:%d: ", __func__, __LINE__);	\
+			fprintf(stderr, __VA_ARGS__);			\
+			fprintf(stderr, "\n");				\
+			exit(1);					\
+		}							\
+	} while (0)
+
+static inline uint64_t test_random(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 7;
+	seed ^= seed << 17;
+	return seed;
+}
+
+/**
+ * @brief Check a subtree, return its node count
+ */
+
+static uint64_t check_subtree(struct interval_node *node,
+			      struct interval_node *parent,
+			      uint64_t min_start, uint64_t max_start,
+			      int32_t *height)
+{
+	int32_t hl, hr;
+	uint64_t max, n;
+
+	if (node == NULL) {
+		*height = 0;
+		return 0;
+	}
+
+	check(node->in_parent == parent, "bad parent of [%" PRIu64 ", %"
+	      PRIu64 "]", node->in_start, node->in_last);
+	check(node->in_start >= min_start && node->in_start <= max_start,
+	      "[%" PRIu64 ", %" PRIu64 "] out of order", node->in_start,
+	      node->in_last);
+	check(node->in_start <= node->in_last, "empty interval");
+
+	n = check_subtree(node->in_left, node, min_start, node->in_start,
+			  &hl);
+	n += check_subtree(node->in_right, node, node->in_start, max_start,
+			   &hr);
+
+	check(hl - hr <= 1 && hr - hl <= 1,
+	      "unbalanced at [%" PRIu64 ", %" PRIu64 "]: %d %d",
+	      node->in_start, node->in_last, hl, hr);
+	*height = (hl > hr ? hl : hr) + 1;
+	check(node->in_height == *height, "height %d, expected %d",
+	      node->in_height, *height);
+
+	max = node->in_last;
+	if (node->in_left != NULL && node->in_left->in_max > max)
+		max = node->in_left->in_max;
+	if (node->in_right != NULL && node->in_right->in_max > max)
+		max = node->in_right->in_max;
+	check(node->in_max == max,
+	      "max of [%" PRIu64 ", %" PRIu64 "] is %" PRIu64 ", expected %"
+	      PRIu64, node->in_start, node->in_last, node->in_max, max);
+
+	return n + 1;
+}
+
+static void check_tree(void)
+{
+	int32_t height;
+	uint64_t n;
+
+	n = check_subtree(tree.it_root, NULL, 0, UINT64_MAX, &height);
+	check(n == count, "%" PRIu64 " nodes, expected %" PRIu64, n, count);
+	check(tree.it_count == count, "count %" PRIu64 ", expected %" PRIu64,
+	      tree.it_count, count);
+}
+
+/**
+ * @brief Check that the tree and the list agree on a query
+ */
+
+static void check_query(uint64_t start, uint64_t last)
+{
+	struct test_interval *ti;
+	struct interval_node *node;
+	struct glist_head *glist;
+	uint64_t found = 0, expected = 0, prev = 0;
+
+	for (node = interval_tree_first(&tree, start, last); node != NULL;
+	     node = interval_tree_next(node, start, last)) {
+		ti = interval_entry(node, struct test_interval, node);
+		check(ti->start <= last && ti->last >= start,
+		      "[%" PRIu64 ", %" PRIu64 "] found for [%" PRIu64 ", %"
+		      PRIu64 "]", ti->start, ti->last, start, last);
+		check(!ti->seen, "[%" PRIu64 ", %" PRIu64 "] found twice",
+		      ti->start, ti->last);
+		check(ti->start >= prev, "found out of order");
+		prev = ti->start;
+		ti->seen = true;
+		found++;
+	}
+
+	glist_for_each(glist, &intervals) {
+		ti = glist_entry(glist, struct test_interval, list);
+		if (ti->start <= last && ti->last >= start) {
+			check(ti->seen, "[%" PRIu64 ", %" PRIu64
+			      "] missed for [%" PRIu64 ", %" PRIu64 "]",
+			      ti->start, ti->last, start, last);
+			expected++;
+		}
+		ti->seen = false;
+	}
+
+	check(found == expected, "%" PRIu64 " found, expected %" PRIu64,
+	      found, expected);
+}
+
+static void add(uint64_t start, uint64_t last)
+{
+	struct test_interval *ti = calloc(1, sizeof(*ti));
+
+	check(ti != NULL, "out of memory");
+	ti->start = start;
+	ti->last = last;
+	interval_node_init(&ti->node);
+	interval_tree_insert(&tree, &ti->node, start, last);
+	check(interval_node_linked(&ti->node), "not linked");
+	glist_add_tail(&intervals, &ti->list);
+	count++;
+}
+
+static void del(struct test_interval *ti)
+{
+	interval_tree_remove(&tree, &ti->node);
+	check(!interval_node_linked(&ti->node), "still linked");
+	glist_del(&ti->list);
+	free(ti);
+	count--;
+}
+
+/**
+ * @brief Remove the nth interval of the list
+ */
+
+static void del_nth(uint64_t n)
+{
+	struct glist_head *glist;
+
+	glist_for_each(glist, &intervals) {
+		if (n-- == 0) {
+			del(glist_entry(glist, struct test_interval, list));
+			return;
+		}
+	}
+}
+
+static void del_all(void)
+{
+	while (!glist_empty(&intervals))
+		del(glist_first_entry(&intervals, struct test_interval,
+				      list));
+	check_tree();
+	check(tree.it_root == NULL, "tree not empty");
+}
+
+/**
+ * @brief Runs of sorted starts rotate at every level
+ *
+ * The long interval inserted first must stay the largest end of every
+ * subtree it ends up in, whatever the rotations do.
+ */
+
+static void test_runs(void)
+{
+	uint64_t i;
+
+	add(0, 1000000);
+	for (i = 1; i <= 1000; i++) {
+		add(i * 10, i * 10 + 5);
+		check_tree();
+	}
+	check_query(5000, 5000);
+	check_query(1000001, 2000000);
+	check_query(10005, 10005);
+	del_all();
+
+	for (i = 1000; i > 0; i--) {
+		add(i * 10, i * 10 + (i % 7) * 100);
+		check_tree();
+	}
+	for (i = 0; i < 10050; i += 97)
+		check_query(i, i + 13);
+	/* Remove from the middle, then the ends */
+	while (count > 0) {
+		del_nth(count / 2);
+		check_tree();
+		if (count > 0) {
+			del_nth(0);
+			check_tree();
+		}
+		check_query(4000, 6000);
+	}
+}
+
+/**
+ * @brief Random inserts, removals and queries
+ */
+
+static void test_random_ops(void)
+{
+	uint64_t i, start, len;
+
+	for (i = 0; i < nops; i++) {
+		if (count < nintervals && (count == 0 ||
+					   test_random() % 3 != 0)) {
+			/* few distinct starts, so that many are shared */
+			start = test_random() % (nintervals * 4);
+			len = test_random() % 8 == 0 ?
+			      test_random() % (nintervals * 4) :
+			      test_random() % 16;
+			add(start, start + len);
+		} else {
+			del_nth(test_random() % count);
+		}
+		check_tree();
+
+		start = test_random() % (nintervals * 5);
+		len = test_random() % 64;
+		check_query(start, start + len);
+	}
+
+	check_query(0, UINT64_MAX);
+	del_all();
+}
+
+int main(int argc, char **argv)
+{
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:o:s:")) != -1) {
+		switch (opt) {
+		case 'n':
+			nintervals = strtoul(optarg, NULL, 0);
+			break;
+		case 'o':
+			nops = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			seed = strtoull(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr,
+				"Usage: %s [-n intervals] [-o ops] [-s seed]\n",
+				argv[0]);
+			return 2;
+		}
+	}
+
+	if (nintervals == 0 || seed == 0) {
+		fprintf(stderr, "intervals and seed must not be 0\n");
+		return 2;
+	}
+
+	interval_tree_init(&tree);
+	glist_init(&intervals);
+
+	test_runs();
+	test_random_ops();
+
+	printf("interval tree OK\n");
+	return 0;
+}
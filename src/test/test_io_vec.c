@@ -0,0 +1,531 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * @file test_io_vec.c
+ * @brief Check read_vec and write_vec against scalar reads and writes
+ *
+ * Random sets of ranges, with gaps between some of them and runs of
+ * contiguous ranges longer than one preadv takes, are moved three
+ * ways: by one vfs_read or vfs_write per range, stopping at the first
+ * short one, by the default read_vec and write_vec over those, and by
+ * vfs_read_vec and vfs_write_vec.  The vectored ones must report the
+ * same status, amounts done and end of file as the scalar calls, and
+ * move the same data.
+ *
+ * Reads run into the end of the file, in the middle of a range and
+ * on the boundary between two.  Writes are cut short by a file size
+ * limit in the middle of a range, or fail with EFBIG when they start
+ * beyond it.
+ *
+ * Exits non-zero on the first mismatch.
+ *
+ * Usage: test_io_vec [-r rounds] [-s seed] [-d directory]
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include "fsal.h"
+#include "nfs_core.h"
+#include "pnfs_utils.h"
+#include "FSAL/access_check.h"
+#include "../FSAL/fsal_private.h"
+#include "../FSAL/FSAL_VFS/vfs_methods.h"
+
+#define check(cond, ...)						\
+	do {								\
+		if (!(cond)) {						\
+			fprintf(stderr, "%s:%d: ", __func__, __LINE__);	\
+			fprintf(stderr, __VA_ARGS__);			\
+			fprintf(stderr, "\n");				\
+			exit(1);					\
+		}							\
+	} while (0)
+
+#define MAX_RANGES 200
+#define MAX_LENGTH 8192
+
+static uint32_t rounds = 200;
+static uint64_t seed = 88172645463325252ULL;
+static const char *dir = "/tmp";
+
+/**
+ * @brief How the ranges are moved
+ */
+
+enum io_way {
+	IO_SCALAR,		/*< One read or write per range */
+	IO_DEFAULT,		/*< The default read_vec and write_vec */
+	IO_VFS,			/*< vfs_read_vec and vfs_write_vec */
+	IO_WAYS
+};
+
+static const char *const io_way_name[IO_WAYS] = {
+	"scalar", "default", "vfs"
+};
+
+/**
+ * @brief A file, with the handle each way moves data through
+ */
+
+struct io_file {
+	char path[PATH_MAX];
+	struct vfs_fsal_obj_handle hdl;
+};
+
+/**
+ * @brief The outcome of moving a set of ranges one way
+ */
+
+struct io_result {
+	struct fsal_io_range ranges[MAX_RANGES];
+	fsal_status_t status;
+	bool eof;
+	bool stable;
+};
+
+static struct fsal_module test_fsal;
+static struct fsal_filesystem test_fs = { .fsal = &test_fsal };
+static struct io_file files[IO_WAYS];
+static struct io_result results[IO_WAYS];
+static char *buffers[IO_WAYS];
+static char *data;
+static uint32_t nranges;
+static struct fsal_io_range ranges[MAX_RANGES];
+
+/*
+ * Defined in MainNFSD, cache_inode and the rest of the FSAL layer,
+ * which the test does not link.  Only other default methods use them.
+ */
+time_t ServerEpoch;
+char *config_path = GANESHA_CONFIG_PATH;
+__thread struct req_op_context *op_ctx;
+verifier4 NFS4_write_verifier;
+uint32_t root_op_export_options;
+uint32_t root_op_export_set;
+size_t open_fd_count;
+pthread_mutex_t fsal_lock = PTHREAD_MUTEX_INITIALIZER;
+
+fsal_status_t fsal_test_access(struct fsal_obj_handle *obj_hdl,
+			       fsal_accessflags_t access_type,
+			       fsal_accessflags_t *allowed,
+			       fsal_accessflags_t *denied)
+{
+	return fsalstat(ERR_FSAL_NOTSUPP, 0);
+}
+
+struct fsal_pnfs_ds *pnfs_ds_alloc(void)
+{
+	return NULL;
+}
+
+int vfs_fsal_open(struct vfs_fsal_obj_handle *hdl, int openflags,
+		  fsal_errors_t *fsal_error)
+{
+	*fsal_error = ERR_FSAL_NOTSUPP;
+	return -1;
+}
+
+/* The files are open already, as whoever runs the test */
+void fsal_set_credentials(const struct user_cred *creds)
+{
+}
+
+void fsal_restore_ganesha_credentials(void)
+{
+}
+
+static inline uint64_t test_random(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 7;
+	seed ^= seed << 17;
+	return seed;
+}
+
+static void file_open(struct io_file *file, enum io_way way)
+{
+	struct fsal_obj_handle *obj = &file->hdl.obj_handle;
+	int fd;
+
+	snprintf(file->path, sizeof(file->path), "%s/test_io_vec.XXXXXX",
+		 dir);
+	fd = mkstemp(file->path);
+	check(fd >= 0, "mkstemp %s: %s", file->path, strerror(errno));
+
+	memset(&file->hdl, 0, sizeof(file->hdl));
+	file->hdl.u.file.fd = fd;
+	file->hdl.u.file.openflags = FSAL_O_RDWR;
+	obj->type = REGULAR_FILE;
+	obj->fsal = &test_fsal;
+	obj->fs = &test_fs;
+
+	/* The default vectored methods on top of the VFS scalar ones */
+	obj->obj_ops = def_handle_ops;
+	obj->obj_ops.read = vfs_read;
+	obj->obj_ops.write = vfs_write;
+	if (way == IO_VFS) {
+		obj->obj_ops.read_vec = vfs_read_vec;
+		obj->obj_ops.write_vec = vfs_write_vec;
+	}
+}
+
+static void file_close(struct io_file *file)
+{
+	close(file->hdl.u.file.fd);
+	unlink(file->path);
+}
+
+/**
+ * @brief Give a file the first size bytes of data
+ */
+
+static void file_fill(struct io_file *file, size_t size)
+{
+	int fd = file->hdl.u.file.fd;
+
+	check(ftruncate(fd, 0) == 0, "ftruncate: %s", strerror(errno));
+	check(pwrite(fd, data, size, 0) == size, "pwrite: %s",
+	      strerror(errno));
+	file->hdl.obj_handle.attributes.filesize = size;
+}
+
+/**
+ * @brief Make random ranges, in order, with or without gaps
+ *
+ * @return End of the last range.
+ */
+
+static uint64_t make_ranges(uint64_t offset, bool gaps)
+{
+	uint32_t i;
+
+	nranges = 1 + test_random() % MAX_RANGES;
+	for (i = 0; i < nranges; i++) {
+		if (gaps && test_random() % 4 == 0)
+			offset += 1 + test_random() % 3 * MAX_LENGTH;
+		ranges[i].offset = offset;
+		ranges[i].length = 1 + test_random() % MAX_LENGTH;
+		offset += ranges[i].length;
+	}
+
+	return offset;
+}
+
+/**
+ * @brief A point inside a range, or the start of one
+ */
+
+static uint64_t pick_point(bool boundary)
+{
+	struct fsal_io_range *range = &ranges[test_random() % nranges];
+
+	if (boundary || range->length < 2)
+		return range->offset;
+
+	return range->offset + 1 + test_random() % (range->length - 1);
+}
+
+/**
+ * @brief Set up the ranges of a way, over its own buffer
+ */
+
+static struct fsal_io_range *way_ranges(enum io_way way, bool write)
+{
+	struct fsal_io_range *r = results[way].ranges;
+	char *buffer = buffers[way];
+	uint32_t i;
+
+	for (i = 0; i < nranges; i++) {
+		r[i] = ranges[i];
+		r[i].done = SIZE_MAX;
+		r[i].buffer = buffer;
+		if (write)
+			memcpy(buffer, data + ranges[i].offset % MAX_LENGTH,
+			       ranges[i].length);
+		else
+			memset(buffer, 0xa5, ranges[i].length);
+		buffer += ranges[i].length;
+	}
+
+	return r;
+}
+
+static void read_ranges(enum io_way way)
+{
+	struct fsal_obj_handle *obj = &files[way].hdl.obj_handle;
+	struct io_result *res = &results[way];
+	struct fsal_io_range *r = way_ranges(way, false);
+	uint32_t i;
+
+	if (way != IO_SCALAR) {
+		res->status = obj->obj_ops.read_vec(obj, r, nranges,
+						    &res->eof);
+		return;
+	}
+
+	res->status = fsalstat(ERR_FSAL_NO_ERROR, 0);
+	res->eof = false;
+	for (i = 0; i < nranges; i++)
+		r[i].done = 0;
+
+	for (i = 0; i < nranges && !res->eof; i++) {
+		res->status = vfs_read(obj, r[i].offset, r[i].length,
+				       r[i].buffer, &r[i].done, &res->eof);
+		if (FSAL_IS_ERROR(res->status) || r[i].done < r[i].length)
+			break;
+	}
+}
+
+static void write_ranges(enum io_way way, bool stable)
+{
+	struct fsal_obj_handle *obj = &files[way].hdl.obj_handle;
+	struct io_result *res = &results[way];
+	struct fsal_io_range *r = way_ranges(way, true);
+	bool range_stable;
+	uint32_t i;
+
+	res->stable = stable;
+	if (way != IO_SCALAR) {
+		res->status = obj->obj_ops.write_vec(obj, r, nranges,
+						     &res->stable);
+		return;
+	}
+
+	res->status = fsalstat(ERR_FSAL_NO_ERROR, 0);
+	for (i = 0; i < nranges; i++)
+		r[i].done = 0;
+
+	for (i = 0; i < nranges; i++) {
+		range_stable = stable;
+		res->status = vfs_write(obj, r[i].offset, r[i].length,
+					r[i].buffer, &r[i].done,
+					&range_stable);
+		if (FSAL_IS_ERROR(res->status) || r[i].done < r[i].length)
+			break;
+	}
+}
+
+/**
+ * @brief Check that a way moved the ranges as the scalar calls did
+ */
+
+static void check_result(const char *desc, enum io_way way, bool write)
+{
+	struct io_result *ref = &results[IO_SCALAR];
+	struct io_result *res = &results[way];
+	uint32_t i;
+
+	check(res->status.major == ref->status.major &&
+	      res->status.minor == ref->status.minor,
+	      "%s %s: status %d/%d, expected %d/%d", desc, io_way_name[way],
+	      res->status.major, res->status.minor, ref->status.major,
+	      ref->status.minor);
+	if (!write)
+		check(res->eof == ref->eof, "%s %s: eof %d, expected %d", desc,
+		      io_way_name[way], res->eof, ref->eof);
+
+	for (i = 0; i < nranges; i++) {
+		check(res->ranges[i].done == ref->ranges[i].done,
+		      "%s %s: range %u of %u done %zu, expected %zu", desc,
+		      io_way_name[way], i, nranges, res->ranges[i].done,
+		      ref->ranges[i].done);
+		if (!write)
+			check(memcmp(res->ranges[i].buffer,
+				     ref->ranges[i].buffer,
+				     ref->ranges[i].done) == 0,
+			      "%s %s: range %u read wrong data", desc,
+			      io_way_name[way], i);
+	}
+}
+
+/**
+ * @brief Check that a file has the same content as the scalar one
+ */
+
+static void check_content(const char *desc, enum io_way way)
+{
+	struct stat ref_st, st;
+	char *ref_buf = buffers[IO_SCALAR], *buf = buffers[way];
+	int ref_fd = files[IO_SCALAR].hdl.u.file.fd;
+	int fd = files[way].hdl.u.file.fd;
+	off_t off;
+	ssize_t n;
+
+	check(fstat(ref_fd, &ref_st) == 0 && fstat(fd, &st) == 0, "fstat");
+	check(st.st_size == ref_st.st_size, "%s %s: size %jd, expected %jd",
+	      desc, io_way_name[way], (intmax_t) st.st_size,
+	      (intmax_t) ref_st.st_size);
+
+	for (off = 0; off < st.st_size; off += n) {
+		n = pread(ref_fd, ref_buf, MAX_LENGTH, off);
+		check(n > 0 && pread(fd, buf, n, off) == n, "pread: %s",
+		      strerror(errno));
+		check(memcmp(ref_buf, buf, n) == 0,
+		      "%s %s: content differs after %jd", desc,
+		      io_way_name[way], (intmax_t) off);
+	}
+}
+
+/**
+ * @brief Read ranges of a file of the given size all three ways
+ */
+
+static void test_read(const char *desc, size_t size)
+{
+	enum io_way way;
+
+	for (way = 0; way < IO_WAYS; way++) {
+		file_fill(&files[way], size);
+		read_ranges(way);
+	}
+
+	for (way = IO_DEFAULT; way < IO_WAYS; way++)
+		check_result(desc, way, false);
+}
+
+/**
+ * @brief Write ranges all three ways, with a file size limit if not 0
+ */
+
+static void test_write(const char *desc, rlim_t limit, bool stable)
+{
+	struct rlimit rl, cut;
+	enum io_way way;
+
+	for (way = 0; way < IO_WAYS; way++)
+		file_fill(&files[way], 0);
+
+	check(getrlimit(RLIMIT_FSIZE, &rl) == 0, "getrlimit");
+	if (limit != 0) {
+		cut = rl;
+		cut.rlim_cur = limit;
+		check(setrlimit(RLIMIT_FSIZE, &cut) == 0, "setrlimit: %s",
+		      strerror(errno));
+	}
+
+	for (way = 0; way < IO_WAYS; way++)
+		write_ranges(way, stable);
+
+	if (limit != 0)
+		check(setrlimit(RLIMIT_FSIZE, &rl) == 0, "setrlimit: %s",
+		      strerror(errno));
+
+	for (way = IO_DEFAULT; way < IO_WAYS; way++) {
+		check_result(desc, way, true);
+		check_content(desc, way);
+	}
+}
+
+static void test_reads(void)
+{
+	uint64_t end;
+
+	end = make_ranges(test_random() % MAX_LENGTH, true);
+	test_read("within the file", end + test_random() % MAX_LENGTH);
+
+	end = make_ranges(test_random() % MAX_LENGTH, test_random() % 2);
+	test_read("ending inside a range", pick_point(false));
+	test_read("ending between ranges", pick_point(true));
+	test_read("ending at the last range", end);
+	test_read("empty file", 0);
+}
+
+static void test_writes(void)
+{
+	make_ranges(test_random() % MAX_LENGTH, true);
+	test_write("unlimited", 0, false);
+	test_write("unlimited stable", 0, true);
+
+	make_ranges(test_random() % MAX_LENGTH, test_random() % 2);
+	test_write("limited inside a range", pick_point(false), false);
+
+	make_ranges(MAX_LENGTH + test_random() % MAX_LENGTH, true);
+	test_write("beyond the limit", 1 + test_random() % MAX_LENGTH,
+		   false);
+}
+
+int main(int argc, char **argv)
+{
+	struct req_op_context req_ctx;
+	enum io_way way;
+	uint32_t i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "r:s:d:")) != -1) {
+		switch (opt) {
+		case 'r':
+			rounds = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			seed = strtoull(optarg, NULL, 0);
+			break;
+		case 'd':
+			dir = optarg;
+			break;
+		default:
+			fprintf(stderr,
+				"Usage: %s [-r rounds] [-s seed] [-d directory]\n",
+				argv[0]);
+			return 2;
+		}
+	}
+
+	if (seed == 0) {
+		fprintf(stderr, "seed must not be 0\n");
+		return 2;
+	}
+
+	/* Writes past the file size limit are cut short, not killed */
+	signal(SIGXFSZ, SIG_IGN);
+
+	memset(&req_ctx, 0, sizeof(req_ctx));
+	op_ctx = &req_ctx;
+
+	/* Enough for the largest file and the ranges of a way */
+	data = malloc((MAX_RANGES * 4 + 1) * MAX_LENGTH);
+	check(data != NULL, "out of memory");
+	for (i = 0; i < (MAX_RANGES * 4 + 1) * MAX_LENGTH; i++)
+		data[i] = test_random();
+
+	for (way = 0; way < IO_WAYS; way++) {
+		buffers[way] = malloc(MAX_RANGES * MAX_LENGTH);
+		check(buffers[way] != NULL, "out of memory");
+		file_open(&files[way], way);
+	}
+
+	for (i = 0; i < rounds; i++) {
+		test_reads();
+		test_writes();
+	}
+
+	for (way = 0; way < IO_WAYS; way++)
+		file_close(&files[way]);
+
+	printf("vectored I/O OK\n");
+	return 0;
+}
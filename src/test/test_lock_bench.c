@@ -0,0 +1,230 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * @file test_lock_bench.c
+ * @brief Compare lock list and interval tree conflict checks
+ *
+ * Loads a file with many byte-range locks, as a database or MPI-IO
+ * job taking one lock per record would, then times a mix of conflict
+ * tests, locks and unlocks of random records.  Each test is done by
+ * walking a list of all the locks, the way the lock list used to be
+ * searched, and by querying an interval tree.
+ *
+ * Usage: test_lock_bench [-l locks] [-o ops] [-r record size]
+ *                        [-u unlock%]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <time.h>
+#include "gsh_list.h"
+#include "interval_tree.h"
+
+struct bench_lock {
+	struct glist_head list;
+	struct interval_node range;
+	uint64_t start;
+	uint64_t last;
+	uint32_t owner;
+	bool write;
+};
+
+static uint64_t nlocks = 50000;
+static uint64_t nops = 20000;
+static uint64_t record = 4096;
+static uint32_t unlock_pct = 20;
+
+static inline uint64_t bench_random(uint64_t *seed)
+{
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 7;
+	*seed ^= *seed << 17;
+	return *seed;
+}
+
+static bool conflicts(struct bench_lock *held, struct bench_lock *want)
+{
+	return (held->write || want->write) && held->owner != want->owner;
+}
+
+static struct bench_lock *list_test(struct glist_head *locks,
+				    struct bench_lock *want)
+{
+	struct glist_head *glist;
+	struct bench_lock *held;
+
+	glist_for_each(glist, locks) {
+		held = glist_entry(glist, struct bench_lock, list);
+		if (held->last >= want->start && held->start <= want->last &&
+		    conflicts(held, want))
+			return held;
+	}
+
+	return NULL;
+}
+
+static struct bench_lock *tree_test(struct interval_tree *tree,
+				    struct bench_lock *want)
+{
+	struct interval_node *node;
+	struct bench_lock *held;
+
+	for (node = interval_tree_first(tree, want->start, want->last);
+	     node != NULL;
+	     node = interval_tree_next(node, want->start, want->last)) {
+		held = interval_entry(node, struct bench_lock, range);
+		if (conflicts(held, want))
+			return held;
+	}
+
+	return NULL;
+}
+
+static double elapsed(struct timespec *start)
+{
+	struct timespec end;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (end.tv_sec - start->tv_sec) +
+	       (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/**
+ * @brief Run the workload against one index
+ *
+ * Slot i of locks holds the lock on record i when it is taken.  An
+ * operation picks a record: if it is locked, it is unlocked with the
+ * given probability, else another owner tests for a conflict; if it is
+ * free, it is tested and locked.
+ */
+
+static void bench_run(const char *name, bool use_tree,
+		      struct bench_lock *locks)
+{
+	struct glist_head list;
+	struct interval_tree tree;
+	struct bench_lock want;
+	struct bench_lock *found;
+	struct timespec start;
+	uint64_t seed = 0x9e3779b97f4a7c15ULL;
+	uint64_t i, r, conflicts_found = 0;
+	double secs;
+
+	glist_init(&list);
+	interval_tree_init(&tree);
+
+	for (i = 0; i < nlocks; i++) {
+		interval_node_init(&locks[i].range);
+		locks[i].start = i * record;
+		locks[i].last = locks[i].start + record - 1;
+		locks[i].owner = i % 64;
+		locks[i].write = true;
+		if (i % 2 == 0)
+			continue;
+		glist_add_tail(&list, &locks[i].list);
+		interval_tree_insert(&tree, &locks[i].range, locks[i].start,
+				     locks[i].last);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (i = 0; i < nops; i++) {
+		r = bench_random(&seed);
+		want = locks[(r >> 8) % nlocks];
+		want.owner = (r >> 40) % 64;
+
+		if (interval_node_linked(&locks[(r >> 8) % nlocks].range) &&
+		    (r & 0xff) * 100 < unlock_pct * 256) {
+			found = &locks[(r >> 8) % nlocks];
+			glist_del(&found->list);
+			interval_tree_remove(&tree, &found->range);
+			continue;
+		}
+
+		found = use_tree ? tree_test(&tree, &want)
+				 : list_test(&list, &want);
+		if (found != NULL) {
+			conflicts_found++;
+			continue;
+		}
+
+		found = &locks[(r >> 8) % nlocks];
+		if (interval_node_linked(&found->range)) {
+			/* Already held by this owner */
+			continue;
+		}
+		found->owner = want.owner;
+		glist_add_tail(&list, &found->list);
+		interval_tree_insert(&tree, &found->range, found->start,
+				     found->last);
+	}
+
+	secs = elapsed(&start);
+
+	printf("%-6s %" PRIu64 " locks: %.0f ops/s, %" PRIu64
+	       " conflicts, %" PRIu64 " locks held\n",
+	       name, nlocks, nops / secs, conflicts_found, tree.it_count);
+}
+
+int main(int argc, char **argv)
+{
+	struct bench_lock *locks;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "l:o:r:u:")) != -1) {
+		switch (opt) {
+		case 'l':
+			nlocks = strtoull(optarg, NULL, 10);
+			break;
+		case 'o':
+			nops = strtoull(optarg, NULL, 10);
+			break;
+		case 'r':
+			record = strtoull(optarg, NULL, 10);
+			break;
+		case 'u':
+			unlock_pct = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr,
+				"usage: %s [-l locks] [-o ops] [-r record size] [-u unlock%%]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	if (nlocks == 0 || record == 0 || unlock_pct > 100) {
+		fprintf(stderr, "invalid arguments\n");
+		return 1;
+	}
+
+	locks = calloc(nlocks, sizeof(*locks));
+	if (locks == NULL)
+		return 1;
+
+	bench_run("list", false, locks);
+	bench_run("tree", true, locks);
+
+	free(locks);
+	return 0;
+}
@@ -0,0 +1,540 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * @file test_readdir_lookup.c
+ * @brief Check that parallel readdir lookups fill the same entries
+ *
+ * Directories of a fake FSAL are read through cache_inode_readdir,
+ * first with the names looked up by readdir_plus, then again by the
+ * Readdir_Lookup threads at several depths.  The lookups sleep a
+ * little, so that they return out of order.  Some of the names are
+ * gone by the time they are looked up, some cross a junction, and in
+ * one directory the cache refuses an entry half way through, which
+ * stops the population.
+ *
+ * Every parallel read must return the same status, entries and
+ * cookies as the serial read of the same directory, and leave the
+ * same dirents behind.  No object found may be leaked.
+ *
+ * The rest of cache_inode is stood in for: entries are kept in a
+ * table indexed by the number of their name.
+ *
+ * Exits non-zero on the first mismatch.
+ *
+ * Usage: test_readdir_lookup [-n names] [-t threads]
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "fsal.h"
+#include "cache_inode.h"
+#include "cache_inode_avl.h"
+#include "cache_inode_lru.h"
+#include "abstract_atomic.h"
+
+#define check(cond, ...)						\
+	do {								\
+		if (!(cond)) {						\
+			fprintf(stderr, "%s:%d: ", __func__, __LINE__);	\
+			fprintf(stderr, __VA_ARGS__);			\
+			fprintf(stderr, "\n");				\
+			exit(1);					\
+		}							\
+	} while (0)
+
+/* Defined in MainNFSD and cache_inode_init.c, which are not linked */
+time_t ServerEpoch;
+char *config_path = GANESHA_CONFIG_PATH;
+struct cache_inode_parameter cache_param;
+
+static uint32_t nnames = 500;
+static uint32_t nthreads = 4;
+static pthread_t main_thread;
+
+/**
+ * @brief What becomes of a name when it is looked up
+ */
+
+enum test_fate {
+	FATE_FOUND,
+	FATE_GONE,		/*< Removed since readdir */
+	FATE_XDEV,		/*< A junction */
+};
+
+/**
+ * @brief A directory of the fake FSAL
+ */
+
+struct test_dir {
+	const char *desc;
+	struct fsal_obj_handle hdl;
+	enum test_fate (*fate)(uint32_t id);
+	uint32_t refuse_id;	/*< Refused by new_entry, or UINT32_MAX */
+};
+
+struct test_handle {
+	struct fsal_obj_handle obj;
+	uint32_t id;
+};
+
+/**
+ * @brief An entry returned by cache_inode_readdir
+ */
+
+struct test_result {
+	uint32_t id;
+	uint64_t cookie;
+	char name[16];
+};
+
+/**
+ * @brief One read of a directory
+ */
+
+struct test_read {
+	struct test_dir *dir;
+	cache_entry_t entry;
+	cache_inode_status_t status;
+	unsigned int nbfound;
+	bool eod;
+	struct test_result *results;
+	uint32_t nresults;
+};
+
+static struct test_read *reading;
+static cache_entry_t **entries;
+static uint32_t nentries;
+static uint64_t handles;
+static uint64_t threaded_lookups;
+
+static enum test_fate fate_found(uint32_t id)
+{
+	return FATE_FOUND;
+}
+
+static enum test_fate fate_mixed(uint32_t id)
+{
+	if (id % 5 == 1)
+		return FATE_GONE;
+	if (id % 11 == 2)
+		return FATE_XDEV;
+	return FATE_FOUND;
+}
+
+static void test_release(struct fsal_obj_handle *obj_hdl)
+{
+	free(container_of(obj_hdl, struct test_handle, obj));
+	atomic_dec_uint64_t(&handles);
+}
+
+static fsal_status_t test_lookup(struct fsal_obj_handle *dir_hdl,
+				 const char *path,
+				 struct fsal_obj_handle **handle)
+{
+	struct test_dir *dir = container_of(dir_hdl, struct test_dir, hdl);
+	uint32_t id = strtoul(path + 1, NULL, 10);
+	struct test_handle *th;
+
+	if (!pthread_equal(pthread_self(), main_thread))
+		atomic_inc_uint64_t(&threaded_lookups);
+
+	/* Up to 60us, so that lookups return out of order */
+	usleep((id * 2654435761U) >> 26);
+
+	switch (dir->fate(id)) {
+	case FATE_GONE:
+		return fsalstat(ERR_FSAL_NOENT, 0);
+	case FATE_XDEV:
+		return fsalstat(ERR_FSAL_XDEV, 0);
+	case FATE_FOUND:
+		break;
+	}
+
+	th = calloc(1, sizeof(*th));
+	check(th != NULL, "out of memory");
+	th->id = id;
+	th->obj.type = id % 7 == 0 ? DIRECTORY : REGULAR_FILE;
+	th->obj.obj_ops.release = test_release;
+	atomic_inc_uint64_t(&handles);
+
+	*handle = &th->obj;
+	return fsalstat(ERR_FSAL_NO_ERROR, 0);
+}
+
+static fsal_status_t test_readdir(struct fsal_obj_handle *dir_hdl,
+				  fsal_cookie_t *whence, void *dir_state,
+				  fsal_readdir_cb cb, bool *eof)
+{
+	char name[16];
+	uint32_t id;
+
+	*eof = false;
+	for (id = 0; id < nnames; id++) {
+		snprintf(name, sizeof(name), "f%u", id);
+		if (!cb(name, dir_state, id + 3))
+			return fsalstat(ERR_FSAL_NO_ERROR, 0);
+	}
+	*eof = true;
+
+	return fsalstat(ERR_FSAL_NO_ERROR, 0);
+}
+
+static fsal_status_t test_readdir_plus(struct fsal_obj_handle *dir_hdl,
+				       fsal_cookie_t *whence, void *dir_state,
+				       fsal_readdir_plus_cb cb, bool *eof)
+{
+	struct fsal_obj_handle *hdl;
+	fsal_status_t status;
+	char name[16];
+	uint32_t id;
+
+	*eof = false;
+	for (id = 0; id < nnames; id++) {
+		snprintf(name, sizeof(name), "f%u", id);
+		hdl = NULL;
+		status = test_lookup(dir_hdl, name, &hdl);
+		if (!cb(name, hdl, status, dir_state, id + 3))
+			return fsalstat(ERR_FSAL_NO_ERROR, 0);
+	}
+	*eof = true;
+
+	return fsalstat(ERR_FSAL_NO_ERROR, 0);
+}
+
+/*
+ * The parts of cache_inode readdir calls out to
+ */
+
+cache_inode_status_t cache_inode_new_entry(struct fsal_obj_handle *new_obj,
+					   uint32_t flags,
+					   cache_entry_t **entry)
+{
+	struct test_handle *th =
+		container_of(new_obj, struct test_handle, obj);
+	uint32_t id = th->id;
+	cache_entry_t *new_entry;
+
+	*entry = NULL;
+	if (id == reading->dir->refuse_id) {
+		new_obj->obj_ops.release(new_obj);
+		return CACHE_INODE_FSAL_ERROR;
+	}
+
+	if (entries[id] != NULL) {
+		new_obj->obj_ops.release(new_obj);
+		*entry = entries[id];
+		return CACHE_INODE_SUCCESS;
+	}
+
+	new_entry = calloc(1, sizeof(*new_entry));
+	check(new_entry != NULL, "out of memory");
+	PTHREAD_RWLOCK_init(&new_entry->attr_lock, NULL);
+	PTHREAD_RWLOCK_init(&new_entry->content_lock, NULL);
+	new_entry->obj_handle = new_obj;
+	new_entry->type = new_obj->type;
+	new_entry->fh_hk.key.hk = id;
+	new_entry->fh_hk.key.kv.addr = &th->id;
+	new_entry->fh_hk.key.kv.len = sizeof(th->id);
+
+	entries[id] = new_entry;
+	nentries++;
+	*entry = new_entry;
+	return CACHE_INODE_SUCCESS;
+}
+
+cache_entry_t *cache_inode_get_keyed(cache_inode_key_t *key,
+				     uint32_t flags,
+				     cache_inode_status_t *status)
+{
+	uint32_t id;
+
+	check(key->kv.len == sizeof(id), "bad key length %zu", key->kv.len);
+	memcpy(&id, key->kv.addr, sizeof(id));
+	check(id < nnames && entries[id] != NULL, "no entry %u", id);
+
+	*status = CACHE_INODE_SUCCESS;
+	return entries[id];
+}
+
+void cache_inode_lru_unref(cache_entry_t *entry, uint32_t flags)
+{
+}
+
+cache_inode_status_t cache_inode_getattr(cache_entry_t *entry,
+					 void *opaque,
+					 cache_inode_getattr_cb_t cb,
+					 enum cb_state cb_state)
+{
+	struct cache_inode_readdir_cb_parms *cb_parms = opaque;
+	struct test_result *result;
+
+	check(reading->nresults < nnames, "too many entries");
+	result = &reading->results[reading->nresults++];
+	memcpy(&result->id, entry->fh_hk.key.kv.addr, sizeof(result->id));
+	result->cookie = cb_parms->cookie;
+	snprintf(result->name, sizeof(result->name), "%s", cb_parms->name);
+
+	return CACHE_INODE_SUCCESS;
+}
+
+cache_inode_status_t cache_inode_access_sw(cache_entry_t *entry,
+					   fsal_accessflags_t access_type,
+					   fsal_accessflags_t *allowed,
+					   fsal_accessflags_t *denied,
+					   bool use_mutex)
+{
+	return CACHE_INODE_SUCCESS;
+}
+
+cache_inode_status_t cache_inode_lock_trust_attrs(cache_entry_t *entry,
+						  bool need_wr_lock)
+{
+	if (need_wr_lock)
+		PTHREAD_RWLOCK_wrlock(&entry->attr_lock);
+	else
+		PTHREAD_RWLOCK_rdlock(&entry->attr_lock);
+
+	return CACHE_INODE_SUCCESS;
+}
+
+cache_inode_status_t cache_inode_invalidate(cache_entry_t *entry,
+					    uint32_t flags)
+{
+	return CACHE_INODE_SUCCESS;
+}
+
+void cache_inode_kill_entry(cache_entry_t *entry)
+{
+}
+
+/* The directories read are new, there is nothing to release */
+void cache_inode_release_dirents(cache_entry_t *entry,
+				 cache_inode_avl_which_t which)
+{
+	check(entry->object.dir.nbactive == 0, "directory already read");
+}
+
+cache_inode_status_t cache_inode_error_convert(fsal_status_t fsal_status)
+{
+	switch (fsal_status.major) {
+	case ERR_FSAL_NO_ERROR:
+		return CACHE_INODE_SUCCESS;
+	case ERR_FSAL_NOENT:
+		return CACHE_INODE_NOT_FOUND;
+	case ERR_FSAL_XDEV:
+		return CACHE_INODE_FSAL_XDEV;
+	default:
+		return CACHE_INODE_FSAL_ERROR;
+	}
+}
+
+const char *cache_inode_err_str(cache_inode_status_t err)
+{
+	static __thread char buf[16];
+
+	snprintf(buf, sizeof(buf), "status %d", err);
+	return buf;
+}
+
+/**
+ * @brief Read a whole directory through cache_inode_readdir
+ */
+
+static void read_dir(struct test_read *rd, struct test_dir *dir)
+{
+	memset(rd, 0, sizeof(*rd));
+	rd->dir = dir;
+	rd->results = calloc(nnames, sizeof(struct test_result));
+	check(rd->results != NULL, "out of memory");
+
+	PTHREAD_RWLOCK_init(&rd->entry.attr_lock, NULL);
+	PTHREAD_RWLOCK_init(&rd->entry.content_lock, NULL);
+	rd->entry.type = DIRECTORY;
+	rd->entry.obj_handle = &dir->hdl;
+	/* Copied into the subdirectories as their parent */
+	rd->entry.fh_hk.key.kv.addr = (void *)dir->desc;
+	rd->entry.fh_hk.key.kv.len = strlen(dir->desc);
+	cache_inode_avl_init(&rd->entry);
+
+	reading = rd;
+	rd->status = cache_inode_readdir(&rd->entry, 0, &rd->nbfound,
+					 &rd->eod, 0, NULL, NULL);
+	reading = NULL;
+}
+
+/**
+ * @brief Check a parallel read against the serial one
+ */
+
+static void check_read(struct test_read *serial, struct test_read *parallel)
+{
+	struct avltree_node *ns, *np;
+	cache_inode_dir_entry_t *ds, *dp;
+	uint32_t i;
+
+	check(parallel->status == serial->status, "%s: status %d, expected %d",
+	      serial->dir->desc, parallel->status, serial->status);
+	check(parallel->eod == serial->eod, "%s: eod %d, expected %d",
+	      serial->dir->desc, parallel->eod, serial->eod);
+	check(parallel->nbfound == serial->nbfound,
+	      "%s: %u found, expected %u", serial->dir->desc,
+	      parallel->nbfound, serial->nbfound);
+	check(parallel->nresults == serial->nresults,
+	      "%s: %u returned, expected %u", serial->dir->desc,
+	      parallel->nresults, serial->nresults);
+
+	for (i = 0; i < serial->nresults; i++) {
+		check(parallel->results[i].id == serial->results[i].id &&
+		      parallel->results[i].cookie ==
+		      serial->results[i].cookie &&
+		      strcmp(parallel->results[i].name,
+			     serial->results[i].name) == 0,
+		      "%s: entry %u is %s, expected %s", serial->dir->desc, i,
+		      parallel->results[i].name, serial->results[i].name);
+	}
+
+	check(parallel->entry.object.dir.nbactive ==
+	      serial->entry.object.dir.nbactive,
+	      "%s: %u dirents, expected %u", serial->dir->desc,
+	      parallel->entry.object.dir.nbactive,
+	      serial->entry.object.dir.nbactive);
+	check((parallel->entry.flags & CACHE_INODE_DIR_POPULATED) ==
+	      (serial->entry.flags & CACHE_INODE_DIR_POPULATED),
+	      "%s: populated differs", serial->dir->desc);
+
+	ns = avltree_first(&serial->entry.object.dir.avl.t);
+	np = avltree_first(&parallel->entry.object.dir.avl.t);
+	while (ns != NULL && np != NULL) {
+		ds = avltree_container_of(ns, cache_inode_dir_entry_t, node_hk);
+		dp = avltree_container_of(np, cache_inode_dir_entry_t, node_hk);
+		check(strcmp(ds->name, dp->name) == 0 &&
+		      ds->hk.k == dp->hk.k && ds->flags == dp->flags &&
+		      ds->ckey.kv.len == dp->ckey.kv.len &&
+		      memcmp(ds->ckey.kv.addr, dp->ckey.kv.addr,
+			     ds->ckey.kv.len) == 0,
+		      "%s: dirent %s, expected %s", serial->dir->desc,
+		      dp->name, ds->name);
+		ns = avltree_next(ns);
+		np = avltree_next(np);
+	}
+	check(ns == NULL && np == NULL, "%s: dirents differ",
+	      serial->dir->desc);
+}
+
+static void check_handles(void)
+{
+	check(atomic_fetch_uint64_t(&handles) == nentries,
+	      "%" PRIu64 " objects held, %u entries",
+	      atomic_fetch_uint64_t(&handles), nentries);
+}
+
+int main(int argc, char **argv)
+{
+	static const uint32_t depths[] = { 1, 3, 8, 64 };
+	struct test_dir dirs[] = {
+		{ .desc = "found", .fate = fate_found },
+		{ .desc = "mixed", .fate = fate_mixed },
+		{ .desc = "refused", .fate = fate_mixed },
+	};
+	const uint32_t ndirs = sizeof(dirs) / sizeof(dirs[0]);
+	const uint32_t ndepths = sizeof(depths) / sizeof(depths[0]);
+	struct req_op_context req_ctx;
+	struct test_read *serial, parallel;
+	uint32_t i, j;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:t:")) != -1) {
+		switch (opt) {
+		case 'n':
+			nnames = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			nthreads = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-n names] [-t threads]\n",
+				argv[0]);
+			return 2;
+		}
+	}
+
+	if (nnames < 2 || nthreads == 0) {
+		fprintf(stderr, "at least 2 names and 1 thread\n");
+		return 2;
+	}
+
+	init_logging("STDERR", -1);
+	main_thread = pthread_self();
+	memset(&req_ctx, 0, sizeof(req_ctx));
+	op_ctx = &req_ctx;
+
+	entries = calloc(nnames, sizeof(cache_entry_t *));
+	serial = calloc(ndirs, sizeof(struct test_read));
+	check(entries != NULL && serial != NULL, "out of memory");
+
+	for (i = 0; i < ndirs; i++) {
+		dirs[i].hdl.type = DIRECTORY;
+		dirs[i].hdl.obj_ops.lookup = test_lookup;
+		dirs[i].hdl.obj_ops.readdir = test_readdir;
+		dirs[i].hdl.obj_ops.readdir_plus = test_readdir_plus;
+		dirs[i].refuse_id = UINT32_MAX;
+	}
+	dirs[2].refuse_id = nnames / 2;
+
+	/* Without threads, the names come from readdir_plus */
+	check(cache_inode_readdir_pkginit() == 0, "pkginit without threads");
+	for (i = 0; i < ndirs; i++) {
+		read_dir(&serial[i], &dirs[i]);
+		check(threaded_lookups == 0, "%s: lookups in threads",
+		      dirs[i].desc);
+		check_handles();
+	}
+	check(serial[0].status == CACHE_INODE_SUCCESS && serial[0].eod &&
+	      serial[0].nresults == nnames, "serial read incomplete");
+	check(serial[2].status != CACHE_INODE_SUCCESS,
+	      "refused entry not reported");
+
+	cache_param.readdir_lookup_threads = nthreads;
+	check(cache_inode_readdir_pkginit() == 0, "pkginit");
+
+	for (j = 0; j < ndepths; j++) {
+		cache_param.readdir_lookup_depth = depths[j];
+		for (i = 0; i < ndirs; i++) {
+			threaded_lookups = 0;
+			read_dir(&parallel, &dirs[i]);
+			check(threaded_lookups != 0,
+			      "%s: no lookups in threads", dirs[i].desc);
+			check_read(&serial[i], &parallel);
+			check_handles();
+			free(parallel.results);
+			/* dirents are left to the exit */
+		}
+	}
+
+	check(cache_inode_readdir_pkgshutdown() == 0, "pkgshutdown");
+
+	printf("readdir lookup OK\n");
+	return 0;
+}